@@ -63,19 +63,227 @@
 #endif /* __has_include */
 
 /* == Default configuration == */
+#ifdef DYSL_BENCH
+// the benchmarks bring their own `main`
+#undef DYSL_CLI
+#define DYSL_STDLIB 1
+#define DYSL_IMPLEMENTATION 1
+#endif /* DYSL_BENCH */
 #ifdef DYSL_CLI
 #define DYSL_STDLIB 1
 #define DYSL_IMPLEMENTATION 1
 #define DYSL_STDIO 1
+#ifndef DYSL_HASH_SEED_FN
+#define DYSL_HASH_SEED_FN cli_random_seed
+#endif /* DYSL_HASH_SEED_FN */
 #endif /* DYSL_CLI */
 #ifndef DYSL_STDLIB
 #define DYSL_STDLIB 0
 #endif /* DYSL_STDLIB */
+#ifndef DYSL_STDIO
+#define DYSL_STDIO 0
+#endif /* DYSL_STDIO */
+/* Initial size of the value stack, in values. */
+#ifndef DYSL_STACK_SIZE
+#define DYSL_STACK_SIZE 1024
+#endif /* DYSL_STACK_SIZE */
+/* Initial size of the value stack of states made with `dysl_new_thread()`,
+ * in values. Unused if the stack is fixed. */
+#ifndef DYSL_THREAD_STACK_SIZE
+#define DYSL_THREAD_STACK_SIZE 64
+#endif /* DYSL_THREAD_STACK_SIZE */
+/* Size the value stack may grow to, in values. */
+#ifndef DYSL_STACK_MAX_SIZE
+#define DYSL_STACK_MAX_SIZE (1024 * 1024)
+#endif /* DYSL_STACK_MAX_SIZE */
+/* Allocate the value stack once, with DYSL_STACK_SIZE values, and never
+ * reallocate it. For targets that can't afford to move it. */
+#ifndef DYSL_STACK_FIXED
+#define DYSL_STACK_FIXED 0
+#endif /* DYSL_STACK_FIXED */
+/* Free values made available on the stack before a native call. */
+#ifndef DYSL_STACK_NATIVE_MIN
+#define DYSL_STACK_NATIVE_MIN 32
+#endif /* DYSL_STACK_NATIVE_MIN */
+/* Maximum depth of nested word calls. */
+#ifndef DYSL_MAX_CALL_DEPTH
+#define DYSL_MAX_CALL_DEPTH 4096
+#endif /* DYSL_MAX_CALL_DEPTH */
+/* Size of the buffer holding the last error message. */
+#ifndef DYSL_ERROR_MESSAGE_SIZE
+#define DYSL_ERROR_MESSAGE_SIZE 256
+#endif /* DYSL_ERROR_MESSAGE_SIZE */
+/* Use computed gotos ("labels as values") to thread the interpreter's
+ * dispatch loop. Falls back to a `switch` when unsupported. */
+#ifndef DYSL_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define DYSL_COMPUTED_GOTO 1
+#else /* defined(__GNUC__) || defined(__clang__) */
+#define DYSL_COMPUTED_GOTO 0
+#endif /* defined(__GNUC__) || defined(__clang__) */
+#endif /* DYSL_COMPUTED_GOTO */
+/* Pack values into 64 bits, storing everything but reals in the payload of
+ * NaNs. Halves the size of values, which are otherwise 16 bytes. */
+#ifndef DYSL_NAN_BOXING
+#define DYSL_NAN_BOXING 0
+#endif /* DYSL_NAN_BOXING */
+/* Bytes allocated between minor (young generation) collections. */
+#ifndef DYSL_GC_MINOR_BYTES
+#define DYSL_GC_MINOR_BYTES (512 * 1024)
+#endif /* DYSL_GC_MINOR_BYTES */
+/* A major collection starts once the old generation grows to this
+ * percentage of its size after the previous major collection. */
+#ifndef DYSL_GC_MAJOR_PERCENT
+#define DYSL_GC_MAJOR_PERCENT 200
+#endif /* DYSL_GC_MAJOR_PERCENT */
+/* Old generation size below which major collections never start. */
+#ifndef DYSL_GC_MAJOR_MIN_BYTES
+#define DYSL_GC_MAJOR_MIN_BYTES (4 * 1024 * 1024)
+#endif /* DYSL_GC_MAJOR_MIN_BYTES */
+/* Work done by each automatic collection step, roughly in objects scanned
+ * or freed. Bounds the pause of a step. */
+#ifndef DYSL_GC_STEP_BUDGET
+#define DYSL_GC_STEP_BUDGET 1024
+#endif /* DYSL_GC_STEP_BUDGET */
+/* Bytes allocated between automatic steps while a cycle is running. */
+#ifndef DYSL_GC_STEP_BYTES
+#define DYSL_GC_STEP_BYTES (8 * 1024)
+#endif /* DYSL_GC_STEP_BYTES */
+/* Allocate small objects from size-class slabs, carved from large chunks,
+ * instead of calling the allocator function once per object. */
+#ifndef DYSL_SLAB_ALLOCATOR
+#define DYSL_SLAB_ALLOCATOR 1
+#endif /* DYSL_SLAB_ALLOCATOR */
+/* Largest object size, in bytes, served by the slabs. */
+#ifndef DYSL_SLAB_MAX_SIZE
+#define DYSL_SLAB_MAX_SIZE 256
+#endif /* DYSL_SLAB_MAX_SIZE */
+/* Size of the chunks the slabs request from the allocator function. */
+#ifndef DYSL_SLAB_CHUNK_SIZE
+#define DYSL_SLAB_CHUNK_SIZE (64 * 1024)
+#endif /* DYSL_SLAB_CHUNK_SIZE */
+/* Default chunk size of contexts created with `dysl_new_arena()`. */
+#ifndef DYSL_ARENA_CHUNK_SIZE
+#define DYSL_ARENA_CHUNK_SIZE (64 * 1024)
+#endif /* DYSL_ARENA_CHUNK_SIZE */
+/* Hash strings with the small, unseeded FNV-1a instead of the default
+ * seeded wyhash. Smaller code, but slower on long strings and open to hash
+ * flooding by untrusted scripts. */
+#ifndef DYSL_HASH_FNV1A
+#define DYSL_HASH_FNV1A 0
+#endif /* DYSL_HASH_FNV1A */
+/* Let the host run the collector's sweep on other threads, see
+ * `dysl_set_sweeper()`. Needs GCC or Clang atomics. */
+#ifndef DYSL_BACKGROUND_SWEEP
+#define DYSL_BACKGROUND_SWEEP 0
+#endif /* DYSL_BACKGROUND_SWEEP */
+/* Let contexts intern their symbols into a table shared with other
+ * contexts, on any thread, see `dysl_new_symbol_table()`. Needs GCC or
+ * Clang atomics. */
+#ifndef DYSL_SHARED_SYMBOLS
+#define DYSL_SHARED_SYMBOLS 0
+#endif /* DYSL_SHARED_SYMBOLS */
+/* Entropy mixed into each context's hash seed, along with the addresses of
+ * the context and of its creator's stack. Those addresses are predictable
+ * without ASLR, and close together for the contexts of a process, so this
+ * default does NOT keep untrusted scripts from flooding the hash tables.
+ * Hosts running them should define DYSL_HASH_SEED_FN. */
+#ifndef DYSL_HASH_SEED
+#define DYSL_HASH_SEED 0
+#endif /* DYSL_HASH_SEED */
+/* Name of a host function, `uint64_t name(void)`, returning random bits
+ * mixed into the seed of every new context and shared symbol table, such as
+ * one reading `getrandom()` or `/dev/urandom`. Undefined by default, the
+ * CLI reads `/dev/urandom`. */
+/* #define DYSL_HASH_SEED_FN my_random_bits */
+/* Strings up to this many bytes are interned, so that equal short strings
+ * share one object and compare by address. Longer strings are copied as
+ * they are created. */
+#ifndef DYSL_STRING_INTERN_MAX
+#define DYSL_STRING_INTERN_MAX 40
+#endif /* DYSL_STRING_INTERN_MAX */
+/* Fuse common pairs of instructions, such as a comparison followed by a
+ * conditional jump, into single superinstructions as they are compiled. */
+#ifndef DYSL_SUPERINSTRUCTIONS
+#define DYSL_SUPERINSTRUCTIONS 1
+#endif /* DYSL_SUPERINSTRUCTIONS */
+/* How many `let` and `def` bindings of a procedure the compiler may resolve
+ * at once. While nothing can shadow one, uses of its name in the same
+ * procedure read it by index instead of looking it up. 0 disables this. */
+#ifndef DYSL_LOCALS_MAX
+#define DYSL_LOCALS_MAX 16
+#endif /* DYSL_LOCALS_MAX */
+/* Count how often each pair of instructions runs back to back, to tune the
+ * superinstruction set. See `dysl_hot_pairs()`. Slows down dispatch. */
+#ifndef DYSL_PROFILE_PAIRS
+#define DYSL_PROFILE_PAIRS 0
+#endif /* DYSL_PROFILE_PAIRS */
+/* Count calls, time and allocations of each word and native procedure, and
+ * sample the word call stack, see `dysl_profile_start()`. Costs a branch
+ * per call while not profiling. */
+#ifndef DYSL_PROFILE
+#define DYSL_PROFILE 0
+#endif /* DYSL_PROFILE */
+/* Use SSE2 or NEON kernels in the memory utilities when the target has
+ * them. Only used without the standard library, which has its own. */
+#ifndef DYSL_SIMD
+#define DYSL_SIMD 1
+#endif /* DYSL_SIMD */
+
+/* Language features. Each one disabled is compiled out of the runtime,
+ * along with its instructions in the dispatch loop, and scripts using it
+ * fail to compile. Bytecode images only load in builds with the same set. */
+/* Real numbers. Without them, integer overflow is an error and `math`,
+ * `serde` and the API only deal in integers. */
+#ifndef DYSL_REALS
+#define DYSL_REALS 1
+#endif /* DYSL_REALS */
+/* Tables, and the `{ ... }` table literal's `TABLE_NEW` instruction. Arrays
+ * stay. */
+#ifndef DYSL_TABLES
+#define DYSL_TABLES 1
+#endif /* DYSL_TABLES */
+/* First-class procedures: `&{ ... }` and `&word` literals, `.call` and
+ * passing procedures as blocks. Words and blocks stay. */
+#ifndef DYSL_PROCS
+#define DYSL_PROCS 1
+#endif /* DYSL_PROCS */
+/* Record the source line of each instruction, for error messages. */
+#ifndef DYSL_LINE_INFO
+#define DYSL_LINE_INFO 1
+#endif /* DYSL_LINE_INFO */
+/* The standard modules opened by `dysl_open_modules()`. `io` follows
+ * DYSL_STDIO. */
+#ifndef DYSL_MODULE_MATH
+#define DYSL_MODULE_MATH 1
+#endif /* DYSL_MODULE_MATH */
+#ifndef DYSL_MODULE_SERDE
+#define DYSL_MODULE_SERDE 1
+#endif /* DYSL_MODULE_SERDE */
+#ifndef DYSL_MODULE_STRING
+#define DYSL_MODULE_STRING 1
+#endif /* DYSL_MODULE_STRING */
+/* Promise that scripts never bind a name that is already bound, so a word
+ * always resolves to the one binding its name has. Word lookups then skip
+ * the shadowing checks of their caches. The compiler rejects a `let` or
+ * `def` of a name bound where it is made, but not a word binding a name
+ * its callers bound, recursion included: those may see the outer binding. */
+#ifndef DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+#define DYSL_NO_DYNAMIC_SCOPE_SHADOWING 0
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
 
 /* == Configuration-derived includes == */
 #if DYSL_STDLIB
 #include <stdlib.h>
+#include <string.h>
 #endif /* DYSL_STDLIB */
+#if !DYSL_STDLIB && DYSL_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#define DYSL_SIMD_SSE2 1
+#elif !DYSL_STDLIB && DYSL_SIMD && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DYSL_SIMD_NEON 1
+#endif /* SIMD kernels */
 #if DYSL_STDIO
 #include <stdio.h>
 #endif /* DYSL_STDIO */
@@ -107,8 +315,9 @@ extern "C" {
  * @param ud        The user data pointer.
  * @param ptr       The pointer to the previously allocated memory block, or
  *                  NULL if a new block is being allocated.
- * @param old_size  The old size of the memory block, or 0 if a new block is
- *                  being allocated.
+ * @param old_size  The size the block at `ptr` was allocated or last resized
+ *                  with, or 0 if a new block is being allocated. Blocks are
+ *                  always freed with their real size.
  * @param new_size  The new size of the memory block, or 0 if the block is being
  *                  freed.
  */
@@ -141,6 +350,11 @@ struct dysl_allocator dysl_standard_allocator(void);
 
 /* == Dysl API == */
 
+#ifdef DYSL_HASH_SEED_FN
+/** The host's random bits for hash seeds, see DYSL_HASH_SEED_FN. */
+uint64_t DYSL_HASH_SEED_FN(void);
+#endif /* DYSL_HASH_SEED_FN */
+
 /** The interpreter context. */
 struct dysl;
 
@@ -149,44 +363,25 @@ struct dysl;
  */
 typedef void(*dysl_native_proc)(struct dysl*);
 
-/** Creates a new interpreter context.
- *
- * The returned context should be destroyed with `dysl_destroy()` when no
- * longer needed.
- *
- * @return  A pointer to the new interpreter context, or NULL on failure.
- */
-struct dysl* dysl_new(struct dysl_allocator allocator);
-
-/** Destroys an interpreter context.
- *
- * @param dysl  The interpreter context to destroy.
- */
-void dysl_destroy(struct dysl* state);
-#ifdef __cplusplus
-}; /* extern "C" */
-#endif /* __cplusplus */
-
-#ifdef DYSL_IMPLEMENTATION
-/* == data types == */
-// primitive types
-typedef int32_t dy_int;
-typedef double dy_real;
-typedef int32_t dy_bool;
-typedef int32_t dy_char;
-typedef uint32_t dy_hash_t;
-
-// object types (forward declarations)
-struct dy_object;
-struct dy_symbol;
-struct dy_string;
+/** A named native procedure, used to register modules. */
+struct dysl_reg {
+    const char* name;    /*< The word's name, NULL terminates a list. */
+    dysl_native_proc fn; /*< The native implementation. */
+};
 
-#define DYSL_TAG_TYPE_MASK ((dy_tag)0xFF)
-#define DYSL_TAG_FLAGS_MASK (~(dy_tag)DYSL_TAG_TYPE_MASK)
-#define DYSL_TAG_FLAGS_SHIFT 8
-#define DYSL_TAG_OBJECT     ((dy_tag)(0x01 << DYSL_TAG_FLAGS_SHIFT))
-#define DYSL_TAG_SPECIAL    ((dy_tag)(0x02 << DYSL_TAG_FLAGS_SHIFT))
+/** Status codes returned by the API. */
+enum dysl_status {
+    DYSL_OK = 0,        /*< Success. */
+    DYSL_ERROR_SYNTAX,  /*< The source code could not be compiled. */
+    DYSL_ERROR_RUNTIME, /*< An error was raised while running. */
+    DYSL_ERROR_MEMORY,  /*< An allocation failed. */
+    DYSL_ERROR_IMAGE,   /*< A bytecode image is malformed or incompatible,
+                         *  or could not be written. */
+    DYSL_YIELD,         /*< Not an error: the state yielded, see
+                         *  `dysl_yield()`. */
+};
 
+/** Value types, as returned by `dysl_type()`. */
 enum dy_type {
     DYSL_TYPE_NIL = 0,
     DYSL_TYPE_INTEGER,
@@ -198,12 +393,41 @@ enum dy_type {
     DYSL_TYPE_ARRAY,
     DYSL_TYPE_TABLE,
     DYSL_TYPE_PROCEDURE,
+    DYSL_TYPE_BUILDER, /*< A mutable string buffer, see `dysl_push_builder`. */
     // meta
     DYSL_TYPE_COUNT,
 };
 
-// tagged union value
+/* Values, as passed to fast natives (see `dysl_register_fast()`). Their
+ * layout depends on the configuration: read and make them with the
+ * `dysl_value_*()` functions below. */
+typedef int32_t dy_int;
+typedef double dy_real;
+typedef int32_t dy_bool;
+typedef int32_t dy_char;
 typedef uint32_t dy_tag;
+struct dy_object;
+struct dy_string;
+
+#define DYSL_TAG_TYPE_MASK ((dy_tag)0xFF)
+#if DYSL_NAN_BOXING
+/* NaN-boxed value. Reals are stored as themselves, every other value is a
+ * negative quiet NaN carrying its type in bits 47-50 and its payload (an
+ * integer, character, boolean or object pointer) in the low 47 bits. NaN
+ * reals are stored as the positive quiet NaN so they never look boxed.
+ *
+ * Object types are the ones from `DYSL_TYPE_STRING` on, and their pointers
+ * must fit in 47 bits, as user space pointers do on mainstream 64-bit
+ * platforms. */
+struct dy_value {
+    uint64_t bits;
+};
+#define DYSL_NAN_BOX        ((uint64_t)0xFFF8000000000000ull)
+#define DYSL_NAN_CANONICAL  ((uint64_t)0x7FF8000000000000ull)
+#define DYSL_NAN_PAYLOAD    ((uint64_t)0x00007FFFFFFFFFFFull)
+#define DYSL_NAN_TYPE_SHIFT 47
+#else /* DYSL_NAN_BOXING */
+// tagged union value
 struct dy_value {
     dy_tag tag;
     union {
@@ -215,487 +439,9537 @@ struct dy_value {
         struct dy_string* string;
     } as;
 };
+#endif /* DYSL_NAN_BOXING */
 
-struct dy_gc;
+/** Returns the type of a value, a `dy_type`. */
+static inline int dysl_value_type(const struct dy_value* value) {
+#if DYSL_NAN_BOXING
+    if ((value->bits & DYSL_NAN_BOX) != DYSL_NAN_BOX)
+        return DYSL_TYPE_REAL;
+    return (int)((value->bits >> DYSL_NAN_TYPE_SHIFT) & 0xF);
+#else /* DYSL_NAN_BOXING */
+    return (int)(value->tag & DYSL_TAG_TYPE_MASK);
+#endif /* DYSL_NAN_BOXING */
+}
 
-#pragma region Object (header) linked list API
-struct dy_object {
-    dy_tag tag;
-    struct dy_object *previous, *next;
-};
-static inline void dObj_close(struct dy_object* obj);
-static inline void dObj_unlink(struct dy_object* obj);
-static inline void dObj_link(struct dy_object* obj, struct dy_object* list);
-#pragma endregion /* Object (header) linked list API */
+/** Returns a value as a real, converting integers, or 0. */
+static inline double dysl_value_real(const struct dy_value* value) {
+    int type = dysl_value_type(value);
+#if DYSL_NAN_BOXING
+    union { uint64_t bits; dy_real real; } pun;
+    pun.bits = value->bits;
+    if (type == DYSL_TYPE_REAL)
+        return pun.real;
+    return type == DYSL_TYPE_INTEGER ? (dy_real)(dy_int)(uint32_t)value->bits
+                                     : 0;
+#else /* DYSL_NAN_BOXING */
+    if (type == DYSL_TYPE_REAL)
+        return value->as.real;
+    return type == DYSL_TYPE_INTEGER ? (dy_real)value->as.integer : 0;
+#endif /* DYSL_NAN_BOXING */
+}
 
-#pragma region Symbol type API
-struct dy_symbol {
-    struct dy_object header;
-    struct dy_symbol* next_in_table;
-    size_t length;
-    dy_hash_t hash;
-    char name[1];
-};
-struct dy_symbol* dSymbol_create(
-    struct dy_gc* gc,
-    const char* name,
-    size_t length,
-    dy_hash_t hash
+/** Returns a value as an integer, converting reals in range, or 0. */
+static inline int32_t dysl_value_integer(const struct dy_value* value) {
+    int type = dysl_value_type(value);
+    if (type == DYSL_TYPE_INTEGER)
+#if DYSL_NAN_BOXING
+        return (dy_int)(uint32_t)value->bits;
+#else /* DYSL_NAN_BOXING */
+        return value->as.integer;
+#endif /* DYSL_NAN_BOXING */
+    if (type != DYSL_TYPE_REAL)
+        return 0;
+    double real = dysl_value_real(value);
+    if (!(real >= (double)INT32_MIN && real <= (double)INT32_MAX))
+        return 0;
+    return (int32_t)real;
+}
+
+/** Returns the truthiness of a value: only nil and false are falsy. */
+static inline int dysl_value_boolean(const struct dy_value* value) {
+    int type = dysl_value_type(value);
+    if (type == DYSL_TYPE_NIL)
+        return 0;
+    if (type != DYSL_TYPE_BOOLEAN)
+        return 1;
+#if DYSL_NAN_BOXING
+    return (int)(value->bits & 1);
+#else /* DYSL_NAN_BOXING */
+    return value->as.boolean != 0;
+#endif /* DYSL_NAN_BOXING */
+}
+
+/** Makes an integer value. */
+static inline struct dy_value dysl_integer_value(int32_t integer) {
+    struct dy_value value;
+#if DYSL_NAN_BOXING
+    value.bits = DYSL_NAN_BOX |
+                 ((uint64_t)DYSL_TYPE_INTEGER << DYSL_NAN_TYPE_SHIFT) |
+                 (uint32_t)integer;
+#else /* DYSL_NAN_BOXING */
+    value.tag = DYSL_TYPE_INTEGER;
+    value.as.integer = integer;
+#endif /* DYSL_NAN_BOXING */
+    return value;
+}
+
+/** Makes a real value. */
+static inline struct dy_value dysl_real_value(double real) {
+    struct dy_value value;
+#if DYSL_NAN_BOXING
+    union { dy_real real; uint64_t bits; } pun;
+    pun.real = real;
+    // any NaN could collide with a boxed value
+    value.bits = real != real ? DYSL_NAN_CANONICAL : pun.bits;
+#else /* DYSL_NAN_BOXING */
+    value.tag = DYSL_TYPE_REAL;
+    value.as.real = real;
+#endif /* DYSL_NAN_BOXING */
+    return value;
+}
+
+/** Makes a boolean value. */
+static inline struct dy_value dysl_boolean_value(int boolean) {
+    struct dy_value value;
+#if DYSL_NAN_BOXING
+    value.bits = DYSL_NAN_BOX |
+                 ((uint64_t)DYSL_TYPE_BOOLEAN << DYSL_NAN_TYPE_SHIFT) |
+                 (uint64_t)(boolean != 0);
+#else /* DYSL_NAN_BOXING */
+    value.tag = DYSL_TYPE_BOOLEAN;
+    value.as.boolean = boolean != 0;
+#endif /* DYSL_NAN_BOXING */
+    return value;
+}
+
+/** Makes a nil value. */
+static inline struct dy_value dysl_nil_value(void) {
+    struct dy_value value;
+#if DYSL_NAN_BOXING
+    value.bits = DYSL_NAN_BOX |
+                 ((uint64_t)DYSL_TYPE_NIL << DYSL_NAN_TYPE_SHIFT);
+#else /* DYSL_NAN_BOXING */
+    value.tag = DYSL_TYPE_NIL;
+    value.as.integer = 0;
+#endif /* DYSL_NAN_BOXING */
+    return value;
+}
+
+/** Creates a new interpreter context.
+ *
+ * The returned context should be destroyed with `dysl_destroy()` when no
+ * longer needed. Contexts share no mutable state, so different contexts
+ * may be used from different threads at the same time.
+ *
+ * @return  A pointer to the new interpreter context, or NULL on failure.
+ */
+struct dysl* dysl_new(struct dysl_allocator allocator);
+
+/** Creates a new interpreter context in arena mode.
+ *
+ * Objects are bump allocated from chunks of `chunk_size` bytes and never
+ * collected: the memory is given back all at once by `dysl_destroy()`. This
+ * suits contexts that run a short script and are then thrown away, as it
+ * drops nearly all per-object bookkeeping.
+ *
+ * @param chunk_size  The size of the chunks requested from the allocator,
+ *                    or 0 for a default size.
+ * @return  A pointer to the new interpreter context, or NULL on failure.
+ */
+struct dysl* dysl_new_arena(struct dysl_allocator allocator, size_t chunk_size);
+
+/** Destroys an interpreter context, along with its threads, or a thread.
+ *
+ * @param dysl  The interpreter context or thread to destroy.
+ */
+void dysl_destroy(struct dysl* state);
+
+#if DYSL_SHARED_SYMBOLS
+/** A symbol table that several contexts intern into, see
+ * `dysl_new_with_symbols()`. */
+struct dysl_symbol_table;
+
+/** Creates a symbol table that contexts on any number of threads can share.
+ *
+ * Lookups and insertions take no locks. The table holds up to `capacity`
+ * symbols (or a default of 4096 when 0) and never grows: once it is full,
+ * contexts intern new names in their own tables, and keep using those
+ * symbols for them. Symbols in it are never collected, and are freed with
+ * the table.
+ *
+ * @return  The table, or NULL on failure.
+ */
+struct dysl_symbol_table* dysl_new_symbol_table(
+    struct dysl_allocator allocator,
+    size_t capacity
 );
-#pragma endregion /* Symbol type API */
 
-#pragma region String type API
-struct dy_string {
-    struct dy_object header;
-    size_t length;
-    char data[1];
-};
-struct dy_string* dString_create(
-    struct dy_gc* gc,
-    const char* data,
-    size_t length
+/** Creates a context that interns its symbols into `symbols`, which must
+ * outlive it. All contexts sharing a table share its hash seed.
+ *
+ * @return  The new context, or NULL on failure.
+ */
+struct dysl* dysl_new_with_symbols(
+    struct dysl_allocator allocator,
+    struct dysl_symbol_table* symbols
 );
-#pragma endregion /* String type API */
 
-#pragma region Garbage Collector API
-struct dy_gc {
-    struct dysl_allocator allocator;
-    struct dy_object root, gen;
-};
-#define dGC_allocator(gc) (&((gc)->allocator))
-void dGC_init(struct dy_gc* gc, struct dysl_allocator allocator);
-static inline void dGC_track(struct dy_gc* gc, struct dy_object* obj);
-static inline void dGC_root(struct dy_gc* gc, struct dy_object* obj);
-static inline void dGC_unroot(struct dy_gc* gc, struct dy_object* obj);
-struct dy_object* dGC_create(struct dy_gc* gc, size_t size, dy_tag tag);
-#pragma endregion /* Garbage Collector API */
+/** Destroys a symbol table, once no context uses it. */
+void dysl_symbol_table_destroy(struct dysl_symbol_table* symbols);
+#endif /* DYSL_SHARED_SYMBOLS */
 
-#pragma region Symbol table API
-#define DYSL_SYMBOLS_INITIAL_CAPACITY 64
-#define DYSL_SYMBOLS_LOAD_FACTOR 0.75
-struct dy_symbols {
-    struct dy_symbol** buckets;
-    size_t count, capacity;
+#if DYSL_BACKGROUND_SWEEP
+/** A task for another thread. */
+typedef void (*dysl_task)(void* argument);
+
+/** Runs collector work for a context on other threads. */
+struct dysl_sweeper {
+    void* user_data;
+    /** Runs `task(argument)` on another thread, or returns 0 if it cannot,
+     * in which case the collector runs it itself. */
+    int (*start)(void* user_data, dysl_task task, void* argument);
 };
-/** Initializes the symbol table. */
-void dSymbols_init(
-    struct dy_symbols* symbols,
-    size_t initial_capacity,
-    struct dysl_allocator* allocator
+
+/** Makes the collector free the objects it finds dead on the sweeper's
+ * threads, while the context goes on running and allocating.
+ *
+ * The context's allocator must then be thread safe. Marking is unchanged,
+ * and the freed small blocks come back to the context at its next
+ * collection step. `dysl_destroy()` waits for the sweeps in progress.
+ */
+void dysl_set_sweeper(struct dysl* dysl, struct dysl_sweeper sweeper);
+#endif /* DYSL_BACKGROUND_SWEEP */
+
+/** Creates a thread: a state with its own stack and environment, sharing
+ * the symbols, modules and collector of `dysl`'s context.
+ *
+ * Threads are cheap, they start with a small stack and an empty
+ * environment, so natives registered with `dysl_register()` must be
+ * registered on them again. Modules are shared. They are destroyed with
+ * `dysl_destroy()`, or along with their context. They are not thread safe:
+ * only one state of a context may run at a time.
+ *
+ * @return  The new thread, or NULL on failure.
+ */
+struct dysl* dysl_new_thread(struct dysl* dysl);
+
+/** Suspends the running state when the calling native returns.
+ *
+ * `dysl_run()` (or `dysl_resume()`) then returns `DYSL_YIELD`, leaving the
+ * native's results on the stack, and `dysl_resume()` continues after the
+ * native's call. Only natives called directly by a script may yield, not
+ * those called from within another native.
+ *
+ * @return  `DYSL_YIELD`, or `DYSL_ERROR_RUNTIME` if the state cannot yield.
+ */
+int dysl_yield(struct dysl* dysl);
+
+/** Continues a state suspended by `dysl_yield()`. Values pushed on its
+ * stack in between are seen by the script as the native's results.
+ *
+ * @return  As `dysl_run()`. Unlike it, the stack is left as is on errors.
+ */
+int dysl_resume(struct dysl* dysl);
+
+/** Returns whether the state is suspended, waiting for `dysl_resume()`. */
+int dysl_is_suspended(struct dysl* dysl);
+
+/** A frozen copy of a context's global state, see `dysl_snapshot()`. */
+struct dysl_snapshot;
+
+/** Takes a snapshot of a context, between runs.
+ *
+ * The snapshot holds a copy of the context's interned symbols, registered
+ * modules, environment (natives registered with `dysl_register()`) and
+ * stack, so values a prelude script left there, such as the procedures it
+ * compiled, are carried over. The context is left untouched and can be
+ * destroyed independently.
+ *
+ * @return  The snapshot, to be destroyed with `dysl_snapshot_destroy()`, or
+ *          NULL on failure.
+ */
+struct dysl_snapshot* dysl_snapshot(struct dysl* dysl);
+
+/** Creates a context from a snapshot, as if it had run everything the
+ * snapshotted context did.
+ *
+ * The snapshot is copied in a single pass, without lexing or compiling, and
+ * only read, so contexts can be created concurrently from the same
+ * snapshot. Contexts created from a snapshot share its hash seed.
+ *
+ * @return  The new context, or NULL on failure.
+ */
+struct dysl* dysl_new_from_snapshot(
+    const struct dysl_snapshot* snapshot,
+    struct dysl_allocator allocator
 );
-/** Destroys the symbol table structure, not the symbols themselves. */
-void dSymbols_destroy(
-    struct dy_symbols* symbols,
-    struct dysl_allocator* allocator
+
+/** Destroys a snapshot, contexts created from it are not affected. */
+void dysl_snapshot_destroy(struct dysl_snapshot* snapshot);
+
+/** Compiles and runs a script.
+ *
+ * The source is compiled to bytecode once, then executed. Bindings made at
+ * the script's top level are dropped when it finishes.
+ *
+ * @param dysl    The interpreter context.
+ * @param source  The script's source code.
+ * @param length  The length of the source code, in bytes.
+ * @return  `DYSL_OK`, `DYSL_YIELD` if a native yielded, or an error status.
+ *          See `dysl_error_message()`.
+ */
+int dysl_run(struct dysl* dysl, const char* source, size_t length);
+
+/** Supplies a script's source one chunk at a time.
+ *
+ * A chunk may end anywhere, even inside a token, and must stay valid until
+ * the reader is called again.
+ *
+ * @param length  Receives the length of the chunk.
+ * @return  The next chunk, or NULL (or a chunk of length 0) at the end.
+ */
+typedef const char* (*dysl_reader)(void* user_data, size_t* length);
+
+/** Compiles and runs a script read from `reader`.
+ *
+ * The source is compiled as it is read, and only the bytes of a token that
+ * spans chunks are copied, so the whole of it is never held in memory at
+ * once. The script runs once it is fully compiled.
+ *
+ * @param keep_bindings  Nonzero to keep the bindings made at the script's
+ *                       top level once it finishes, so the scripts run
+ *                       after it can use them, as a REPL does.
+ * @return  As `dysl_run()`.
+ */
+int dysl_run_reader(
+    struct dysl* dysl,
+    dysl_reader reader,
+    void* user_data,
+    int keep_bindings
 );
-/** Looks up a symbol in the table, returns its slot. */
-struct dy_symbol** dSymbols_lookup(
-    struct dy_symbols* symbols,
-    const char* name,
+
+/** Returns whether the last compilation failed only because the source
+ * ended too early, inside a block, string or definition. A REPL can then
+ * read more lines and try again. */
+int dysl_is_incomplete(struct dysl* dysl);
+
+/** Receives the bytes of a bytecode image as it is written.
+ *
+ * @return  0 on success, nonzero to abort the dump.
+ */
+typedef int (*dysl_writer)(void* user_data, const void* data, size_t size);
+
+/** Compiles a script into a bytecode image, which `dysl_run_image()` runs
+ * without lexing or parsing it again.
+ *
+ * An image holds the compiled procedures, their constants and the names of
+ * their symbols, with hashes. It only loads in builds with the same byte
+ * order and instruction set.
+ *
+ * @return  `DYSL_OK`, a compilation error, or `DYSL_ERROR_IMAGE` if the
+ *          writer failed.
+ */
+int dysl_dump(
+    struct dysl* dysl,
+    const char* source,
     size_t length,
-    dy_hash_t hash,
-    int* found
+    dysl_writer writer,
+    void* user_data
 );
-/** Returns the slot for the interned symbol with the given name, growing the
- * table if necessary.
+
+/** Runs a bytecode image made by `dysl_dump()`.
  *
- * After this call, the table will have counted the new symbol.
+ * The image is only read, and only during the call, so it may be mapped
+ * straight from a file. Its structure and the operands of its code are
+ * checked: every constant, slot and jump target the code names exists, so
+ * a damaged image is an error rather than read past. The order the code
+ * runs in is not, such as a slot read before it is written: only run
+ * images `dysl_dump()` made.
  *
- * The caller is responsible for allocating the symbol and placing it in the
- * returned slot.
+ * @return  As `dysl_run()`, or `DYSL_ERROR_IMAGE` if the image is invalid.
  */
-struct dy_symbol** dSymbols_intern(
-    struct dy_symbols* symbols,
+int dysl_run_image(struct dysl* dysl, const void* image, size_t size);
+
+/** Returns whether `data` starts like a bytecode image. */
+int dysl_is_image(const void* data, size_t size);
+
+/** Returns the message describing the last error, or an empty string. */
+const char* dysl_error_message(struct dysl* dysl);
+
+/** Raises a runtime error from a native procedure.
+ *
+ * The native procedure should return right after raising it; the error is
+ * propagated once control gets back to the interpreter.
+ */
+void dysl_error(struct dysl* dysl, const char* message);
+
+/** Registers a native procedure as a word visible to every script. */
+void dysl_register(struct dysl* dysl, const char* name, dysl_native_proc fn);
+
+/** A fast native procedure, see `dysl_register_fast()`.
+ *
+ * @param args    Its arguments, in place on the stack, in pushing order.
+ * @param result  Where its result goes, nil until it is set.
+ */
+typedef void (*dysl_fast_proc)(
+    struct dysl* dysl,
+    const struct dy_value* args,
+    struct dy_value* result
+);
+
+/** Registers a native procedure that takes `arity` values from the stack
+ * and returns one, as a word visible to every script.
+ *
+ * Its arguments are read straight from the stack and its result written in
+ * place, so calling it costs no more than the C call. It may raise errors
+ * with `dysl_error()`, but must not push values: that could move the stack
+ * away from `args` and `result`.
+ */
+void dysl_register_fast(
+    struct dysl* dysl,
     const char* name,
-    size_t length,
-    dy_hash_t hash,
-    struct dysl_allocator* allocator
+    int arity,
+    dysl_fast_proc fn
 );
-/** Grows or shrinks the symbol table to a reasonable size that accommodates the
- * desired count of symbols. */
-void dSymbols_ensure_capacity(
-    struct dy_symbols* symbols,
-    size_t desired_count,
-    struct dysl_allocator* allocator
+
+/** Calls the word (or procedure variable) `word` `count` times, looking it
+ * up once.
+ *
+ * Call `i` is given the `arity` values from `inputs[i * arity]`, and
+ * `outputs[i]` receives the value it leaves on top of the stack, or nil if
+ * it leaves none. The stack is as it was once the batch returns. Natives
+ * called this way cannot yield.
+ *
+ * The outputs so far are kept on the stack while the batch runs, so it
+ * grows by `count` values, and alive until it returns, but not after: read
+ * them, or push them back with `dysl_push_value()`, before the context
+ * allocates again.
+ *
+ * @return  `DYSL_OK`, or the status of the first call that failed, with the
+ *          outputs of those before it written.
+ */
+int dysl_call_batch(
+    struct dysl* dysl,
+    const char* word,
+    int arity,
+    const struct dy_value* inputs,
+    size_t count,
+    struct dy_value* outputs
 );
-/** Resizes the symbol table to the new capacity. */
-void dSymbols_resize(
-    struct dy_symbols* symbols,
-    size_t new_capacity,
-    struct dysl_allocator* allocator
+
+/** Registers a module, made available to scripts through `import name`.
+ *
+ * After `import name`, each entry is bound to the word `name:entry`. Words
+ * are only bound, and their procedures created, when first looked up, so
+ * unused words cost a hash each.
+ *
+ * @param entries  A list of procedures, terminated by an entry whose `name`
+ *                 is NULL. It must outlive the interpreter context.
+ */
+void dysl_register_module(
+    struct dysl* dysl,
+    const char* name,
+    const struct dysl_reg* entries
 );
-/** Returns whether the symbol table should grow to accommodate the desired
- * count of symbols. */
-int dSymbols_should_grow(struct dy_symbols* symbols, size_t desired_count);
-#pragma endregion /* Symbol table API */
 
-#pragma region Global context API
-struct dy_global {
-    struct dy_gc gc;
-    struct dy_symbols symbols;
-    struct dysl* main_state;
-};
-#define dGlobal_gc(global) (&((global)->gc))
-void dGlobal_init(struct dy_global* global, struct dysl_allocator allocator);
-#pragma endregion /* Global context API */
+/** Performs an incremental garbage collection step.
+ *
+ * Starts a new collection cycle if none is running. Collection also happens
+ * automatically, in small steps, as the interpreter allocates.
+ *
+ * @param budget  The amount of work to do, roughly in objects scanned or
+ *                freed.
+ * @return  1 if the step finished a cycle, 0 otherwise.
+ */
+int dysl_gc_step(struct dysl* dysl, size_t budget);
 
-#pragma region Value Stack API
-struct dy_stack {
-    struct dy_value* base;
+/** Performs a full collection, freeing every unreachable object. */
+void dysl_gc_collect(struct dysl* dysl);
+
+/** Reads a host clock, in any unit. */
+typedef uint64_t (*dysl_clock)(void* user_data);
+
+/** Makes the collector time its work with `clock`, NULL stops timing.
+ *
+ * The time adds up in the `gc_time` of `dysl_memstats()`. */
+void dysl_set_gc_clock(struct dysl* dysl, dysl_clock clock, void* user_data);
+
+/** Memory use of a context, as reported by `dysl_memstats()`. */
+struct dysl_memstats {
+    size_t bytes;       /*< Allocated from the allocator and not freed. */
+    size_t peak_bytes;  /*< The most `bytes` has ever been. */
+    size_t limit;       /*< See `dysl_set_memory_limit()`, 0 if none. */
+    size_t allocations; /*< Blocks allocated so far. */
+    size_t refused;     /*< Allocations refused for exceeding `limit`. */
+    uint64_t gc_time;   /*< Spent collecting, see `dysl_set_gc_clock()`. */
+    /** Objects created so far, by type (`DYSL_TYPE_STRING`, ...). */
+    size_t objects[DYSL_TYPE_COUNT];
+};
+
+/** Reports how much memory a context (with all its threads) uses. Small
+ * objects are carved from larger chunks, which count as a whole. */
+void dysl_memstats(struct dysl* dysl, struct dysl_memstats* stats);
+
+/** Caps the bytes a context may have allocated at once, 0 removes the cap.
+ *
+ * A full collection runs at the next safe point once allocation goes
+ * halfway from where the last one left off to the cap. Allocations that
+ * would exceed it fail instead, raising `DYSL_ERROR_MEMORY`, and make the
+ * next safe point collect.
+ */
+void dysl_set_memory_limit(struct dysl* dysl, size_t limit);
+
+/** An instruction pair counted by the pair profiler. */
+struct dysl_pair_count {
+    const char* first;   /*< Name of the instruction that ran first. */
+    const char* second;
+    uint64_t count;
+};
+
+/** Reports the instruction pairs that ran back to back most often.
+ *
+ * Requires `DYSL_PROFILE_PAIRS`, without it nothing is counted.
+ *
+ * @param pairs  Receives up to `max` pairs, most frequent first.
+ * @return  The number of pairs written.
+ */
+size_t dysl_hot_pairs(
+    struct dysl* dysl,
+    struct dysl_pair_count* pairs,
+    size_t max
+);
+
+#if DYSL_PROFILE
+/** What the profiler found for one word or native procedure. */
+struct dysl_profile_entry {
+    const char* name;
+    uint64_t calls;
+    uint64_t self_time;   /*< Clock ticks spent in it, not in what it called. */
+    uint64_t allocations; /*< Objects it created itself. */
+};
+
+/** Starts profiling the context, discarding the previous profile.
+ *
+ * Calls of named procedures (`def`'d words and natives) are counted and
+ * timed. Every `period` ticks the word call stack is sampled.
+ *
+ * @param clock  The clock, or NULL to count calls and returns as ticks.
+ */
+void dysl_profile_start(
+    struct dysl* dysl,
+    dysl_clock clock,
+    void* user_data,
+    uint64_t period
+);
+/** Stops profiling, the profile stays available. */
+void dysl_profile_stop(struct dysl* dysl);
+/** Reports the profiled procedures, most self time first.
+ *
+ * @param entries  Receives up to `max` entries, whose names stay valid
+ *                 until profiling starts again or the context is destroyed.
+ * @return  The number of entries written.
+ */
+size_t dysl_profile_entries(
+    struct dysl* dysl,
+    struct dysl_profile_entry* entries,
+    size_t max
+);
+/** Writes the sampled stacks in the folded format of flame graph tools,
+ * a `word;word;word samples` line per stack.
+ *
+ * @return  `DYSL_OK`, or `DYSL_ERROR_IMAGE` if the writer failed.
+ */
+int dysl_profile_dump(struct dysl* dysl, dysl_writer writer, void* user_data);
+#endif /* DYSL_PROFILE */
+
+/** Registers the standard modules (`io`, `math`, `serde`, `string`)
+ * available in the current configuration. */
+void dysl_open_modules(struct dysl* dysl);
+
+/* Stack manipulation.
+ *
+ * Stack indices are either non-negative, counting from the bottom of the
+ * stack (0 is the first value), or negative, counting from the top (-1 is
+ * the top value). Reading an invalid index yields nil. */
+
+/** Returns the number of values on the stack. */
+int dysl_get_top(struct dysl* dysl);
+/** Makes room for pushing `count` more values, growing the stack if
+ * needed. Native procedures always have some room, this is for those
+ * pushing many values.
+ *
+ * @return  1 on success, 0 if the stack cannot grow. No error is raised.
+ */
+int dysl_ensure_stack(struct dysl* dysl, int count);
+/** Pops `count` values from the stack. */
+void dysl_pop(struct dysl* dysl, int count);
+/** Returns the type (`DYSL_TYPE_*`) of the value at `index`. */
+int dysl_type(struct dysl* dysl, int index);
+
+void dysl_push_nil(struct dysl* dysl);
+void dysl_push_integer(struct dysl* dysl, int32_t value);
+/** Pushes a real. Builds without DYSL_REALS push it truncated to an
+ * integer instead. */
+void dysl_push_real(struct dysl* dysl, double value);
+void dysl_push_boolean(struct dysl* dysl, int value);
+/** Pushes a value, as made by the `dysl_*_value()` functions or taken from
+ * a fast native's arguments or `dysl_call_batch()`. */
+void dysl_push_value(struct dysl* dysl, struct dy_value value);
+void dysl_push_string(struct dysl* dysl, const char* data, size_t length);
+/** Frees the host's bytes behind an external string. */
+typedef void (*dysl_release)(void* user_data, const char* data, size_t length);
+/** Pushes a string made of `length` bytes at `data`, without copying them.
+ *
+ * The bytes stay the host's, and must not change until `release` (if not
+ * NULL) is called with them, exactly once. That is when the string is
+ * collected, or right away if it was copied after all: strings short enough
+ * to be interned are, and so is every string of an arena context. Snapshots
+ * copy the bytes too. With a sweeper, `release` may run on its thread.
+ *
+ * The bytes need not be null-terminated, and `dysl_to_string()` returns
+ * `data` itself.
+ */
+void dysl_push_external_string(
+    struct dysl* dysl,
+    const char* data,
+    size_t length,
+    dysl_release release,
+    void* user_data
+);
+void dysl_push_symbol(struct dysl* dysl, const char* name, size_t length);
+/** Pushes a new, empty array. */
+void dysl_push_array(struct dysl* dysl);
+#if DYSL_TABLES
+/** Pushes a new, empty table. */
+void dysl_push_table(struct dysl* dysl);
+#endif /* DYSL_TABLES */
+/** Pushes a new, empty string builder.
+ *
+ * Builders grow in place, so building a long string piece by piece takes
+ * linear time, where repeated concatenation copies the whole string each
+ * time. They print as their contents. */
+void dysl_push_builder(struct dysl* dysl);
+
+/** Replaces the key on top of the stack with the value stored under it in
+ * the array or table at `index`, or nil if there is none. Arrays are
+ * indexed from 1. */
+void dysl_get(struct dysl* dysl, int index);
+/** Stores the value on top of the stack under the key right below it, in
+ * the array or table at `index`, and pops both.
+ *
+ * Storing nil removes a table's key. Arrays only take indices up to their
+ * length plus one, which appends. */
+void dysl_set(struct dysl* dysl, int index);
+/** Returns the length of the string, array or table at `index`, or 0.
+ *
+ * The length of a table is the number of consecutive integer keys from 1
+ * held in its array part. */
+size_t dysl_length(struct dysl* dysl, int index);
+/** Appends the value on top of the stack to the array, table or builder at
+ * `index`, and pops it. Builders take the value's text, as printed. */
+void dysl_append(struct dysl* dysl, int index);
+/** Appends `length` bytes to the builder at `index`. */
+void dysl_append_string(
+    struct dysl* dysl,
+    int index,
+    const char* data,
+    size_t length
+);
+/** Pushes a string holding the current contents of the builder at
+ * `index`. */
+void dysl_build_string(struct dysl* dysl, int index);
+
+/** Returns the value at `index` as an integer, converting reals. */
+int32_t dysl_to_integer(struct dysl* dysl, int index);
+/** Returns the value at `index` as a real, converting integers. */
+double dysl_to_real(struct dysl* dysl, int index);
+/** Returns the truthiness of the value at `index`. */
+int dysl_to_boolean(struct dysl* dysl, int index);
+/** Returns the bytes of the string, symbol or builder at `index`, or NULL.
+ *
+ * The bytes are read in place, never copied. The returned pointer is valid
+ * while the value stays on the stack, and for builders, until they are
+ * appended to. Only builders and external strings may lack a terminating
+ * null byte.
+ *
+ * @param length  If not NULL, receives the length in bytes.
+ */
+const char* dysl_to_string(struct dysl* dysl, int index, size_t* length);
+#ifdef __cplusplus
+}; /* extern "C" */
+#endif /* __cplusplus */
+
+#ifdef DYSL_IMPLEMENTATION
+/* == data types == */
+// primitive types, see the values in the Dysl API for the others
+typedef uint32_t dy_hash_t;
+
+// object types (forward declarations)
+struct dy_global;
+struct dy_symbol;
+struct dy_proc;
+
+#define DYSL_TAG_FLAGS_MASK (~(dy_tag)DYSL_TAG_TYPE_MASK)
+#define DYSL_TAG_FLAGS_SHIFT 8
+#define DYSL_TAG_OBJECT     ((dy_tag)(0x01 << DYSL_TAG_FLAGS_SHIFT))
+#define DYSL_TAG_SPECIAL    ((dy_tag)(0x02 << DYSL_TAG_FLAGS_SHIFT))
+// garbage collector flags, see the Garbage Collector API
+#define DYSL_TAG_OLD        ((dy_tag)(0x04 << DYSL_TAG_FLAGS_SHIFT))
+#define DYSL_TAG_GRAY       ((dy_tag)(0x08 << DYSL_TAG_FLAGS_SHIFT))
+#define DYSL_TAG_ROOT       ((dy_tag)(0x10 << DYSL_TAG_FLAGS_SHIFT))
+// symbols owned by a shared table, see the Shared symbol table API
+#define DYSL_TAG_SHARED     ((dy_tag)(0x20 << DYSL_TAG_FLAGS_SHIFT))
+// strings whose bytes belong to the host, see `dy_external_string`
+#define DYSL_TAG_EXTERNAL   ((dy_tag)(0x40 << DYSL_TAG_FLAGS_SHIFT))
+// symbols with a colon, which may name module words, see `dy_module`
+#define DYSL_TAG_QUALIFIED  ((dy_tag)(0x80 << DYSL_TAG_FLAGS_SHIFT))
+
+#pragma region Value API
+#if DYSL_NAN_BOXING
+#define dV_box(type, payload) \
+    (DYSL_NAN_BOX | ((uint64_t)(type) << DYSL_NAN_TYPE_SHIFT) | (payload))
+#define dV_is_boxed(v) (((v).bits & DYSL_NAN_BOX) == DYSL_NAN_BOX)
+/* all 17 bits above the payload, which identify a boxed type at once */
+#define dV_box_tag(v) ((uint32_t)((v).bits >> DYSL_NAN_TYPE_SHIFT))
+#define dV_box_tag_of(type) \
+    ((uint32_t)(DYSL_NAN_BOX >> DYSL_NAN_TYPE_SHIFT) | (uint32_t)(type))
+#define dV_type(v) \
+    (dV_is_boxed(v) \
+        ? (enum dy_type)(dV_box_tag(v) & 0xF) \
+        : DYSL_TYPE_REAL)
+#define dV_is(v, type) \
+    ((type) == DYSL_TYPE_REAL \
+        ? !dV_is_boxed(v) \
+        : dV_box_tag(v) == dV_box_tag_of(type))
+#define dV_is_object(v) (dV_box_tag(v) >= dV_box_tag_of(DYSL_TYPE_STRING))
+#define dV_is_number(v) \
+    (!dV_is_boxed(v) || dV_box_tag(v) == dV_box_tag_of(DYSL_TYPE_INTEGER))
+/** Only nil and false are falsy. */
+#define dV_is_falsy(v) \
+    ((v).bits == dV_box(DYSL_TYPE_NIL, 0) || \
+     (v).bits == dV_box(DYSL_TYPE_BOOLEAN, 0))
+#define dV_integer(v)   ((dy_int)(uint32_t)(v).bits)
+#define dV_real(v)      dV_bits_to_real((v).bits)
+#define dV_boolean(v)   ((dy_bool)((v).bits & 1))
+#define dV_character(v) ((dy_char)(uint32_t)(v).bits)
+#define dV_object(v) \
+    ((struct dy_object*)(uintptr_t)((v).bits & DYSL_NAN_PAYLOAD))
+#define dV_string(v)    ((struct dy_string*)dV_object(v))
+#define dV_symbol(v)    ((struct dy_symbol*)dV_object(v))
+#define dV_proc(v)      ((struct dy_proc*)dV_object(v))
+#define dV_array(v)     ((struct dy_array*)dV_object(v))
+#define dV_table(v)     ((struct dy_table*)dV_object(v))
+#define dV_builder(v)   ((struct dy_builder*)dV_object(v))
+/** Returns a number value as a real. */
+#define dV_to_real(v) \
+    (dV_is_boxed(v) ? (dy_real)dV_integer(v) : dV_real(v))
+static inline dy_real dV_bits_to_real(uint64_t bits);
+#else /* DYSL_NAN_BOXING */
+#define dV_type(v)      ((enum dy_type)((v).tag & DYSL_TAG_TYPE_MASK))
+#define dV_is(v, type)  (dV_type(v) == (type))
+#define dV_is_object(v) (((v).tag & DYSL_TAG_OBJECT) != 0)
+#define dV_is_number(v) \
+    (dV_is((v), DYSL_TYPE_INTEGER) || dV_is((v), DYSL_TYPE_REAL))
+/** Only nil and false are falsy. */
+#define dV_is_falsy(v) \
+    (dV_is((v), DYSL_TYPE_NIL) || \
+     (dV_is((v), DYSL_TYPE_BOOLEAN) && !(v).as.boolean))
+#define dV_integer(v)   ((v).as.integer)
+#define dV_real(v)      ((v).as.real)
+#define dV_boolean(v)   ((v).as.boolean)
+#define dV_character(v) ((v).as.character)
+#define dV_object(v)    ((v).as.object)
+#define dV_string(v)    ((v).as.string)
+#define dV_symbol(v)    ((struct dy_symbol*)(v).as.object)
+#define dV_proc(v)      ((struct dy_proc*)(v).as.object)
+#define dV_array(v)     ((struct dy_array*)(v).as.object)
+#define dV_table(v)     ((struct dy_table*)(v).as.object)
+#define dV_builder(v)   ((struct dy_builder*)(v).as.object)
+/** Returns a number value as a real. */
+#define dV_to_real(v) \
+    (dV_is((v), DYSL_TYPE_INTEGER) ? (dy_real)(v).as.integer : (v).as.real)
+#endif /* DYSL_NAN_BOXING */
+
+static inline struct dy_value dV_nil(void);
+static inline struct dy_value dV_make_integer(dy_int integer);
+static inline struct dy_value dV_make_real(dy_real real);
+static inline struct dy_value dV_make_boolean(dy_bool boolean);
+static inline struct dy_value dV_make_object(struct dy_object* obj);
+/** Compares values for equality: numbers by value, strings by contents and
+ * everything else by identity. */
+int dV_equals(struct dy_value a, struct dy_value b);
+/** Formats a value for display.
+ *
+ * Strings and symbols are returned in place, everything else is formatted
+ * into `buf` (of at least `DYSL_FORMAT_BUFFER_SIZE` bytes).
+ *
+ * @param length  Receives the length of the returned bytes.
+ * @return  A pointer to the formatted bytes, not necessarily null-terminated.
+ */
+const char* dV_format(struct dy_value value, char* buf, size_t* length);
+#define DYSL_FORMAT_BUFFER_SIZE 48
+#pragma endregion /* Value API */
+
+struct dy_gc;
+
+#pragma region Object (header) linked list API
+/** The header every object starts with. */
+struct dy_object {
+    dy_tag tag;
+    uint32_t cycle; /*< The last collection cycle that marked the object. */
+};
+/** Links an object into one of the collector's lists. It is allocated right
+ * before the object's header, except in arena mode, where objects are never
+ * linked. List heads are bare links. */
+struct dy_link {
+    struct dy_link *previous, *next;
+};
+#define dObj_links(obj) ((struct dy_link*)(obj) - 1)
+#define dObj_from_link(link) ((struct dy_object*)((struct dy_link*)(link) + 1))
+static inline void dObj_close(struct dy_link* list);
+static inline void dObj_unlink(struct dy_object* obj);
+static inline void dObj_link(struct dy_object* obj, struct dy_link* list);
+/** Moves every object in `list` to the front of `into`. */
+static inline void dObj_splice(struct dy_link* list, struct dy_link* into);
+/** Returns the first object in `list`, or NULL if it is empty. */
+static inline struct dy_object* dObj_first(struct dy_link* list);
+#pragma endregion /* Object (header) linked list API */
+
+#pragma region Symbol type API
+struct dy_symbol {
+    struct dy_object header;
+    size_t length;
+    dy_hash_t hash;
+    uint32_t env_version; /*< Bumped whenever the name is bound. */
+    char name[1];
+};
+struct dy_symbol* dSymbol_create(
+    struct dy_gc* gc,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+);
+/** Tags `sym` `DYSL_TAG_QUALIFIED` if its name has a colon. */
+static inline void dSymbol_qualify(struct dy_symbol* sym);
+#define dSymbol_is_qualified(sym) \
+    (((sym)->header.tag & DYSL_TAG_QUALIFIED) != 0)
+#pragma endregion /* Symbol type API */
+
+#pragma region String type API
+struct dy_string {
+    struct dy_object header;
+    size_t length;
+    dy_hash_t hash; /*< Set on interned strings only. */
+    char data[1];
+};
+/** Whether strings of `length` bytes are interned. Those strings are unique,
+ * so two of them are equal only if they are the same object. */
+#define dString_is_short(length) ((length) <= DYSL_STRING_INTERN_MAX)
+/** Creates a string that is not interned. Use `dGlobal_string` unless the
+ * string is longer than `DYSL_STRING_INTERN_MAX`. */
+struct dy_string* dString_create(
+    struct dy_gc* gc,
+    const char* data,
+    size_t length
+);
+/** Allocates a null-terminated string of `length` uninitialized bytes. Like
+ * `dString_create`, the result is not interned. */
+struct dy_string* dString_alloc(struct dy_gc* gc, size_t length);
+/** A string pointing at the host's bytes, tagged `DYSL_TAG_EXTERNAL`. Its
+ * own `data` is unused, the bytes go to `release` when it is freed. */
+struct dy_external_string {
+    struct dy_string string;
+    const char* data;
+    dysl_release release;
+    void* user_data;
+};
+/** Creates an external string, which must not be short enough to be
+ * interned. Returns NULL on failure, leaving the bytes to the caller. */
+struct dy_string* dString_create_external(
+    struct dy_gc* gc,
+    const char* data,
+    size_t length,
+    dysl_release release,
+    void* user_data
+);
+/** Returns a string's bytes, wherever they live. */
+static inline const char* dString_data(const struct dy_string* str);
+#pragma endregion /* String type API */
+
+#pragma region Builder type API
+/** A growable byte buffer for building strings. Its contents are always
+ * contiguous, and only become a string when one is asked for. */
+struct dy_builder {
+    struct dy_object header;
+    char* data;
+    size_t length, capacity;
+};
+#define DYSL_BUILDER_INITIAL_CAPACITY 64
+/** Creates an empty builder with room for `capacity` bytes. */
+struct dy_builder* dBuilder_create(struct dy_gc* gc, size_t capacity);
+/** Grows the builder to hold at least `capacity` bytes, doubling its
+ * capacity. Returns 0 if allocation fails. */
+int dBuilder_reserve(struct dy_gc* gc, struct dy_builder* builder, size_t capacity);
+/** Appends `length` bytes, which may be the builder's own contents. Returns
+ * 0 if allocation fails. */
+int dBuilder_append(
+    struct dy_gc* gc,
+    struct dy_builder* builder,
+    const char* data,
+    size_t length
+);
+#pragma endregion /* Builder type API */
+
+#pragma region Array type API
+/** A contiguous, growable vector of values. Scripts index it from 1. */
+struct dy_array {
+    struct dy_object header;
+    struct dy_value* values;
+    uint32_t count, capacity;
+};
+#define DYSL_ARRAY_INITIAL_CAPACITY 8
+/** Creates an empty array with room for `capacity` values. */
+struct dy_array* dArray_create(struct dy_gc* gc, uint32_t capacity);
+/** Grows the array to hold at least `capacity` values, doubling its
+ * capacity. Returns 0 if allocation fails. */
+int dArray_reserve(struct dy_gc* gc, struct dy_array* array, uint32_t capacity);
+/** Appends a value, returns 0 if allocation fails. */
+int dArray_push(struct dy_gc* gc, struct dy_array* array, struct dy_value value);
+#pragma endregion /* Array type API */
+
+#if DYSL_TABLES
+#pragma region Table type API
+/* Tables are split in two, as Lua's: integer keys from 1 to `array_count`
+ * live in a dense array part, every other key in a hash part. The hash
+ * part is an open addressing table with linear probing, a power-of-two
+ * capacity and backward-shift deletion, as the symbol table.
+ *
+ * Keys are compared by value, except symbols, which are interned and so
+ * compared by identity. Reals holding an integer are stored as that
+ * integer. Storing nil removes a key. */
+/** A hash part entry, empty when `key` is nil. */
+struct dy_table_node {
+    struct dy_value key;
+    struct dy_value value;
+    dy_hash_t hash;
+};
+struct dy_table {
+    struct dy_object header;
+    struct dy_value* array;
+    struct dy_table_node* nodes;
+    uint32_t array_count, array_capacity;
+    uint32_t node_count, node_capacity;
+};
+#define DYSL_TABLE_MIN_NODES 4
+/** Creates a table with room for `node_count` keys in its hash part. */
+struct dy_table* dTable_create(struct dy_gc* gc, uint32_t node_count);
+/** Returns the value stored under `key`, or nil. */
+struct dy_value dTable_get(
+    struct dy_global* global,
+    struct dy_table* table,
+    struct dy_value key
+);
+/** Stores `value` under `key`.
+ *
+ * @return  `DYSL_OK`, `DYSL_ERROR_RUNTIME` if the key is nil or NaN, or
+ *          `DYSL_ERROR_MEMORY`.
+ */
+int dTable_set(
+    struct dy_global* global,
+    struct dy_table* table,
+    struct dy_value key,
+    struct dy_value value
+);
+#pragma endregion /* Table type API */
+#endif /* DYSL_TABLES */
+
+#pragma region Bytecode API
+/* Instructions are 32 bits wide: an 8-bit opcode in the low bits and a
+ * signed 24-bit argument in the high bits. Opcodes marked `+x` are followed
+ * by one extra 32-bit word holding a second argument.
+ *
+ * Jump offsets are relative to the instruction after the jump (and after
+ * its extra word, if any). */
+typedef uint32_t dy_instr;
+/* instructions of optional features, only listed when they are enabled */
+#if DYSL_PROCS
+#define DYSL_OPCODES_PROCS(X) \
+    X(CALL_VBLOCK)   /* proc -- : call K[arg] with proc as its block */ \
+    X(CALL)          /* proc -- : calls proc */
+#else /* DYSL_PROCS */
+#define DYSL_OPCODES_PROCS(X)
+#endif /* DYSL_PROCS */
+#if DYSL_TABLES
+#define DYSL_OPCODES_TABLES(X) \
+    X(TABLE_NEW)     /* key value pairs above slots[arg] -- table */
+#else /* DYSL_TABLES */
+#define DYSL_OPCODES_TABLES(X)
+#endif /* DYSL_TABLES */
+#if DYSL_SUPERINSTRUCTIONS
+/* superinstructions, fused by the compiler from the pair they name */
+#define DYSL_OPCODES_FUSED(X) \
+    X(JUMP_IF_NOT_EQ) /* a b -- : EQ JUMP_IF_FALSE */ \
+    X(JUMP_IF_NOT_NE) /* a b -- : NE JUMP_IF_FALSE */ \
+    X(JUMP_IF_NOT_LT) /* a b -- : LT JUMP_IF_FALSE */ \
+    X(JUMP_IF_NOT_GT) /* a b -- : GT JUMP_IF_FALSE */ \
+    X(JUMP_IF_NOT_LE) /* a b -- : LE JUMP_IF_FALSE */ \
+    X(JUMP_IF_NOT_GE) /* a b -- : GE JUMP_IF_FALSE */ \
+    X(ADD_INT)       /* a -- a+arg : PUSH_INT ADD */ \
+    X(SUB_INT)       /* a -- a-arg : PUSH_INT SUB */ \
+    DYSL_OPCODES_FUSED_PROCS(X)
+#if DYSL_PROCS
+#define DYSL_OPCODES_FUSED_PROCS(X) \
+    X(CALL_VAR)      /* CALL_WORD, and if K[arg] is a variable holding a proc, \
+                      * the CALL that follows it */
+#else /* DYSL_PROCS */
+#define DYSL_OPCODES_FUSED_PROCS(X)
+#endif /* DYSL_PROCS */
+#else /* DYSL_SUPERINSTRUCTIONS */
+#define DYSL_OPCODES_FUSED(X)
+#endif /* DYSL_SUPERINSTRUCTIONS */
+#define DYSL_OPCODES(X) \
+    X(NOP)           /* */ \
+    X(RETURN)        /* returns from the current word */ \
+    X(PUSH_NIL)      /* -- nil */ \
+    X(PUSH_TRUE)     /* -- true */ \
+    X(PUSH_FALSE)    /* -- false */ \
+    X(PUSH_INT)      /* -- arg */ \
+    X(PUSH_CONST)    /* -- K[arg] */ \
+    X(CALL_WORD)     /* resolves K[arg], calls words, pushes variables */ \
+    X(CALL_BLOCK)    /* +x: call K[arg] with K[x] as its block */ \
+    DYSL_OPCODES_PROCS(X) \
+    X(GET)           /* -- value of binding K[arg] */ \
+    X(LET)           /* value -- : binds K[arg] to value */ \
+    X(SET)           /* value -- : assigns the nearest binding K[arg] */ \
+    X(DEF)           /* proc -- : binds K[arg] as a word */ \
+    X(LET_LOCAL)     /* +x: LET, and slots[x] = the binding's index */ \
+    X(DEF_LOCAL)     /* +x: DEF, and slots[x] = the binding's index */ \
+    X(GET_LOCAL)     /* -- value of the binding slots[arg] indexes */ \
+    X(SET_LOCAL)     /* value -- : assigns the binding slots[arg] indexes */ \
+    X(CALL_LOCAL)    /* calls the word slots[arg] indexes */ \
+    X(IMPORT)        /* makes the words of module K[arg] visible */ \
+    X(YIELD)         /* calls the current word's block */ \
+    X(BLOCK_GIVEN)   /* -- bool */ \
+    X(JUMP)          /* jumps by arg */ \
+    X(JUMP_IF_FALSE) /* cond -- : jumps by arg if cond is falsy */ \
+    X(ENV_SAVE)      /* slots[arg] = environment mark */ \
+    X(ENV_RESTORE)   /* drops bindings made after slots[arg] was saved */ \
+    X(ENV_KEEP)      /* keeps the word's bindings after it returns */ \
+    X(TIMES_INIT)    /* count -- : slots[arg] = count */ \
+    X(TIMES_STEP)    /* +x: jumps by x if slots[arg]-- is zero */ \
+    X(FOR_INIT)      /* start end -- : slots[arg..arg+2] = start end 1 */ \
+    X(FOR_INIT_STEP) /* start end step -- : slots[arg..arg+2] */ \
+    X(FOR_STEP)      /* +x: -- i, or jumps by x when done */ \
+    X(DUP)           /* a -- a a */ \
+    X(DROP)          /* a -- */ \
+    X(SWAP)          /* a b -- b a */ \
+    X(OVER)          /* a b -- a b a */ \
+    X(ROT)           /* a b c -- b c a */ \
+    X(NIP)           /* a b -- b */ \
+    X(ADD)           /* a b -- a+b */ \
+    X(SUB)           /* a b -- a-b */ \
+    X(MUL)           /* a b -- a*b */ \
+    X(DIV)           /* a b -- a/b */ \
+    X(MOD)           /* a b -- a%b */ \
+    X(EQ)            /* a b -- a=b */ \
+    X(NE)            /* a b -- a!=b */ \
+    X(LT)            /* a b -- a<b */ \
+    X(GT)            /* a b -- a>b */ \
+    X(LE)            /* a b -- a<=b */ \
+    X(GE)            /* a b -- a>=b */ \
+    X(NOT)           /* a -- !a */ \
+    X(AND)           /* a b -- a&&b */ \
+    X(OR)            /* a b -- a||b */ \
+    X(STACK_MARK)    /* slots[arg] = stack depth */ \
+    X(ARRAY_NEW)     /* values above slots[arg] -- array */ \
+    DYSL_OPCODES_TABLES(X) \
+    X(GET_INDEX)     /* container key -- value */ \
+    X(SET_INDEX)     /* container key value -- */ \
+    X(APPEND)        /* container value -- */ \
+    X(LENGTH)        /* x -- length of x */ \
+    DYSL_OPCODES_FUSED(X)
+enum dy_opcode {
+#define DYSL_OPCODE_ENUM(name) DYSL_OP_##name,
+    DYSL_OPCODES(DYSL_OPCODE_ENUM)
+#undef DYSL_OPCODE_ENUM
+    // meta
+    DYSL_OP_COUNT,
+};
+#define DYSL_INSTR_ARG_MAX ((int32_t)0x7FFFFF)
+#define DYSL_INSTR_ARG_MIN (-(int32_t)0x800000)
+#define dI_op(i)  ((enum dy_opcode)((i) & 0xFF))
+#define dI_arg(i) ((int32_t)(i) >> 8)
+#define dI_make(op, arg) ((dy_instr)(op) | ((dy_instr)(arg) << 8))
+/** The comparison fused into a `JUMP_IF_NOT_*` superinstruction. */
+#define dI_branch_compare(op) \
+    ((enum dy_opcode)(DYSL_OP_EQ + ((op) - DYSL_OP_JUMP_IF_NOT_EQ)))
+#pragma endregion /* Bytecode API */
+
+#pragma region Procedure type API
+struct dy_env_cache;
+/** A procedure: either compiled bytecode or a native function.
+ *
+ * Words, blocks and procs are all procedures. */
+struct dy_proc {
+    struct dy_object header;
+    dysl_native_proc native;     /*< NULL for bytecode procedures. */
+    dysl_fast_proc fast;         /*< Set for fast natives, see `arity`. */
+    uint32_t arity;              /*< Arguments a fast native takes. */
+    struct dy_symbol* name;      /*< NULL for anonymous procedures. */
+    dy_instr* code;
+    int32_t* lines;              /*< Source line of each instruction. */
+    struct dy_value* constants;
+    /** One per constant, for the name constants the code resolves. */
+    struct dy_env_cache* caches;
+    uint32_t code_size, constant_count;
+    uint32_t slot_count;         /*< Hidden local slots, used by loops. */
+};
+struct dy_proc* dProc_create_native(
+    struct dy_gc* gc,
+    struct dy_symbol* name,
+    dysl_native_proc native
+);
+/** Creates a fast native. Its `native` is set too, so it is told apart
+ * from bytecode like any native, but is never called. */
+struct dy_proc* dProc_create_fast(
+    struct dy_gc* gc,
+    struct dy_symbol* name,
+    dysl_fast_proc fast,
+    uint32_t arity
+);
+/** Creates a bytecode procedure, taking ownership of the given buffers. */
+struct dy_proc* dProc_create(
+    struct dy_gc* gc,
+    struct dy_symbol* name,
+    dy_instr* code,
+    int32_t* lines,
+    uint32_t code_size,
+    struct dy_value* constants,
+    uint32_t constant_count,
+    uint32_t slot_count
+);
+#pragma endregion /* Procedure type API */
+
+#pragma region Slab allocator API
+/* Objects of up to `DYSL_SLAB_MAX_SIZE` bytes are rounded up to a multiple
+ * of `DYSL_SLAB_GRANULARITY` and served from that size class' free list, or
+ * carved from the current chunk when it is empty. Freeing pushes the block
+ * back onto its list, chunks are only returned when the slabs are
+ * destroyed. */
+#define DYSL_SLAB_GRANULARITY 16
+#define DYSL_SLAB_CLASS_COUNT (DYSL_SLAB_MAX_SIZE / DYSL_SLAB_GRANULARITY)
+/** A free block, linked through its first bytes. */
+struct dy_slab_block {
+    struct dy_slab_block* next;
+};
+/** A chunk of slab memory, its blocks follow the header. */
+struct dy_slab_chunk {
+    struct dy_slab_chunk* next;
+    size_t size;
+};
+struct dy_slabs {
+    struct dy_slab_block* free[DYSL_SLAB_CLASS_COUNT];
+    char *cursor, *limit;        /*< Unused part of the current chunk. */
+    struct dy_slab_chunk* chunks;
+    size_t chunk_size;
+};
+/** Returns whether blocks of `size` bytes are served by the slabs. */
+#define dSlab_serves(size) \
+    (DYSL_SLAB_ALLOCATOR && (size) <= DYSL_SLAB_MAX_SIZE)
+void dSlab_init(struct dy_slabs* slabs, size_t chunk_size);
+/** Returns every chunk to the allocator. */
+void dSlab_destroy(struct dy_slabs* slabs, struct dysl_allocator* allocator);
+/** Allocates a block of `size` (at most `DYSL_SLAB_MAX_SIZE`) bytes. */
+static inline void* dSlab_alloc(
+    struct dy_slabs* slabs,
+    size_t size,
+    struct dysl_allocator* allocator
+);
+/** Frees a block, `size` must be the size it was allocated with. */
+static inline void dSlab_free(struct dy_slabs* slabs, void* ptr, size_t size);
+/** Carves `size` bytes from the current chunk, starting a new one if needed.
+ * Carved blocks can only be freed along with their chunk. */
+void* dSlab_carve(
+    struct dy_slabs* slabs,
+    size_t size,
+    struct dysl_allocator* allocator
+);
+#pragma endregion /* Slab allocator API */
+
+#pragma region Garbage Collector API
+/* An incremental, generational mark-and-sweep collector.
+ *
+ * Objects are born young, in the `gen` list. Minor cycles only consider
+ * young objects: the reachable ones are promoted to the `old` list and the
+ * rest are swept. Major cycles consider every object.
+ *
+ * Marking is tri-color. White objects are unmarked candidates, gray objects
+ * wait in the `gray` list to have their references scanned and black
+ * objects have been scanned (and live in `old`). An object is marked when
+ * its `cycle` stamp matches the collector's, so starting a cycle whitens
+ * everything at once. When marking ends, whatever is left in `gen` is
+ * moved to the `sweep` list and freed a few objects at a time.
+ *
+ * Minor cycles never scan old objects, so storing a reference to a young
+ * object into an old one must go through `dGC_barrier()`, which puts the
+ * old object back in the gray list (the remembered set). The same barrier
+ * keeps black objects from hiding white ones during major cycles. While
+ * marking, such objects wait in the `again` list instead, and are scanned
+ * once more when marking ends: rescanning a large, often written object at
+ * every step would never let marking catch up.
+ *
+ * Stacks, environments, frames, modules and the `root` list are scanned
+ * when a cycle starts and once more when marking ends. The symbol table is
+ * weak: symbols are removed from it when swept, and revived if interned
+ * again before that.
+ *
+ * With a sweeper (see `dysl_set_sweeper`), the weak tables are instead
+ * pruned all at once when marking ends, and the `sweep` list is handed over
+ * as a batch. Nothing reaches its objects any more, so another thread can
+ * free them while the cycle ends right away. Slab blocks are not freed
+ * there, as the slabs belong to the context's thread: they are chained by
+ * size class and spliced back into the free lists when the batch is
+ * reaped. */
+enum dy_gc_state {
+    DYSL_GC_PAUSE = 0, /*< No cycle in progress. */
+    DYSL_GC_MARK,      /*< Scanning gray objects. */
+    DYSL_GC_SWEEP,     /*< Freeing the objects left white. */
+};
+struct dy_gc {
+    struct dysl_allocator allocator;
+    struct dy_slabs slabs;
+    struct dy_link root, gen;
+    struct dy_link old, gray, sweep;
+    struct dy_link again;   /*< Regrayed while marking, see `dGC_barrier`. */
+    int arena;              /*< Objects are bump allocated, never collected. */
+    uint32_t cycle;
+    int state, major;
+    size_t young_bytes;     /*< Allocated since the last cycle started. */
+    size_t old_bytes;       /*< Promoted since the last major cycle. */
+    size_t major_threshold; /*< `old_bytes` starting a major cycle. */
+    ptrdiff_t debt;         /*< A step is due when this is not negative. */
+    size_t created[DYSL_TYPE_COUNT]; /*< Objects created, by type. */
+    dysl_clock clock;       /*< Times steps and collections, if not NULL. */
+    void* clock_data;
+    uint64_t time;          /*< Spent in steps and collections. */
+#if DYSL_BACKGROUND_SWEEP
+    struct dysl_sweeper sweeper;   /*< Used if `start` is not NULL. */
+    struct dy_sweep_batch* batches; /*< Sweeps handed to the sweeper. */
+#endif /* DYSL_BACKGROUND_SWEEP */
+};
+#define dGC_allocator(gc) (&((gc)->allocator))
+void dGC_init(struct dy_gc* gc, struct dysl_allocator allocator);
+/** Switches a collector that has not allocated yet to arena mode: objects
+ * are carved from `chunk_size` byte chunks and only freed when the
+ * collector is destroyed. */
+void dGC_use_arena(struct dy_gc* gc, size_t chunk_size);
+#define dGC_is_arena(gc) ((gc)->arena)
+/** Frees every object. */
+void dGC_destroy(struct dy_gc* gc);
+static inline void dGC_track(struct dy_gc* gc, struct dy_object* obj);
+/** Keeps an object (and everything it references) alive until unrooted. */
+static inline void dGC_root(struct dy_gc* gc, struct dy_object* obj);
+static inline void dGC_unroot(struct dy_gc* gc, struct dy_object* obj);
+struct dy_object* dGC_create(struct dy_gc* gc, size_t size, dy_tag tag);
+/** Returns the size an object was allocated with, in bytes. */
+size_t dGC_object_size(const struct dy_object* obj);
+/** Frees an object, and the buffers it owns. */
+void dGC_release(struct dy_gc* gc, struct dy_object* obj);
+/** The most elements of `type` a single buffer may hold. */
+#define DYSL_BUFFER_MAX(type) \
+    ((uint32_t)dU_min((size_t)UINT32_MAX, SIZE_MAX / sizeof(type)))
+/** Resizes a buffer owned by an object, counting growth as allocation.
+ *
+ * In arena mode the new buffer is carved from the chunks and the old one is
+ * left behind. Returns NULL if allocation fails, leaving `buffer` as is. */
+void* dGC_realloc_buffer(
+    struct dy_gc* gc,
+    void* buffer,
+    size_t old_size,
+    size_t new_size
+);
+#define DYSL_ARENA_ALIGNMENT 8
+/** Marks an object as reachable. */
+void dGC_mark(struct dy_gc* gc, struct dy_object* obj);
+static inline void dGC_mark_value(struct dy_gc* gc, struct dy_value value);
+/** Write barrier, for storing a reference to `value` into `obj`. */
+static inline void dGC_barrier(
+    struct dy_gc* gc,
+    struct dy_object* obj,
+    struct dy_object* value
+);
+static inline void dGC_barrier_value(
+    struct dy_gc* gc,
+    struct dy_object* obj,
+    struct dy_value value
+);
+/** Returns whether `obj` was found unreachable and awaits sweeping. Only
+ * weak references can still lead to such an object. */
+static inline int dGC_is_dead(struct dy_gc* gc, struct dy_object* obj);
+/** Brings a dead object, found through a weak reference, back to life. */
+void dGC_revive(struct dy_gc* gc, struct dy_object* obj);
+/** Performs up to `budget` units of collection work (roughly, objects
+ * scanned or freed).
+ *
+ * When no cycle is running, one is started if enough was allocated since
+ * the last one, or always if `force` is set.
+ *
+ * @return  1 if a cycle was finished, 0 otherwise.
+ */
+int dGC_step(struct dy_global* global, size_t budget, int force);
+/** Steps the collector if enough was allocated since its last step. Only
+ * call it where every live object is reachable from the roots. */
+static inline void dGC_check(struct dysl* D);
+/** Finishes the running cycle, if any, then runs a major one. */
+void dGC_collect(struct dy_global* global);
+/** `dGC_step()` and `dGC_collect()`, untimed. They call each other, so only
+ * the outermost call is timed. */
+static int dGC_advance(struct dy_global* global, size_t budget, int force);
+static void dGC_complete(struct dy_global* global);
+#if DYSL_BACKGROUND_SWEEP
+/** Takes back the blocks of the sweeps the sweeper finished, or of all of
+ * them if `wait` is set. */
+void dGC_reap(struct dy_global* global, int wait);
+#endif /* DYSL_BACKGROUND_SWEEP */
+#pragma endregion /* Garbage Collector API */
+
+#pragma region Symbol table API
+/* An open addressing table with linear probing. Entries keep the symbol's
+ * hash next to its pointer, so probing rarely touches the symbols. The
+ * capacity is a power of two and removal shifts the following entries
+ * back, so there are no tombstones. */
+#define DYSL_SYMBOLS_INITIAL_CAPACITY 64
+#define DYSL_SYMBOLS_LOAD_FACTOR 0.75
+/** A table entry, empty when `object` is NULL. The symbol table holds
+ * symbols, and the same structure interns short strings. */
+struct dy_symbol_entry {
+    dy_hash_t hash;
+    struct dy_object* object;
+};
+struct dy_symbols {
+    struct dy_symbol_entry* entries;
+    size_t count, capacity;
+};
+/** Initializes the symbol table, `initial_capacity` must be a power of
+ * two. */
+void dSymbols_init(
+    struct dy_symbols* symbols,
+    size_t initial_capacity,
+    struct dysl_allocator* allocator
+);
+/** Destroys the symbol table structure, not the symbols themselves. */
+void dSymbols_destroy(
+    struct dy_symbols* symbols,
+    struct dysl_allocator* allocator
+);
+/** Looks up a symbol in the table, returns its entry, or the empty entry
+ * where it would be inserted. Returns NULL if the table has no entries. */
+struct dy_symbol_entry* dSymbols_lookup(
+    struct dy_symbols* symbols,
+    const char* name,
+    size_t length,
+    dy_hash_t hash,
+    int* found
+);
+/** Returns the entry for the interned symbol with the given name, growing
+ * the table if necessary.
+ *
+ * If the entry is empty, the table will have counted the new symbol and
+ * the caller is responsible for allocating it and filling the entry.
+ * Returns NULL if the table is full and could not grow.
+ */
+struct dy_symbol_entry* dSymbols_intern(
+    struct dy_symbols* symbols,
+    const char* name,
+    size_t length,
+    dy_hash_t hash,
+    struct dysl_allocator* allocator
+);
+/** Grows or shrinks the symbol table to a reasonable size that accommodates the
+ * desired count of symbols. */
+void dSymbols_ensure_capacity(
+    struct dy_symbols* symbols,
+    size_t desired_count,
+    struct dysl_allocator* allocator
+);
+/** Resizes the symbol table to the new capacity, a power of two. */
+void dSymbols_resize(
+    struct dy_symbols* symbols,
+    size_t new_capacity,
+    struct dysl_allocator* allocator
+);
+/** Returns whether the symbol table should grow to accommodate the desired
+ * count of symbols. */
+int dSymbols_should_grow(struct dy_symbols* symbols, size_t desired_count);
+/** Removes a symbol or string with the given hash from the table. */
+void dSymbols_remove(
+    struct dy_symbols* symbols,
+    struct dy_object* obj,
+    dy_hash_t hash
+);
+#pragma endregion /* Symbol table API */
+
+#if DYSL_SHARED_SYMBOLS || DYSL_BACKGROUND_SWEEP
+#if defined(__GNUC__) || defined(__clang__)
+#define dAtomic_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define dAtomic_load_relaxed(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define dAtomic_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define dAtomic_add(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define dAtomic_cas(p, expected, desired) \
+    __atomic_compare_exchange_n((p), (expected), (desired), 0, \
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else /* defined(__GNUC__) || defined(__clang__) */
+#error "[dysl] DYSL_SHARED_SYMBOLS and DYSL_BACKGROUND_SWEEP need atomics"
+#endif /* defined(__GNUC__) || defined(__clang__) */
+#endif /* DYSL_SHARED_SYMBOLS || DYSL_BACKGROUND_SWEEP */
+
+#if DYSL_SHARED_SYMBOLS
+#pragma region Shared symbol table API
+/* A fixed capacity table, open addressing with linear probing, that many
+ * threads read and insert into without locks. Entries are only ever filled,
+ * by compare-and-swap, so a probe that reaches an empty entry has seen
+ * every entry the name could be in. Inserting first claims room in the
+ * count, which stays below the capacity, so probes always end.
+ *
+ * Shared symbols are owned by no collector: they are tagged
+ * `DYSL_TAG_SHARED`, which `dGC_mark` skips, and freed with the table.
+ * Their `env_version` is bumped atomically, as any context may bind them. */
+#define DYSL_SHARED_SYMBOLS_CAPACITY 4096
+struct dysl_symbol_table {
+    struct dysl_allocator allocator;
+    uint64_t hash_seed;       /*< The seed of every context sharing it. */
+    struct dy_symbol** entries;
+    size_t capacity, limit;   /*< Entries, and how many may be filled. */
+    size_t count;             /*< Entries filled or claimed, atomic. */
+};
+/** Returns the shared symbol with the given name, creating it if needed.
+ * Returns NULL if the table is full or allocation fails. */
+struct dy_symbol* dShared_intern(
+    struct dysl_symbol_table* table,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+);
+#define dSymbol_version(sym) dAtomic_load_relaxed(&(sym)->env_version)
+#define dSymbol_bump(sym) \
+    ((sym)->header.tag & DYSL_TAG_SHARED \
+        ? (void)dAtomic_add(&(sym)->env_version, 1) \
+        : (void)(sym)->env_version++)
+#pragma endregion /* Shared symbol table API */
+#else /* DYSL_SHARED_SYMBOLS */
+#define dSymbol_version(sym) ((sym)->env_version)
+#define dSymbol_bump(sym) ((void)(sym)->env_version++)
+#endif /* DYSL_SHARED_SYMBOLS */
+
+#if DYSL_PROFILE
+#pragma region Profiler API
+/* Each named procedure gets an entry with its totals. The sampled stacks
+ * form a calling context tree: a node per distinct chain of calls, the
+ * root being the top level. Each state keeps a stack of the nodes it is
+ * running, so a sample only bumps the top node's count. */
+struct dy_profile_entry {
+    struct dy_symbol* name;
+    uint64_t calls, self_time, allocations;
+};
+struct dy_profile_node {
+    uint32_t entry;
+    uint32_t parent, child, sibling; /*< Node indices, 0 for none. */
+    uint64_t samples;
+};
+/** A running call, on a state's profiler stack. */
+struct dy_profile_frame {
+    uint32_t node;
+    uint64_t start, child_time;
+    size_t start_allocations, child_allocations;
+};
+struct dy_profiler {
+    int active;
+    dysl_clock clock;
+    void* clock_data;
+    uint64_t ticks;     /*< The clock, when there is none. */
+    uint64_t period, last_sample;
+    struct dy_profile_entry* entries;
+    size_t entry_count, entry_capacity;
+    struct dy_profile_node* nodes;   /*< The root is the first. */
+    size_t node_count, node_capacity;
+};
+/** Starts timing a call of `name`, returns 0 if it cannot be profiled. */
+static int dProfile_enter(struct dysl* D, struct dy_symbol* name);
+/** Ends the innermost profiled call. */
+static void dProfile_leave(struct dysl* D);
+#pragma endregion /* Profiler API */
+#endif /* DYSL_PROFILE */
+
+#pragma region Global context API
+/** What a context has allocated from the host's allocator. The collector,
+ * and so everything else, allocates through `dGlobal_allocate`, which
+ * keeps this up to date and enforces the limit. */
+struct dy_memory {
+    struct dysl_allocator allocator; /*< The host's allocator. */
+    size_t bytes, peak;
+    size_t allocations, refused;
+    size_t limit;       /*< 0 for none. */
+    size_t collect_at;  /*< `bytes` past which a full collection is due. */
+    int collect;        /*< A full collection is due at the next step. */
+};
+struct dy_global {
+    struct dy_memory memory;
+    struct dy_gc gc;
+    struct dy_symbols symbols;
+    struct dy_symbols strings; /*< Interned short strings, weak like symbols. */
+    struct dy_module* modules;
+    uint64_t random_state;
+    uint64_t hash_seed; /*< Seed of `dHash_slice`, prepared by `dHash_seed`. */
+    struct dysl* main_state;
+    struct dysl* threads;   /*< States made with `dysl_new_thread`. */
+#if DYSL_SHARED_SYMBOLS
+    /** Where symbols are interned first, if not NULL. */
+    struct dysl_symbol_table* shared_symbols;
+#endif /* DYSL_SHARED_SYMBOLS */
+    uint32_t env_ids;       /*< Next `dy_env` id. */
+#if DYSL_PROFILE_PAIRS
+    /** Runs of each instruction pair, indexed by `first * DYSL_OP_COUNT +
+     * second`. */
+    uint64_t pair_counts[DYSL_OP_COUNT * DYSL_OP_COUNT];
+#endif /* DYSL_PROFILE_PAIRS */
+#if DYSL_PROFILE
+    struct dy_profiler profiler;
+#endif /* DYSL_PROFILE */
+};
+#define dGlobal_gc(global) (&((global)->gc))
+void dGlobal_init(struct dy_global* global, struct dysl_allocator allocator);
+void dGlobal_destroy(struct dy_global* global);
+/** The collector's allocator function, `ud` is the global context. Counts
+ * what goes through it, and fails growth past the memory limit. */
+void* dGlobal_allocate(void* ud, void* ptr, size_t old_size, size_t new_size);
+/** Sets where the next full collection is due, halfway from the bytes now
+ * allocated to the limit. */
+void dGlobal_pace_limit(struct dy_global* global);
+/** Returns the interned symbol with the given name, creating it if needed.
+ * Returns NULL if allocation fails. */
+struct dy_symbol* dGlobal_intern(
+    struct dy_global* global,
+    const char* name,
+    size_t length
+);
+/** As `dGlobal_intern`, with the name's hash already computed. */
+struct dy_symbol* dGlobal_intern_hashed(
+    struct dy_global* global,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+);
+/** Returns a string with the given contents, the interned one if the string
+ * is short. Returns NULL if allocation fails. */
+struct dy_string* dGlobal_string(
+    struct dy_global* global,
+    const char* data,
+    size_t length
+);
+struct dy_module* dGlobal_find_module(
+    struct dy_global* global,
+    struct dy_symbol* name
+);
+/** Returns the module word a `module:word` name names, or NULL if the
+ * name is no module's word. */
+struct dy_module_entry* dGlobal_find_entry(
+    struct dy_global* global,
+    struct dy_symbol* name
+);
+#pragma endregion /* Global context API */
+
+#pragma region Value Stack API
+struct dy_stack {
+    struct dy_value* base;
+    struct dy_value* top;
+    size_t size;
+};
+#define dStack_count(stack) ((size_t)((stack)->top - (stack)->base))
+/** Returns how many more values fit before the stack must grow. */
+#define dStack_room(stack) \
+    ((size_t)((stack)->base + (stack)->size - (stack)->top))
+/** Initializes the stack with `size` values, returns 0 on failure. */
+int dStack_init(
+    struct dy_stack* stack,
+    size_t size,
+    struct dysl_allocator* allocator
+);
+void dStack_destroy(struct dy_stack* stack, struct dysl_allocator* allocator);
+/** Reallocates the stack so at least `n` more values fit, moving it.
+ * Pointers into the old stack must be recomputed after it returns.
+ *
+ * @return  `DYSL_OK`, `DYSL_ERROR_RUNTIME` if the stack would outgrow
+ *          `DYSL_STACK_MAX_SIZE` (or is fixed), or `DYSL_ERROR_MEMORY`.
+ */
+int dStack_grow(
+    struct dy_stack* stack,
+    size_t n,
+    struct dysl_allocator* allocator
+);
+#pragma endregion /* Value Stack API */
+
+#pragma region Environment API
+/** A binding in the dynamic environment. Words (`def`, natives) are called
+ * when referenced, variables (`let`) are pushed. */
+struct dy_binding {
+    struct dy_symbol* name;
+    struct dy_value value;
+    int is_word;
+};
+/** The dynamic environment stack. Bindings are resolved from the top. */
+struct dy_env {
+    struct dy_binding* bindings;
+    size_t count, capacity;
+    uint32_t id; /*< Tells apart the environments of a context's states. */
+};
+#define DYSL_ENV_INITIAL_CAPACITY 64
+void dEnv_init(struct dy_env* env);
+void dEnv_destroy(struct dy_env* env, struct dysl_allocator* allocator);
+/** Pushes a new binding, returns 0 if allocation fails. */
+int dEnv_push(
+    struct dy_env* env,
+    struct dy_symbol* name,
+    struct dy_value value,
+    int is_word,
+    struct dysl_allocator* allocator
+);
+/** Finds the innermost binding for `name`, or NULL if it is unbound. */
+static inline struct dy_binding* dEnv_find(
+    struct dy_env* env,
+    struct dy_symbol* name
+);
+/** Remembers which binding a name resolved to, and in which environment.
+ *
+ * Bindings are only ever pushed and popped, so a binding found for `name`
+ * stays its innermost one until another binding for `name` is pushed, which
+ * bumps its `env_version`, or the binding itself is popped. A module word
+ * found through its module's marker stays found as long as the marker. */
+struct dy_env_cache {
+    uint32_t version; /*< `env_version` of the name when cached, 0 if never. */
+    uint32_t index;   /*< Index of the binding, or of the module's marker. */
+    uint32_t env;     /*< `id` of the environment it was found in. */
+    struct dy_module_entry* entry; /*< The module word, NULL if not one. */
+};
+/** Returns the binding `cache` remembers for `name`, or NULL if it may not
+ * be the innermost one anymore. */
+static inline struct dy_binding* dEnv_cached(
+    struct dy_env* env,
+    struct dy_symbol* name,
+    struct dy_env_cache* cache
+);
+/** Remembers in `cache` that `name` was found bound by `binding`, or, if
+ * `entry` is not NULL, that it is the module word `entry` whose module's
+ * marker is `binding`. */
+static inline void dEnv_remember(
+    struct dy_env* env,
+    struct dy_symbol* name,
+    struct dy_binding* binding,
+    struct dy_module_entry* entry,
+    struct dy_env_cache* cache
+);
+#pragma endregion /* Environment API */
+
+#pragma region Module API
+/** A word of a registered module. Its name is interned the first time a
+ * script looks it up, and its native procedure the first time it is found
+ * imported. */
+struct dy_module_entry {
+    const char* name;           /*< The host's name of the word, unqualified. */
+    dy_hash_t hash;             /*< Hash of the qualified name, `module:word`. */
+    dysl_native_proc fn;
+    struct dy_symbol* marker;   /*< Its module's `marker`. */
+    /** The word's binding wherever its module is imported: NULL named until
+     * looked up, nil valued until found imported. */
+    struct dy_binding binding;
+};
+/** A registered module. `import` binds its `marker`, through which lookups
+ * of `module:word` names resolve to the binding of the module's entry. */
+struct dy_module {
+    struct dy_module* next;
+    struct dy_symbol* name;
+    struct dy_symbol* marker; /*< `module:`. */
+    size_t count;
+    struct dy_module_entry* entries;
+};
+/** The size of a module's block, which holds its entries. */
+#define dModule_size(count) \
+    (sizeof(struct dy_module) + (count) * sizeof(struct dy_module_entry))
+#pragma endregion /* Module API */
+
+#pragma region Interpreter state API
+/** An activation of a bytecode procedure. */
+struct dy_frame {
+    struct dy_proc* proc;
+    const dy_instr* ip;
+    struct dy_proc* block;  /*< The block passed to the word, or NULL. */
+    size_t env_base;        /*< Environment size when the word was called. */
+    size_t slot_base;       /*< Index of the procedure's first slot. */
+#if DYSL_PROFILE
+    size_t profile_depth;   /*< Profiler stack depth before the call. */
+#endif /* DYSL_PROFILE */
+};
+struct dysl {
+    struct dy_global* global;
+    struct dy_stack stack;
+    struct dy_env env;
+    struct dy_frame* frames;
+    size_t frame_count, frame_capacity;
+    struct dy_value* slots;
+    size_t slot_count, slot_capacity;
+    /** Other threads of the context, see `dysl_new_thread`. */
+    struct dysl *prev_thread, *next_thread;
+    unsigned vm_depth;      /*< Nested `dVM_execute` calls running. */
+    int suspended;          /*< Whether `dVM_execute` yielded. */
+    size_t resume_base;     /*< Base frame to resume, when suspended. */
+#if DYSL_PROFILE
+    struct dy_profile_frame* profile_frames;
+    size_t profile_depth, profile_capacity;
+#endif /* DYSL_PROFILE */
+    int status;
+    char error[DYSL_ERROR_MESSAGE_SIZE];
+    /** Whether the last compile error came from the source ending early. */
+    int incomplete;
+};
+#define dS_gc(state) dGlobal_gc((state)->global)
+#define dS_allocator(state) dGC_allocator(dS_gc(state))
+/** Initializes a state owned by `global` with a stack of `stack_size`
+ * values, returns 0 on failure. */
+int dS_init(struct dysl* D, struct dy_global* global, size_t stack_size);
+void dS_destroy(struct dysl* D);
+/** Sets the error status and message, prefixed by `line` when positive.
+ * `detail`, if not NULL, is appended quoted. Returns `status`. */
+int dS_error(
+    struct dysl* D,
+    int status,
+    int32_t line,
+    const char* message,
+    const char* detail,
+    size_t detail_length
+);
+/** Resolves an API stack index, returns NULL if out of bounds. */
+static inline struct dy_value* dS_index(struct dysl* D, int index);
+/** Makes room for `n` more values, raising an error and returning 0 if the
+ * stack cannot grow. */
+int dS_ensure_stack(struct dysl* D, size_t n);
+/** Pushes a value, raising an error if the stack is full and can't grow. */
+static inline void dS_push(struct dysl* D, struct dy_value value);
+/** Returns the source line being executed, or 0 if unknown. */
+int32_t dS_line(struct dysl* D);
+#pragma endregion /* Interpreter state API */
+
+#pragma region Lexer API
+enum dy_token_type {
+    DYSL_TOKEN_EOF = 0,
+    DYSL_TOKEN_ERROR,
+    DYSL_TOKEN_WORD,       /*< any other run of non-blank characters */
+    DYSL_TOKEN_INTEGER,    /*< 123 0x1AF 0b101010 0o777 */
+    DYSL_TOKEN_REAL,       /*< 1.23 */
+    DYSL_TOKEN_STRING,     /*< "text", `start` excludes the quotes */
+    DYSL_TOKEN_SYMBOL,     /*< :name, `start` excludes the colon */
+    DYSL_TOKEN_REF,        /*< &name, `start` excludes the ampersand */
+    DYSL_TOKEN_OPEN,       /*< { */
+    DYSL_TOKEN_PROC_OPEN,  /*< &{ */
+    DYSL_TOKEN_CLOSE,      /*< } */
+};
+struct dy_token {
+    enum dy_token_type type;
+    const char* start;
+    size_t length;
+    int32_t line;
+    union {
+        dy_int integer;
+        dy_real real;
+        const char* error;
+    } as;
+};
+/** Scans a source held in memory, or one streamed from a reader.
+ *
+ * A streamed token ending at a chunk's end may go on in the next chunk, so
+ * what is left of the chunk is carried over into `buffer` and scanned
+ * again once more input comes. Tokens then only stay valid until the next
+ * one is scanned. */
+struct dy_lexer {
+    const char* cursor;
+    const char* end;
+    int32_t line;
+    dysl_reader reader;     /*< NULL for a source in memory, or once read. */
+    void* reader_data;
+    struct dysl_allocator* allocator;
+    char* buffer;           /*< Carried over input, NUL terminated. */
+    size_t buffer_capacity;
+};
+/** Scans `length` bytes of source in memory. */
+void dLex_init(struct dy_lexer* lexer, const char* source, size_t length);
+/** Scans the source `reader` supplies, buffering with `allocator`. */
+void dLex_init_reader(
+    struct dy_lexer* lexer,
+    dysl_reader reader,
+    void* user_data,
+    struct dysl_allocator* allocator
+);
+/** Frees the lexer's buffer. */
+void dLex_destroy(struct dy_lexer* lexer);
+/** Scans the next token. */
+void dLex_next(struct dy_lexer* lexer, struct dy_token* token);
+/** Error messages of tokens that more input could have completed, or that
+ * could not be buffered. */
+static const char dLex_unterminated[] = "unterminated string";
+static const char dLex_out_of_memory[] = "out of memory";
+#pragma endregion /* Lexer API */
+
+#pragma region Compiler API
+#define DYSL_KEYWORDS(X) \
+    X(DEF, "def") X(DO, "do") X(END, "end") X(IF, "if") X(ELSE, "else") \
+    X(LOOP, "loop") X(WHILE, "while") X(TIMES, "times") X(FOR, "for") \
+    X(FOR_STEP, "for+") X(BREAK, "break") X(CONTINUE, "continue") \
+    X(IMPORT, "import") X(PROC, "proc") X(ARROW, "->") X(LET, "let") \
+    X(TRUE, "true") X(FALSE, "false") X(NIL, "nil") \
+    X(ARRAY, "array") X(TABLE, "table")
+enum dy_keyword {
+    DYSL_KW_NONE = 0,
+#define DYSL_KEYWORD_ENUM(name, text) DYSL_KW_##name,
+    DYSL_KEYWORDS(DYSL_KEYWORD_ENUM)
+#undef DYSL_KEYWORD_ENUM
+    // meta
+    DYSL_KW_COUNT,
+};
+/** A pending loop, for `break` and `continue`. */
+struct dy_loop {
+    struct dy_loop* enclosing;
+    size_t break_list, continue_list; /*< Jump chains, pc + 1 (0 = empty). */
+    uint32_t env_slot;                /*< Slot holding the environment mark. */
+    size_t env_pc;                    /*< The loop's ENV_SAVE instruction. */
+    size_t bindings;                  /*< Bindings compiled before the loop. */
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    uint32_t live;                    /*< Live names before the loop. */
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+};
+/** A binding resolved at compile time: from its `LET_LOCAL` or `DEF_LOCAL`
+ * on, and until the region it was made in closes, it is the innermost
+ * binding of its name. Callees cannot shadow it, as the bindings they make
+ * are dropped when they return. */
+struct dy_local {
+    struct dy_symbol* name;
+    uint32_t slot;           /*< Slot holding the binding's index. */
+    uint32_t region;         /*< Depth of the region it was made in. */
+    unsigned char is_word;   /*< Made by `def`. */
+    unsigned char shadowed;  /*< Rebound since, maybe conditionally. */
+};
+/** A procedure being compiled. */
+struct dy_funcstate {
+    struct dy_funcstate* enclosing;
+    struct dy_symbol* name;
+    dy_instr* code;
+    int32_t* lines;
+    size_t code_count, code_capacity;
+    struct dy_value* constants;
+    size_t constant_count, constant_capacity;
+    struct dy_loop* loop;
+    uint32_t slot_count, max_slots;
+    size_t bindings;  /*< Number of binding instructions emitted. */
+    /** Instructions before this one are jump targets or extra words, so
+     * the next instruction may not be fused into them. */
+    size_t fuse_barrier;
+    /** Resolved bindings, innermost last. A region is a block or a loop,
+     * whose bindings may be gone, or never made, once it is left. */
+    struct dy_local locals[DYSL_LOCALS_MAX > 0 ? DYSL_LOCALS_MAX : 1];
+    uint32_t local_count;
+    uint32_t region;
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    uint32_t live;    /*< Live names before the procedure. */
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+};
+struct dy_compiler {
+    struct dysl* D;
+    struct dy_lexer lexer;
+    struct dy_token token;    /*< The current token. */
+    struct dy_funcstate* fs;
+    int failed;
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    /** Names bound by the code compiled so far and still bound where the
+     * compiler is: loops drop the bindings of each iteration, procedures
+     * those of each call, and the rest stay until the script returns. */
+    struct dy_symbol** live;
+    uint32_t live_count, live_capacity;
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+};
+/** Compiles a script into a procedure, or returns NULL and sets the error. */
+struct dy_proc* dC_compile(struct dysl* D, const char* source, size_t length);
+/** Compiles the script `reader` supplies as it is read. With
+ * `keep_bindings`, the bindings made at its top level outlive its run. */
+struct dy_proc* dC_compile_reader(
+    struct dysl* D,
+    dysl_reader reader,
+    void* user_data,
+    int keep_bindings
+);
+#pragma endregion /* Compiler API */
+
+#pragma region Bytecode image API
+/* An image is a sequence of 32-bit words in the host's byte order:
+ *
+ *   header   magic, version, opcode count, language features (see
+ *            `DYSL_IMAGE_FEATURES`), symbol count, procedure count, and
+ *            the 64-bit seed the symbol hashes were made with
+ *   symbols  hash, length and bytes of each symbol
+ *   procs    name (symbol index + 1, or 0), code size, constant count,
+ *            slot count, code, lines and constants of each procedure
+ *
+ * Bytes are padded to a whole word. A constant is a kind word (its value
+ * type) followed by its value: an integer, a real in two words, a symbol
+ * index, a string's length and bytes, or the index of a procedure.
+ * Procedures come after the ones they use, the script's is the last. */
+#define DYSL_IMAGE_MAGIC 0x43427944u /* "DyBC" read as little endian */
+#define DYSL_IMAGE_VERSION 3
+#define DYSL_IMAGE_HEADER_WORDS 8
+/* the language features of the build, which the loading one must match */
+#define DYSL_IMAGE_FEATURES \
+    ((DYSL_REALS ? 1u : 0u) | (DYSL_TABLES ? 2u : 0u) | \
+     (DYSL_PROCS ? 4u : 0u) | (DYSL_SUPERINSTRUCTIONS ? 8u : 0u))
+/** Compiles a script and writes its image. */
+int dImage_dump(
+    struct dysl* D,
+    const char* source,
+    size_t length,
+    dysl_writer writer,
+    void* user_data
+);
+/** Loads an image, returns its script procedure or NULL and sets the
+ * error. */
+struct dy_proc* dImage_load(struct dysl* D, const void* image, size_t size);
+#pragma endregion /* Bytecode image API */
+
+#pragma region Virtual machine API
+/** Calls a procedure, passing it a block (which may be NULL), and runs it to
+ * completion. Returns a status code. */
+int dVM_call(struct dysl* D, struct dy_proc* proc, struct dy_proc* block);
+#pragma endregion /* Virtual machine API */
+
+#pragma region Allocator API
+static inline void* dAlloc_alloc(struct dysl_allocator* allocator, size_t size);
+static inline void* dAlloc_free(
+    struct dysl_allocator* allocator,
+    void* ptr,
+    size_t size
+);
+static inline void* dAlloc_realloc(
+    struct dysl_allocator* allocator,
+    void* ptr,
+    size_t old_size,
+    size_t new_size
+);
+#pragma endregion /* Allocator API */
+
+#pragma region Utility functions and macros
+#define dU_min(a, b) ((a) < (b) ? (a) : (b))
+#define dU_max(a, b) ((a) > (b) ? (a) : (b))
+
+/* Integer arithmetic that reports overflow instead of wrapping: each stores
+ * the result in `*r` and returns nonzero if it did not fit. */
+#if defined(__GNUC__) || defined(__clang__)
+#define dU_add_overflow(a, b, r) __builtin_add_overflow((a), (b), (r))
+#define dU_sub_overflow(a, b, r) __builtin_sub_overflow((a), (b), (r))
+#define dU_mul_overflow(a, b, r) __builtin_mul_overflow((a), (b), (r))
+#else /* defined(__GNUC__) || defined(__clang__) */
+static inline int dU_add_overflow(int32_t a, int32_t b, int32_t* r) {
+    int64_t wide = (int64_t)a + b;
+    *r = (int32_t)(uint32_t)wide;
+    return wide != *r;
+}
+
+static inline int dU_sub_overflow(int32_t a, int32_t b, int32_t* r) {
+    int64_t wide = (int64_t)a - b;
+    *r = (int32_t)(uint32_t)wide;
+    return wide != *r;
+}
+
+static inline int dU_mul_overflow(int32_t a, int32_t b, int32_t* r) {
+    int64_t wide = (int64_t)a * b;
+    *r = (int32_t)(uint32_t)wide;
+    return wide != *r;
+}
+#endif /* defined(__GNUC__) || defined(__clang__) */
+/** Divides, truncating. Returns nonzero without dividing when the divisor is
+ * zero or the quotient doesn't fit. */
+#define dU_div_overflow(a, b, r) \
+    ((b) == 0 || ((b) == -1 && (a) == INT32_MIN) ? 1 : (*(r) = (a) / (b), 0))
+
+#if DYSL_STDLIB
+/** Clears a chunk of memory (sets to zero) */
+static inline void dMem_clear(void* ptr, size_t size) {
+    memset(ptr, 0, size);
+}
+
+/** Copies a chunk of memory (from src to dest) */
+static inline void dMem_copy(void* dest, const void* src, size_t size) {
+    memcpy(dest, src, size);
+}
+#else /* DYSL_STDLIB */
+#if defined(__GNUC__) || defined(__clang__)
+/* A machine word that may alias anything and sit at any address, so the
+ * memory utilities can move whole words without breaking aliasing rules. */
+typedef uintptr_t __attribute__((__may_alias__, __aligned__(1))) dy_mem_word;
+#define DYSL_MEM_WORDS 1
+#endif /* defined(__GNUC__) || defined(__clang__) */
+
+/** Clears a chunk of memory (sets to zero) */
+static inline void dMem_clear(void* ptr, size_t size) {
+    uint8_t* p = (uint8_t*)ptr;
+#if DYSL_SIMD_SSE2
+    __m128i zero = _mm_setzero_si128();
+    for (; size >= 16; size -= 16, p += 16)
+        _mm_storeu_si128((__m128i*)p, zero);
+#elif DYSL_SIMD_NEON
+    uint8x16_t zero = vdupq_n_u8(0);
+    for (; size >= 16; size -= 16, p += 16)
+        vst1q_u8(p, zero);
+#endif /* SIMD kernels */
+#if DYSL_MEM_WORDS
+    for (; size >= sizeof(dy_mem_word); size -= sizeof(dy_mem_word)) {
+        *(dy_mem_word*)p = 0;
+        p += sizeof(dy_mem_word);
+    }
+#endif /* DYSL_MEM_WORDS */
+    for (size_t i = 0; i < size; i++)
+        p[i] = 0;
+}
+
+/** Copies a chunk of memory (from src to dest) */
+static inline void dMem_copy(void* dest, const void* src, size_t size) {
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+#if DYSL_SIMD_SSE2
+    for (; size >= 16; size -= 16, d += 16, s += 16)
+        _mm_storeu_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+#elif DYSL_SIMD_NEON
+    for (; size >= 16; size -= 16, d += 16, s += 16)
+        vst1q_u8(d, vld1q_u8(s));
+#endif /* SIMD kernels */
+#if DYSL_MEM_WORDS
+    for (; size >= sizeof(dy_mem_word); size -= sizeof(dy_mem_word)) {
+        *(dy_mem_word*)d = *(const dy_mem_word*)s;
+        d += sizeof(dy_mem_word);
+        s += sizeof(dy_mem_word);
+    }
+#endif /* DYSL_MEM_WORDS */
+    for (size_t i = 0; i < size; i++)
+        d[i] = s[i];
+}
+#endif /* DYSL_STDLIB */
+
+/** FNV-1a hash function implementation */
+static inline dy_hash_t dHash_fnv1a(const void* key, size_t length) {
+    const uint8_t* data = (const uint8_t*)key;
+    dy_hash_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/** Multiplies two 64 bit numbers into a 128 bit product, storing its low
+ * half in `a` and its high half in `b`. */
+static inline void dHash_mum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else /* defined(__SIZEOF_INT128__) */
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif /* defined(__SIZEOF_INT128__) */
+}
+
+/** Multiplies two 64 bit numbers, folding the 128 bit product. */
+static inline uint64_t dHash_mix(uint64_t a, uint64_t b) {
+    dHash_mum(&a, &b);
+    return a ^ b;
+}
+
+/** Reads a little-endian 64 bit number from any address. */
+static inline uint64_t dHash_read64(const uint8_t* p) {
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+        (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 |
+        (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+/** Reads a little-endian 32 bit number from any address. */
+static inline uint64_t dHash_read32(const uint8_t* p) {
+    return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+        (uint64_t)p[3] << 24;
+}
+
+#define DYSL_WYHASH_P0 0x2d358dccaa6c78a5ull
+#define DYSL_WYHASH_P1 0x8bb84b93962eacc9ull
+#define DYSL_WYHASH_P2 0x4b33a62ed433d4a3ull
+#define DYSL_WYHASH_P3 0x4d5a2da51de1aa47ull
+
+/** Prepares a seed for `dHash_wyhash`. */
+static inline uint64_t dHash_seed(uint64_t seed) {
+    return seed ^ dHash_mix(seed ^ DYSL_WYHASH_P0, DYSL_WYHASH_P1);
+}
+
+/** The entropy of a new context's seed, but for addresses. */
+static inline uint64_t dHash_entropy(void) {
+#ifdef DYSL_HASH_SEED_FN
+    return (uint64_t)(DYSL_HASH_SEED) ^ (uint64_t)DYSL_HASH_SEED_FN();
+#else /* DYSL_HASH_SEED_FN */
+    return (uint64_t)(DYSL_HASH_SEED);
+#endif /* DYSL_HASH_SEED_FN */
+}
+
+/** wyhash (final version 4, by Wang Yi, public domain), reading 8 to 48
+ * bytes per round. `seed` must come from `dHash_seed`. */
+static inline dy_hash_t dHash_wyhash(
+    const void* key,
+    size_t length,
+    uint64_t seed
+) {
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t a, b;
+    if (length <= 16) {
+        if (length >= 4) {
+            size_t offset = (length >> 3) << 2;
+            a = (dHash_read32(p) << 32) | dHash_read32(p + offset);
+            b = (dHash_read32(p + length - 4) << 32) |
+                dHash_read32(p + length - 4 - offset);
+        } else if (length > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) |
+                p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+        if (i >= 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = dHash_mix(dHash_read64(p) ^ DYSL_WYHASH_P1,
+                    dHash_read64(p + 8) ^ seed);
+                seed1 = dHash_mix(dHash_read64(p + 16) ^ DYSL_WYHASH_P2,
+                    dHash_read64(p + 24) ^ seed1);
+                seed2 = dHash_mix(dHash_read64(p + 32) ^ DYSL_WYHASH_P3,
+                    dHash_read64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = dHash_mix(dHash_read64(p) ^ DYSL_WYHASH_P1,
+                dHash_read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = dHash_read64(p + i - 16);
+        b = dHash_read64(p + i - 8);
+    }
+    a ^= DYSL_WYHASH_P1;
+    b ^= seed;
+    dHash_mum(&a, &b);
+    uint64_t hash = dHash_mix(a ^ DYSL_WYHASH_P0 ^ length, b ^ DYSL_WYHASH_P1);
+    return (dy_hash_t)(hash ^ (hash >> 32));
+}
+
+/** Hashes a slice of memory. This is the hash used for every string-keyed
+ * lookup, `seed` is the context's `hash_seed`. */
+#if DYSL_HASH_FNV1A
+#define dHash_slice(seed, key, length) \
+    ((void)(seed), dHash_fnv1a((key), (length)))
+#else /* DYSL_HASH_FNV1A */
+#define dHash_slice(seed, key, length) dHash_wyhash((key), (length), (seed))
+#endif /* DYSL_HASH_FNV1A */
+
+/** Compares two memory slices for equality */
+static inline int dSlice_equals(
+    const void* a,
+    size_t a_length,
+    const void* b,
+    size_t b_length
+) {
+    if (a_length != b_length)
+        return 0;
+    if (a == b)
+        return 1;
+#if DYSL_STDLIB
+    return memcmp(a, b, a_length) == 0;
+#else /* DYSL_STDLIB */
+    const uint8_t* pa = (const uint8_t*)a;
+    const uint8_t* pb = (const uint8_t*)b;
+    size_t length = a_length;
+#if DYSL_SIMD_SSE2
+    for (; length >= 16; length -= 16, pa += 16, pb += 16) {
+        __m128i eq = _mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i*)pa),
+            _mm_loadu_si128((const __m128i*)pb)
+        );
+        if (_mm_movemask_epi8(eq) != 0xFFFF)
+            return 0;
+    }
+#elif DYSL_SIMD_NEON
+    for (; length >= 16; length -= 16, pa += 16, pb += 16) {
+        if (vminvq_u8(vceqq_u8(vld1q_u8(pa), vld1q_u8(pb))) != 0xFF)
+            return 0;
+    }
+#endif /* SIMD kernels */
+#if DYSL_MEM_WORDS
+    for (; length >= sizeof(dy_mem_word); length -= sizeof(dy_mem_word)) {
+        if (*(const dy_mem_word*)pa != *(const dy_mem_word*)pb)
+            return 0;
+        pa += sizeof(dy_mem_word);
+        pb += sizeof(dy_mem_word);
+    }
+#endif /* DYSL_MEM_WORDS */
+    for (size_t i = 0; i < length; i++) {
+        if (pa[i] != pb[i])
+            return 0;
+    }
+    return 1;
+#endif /* DYSL_STDLIB */
+}
+
+/** Compares a slice against a null-terminated string */
+#define dSlice_equals_cstr(a, a_length, cstr) \
+    dSlice_equals((a), (a_length), (cstr), dU_strlen(cstr))
+
+/** Returns the length of a null-terminated string */
+static inline size_t dU_strlen(const char* s) {
+    size_t length = 0;
+    while (s[length] != '\0')
+        length++;
+    return length;
+}
+
+/** Rounds a real down to the nearest integral value */
+static inline dy_real dU_floor(dy_real x) {
+    // reals this large are already integral, NaN compares false
+    if (!(x > -4503599627370496.0 && x < 4503599627370496.0))
+        return x;
+    dy_real t = (dy_real)(int64_t)x;
+    return t > x ? t - 1 : t;
+}
+
+/** Formats an integer in decimal, returns the length (at most 20 bytes) */
+size_t dU_format_integer(char* buf, int64_t value);
+/** Formats a real, returns the length (at most `DYSL_FORMAT_BUFFER_SIZE`) */
+size_t dU_format_real(char* buf, dy_real value);
+#pragma endregion /* Utility functions and macros */
+
+/* == Implementation == */
+
+#pragma region Allocator API implementation
+static inline void* dAlloc_alloc(struct dysl_allocator* allocator, size_t size) {
+    return allocator->fn(allocator->user_data, NULL, 0, size);
+}
+static inline void* dAlloc_free(
+    struct dysl_allocator* allocator,
+    void* ptr,
+    size_t size
+) {
+    return allocator->fn(allocator->user_data, ptr, size, 0);
+}
+static inline void* dAlloc_realloc(
+    struct dysl_allocator* allocator,
+    void* ptr,
+    size_t old_size,
+    size_t new_size
+) {
+    return allocator->fn(allocator->user_data, ptr, old_size, new_size);
+}
+#pragma endregion /* Allocator API implementation */
+
+#pragma region Object (header) linked list API implementation
+static inline void dObj_close(struct dy_link* list) {
+    list->previous = list->next = list;
+}
+
+static inline void dObj_unlink(struct dy_object* obj) {
+    struct dy_link* link = dObj_links(obj);
+    link->previous->next = link->next;
+    link->next->previous = link->previous;
+    dObj_close(link);
+}
+
+static inline void dObj_link(struct dy_object* obj, struct dy_link* list) {
+    struct dy_link* link = dObj_links(obj);
+    link->next = list->next;
+    link->previous = list;
+    list->next->previous = link;
+    list->next = link;
+}
+
+static inline void dObj_splice(struct dy_link* list, struct dy_link* into) {
+    if (list->next == list)
+        return;
+    struct dy_link* first = list->next;
+    struct dy_link* last = list->previous;
+    first->previous = into;
+    last->next = into->next;
+    into->next->previous = last;
+    into->next = first;
+    dObj_close(list);
+}
+
+static inline struct dy_object* dObj_first(struct dy_link* list) {
+    return list->next == list ? NULL : dObj_from_link(list->next);
+}
+#pragma endregion /* Object (header) linked list API implementation */
+
+#pragma region Symbol type API implementation
+static inline void dSymbol_qualify(struct dy_symbol* sym) {
+    for (size_t b = 0; b < sym->length; b++) {
+        if (sym->name[b] == ':') {
+            sym->header.tag |= DYSL_TAG_QUALIFIED;
+            return;
+        }
+    }
+}
+
+struct dy_symbol* dSymbol_create(
+    struct dy_gc* gc,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+) {
+    size_t total_size = sizeof(struct dy_symbol) + length;
+    struct dy_symbol* sym = (struct dy_symbol*)dGC_create(
+        gc,
+        total_size,
+        DYSL_TYPE_SYMBOL
+    );
+    if (sym == NULL)
+        return NULL;
+    sym->length = length;
+    sym->hash = hash;
+    sym->env_version = 1;
+    dMem_copy(sym->name, name, length);
+    sym->name[length] = '\0'; // null-terminate
+    dSymbol_qualify(sym);
+    return sym;
+}
+#pragma endregion /* Symbol type API implementation */
+
+#pragma region String type API implementation
+struct dy_string* dString_create(
+    struct dy_gc* gc,
+    const char* data,
+    size_t length
+) {
+    struct dy_string* str = dString_alloc(gc, length);
+    if (str == NULL)
+        return NULL;
+    dMem_copy(str->data, data, length);
+    return str;
+}
+
+struct dy_string* dString_alloc(struct dy_gc* gc, size_t length) {
+    struct dy_string* str = (struct dy_string*)dGC_create(
+        gc,
+        sizeof(struct dy_string) + length + 1,
+        DYSL_TYPE_STRING
+    );
+    if (str == NULL)
+        return NULL;
+    str->length = length;
+    str->hash = 0;
+    str->data[length] = '\0'; // null-terminate
+    return str;
+}
+
+struct dy_string* dString_create_external(
+    struct dy_gc* gc,
+    const char* data,
+    size_t length,
+    dysl_release release,
+    void* user_data
+) {
+    struct dy_external_string* ext = (struct dy_external_string*)dGC_create(
+        gc,
+        sizeof(struct dy_external_string),
+        DYSL_TYPE_STRING | DYSL_TAG_EXTERNAL
+    );
+    if (ext == NULL)
+        return NULL;
+    ext->string.length = length;
+    ext->string.hash = 0;
+    ext->string.data[0] = '\0';
+    ext->data = data;
+    ext->release = release;
+    ext->user_data = user_data;
+    return &ext->string;
+}
+
+static inline const char* dString_data(const struct dy_string* str) {
+    if (str->header.tag & DYSL_TAG_EXTERNAL)
+        return ((const struct dy_external_string*)str)->data;
+    return str->data;
+}
+#pragma endregion /* String type API implementation */
+
+#pragma region Symbol table API implementation
+/** Allocates `capacity` empty entries. */
+static struct dy_symbol_entry* dSymbols_alloc_entries(
+    size_t capacity,
+    struct dysl_allocator* allocator
+) {
+    struct dy_symbol_entry* entries = (struct dy_symbol_entry*)dAlloc_alloc(
+        allocator,
+        sizeof(struct dy_symbol_entry) * capacity
+    );
+    if (entries == NULL)
+        return NULL;
+    for (size_t i = 0; i < capacity; i++)
+        entries[i].object = NULL;
+    return entries;
+}
+
+void dSymbols_init(
+    struct dy_symbols* symbols,
+    size_t initial_capacity,
+    struct dysl_allocator* allocator
+) {
+    symbols->count = 0;
+    symbols->entries = dSymbols_alloc_entries(initial_capacity, allocator);
+    // an unallocated table grows on first use
+    symbols->capacity = symbols->entries != NULL ? initial_capacity : 0;
+}
+
+void dSymbols_destroy(struct dy_symbols* symbols, struct dysl_allocator* allocator) {
+    // destroys only the symbol table structure,
+    // the symbols themselves should be GC'd
+    if (symbols->entries != NULL)
+        dAlloc_free(allocator, symbols->entries,
+                    sizeof(struct dy_symbol_entry) * symbols->capacity);
+    symbols->entries = NULL;
+    symbols->count = 0;
+    symbols->capacity = 0;
+}
+
+/** Returns the bytes naming a table entry's symbol or string. */
+static inline const char* dSymbols_key(struct dy_object* obj, size_t* length) {
+    if ((obj->tag & DYSL_TAG_TYPE_MASK) == DYSL_TYPE_SYMBOL) {
+        *length = ((struct dy_symbol*)obj)->length;
+        return ((struct dy_symbol*)obj)->name;
+    }
+    *length = ((struct dy_string*)obj)->length;
+    return dString_data((struct dy_string*)obj);
+}
+
+struct dy_symbol_entry* dSymbols_lookup(
+    struct dy_symbols* symbols,
+    const char* name,
+    size_t length,
+    dy_hash_t hash,
+    int* found
+) {
+    *found = 0;
+    if (symbols->capacity == 0)
+        return NULL;
+    size_t mask = symbols->capacity - 1;
+    size_t index = hash & mask;
+    for (;;) {
+        struct dy_symbol_entry* entry = &symbols->entries[index];
+        if (entry->object == NULL)
+            return entry;
+        if (entry->hash == hash) {
+            size_t entry_length;
+            const char* key = dSymbols_key(entry->object, &entry_length);
+            if (entry_length == length &&
+                dSlice_equals(key, length, name, length)) {
+                *found = 1;
+                return entry;
+            }
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+struct dy_symbol_entry* dSymbols_intern(
+    struct dy_symbols* symbols,
+    const char* name,
+    size_t length,
+    dy_hash_t hash,
+    struct dysl_allocator* allocator
+) {
+    int found = 0;
+    struct dy_symbol_entry* slot;
+    // first lookup
+    slot = dSymbols_lookup(symbols, name, length, hash, &found);
+    if (found) return slot;
+    // not found, create new symbol
+    size_t new_count = symbols->count + 1;
+    if (dSymbols_should_grow(symbols, new_count)) {
+        dSymbols_ensure_capacity(symbols, new_count, allocator);
+        // probing needs at least one empty entry left
+        if (new_count >= symbols->capacity)
+            return NULL;
+        // re-lookup after resize
+        slot = dSymbols_lookup(symbols, name, length, hash, &found);
+    }
+    symbols->count = new_count;
+    // caller allocates the symbol and fills the entry
+    return slot;
+}
+
+void dSymbols_resize(
+    struct dy_symbols* symbols,
+    size_t new_capacity,
+    struct dysl_allocator* allocator
+) {
+    if (new_capacity == symbols->capacity || new_capacity <= symbols->count)
+        return;
+    struct dy_symbol_entry* new_entries = dSymbols_alloc_entries(
+        new_capacity,
+        allocator
+    );
+    if (new_entries == NULL)
+        // Allocation failed, run at a higher load until the next resize.
+        // This keeps things functional at the cost of performance.
+        return;
+    // reinsert existing symbols, no comparisons needed
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < symbols->capacity; i++) {
+        struct dy_symbol_entry* entry = &symbols->entries[i];
+        if (entry->object == NULL)
+            continue;
+        size_t index = entry->hash & mask;
+        while (new_entries[index].object != NULL)
+            index = (index + 1) & mask;
+        new_entries[index] = *entry;
+    }
+    // free old entries
+    if (symbols->entries != NULL)
+        dAlloc_free(allocator, symbols->entries,
+                    sizeof(struct dy_symbol_entry) * symbols->capacity);
+    symbols->entries = new_entries;
+    symbols->capacity = new_capacity;
+}
+
+void dSymbols_ensure_capacity(
+    struct dy_symbols* symbols,
+    size_t desired_count,
+    struct dysl_allocator* allocator
+) {
+    size_t capacity = symbols->capacity;
+    size_t grow_threshold = (size_t)(capacity * DYSL_SYMBOLS_LOAD_FACTOR);
+    size_t shrink_threshold = capacity / 4;
+    size_t new_capacity = dU_max(capacity, DYSL_SYMBOLS_INITIAL_CAPACITY);
+    if (desired_count > grow_threshold) {
+        // need to grow
+        while (new_capacity * DYSL_SYMBOLS_LOAD_FACTOR < desired_count) {
+            new_capacity *= 2;
+        }
+    } else if (desired_count < shrink_threshold &&
+               capacity > DYSL_SYMBOLS_INITIAL_CAPACITY) {
+        // need to shrink
+        new_capacity = capacity / 2;
+        new_capacity = dU_max(new_capacity, DYSL_SYMBOLS_INITIAL_CAPACITY);
+        while (new_capacity > DYSL_SYMBOLS_INITIAL_CAPACITY &&
+               desired_count < (size_t)(new_capacity / 4)) {
+            new_capacity /= 2;
+        }
+    }
+    dSymbols_resize(symbols, new_capacity, allocator);
+}
+
+int dSymbols_should_grow(struct dy_symbols* symbols, size_t desired_count) {
+    size_t grow_threshold = (size_t)(symbols->capacity * DYSL_SYMBOLS_LOAD_FACTOR);
+    return desired_count > grow_threshold;
+}
+
+void dSymbols_remove(
+    struct dy_symbols* symbols,
+    struct dy_object* obj,
+    dy_hash_t hash
+) {
+    if (symbols->capacity == 0)
+        return;
+    size_t mask = symbols->capacity - 1;
+    size_t hole = hash & mask;
+    while (symbols->entries[hole].object != obj) {
+        if (symbols->entries[hole].object == NULL)
+            return; // not in the table
+        hole = (hole + 1) & mask;
+    }
+    // shift back the entries that probed past the hole
+    size_t index = hole;
+    for (;;) {
+        index = (index + 1) & mask;
+        struct dy_symbol_entry* entry = &symbols->entries[index];
+        if (entry->object == NULL)
+            break;
+        size_t home = entry->hash & mask;
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            symbols->entries[hole] = *entry;
+            hole = index;
+        }
+    }
+    symbols->entries[hole].object = NULL;
+    symbols->count--;
+}
+#pragma endregion /* Symbol table API implementation */
+
+#if DYSL_SHARED_SYMBOLS
+#pragma region Shared symbol table API implementation
+static struct dy_symbol* dShared_create_symbol(
+    struct dysl_symbol_table* table,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+) {
+    struct dy_symbol* sym = (struct dy_symbol*)dAlloc_alloc(
+        &table->allocator,
+        sizeof(struct dy_symbol) + length
+    );
+    if (sym == NULL)
+        return NULL;
+    // old and never white, so write barriers leave it be
+    sym->header.tag = DYSL_TYPE_SYMBOL | DYSL_TAG_OBJECT | DYSL_TAG_OLD |
+                      DYSL_TAG_SHARED;
+    sym->header.cycle = 0;
+    sym->length = length;
+    sym->hash = hash;
+    sym->env_version = 1;
+    dMem_copy(sym->name, name, length);
+    sym->name[length] = '\0';
+    dSymbol_qualify(sym);
+    return sym;
+}
+
+struct dy_symbol* dShared_intern(
+    struct dysl_symbol_table* table,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+) {
+    size_t mask = table->capacity - 1;
+    struct dy_symbol* created = NULL;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        struct dy_symbol* sym = dAtomic_load(&table->entries[index]);
+        if (sym == NULL) {
+            if (created == NULL) {
+                if (dAtomic_add(&table->count, 1) >= table->limit) {
+                    dAtomic_add(&table->count, (size_t)-1);
+                    return NULL;
+                }
+                created = dShared_create_symbol(table, name, length, hash);
+                if (created == NULL) {
+                    dAtomic_add(&table->count, (size_t)-1);
+                    return NULL;
+                }
+            }
+            if (dAtomic_cas(&table->entries[index], &sym, created))
+                return created;
+            // another thread filled the entry first, `sym` is its symbol
+        }
+        if (sym->hash == hash &&
+            dSlice_equals(sym->name, sym->length, name, length)) {
+            if (created != NULL) {
+                dAlloc_free(&table->allocator, created,
+                            sizeof(struct dy_symbol) + length);
+                dAtomic_add(&table->count, (size_t)-1);
+            }
+            return sym;
+        }
+    }
+}
+#pragma endregion /* Shared symbol table API implementation */
+#endif /* DYSL_SHARED_SYMBOLS */
+
+#pragma region Slab allocator API implementation
+/* blocks start at this offset in a chunk, keeping them aligned */
+#define DYSL_SLAB_CHUNK_HEADER \
+    ((sizeof(struct dy_slab_chunk) + DYSL_SLAB_GRANULARITY - 1) / \
+     DYSL_SLAB_GRANULARITY * DYSL_SLAB_GRANULARITY)
+#define dSlab_class(size) (((size) - 1) / DYSL_SLAB_GRANULARITY)
+
+void dSlab_init(struct dy_slabs* slabs, size_t chunk_size) {
+    for (size_t c = 0; c < DYSL_SLAB_CLASS_COUNT; c++)
+        slabs->free[c] = NULL;
+    slabs->cursor = slabs->limit = NULL;
+    slabs->chunks = NULL;
+    slabs->chunk_size = chunk_size;
+}
+
+void dSlab_destroy(struct dy_slabs* slabs, struct dysl_allocator* allocator) {
+    struct dy_slab_chunk* chunk = slabs->chunks;
+    while (chunk != NULL) {
+        struct dy_slab_chunk* next = chunk->next;
+        dAlloc_free(allocator, chunk, chunk->size);
+        chunk = next;
+    }
+    dSlab_init(slabs, slabs->chunk_size);
+}
+
+void* dSlab_carve(
+    struct dy_slabs* slabs,
+    size_t size,
+    struct dysl_allocator* allocator
+) {
+    if ((size_t)(slabs->limit - slabs->cursor) >= size) {
+        void* block = slabs->cursor;
+        slabs->cursor += size;
+        return block;
+    }
+    int oversized = size > slabs->chunk_size - DYSL_SLAB_CHUNK_HEADER;
+    size_t chunk_size = oversized
+        ? DYSL_SLAB_CHUNK_HEADER + size
+        : slabs->chunk_size;
+    struct dy_slab_chunk* chunk = (struct dy_slab_chunk*)dAlloc_alloc(
+        allocator,
+        chunk_size
+    );
+    if (chunk == NULL)
+        return NULL;
+    chunk->next = slabs->chunks;
+    chunk->size = chunk_size;
+    slabs->chunks = chunk;
+    char* block = (char*)chunk + DYSL_SLAB_CHUNK_HEADER;
+    if (!oversized) {
+        // whatever was left of the previous chunk is abandoned
+        slabs->cursor = block + size;
+        slabs->limit = (char*)chunk + chunk_size;
+    }
+    return block;
+}
+
+static inline void* dSlab_alloc(
+    struct dy_slabs* slabs,
+    size_t size,
+    struct dysl_allocator* allocator
+) {
+    size_t c = dSlab_class(size);
+    struct dy_slab_block* block = slabs->free[c];
+    if (block != NULL) {
+        slabs->free[c] = block->next;
+        return block;
+    }
+    return dSlab_carve(slabs, (c + 1) * DYSL_SLAB_GRANULARITY, allocator);
+}
+
+static inline void dSlab_free(struct dy_slabs* slabs, void* ptr, size_t size) {
+    size_t c = dSlab_class(size);
+    struct dy_slab_block* block = (struct dy_slab_block*)ptr;
+    block->next = slabs->free[c];
+    slabs->free[c] = block;
+}
+#pragma endregion /* Slab allocator API implementation */
+
+#pragma region Garbage Collector API implementation
+void dGC_init(struct dy_gc* gc, struct dysl_allocator allocator) {
+    gc->allocator = allocator;
+#if DYSL_BACKGROUND_SWEEP
+    gc->sweeper.user_data = NULL;
+    gc->sweeper.start = NULL;
+    gc->batches = NULL;
+#endif /* DYSL_BACKGROUND_SWEEP */
+    for (size_t t = 0; t < DYSL_TYPE_COUNT; t++)
+        gc->created[t] = 0;
+    gc->clock = NULL;
+    gc->clock_data = NULL;
+    gc->time = 0;
+    dSlab_init(&gc->slabs, DYSL_SLAB_CHUNK_SIZE);
+    dObj_close(&gc->root);
+    dObj_close(&gc->gen);
+    dObj_close(&gc->old);
+    dObj_close(&gc->gray);
+    dObj_close(&gc->sweep);
+    dObj_close(&gc->again);
+    gc->arena = 0;
+    gc->cycle = 0;
+    gc->state = DYSL_GC_PAUSE;
+    gc->major = 0;
+    gc->young_bytes = 0;
+    gc->old_bytes = 0;
+    gc->major_threshold = DYSL_GC_MAJOR_MIN_BYTES;
+    gc->debt = -(ptrdiff_t)DYSL_GC_MINOR_BYTES;
+}
+
+void dGC_use_arena(struct dy_gc* gc, size_t chunk_size) {
+    gc->arena = 1;
+    gc->slabs.chunk_size = chunk_size;
+    // never step
+    gc->debt = PTRDIFF_MIN;
+}
+
+/** Frees the buffers owned by an object, not the object itself. */
+static void dGC_release_buffers(
+    struct dysl_allocator* allocator,
+    struct dy_object* obj
+) {
+    if ((obj->tag & DYSL_TAG_TYPE_MASK) == DYSL_TYPE_PROCEDURE) {
+        struct dy_proc* proc = (struct dy_proc*)obj;
+        if (proc->code != NULL)
+            dAlloc_free(allocator, proc->code,
+                        sizeof(dy_instr) * proc->code_size);
+        if (proc->lines != NULL)
+            dAlloc_free(allocator, proc->lines,
+                        sizeof(int32_t) * proc->code_size);
+        if (proc->constants != NULL)
+            dAlloc_free(allocator, proc->constants,
+                        sizeof(struct dy_value) * proc->constant_count);
+    } else if ((obj->tag & DYSL_TAG_TYPE_MASK) == DYSL_TYPE_ARRAY) {
+        struct dy_array* array = (struct dy_array*)obj;
+        if (array->values != NULL)
+            dAlloc_free(allocator, array->values,
+                        sizeof(struct dy_value) * array->capacity);
+#if DYSL_TABLES
+    } else if ((obj->tag & DYSL_TAG_TYPE_MASK) == DYSL_TYPE_TABLE) {
+        struct dy_table* table = (struct dy_table*)obj;
+        if (table->array != NULL)
+            dAlloc_free(allocator, table->array,
+                        sizeof(struct dy_value) * table->array_capacity);
+        if (table->nodes != NULL)
+            dAlloc_free(allocator, table->nodes,
+                        sizeof(struct dy_table_node) * table->node_capacity);
+#endif /* DYSL_TABLES */
+    } else if ((obj->tag & DYSL_TAG_TYPE_MASK) == DYSL_TYPE_BUILDER) {
+        struct dy_builder* builder = (struct dy_builder*)obj;
+        if (builder->data != NULL)
+            dAlloc_free(allocator, builder->data, builder->capacity);
+    } else if (obj->tag & DYSL_TAG_EXTERNAL) {
+        struct dy_external_string* ext = (struct dy_external_string*)obj;
+        if (ext->release != NULL)
+            ext->release(ext->user_data, ext->data, ext->string.length);
+    }
+}
+
+static void dGC_release_list(struct dy_gc* gc, struct dy_link* list) {
+    struct dy_link* link = list->next;
+    while (link != list) {
+        struct dy_link* next = link->next;
+        struct dy_object* obj = dObj_from_link(link);
+        // slab blocks go away with their chunks
+        if (dSlab_serves(sizeof(struct dy_link) + dGC_object_size(obj)))
+            dGC_release_buffers(dGC_allocator(gc), obj);
+        else
+            dGC_release(gc, obj);
+        link = next;
+    }
+    dObj_close(list);
+}
+
+void dGC_destroy(struct dy_gc* gc) {
+    dGC_release_list(gc, &gc->root);
+    dGC_release_list(gc, &gc->gen);
+    dGC_release_list(gc, &gc->old);
+    dGC_release_list(gc, &gc->gray);
+    dGC_release_list(gc, &gc->sweep);
+    dGC_release_list(gc, &gc->again);
+    dSlab_destroy(&gc->slabs, dGC_allocator(gc));
+    gc->state = DYSL_GC_PAUSE;
+}
+
+static inline void dGC_track(struct dy_gc* gc, struct dy_object* obj) {
+    dObj_link(obj, &gc->gen);
+}
+
+static inline void dGC_root(struct dy_gc* gc, struct dy_object* obj) {
+    if (dGC_is_arena(gc))
+        return;
+    dObj_unlink(obj);
+    obj->tag = (obj->tag & ~DYSL_TAG_GRAY) | DYSL_TAG_ROOT;
+    dObj_link(obj, &gc->root);
+}
+
+static inline void dGC_unroot(struct dy_gc* gc, struct dy_object* obj) {
+    if (dGC_is_arena(gc))
+        return;
+    // it may reference anything, let the next scan find its place
+    dObj_unlink(obj);
+    obj->tag = (obj->tag & ~DYSL_TAG_ROOT) | DYSL_TAG_GRAY;
+    dObj_link(obj, &gc->gray);
+}
+
+struct dy_object* dGC_create(struct dy_gc* gc, size_t size, dy_tag tag) {
+    struct dysl_allocator* allocator = dGC_allocator(gc);
+    struct dy_object* obj;
+    if (dGC_is_arena(gc)) {
+        size_t aligned = (size + DYSL_ARENA_ALIGNMENT - 1) &
+                         ~(size_t)(DYSL_ARENA_ALIGNMENT - 1);
+        obj = (struct dy_object*)dSlab_carve(&gc->slabs, aligned, allocator);
+        if (obj == NULL)
+            return NULL;
+        obj->tag = tag | DYSL_TAG_OBJECT;
+        obj->cycle = 0;
+        gc->created[tag & DYSL_TAG_TYPE_MASK]++;
+        return obj;
+    }
+    size_t block_size = sizeof(struct dy_link) + size;
+    struct dy_link* link = (struct dy_link*)(dSlab_serves(block_size)
+        ? dSlab_alloc(&gc->slabs, block_size, allocator)
+        : dAlloc_alloc(allocator, block_size));
+    if (link == NULL)
+        return NULL;
+    obj = dObj_from_link(link);
+    obj->tag = tag | DYSL_TAG_OBJECT;
+    obj->cycle = gc->cycle - 1; // white
+    dGC_track(gc, obj);
+    gc->created[tag & DYSL_TAG_TYPE_MASK]++;
+    gc->young_bytes += size;
+    gc->debt += (ptrdiff_t)size;
+    return obj;
+}
+
+size_t dGC_object_size(const struct dy_object* obj) {
+    switch ((enum dy_type)(obj->tag & DYSL_TAG_TYPE_MASK)) {
+    case DYSL_TYPE_SYMBOL:
+        return sizeof(struct dy_symbol) + ((const struct dy_symbol*)obj)->length;
+    case DYSL_TYPE_STRING:
+        if (obj->tag & DYSL_TAG_EXTERNAL)
+            return sizeof(struct dy_external_string);
+        return sizeof(struct dy_string) +
+               ((const struct dy_string*)obj)->length + 1;
+    case DYSL_TYPE_PROCEDURE: {
+        // as padded by `dProc_create`
+        size_t align = sizeof(struct dy_value);
+        size_t caches_size = sizeof(struct dy_env_cache) *
+                             ((const struct dy_proc*)obj)->constant_count;
+        return sizeof(struct dy_proc) +
+               (caches_size + align - 1) / align * align;
+    }
+    case DYSL_TYPE_ARRAY:
+        return sizeof(struct dy_array);
+#if DYSL_TABLES
+    case DYSL_TYPE_TABLE:
+        return sizeof(struct dy_table);
+#endif /* DYSL_TABLES */
+    case DYSL_TYPE_BUILDER:
+        return sizeof(struct dy_builder);
+    default:
+        return sizeof(struct dy_object);
+    }
+}
+
+void* dGC_realloc_buffer(
+    struct dy_gc* gc,
+    void* buffer,
+    size_t old_size,
+    size_t new_size
+) {
+    struct dysl_allocator* allocator = dGC_allocator(gc);
+    if (dGC_is_arena(gc)) {
+        size_t aligned = (new_size + DYSL_ARENA_ALIGNMENT - 1) &
+                         ~(size_t)(DYSL_ARENA_ALIGNMENT - 1);
+        void* moved = dSlab_carve(&gc->slabs, aligned, allocator);
+        if (moved != NULL && buffer != NULL)
+            dMem_copy(moved, buffer, dU_min(old_size, new_size));
+        return moved;
+    }
+    void* moved = dAlloc_realloc(allocator, buffer, old_size, new_size);
+    if (moved != NULL && new_size > old_size) {
+        gc->young_bytes += new_size - old_size;
+        gc->debt += (ptrdiff_t)(new_size - old_size);
+    }
+    return moved;
+}
+
+void dGC_release(struct dy_gc* gc, struct dy_object* obj) {
+    dGC_release_buffers(dGC_allocator(gc), obj);
+    size_t block_size = sizeof(struct dy_link) + dGC_object_size(obj);
+    if (dSlab_serves(block_size))
+        dSlab_free(&gc->slabs, dObj_links(obj), block_size);
+    else
+        dAlloc_free(dGC_allocator(gc), dObj_links(obj), block_size);
+}
+
+static inline int dGC_is_white(struct dy_gc* gc, struct dy_object* obj) {
+    return obj->cycle != gc->cycle &&
+           (gc->major || !(obj->tag & DYSL_TAG_OLD));
+}
+
+/** Makes a marked object black: old, in the old list. */
+static inline void dGC_promote(struct dy_gc* gc, struct dy_object* obj) {
+    if (gc->major || !(obj->tag & DYSL_TAG_OLD))
+        gc->old_bytes += dGC_object_size(obj);
+    obj->tag |= DYSL_TAG_OLD;
+    dObj_link(obj, &gc->old);
+}
+
+static inline void dGC_regray(struct dy_gc* gc, struct dy_object* obj) {
+    dObj_unlink(obj);
+    obj->tag |= DYSL_TAG_GRAY;
+    dObj_link(obj, gc->state == DYSL_GC_MARK ? &gc->again : &gc->gray);
+}
+
+void dGC_mark(struct dy_gc* gc, struct dy_object* obj) {
+#if DYSL_SHARED_SYMBOLS
+    if (obj->tag & DYSL_TAG_SHARED)
+        return; // owned by no collector, and read by other threads
+#endif /* DYSL_SHARED_SYMBOLS */
+    if (!dGC_is_white(gc, obj))
+        return;
+    obj->cycle = gc->cycle;
+    if (obj->tag & DYSL_TAG_ROOT)
+        return; // scanned along with the roots
+    dObj_unlink(obj);
+    switch ((enum dy_type)(obj->tag & DYSL_TAG_TYPE_MASK)) {
+    case DYSL_TYPE_SYMBOL:
+    case DYSL_TYPE_STRING:
+        // no references, straight to black
+        dGC_promote(gc, obj);
+        break;
+    default:
+        obj->tag |= DYSL_TAG_GRAY;
+        dObj_link(obj, &gc->gray);
+        break;
+    }
+}
+
+static inline void dGC_mark_value(struct dy_gc* gc, struct dy_value value) {
+    if (dV_is_object(value))
+        dGC_mark(gc, dV_object(value));
+}
+
+static inline void dGC_barrier(
+    struct dy_gc* gc,
+    struct dy_object* obj,
+    struct dy_object* value
+) {
+    // young and gray objects will be scanned anyway, roots are rescanned
+    dy_tag flags = obj->tag & (DYSL_TAG_OLD | DYSL_TAG_GRAY | DYSL_TAG_ROOT);
+    if (flags != DYSL_TAG_OLD)
+        return;
+    if (gc->state == DYSL_GC_MARK && gc->major
+        ? obj->cycle == gc->cycle && value->cycle != gc->cycle
+        : !(value->tag & DYSL_TAG_OLD))
+        dGC_regray(gc, obj);
+}
+
+static inline void dGC_barrier_value(
+    struct dy_gc* gc,
+    struct dy_object* obj,
+    struct dy_value value
+) {
+    if (dV_is_object(value))
+        dGC_barrier(gc, obj, dV_object(value));
+}
+
+static inline int dGC_is_dead(struct dy_gc* gc, struct dy_object* obj) {
+    return gc->state == DYSL_GC_SWEEP &&
+           !(obj->tag & DYSL_TAG_ROOT) &&
+           dGC_is_white(gc, obj);
+}
+
+void dGC_revive(struct dy_gc* gc, struct dy_object* obj) {
+    dObj_unlink(obj);
+    obj->cycle = gc->cycle;
+    dObj_link(obj, (obj->tag & DYSL_TAG_OLD) ? &gc->old : &gc->gen);
+}
+
+/** Marks the objects referenced by `obj`, returns the work done. */
+static size_t dGC_traverse(struct dy_gc* gc, struct dy_object* obj) {
+    switch ((enum dy_type)(obj->tag & DYSL_TAG_TYPE_MASK)) {
+    case DYSL_TYPE_PROCEDURE: {
+        struct dy_proc* proc = (struct dy_proc*)obj;
+        if (proc->name != NULL)
+            dGC_mark(gc, &proc->name->header);
+        for (uint32_t k = 0; k < proc->constant_count; k++)
+            dGC_mark_value(gc, proc->constants[k]);
+        return 1 + proc->constant_count;
+    }
+    case DYSL_TYPE_ARRAY: {
+        struct dy_array* array = (struct dy_array*)obj;
+        for (uint32_t v = 0; v < array->count; v++)
+            dGC_mark_value(gc, array->values[v]);
+        return 1 + array->count;
+    }
+#if DYSL_TABLES
+    case DYSL_TYPE_TABLE: {
+        struct dy_table* table = (struct dy_table*)obj;
+        for (uint32_t v = 0; v < table->array_count; v++)
+            dGC_mark_value(gc, table->array[v]);
+        for (uint32_t n = 0; n < table->node_capacity; n++) {
+            struct dy_table_node* node = &table->nodes[n];
+            if (dV_is(node->key, DYSL_TYPE_NIL))
+                continue;
+            dGC_mark_value(gc, node->key);
+            dGC_mark_value(gc, node->value);
+        }
+        return 1 + table->array_count + table->node_capacity;
+    }
+#endif /* DYSL_TABLES */
+    default:
+        return 1;
+    }
+}
+
+/** Blackens the first gray object, returns the work done. */
+static size_t dGC_scan(struct dy_gc* gc) {
+    struct dy_object* obj = dObj_first(&gc->gray);
+    dObj_unlink(obj);
+    obj->tag &= ~DYSL_TAG_GRAY;
+    dGC_promote(gc, obj);
+    return dGC_traverse(gc, obj);
+}
+
+static void dGC_mark_state(struct dy_gc* gc, struct dysl* D) {
+    for (struct dy_value* v = D->stack.base; v < D->stack.top; v++)
+        dGC_mark_value(gc, *v);
+    for (size_t b = 0; b < D->env.count; b++) {
+        dGC_mark(gc, &D->env.bindings[b].name->header);
+        dGC_mark_value(gc, D->env.bindings[b].value);
+    }
+    for (size_t f = 0; f < D->frame_count; f++) {
+        dGC_mark(gc, &D->frames[f].proc->header);
+        if (D->frames[f].block != NULL)
+            dGC_mark(gc, &D->frames[f].block->header);
+    }
+    for (size_t s = 0; s < D->slot_count; s++)
+        dGC_mark_value(gc, D->slots[s]);
+}
+
+static void dGC_mark_roots(struct dy_global* global) {
+    struct dy_gc* gc = &global->gc;
+    for (struct dy_link* link = gc->root.next; link != &gc->root;
+         link = link->next) {
+        struct dy_object* obj = dObj_from_link(link);
+        obj->cycle = gc->cycle;
+        dGC_traverse(gc, obj);
+    }
+    for (struct dy_module* m = global->modules; m != NULL; m = m->next) {
+        dGC_mark(gc, &m->name->header);
+        dGC_mark(gc, &m->marker->header);
+        for (size_t e = 0; e < m->count; e++) {
+            if (m->entries[e].binding.name != NULL)
+                dGC_mark(gc, &m->entries[e].binding.name->header);
+            dGC_mark_value(gc, m->entries[e].binding.value);
+        }
+    }
+    if (global->main_state != NULL)
+        dGC_mark_state(gc, global->main_state);
+    for (struct dysl* D = global->threads; D != NULL; D = D->next_thread)
+        dGC_mark_state(gc, D);
+#if DYSL_PROFILE
+    // the profile outlives the procedures it names
+    for (size_t e = 0; e < global->profiler.entry_count; e++)
+        dGC_mark(gc, &global->profiler.entries[e].name->header);
+#endif /* DYSL_PROFILE */
+}
+
+static void dGC_start_cycle(struct dy_global* global) {
+    struct dy_gc* gc = &global->gc;
+    gc->cycle++; // whitens everything
+    gc->young_bytes = 0;
+    gc->major = gc->old_bytes >= gc->major_threshold;
+    if (gc->major) {
+        // every object is a candidate, the remembered set included
+        struct dy_object* obj;
+        while ((obj = dObj_first(&gc->gray)) != NULL) {
+            dObj_unlink(obj);
+            obj->tag &= ~DYSL_TAG_GRAY;
+            dObj_link(obj, &gc->gen);
+        }
+        dObj_splice(&gc->old, &gc->gen);
+        gc->old_bytes = 0;
+    }
+    gc->state = DYSL_GC_MARK;
+    dGC_mark_roots(global);
+}
+
+#if DYSL_BACKGROUND_SWEEP
+/** Dead objects handed to the sweeper, and the slab blocks it chained. */
+struct dy_sweep_batch {
+    struct dy_sweep_batch* next;
+    struct dysl_allocator* host;      /*< The host's allocator. */
+    struct dysl_allocator allocator;  /*< Frees through `host`, counting. */
+    size_t freed;                     /*< Bytes freed through `allocator`. */
+    struct dy_link objects;
+    struct dy_slab_block* heads[DYSL_SLAB_CLASS_COUNT];
+    struct dy_slab_block* tails[DYSL_SLAB_CLASS_COUNT];
+    int done; /*< Set by the sweeper when finished, atomic. */
+};
+
+/** The sweeper's allocator function, leaving the context's counts to the
+ * owner. */
+static void* dGC_sweep_free(
+    void* ud,
+    void* ptr,
+    size_t old_size,
+    size_t new_size
+) {
+    struct dy_sweep_batch* batch = (struct dy_sweep_batch*)ud;
+    batch->freed += old_size;
+    return batch->host->fn(batch->host->user_data, ptr, old_size, new_size);
+}
+
+/** Frees a batch's objects, runs on the sweeper's thread. Slab blocks are
+ * chained for the owner. */
+static void dGC_sweep_batch(void* argument) {
+    struct dy_sweep_batch* batch = (struct dy_sweep_batch*)argument;
+    struct dy_link* link = batch->objects.next;
+    while (link != &batch->objects) {
+        struct dy_link* next = link->next;
+        struct dy_object* obj = dObj_from_link(link);
+        dGC_release_buffers(&batch->allocator, obj);
+        size_t block_size = sizeof(struct dy_link) + dGC_object_size(obj);
+        if (dSlab_serves(block_size)) {
+            size_t c = dSlab_class(block_size);
+            struct dy_slab_block* block = (struct dy_slab_block*)link;
+            block->next = batch->heads[c];
+            if (batch->heads[c] == NULL)
+                batch->tails[c] = block;
+            batch->heads[c] = block;
+        } else {
+            dAlloc_free(&batch->allocator, link, block_size);
+        }
+        link = next;
+    }
+    dAtomic_store(&batch->done, 1);
+}
+
+void dGC_reap(struct dy_global* global, int wait) {
+    struct dy_gc* gc = &global->gc;
+    struct dy_sweep_batch** cursor = &gc->batches;
+    while (*cursor != NULL) {
+        struct dy_sweep_batch* batch = *cursor;
+        if (!dAtomic_load(&batch->done)) {
+            if (!wait) {
+                cursor = &batch->next;
+                continue;
+            }
+            while (!dAtomic_load(&batch->done))
+                ;
+        }
+        for (size_t c = 0; c < DYSL_SLAB_CLASS_COUNT; c++) {
+            if (batch->heads[c] == NULL)
+                continue;
+            batch->tails[c]->next = gc->slabs.free[c];
+            gc->slabs.free[c] = batch->heads[c];
+        }
+        global->memory.bytes -= batch->freed;
+        *cursor = batch->next;
+        dAlloc_free(dGC_allocator(gc), batch, sizeof(*batch));
+    }
+}
+
+/** Removes the dead objects of a weak table at once. */
+static void dGC_prune(struct dy_gc* gc, struct dy_symbols* symbols) {
+    size_t e = 0;
+    while (e < symbols->capacity) {
+        struct dy_object* obj = symbols->entries[e].object;
+        // removing shifts the following entries back, into this one
+        if (obj != NULL && dGC_is_dead(gc, obj))
+            dSymbols_remove(symbols, obj, symbols->entries[e].hash);
+        else
+            e++;
+    }
+}
+
+/** Hands the `sweep` list to the sweeper, leaving it empty. If no batch
+ * can be allocated, the list is swept as usual. */
+static void dGC_sweep_in_background(struct dy_global* global) {
+    struct dy_gc* gc = &global->gc;
+    struct dy_sweep_batch* batch = (struct dy_sweep_batch*)dAlloc_alloc(
+        dGC_allocator(gc), sizeof(*batch)
+    );
+    if (batch == NULL)
+        return;
+    // the sweeper frees them, nothing may find them again
+    dGC_prune(gc, &global->symbols);
+    dGC_prune(gc, &global->strings);
+    batch->host = &global->memory.allocator;
+    batch->allocator.user_data = batch;
+    batch->allocator.fn = dGC_sweep_free;
+    batch->freed = 0;
+    dObj_close(&batch->objects);
+    dObj_splice(&gc->sweep, &batch->objects);
+    for (size_t c = 0; c < DYSL_SLAB_CLASS_COUNT; c++)
+        batch->heads[c] = batch->tails[c] = NULL;
+    batch->done = 0;
+    batch->next = gc->batches;
+    gc->batches = batch;
+    if (!gc->sweeper.start(gc->sweeper.user_data, dGC_sweep_batch, batch))
+        dGC_sweep_batch(batch);
+}
+#endif /* DYSL_BACKGROUND_SWEEP */
+
+/** The atomic end of marking: whatever is still white is garbage. */
+static void dGC_finish_mark(struct dy_global* global) {
+    struct dy_gc* gc = &global->gc;
+    dObj_splice(&gc->again, &gc->gray);
+    dGC_mark_roots(global);
+    while (dObj_first(&gc->gray) != NULL)
+        dGC_scan(gc);
+    dObj_splice(&gc->gen, &gc->sweep);
+    gc->state = DYSL_GC_SWEEP;
+#if DYSL_BACKGROUND_SWEEP
+    if (gc->sweeper.start != NULL && dObj_first(&gc->sweep) != NULL)
+        dGC_sweep_in_background(global);
+#endif /* DYSL_BACKGROUND_SWEEP */
+}
+
+/** Frees a swept object, dropping weak references to it. */
+static void dGC_free(struct dy_global* global, struct dy_object* obj) {
+    switch (obj->tag & DYSL_TAG_TYPE_MASK) {
+    case DYSL_TYPE_SYMBOL:
+        dSymbols_remove(&global->symbols, obj, ((struct dy_symbol*)obj)->hash);
+        break;
+    case DYSL_TYPE_STRING: {
+        struct dy_string* str = (struct dy_string*)obj;
+        if (dString_is_short(str->length))
+            dSymbols_remove(&global->strings, obj, str->hash);
+        break;
+    }
+    default:
+        break;
+    }
+    dGC_release(&global->gc, obj);
+}
+
+int dGC_step(struct dy_global* global, size_t budget, int force) {
+    struct dy_gc* gc = &global->gc;
+    if (gc->clock == NULL)
+        return dGC_advance(global, budget, force);
+    uint64_t start = gc->clock(gc->clock_data);
+    int finished = dGC_advance(global, budget, force);
+    gc->time += gc->clock(gc->clock_data) - start;
+    return finished;
+}
+
+static int dGC_advance(struct dy_global* global, size_t budget, int force) {
+    struct dy_gc* gc = &global->gc;
+    if (dGC_is_arena(gc))
+        return 0;
+#if DYSL_BACKGROUND_SWEEP
+    if (gc->batches != NULL)
+        dGC_reap(global, 0);
+#endif /* DYSL_BACKGROUND_SWEEP */
+    if (!force && global->memory.collect) {
+        dGC_complete(global);
+        return 1;
+    }
+    if (gc->state == DYSL_GC_PAUSE) {
+        if (!force && gc->young_bytes < DYSL_GC_MINOR_BYTES) {
+            gc->debt = (ptrdiff_t)gc->young_bytes -
+                       (ptrdiff_t)DYSL_GC_MINOR_BYTES;
+            return 0;
+        }
+        dGC_start_cycle(global);
+    }
+    size_t work = 0;
+    while (work < budget) {
+        if (gc->state == DYSL_GC_MARK) {
+            if (dObj_first(&gc->gray) != NULL) {
+                work += dGC_scan(gc);
+            } else {
+                dGC_finish_mark(global);
+                work++;
+            }
+        } else if (dObj_first(&gc->sweep) != NULL) {
+            struct dy_object* obj = dObj_first(&gc->sweep);
+            dObj_unlink(obj);
+            dGC_free(global, obj);
+            work++;
+        } else {
+            gc->state = DYSL_GC_PAUSE;
+            if (gc->major) {
+                size_t threshold = gc->old_bytes / 100 * DYSL_GC_MAJOR_PERCENT;
+                gc->major_threshold = dU_max(threshold,
+                                             DYSL_GC_MAJOR_MIN_BYTES);
+            }
+            gc->debt = (ptrdiff_t)gc->young_bytes -
+                       (ptrdiff_t)DYSL_GC_MINOR_BYTES;
+            return 1;
+        }
+    }
+    gc->debt = -(ptrdiff_t)DYSL_GC_STEP_BYTES;
+    return 0;
+}
+
+static inline void dGC_check(struct dysl* D) {
+    if (D->global->gc.debt >= 0)
+        dGC_step(D->global, DYSL_GC_STEP_BUDGET, 0);
+}
+
+void dGC_collect(struct dy_global* global) {
+    struct dy_gc* gc = &global->gc;
+    if (gc->clock == NULL) {
+        dGC_complete(global);
+        return;
+    }
+    uint64_t start = gc->clock(gc->clock_data);
+    dGC_complete(global);
+    gc->time += gc->clock(gc->clock_data) - start;
+}
+
+static void dGC_complete(struct dy_global* global) {
+    struct dy_gc* gc = &global->gc;
+    if (dGC_is_arena(gc))
+        return;
+    global->memory.collect = 0;
+    // finish the running cycle, its marks may be stale
+    if (gc->state != DYSL_GC_PAUSE)
+        while (!dGC_advance(global, (size_t)-1, 1)) {}
+    gc->major_threshold = 0;
+    while (!dGC_advance(global, (size_t)-1, 1)) {}
+#if DYSL_BACKGROUND_SWEEP
+    // so the limit is paced from what is really left
+    if (global->memory.limit != 0)
+        dGC_reap(global, 1);
+#endif /* DYSL_BACKGROUND_SWEEP */
+    dGlobal_pace_limit(global);
+}
+#pragma endregion /* Garbage Collector API implementation */
+
+#pragma region Global context API implementation
+void dGlobal_init(struct dy_global* global, struct dysl_allocator allocator) {
+    struct dysl_allocator counted;
+    global->memory.allocator = allocator;
+    global->memory.bytes = global->memory.peak = 0;
+    global->memory.allocations = global->memory.refused = 0;
+    global->memory.limit = 0;
+    global->memory.collect_at = SIZE_MAX;
+    global->memory.collect = 0;
+    counted.user_data = global;
+    counted.fn = dGlobal_allocate;
+    dGC_init(&global->gc, counted);
+    dSymbols_init(&global->symbols, DYSL_SYMBOLS_INITIAL_CAPACITY,
+                  dGC_allocator(&global->gc));
+    dSymbols_init(&global->strings, DYSL_SYMBOLS_INITIAL_CAPACITY,
+                  dGC_allocator(&global->gc));
+    global->modules = NULL;
+    // any non-zero seed works for xorshift, the address varies between runs
+    global->random_state = 0x9E3779B97F4A7C15ull ^ (uint64_t)(uintptr_t)global;
+    // heap and stack addresses both move under ASLR, if there is any
+    global->hash_seed = dHash_seed(dHash_mix(
+        dHash_entropy() ^ (uint64_t)(uintptr_t)global,
+        (uint64_t)(uintptr_t)&allocator ^ DYSL_WYHASH_P2
+    ));
+    global->main_state = NULL;
+    global->threads = NULL;
+    global->env_ids = 0;
+#if DYSL_SHARED_SYMBOLS
+    global->shared_symbols = NULL;
+#endif /* DYSL_SHARED_SYMBOLS */
+#if DYSL_PROFILE_PAIRS
+    dMem_clear(global->pair_counts, sizeof(global->pair_counts));
+#endif /* DYSL_PROFILE_PAIRS */
+#if DYSL_PROFILE
+    dMem_clear(&global->profiler, sizeof(global->profiler));
+#endif /* DYSL_PROFILE */
+}
+
+void dGlobal_destroy(struct dy_global* global) {
+    struct dysl_allocator* allocator = dGC_allocator(&global->gc);
+#if DYSL_BACKGROUND_SWEEP
+    // sweeps in progress still use the slabs' chunks
+    dGC_reap(global, 1);
+#endif /* DYSL_BACKGROUND_SWEEP */
+    struct dy_module* module = global->modules;
+    while (module != NULL) {
+        struct dy_module* next = module->next;
+        dAlloc_free(allocator, module, dModule_size(module->count));
+        module = next;
+    }
+    global->modules = NULL;
+#if DYSL_PROFILE
+    struct dy_profiler* profiler = &global->profiler;
+    if (profiler->entries != NULL)
+        dAlloc_free(allocator, profiler->entries,
+                    sizeof(struct dy_profile_entry) * profiler->entry_capacity);
+    if (profiler->nodes != NULL)
+        dAlloc_free(allocator, profiler->nodes,
+                    sizeof(struct dy_profile_node) * profiler->node_capacity);
+#endif /* DYSL_PROFILE */
+    dSymbols_destroy(&global->symbols, allocator);
+    dSymbols_destroy(&global->strings, allocator);
+    dGC_destroy(&global->gc);
+}
+
+void* dGlobal_allocate(void* ud, void* ptr, size_t old_size, size_t new_size) {
+    struct dy_global* global = (struct dy_global*)ud;
+    struct dy_memory* memory = &global->memory;
+    if (new_size > old_size && memory->limit != 0 &&
+        new_size - old_size > memory->limit - dU_min(memory->bytes,
+                                                     memory->limit)) {
+        // nothing can be collected here, the next safe point will
+        memory->refused++;
+        memory->collect = 1;
+        global->gc.debt = 0;
+        return NULL;
+    }
+    void* block = memory->allocator.fn(memory->allocator.user_data, ptr,
+                                       old_size, new_size);
+    if (block == NULL && new_size != 0)
+        return NULL;
+    if (ptr == NULL)
+        memory->allocations++;
+    memory->bytes = memory->bytes - old_size + new_size;
+    if (memory->bytes > memory->peak)
+        memory->peak = memory->bytes;
+    if (memory->bytes > memory->collect_at && !memory->collect) {
+        memory->collect = 1;
+        global->gc.debt = 0;
+    }
+    return block;
+}
+
+void dGlobal_pace_limit(struct dy_global* global) {
+    struct dy_memory* memory = &global->memory;
+    memory->collect_at = memory->limit == 0
+        ? SIZE_MAX
+        : memory->bytes +
+          (memory->limit - dU_min(memory->bytes, memory->limit)) / 2;
+}
+
+struct dy_symbol* dGlobal_intern(
+    struct dy_global* global,
+    const char* name,
+    size_t length
+) {
+    dy_hash_t hash = dHash_slice(global->hash_seed, name, length);
+    return dGlobal_intern_hashed(global, name, length, hash);
+}
+
+struct dy_symbol* dGlobal_intern_hashed(
+    struct dy_global* global,
+    const char* name,
+    size_t length,
+    dy_hash_t hash
+) {
+#if DYSL_SHARED_SYMBOLS
+    if (global->shared_symbols != NULL) {
+        // a name the shared table refused, even while it was only full of
+        // claims, stays the context's own after the table takes it
+        int found = 0;
+        if (global->symbols.count > 0)
+            dSymbols_lookup(&global->symbols, name, length, hash, &found);
+        struct dy_symbol* shared = found
+            ? NULL
+            : dShared_intern(global->shared_symbols, name, length, hash);
+        // once the shared table is full, the context keeps new names
+        if (shared != NULL)
+            return shared;
+    }
+#endif /* DYSL_SHARED_SYMBOLS */
+    struct dy_symbol_entry* slot = dSymbols_intern(
+        &global->symbols,
+        name,
+        length,
+        hash,
+        dGC_allocator(&global->gc)
+    );
+    if (slot == NULL)
+        return NULL;
+    if (slot->object != NULL) {
+        struct dy_symbol* sym = (struct dy_symbol*)slot->object;
+        // the table is weak, the symbol may be waiting to be swept
+        if (dGC_is_dead(&global->gc, &sym->header))
+            dGC_revive(&global->gc, &sym->header);
+        return sym;
+    }
+    struct dy_symbol* sym = dSymbol_create(&global->gc, name, length, hash);
+    if (sym == NULL) {
+        // the table counted the symbol already
+        global->symbols.count--;
+        return NULL;
+    }
+    slot->hash = hash;
+    slot->object = &sym->header;
+    return sym;
+}
+
+struct dy_string* dGlobal_string(
+    struct dy_global* global,
+    const char* data,
+    size_t length
+) {
+    if (!dString_is_short(length))
+        return dString_create(&global->gc, data, length);
+    dy_hash_t hash = dHash_slice(global->hash_seed, data, length);
+    struct dy_symbol_entry* slot = dSymbols_intern(
+        &global->strings,
+        data,
+        length,
+        hash,
+        dGC_allocator(&global->gc)
+    );
+    if (slot == NULL)
+        return NULL;
+    if (slot->object != NULL) {
+        // weak like the symbol table, revive a string waiting to be swept
+        if (dGC_is_dead(&global->gc, slot->object))
+            dGC_revive(&global->gc, slot->object);
+        return (struct dy_string*)slot->object;
+    }
+    struct dy_string* str = dString_create(&global->gc, data, length);
+    if (str == NULL) {
+        global->strings.count--;
+        return NULL;
+    }
+    str->hash = hash;
+    slot->hash = hash;
+    slot->object = &str->header;
+    return str;
+}
+
+struct dy_module* dGlobal_find_module(
+    struct dy_global* global,
+    struct dy_symbol* name
+) {
+    for (struct dy_module* m = global->modules; m != NULL; m = m->next) {
+        if (m->name == name)
+            return m;
+    }
+    return NULL;
+}
+
+struct dy_module_entry* dGlobal_find_entry(
+    struct dy_global* global,
+    struct dy_symbol* name
+) {
+    if (!dSymbol_is_qualified(name))
+        return NULL;
+    for (struct dy_module* m = global->modules; m != NULL; m = m->next) {
+        size_t prefix = m->marker->length;
+        if (name->length <= prefix || name->name[prefix - 1] != ':' ||
+            !dSlice_equals(name->name, prefix, m->marker->name, prefix))
+            continue;
+        // the hashes were made with the same seed, and tell most words apart
+        for (size_t e = 0; e < m->count; e++) {
+            struct dy_module_entry* entry = &m->entries[e];
+            if (entry->hash == name->hash &&
+                dSlice_equals_cstr(name->name + prefix, name->length - prefix,
+                                   entry->name))
+                return entry;
+        }
+    }
+    return NULL;
+}
+#pragma endregion /* Global context API implementation */
+
+#pragma region Value API implementation
+#if DYSL_NAN_BOXING
+static inline dy_real dV_bits_to_real(uint64_t bits) {
+    union { uint64_t bits; dy_real real; } pun;
+    pun.bits = bits;
+    return pun.real;
+}
+
+static inline struct dy_value dV_nil(void) {
+    struct dy_value v;
+    v.bits = dV_box(DYSL_TYPE_NIL, 0);
+    return v;
+}
+
+static inline struct dy_value dV_make_integer(dy_int integer) {
+    struct dy_value v;
+    v.bits = dV_box(DYSL_TYPE_INTEGER, (uint32_t)integer);
+    return v;
+}
+
+static inline struct dy_value dV_make_real(dy_real real) {
+    union { dy_real real; uint64_t bits; } pun;
+    pun.real = real;
+    struct dy_value v;
+    // any NaN could collide with a boxed value
+    v.bits = real != real ? DYSL_NAN_CANONICAL : pun.bits;
+    return v;
+}
+
+static inline struct dy_value dV_make_boolean(dy_bool boolean) {
+    struct dy_value v;
+    v.bits = dV_box(DYSL_TYPE_BOOLEAN, boolean != 0);
+    return v;
+}
+
+static inline struct dy_value dV_make_object(struct dy_object* obj) {
+    struct dy_value v;
+    v.bits = dV_box(obj->tag & DYSL_TAG_TYPE_MASK, (uint64_t)(uintptr_t)obj);
+    return v;
+}
+#else /* DYSL_NAN_BOXING */
+static inline struct dy_value dV_nil(void) {
+    struct dy_value v;
+    v.tag = DYSL_TYPE_NIL;
+    v.as.integer = 0;
+    return v;
+}
+
+static inline struct dy_value dV_make_integer(dy_int integer) {
+    struct dy_value v;
+    v.tag = DYSL_TYPE_INTEGER;
+    v.as.integer = integer;
+    return v;
+}
+
+static inline struct dy_value dV_make_real(dy_real real) {
+    struct dy_value v;
+    v.tag = DYSL_TYPE_REAL;
+    v.as.real = real;
+    return v;
+}
+
+static inline struct dy_value dV_make_boolean(dy_bool boolean) {
+    struct dy_value v;
+    v.tag = DYSL_TYPE_BOOLEAN;
+    v.as.boolean = boolean != 0;
+    return v;
+}
+
+static inline struct dy_value dV_make_object(struct dy_object* obj) {
+    struct dy_value v;
+    v.tag = (obj->tag & DYSL_TAG_TYPE_MASK) | DYSL_TAG_OBJECT;
+    v.as.object = obj;
+    return v;
+}
+#endif /* DYSL_NAN_BOXING */
+
+/** Compares strings, by address when they are short and so interned. */
+static inline int dString_equals(struct dy_string* a, struct dy_string* b) {
+    if (a == b)
+        return 1;
+    if (a->length != b->length || dString_is_short(a->length))
+        return 0;
+    return dSlice_equals(dString_data(a), a->length,
+                         dString_data(b), b->length);
+}
+
+int dV_equals(struct dy_value a, struct dy_value b) {
+    if (dV_is_number(a) && dV_is_number(b)) {
+        if (dV_is(a, DYSL_TYPE_INTEGER) && dV_is(b, DYSL_TYPE_INTEGER))
+            return dV_integer(a) == dV_integer(b);
+        return dV_to_real(a) == dV_to_real(b);
+    }
+    if (dV_type(a) != dV_type(b))
+        return 0;
+    switch (dV_type(a)) {
+    case DYSL_TYPE_NIL:
+        return 1;
+    case DYSL_TYPE_BOOLEAN:
+        return dV_boolean(a) == dV_boolean(b);
+    case DYSL_TYPE_CHARACTER:
+        return dV_character(a) == dV_character(b);
+    case DYSL_TYPE_STRING:
+        return dString_equals(dV_string(a), dV_string(b));
+    default:
+        return dV_object(a) == dV_object(b);
+    }
+}
+
+const char* dV_format(struct dy_value value, char* buf, size_t* length) {
+    const char* text;
+    switch (dV_type(value)) {
+    case DYSL_TYPE_NIL:
+        text = "nil";
+        break;
+    case DYSL_TYPE_BOOLEAN:
+        text = dV_boolean(value) ? "true" : "false";
+        break;
+    case DYSL_TYPE_INTEGER:
+        *length = dU_format_integer(buf, dV_integer(value));
+        return buf;
+    case DYSL_TYPE_REAL:
+        *length = dU_format_real(buf, dV_real(value));
+        return buf;
+    case DYSL_TYPE_CHARACTER: {
+        // encode as UTF-8
+        uint32_t c = (uint32_t)dV_character(value);
+        size_t n = 0;
+        if (c < 0x80) {
+            buf[n++] = (char)c;
+        } else if (c < 0x800) {
+            buf[n++] = (char)(0xC0 | (c >> 6));
+            buf[n++] = (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            buf[n++] = (char)(0xE0 | (c >> 12));
+            buf[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            buf[n++] = (char)(0x80 | (c & 0x3F));
+        } else {
+            buf[n++] = (char)(0xF0 | ((c >> 18) & 0x07));
+            buf[n++] = (char)(0x80 | ((c >> 12) & 0x3F));
+            buf[n++] = (char)(0x80 | ((c >> 6) & 0x3F));
+            buf[n++] = (char)(0x80 | (c & 0x3F));
+        }
+        *length = n;
+        return buf;
+    }
+    case DYSL_TYPE_STRING:
+        *length = dV_string(value)->length;
+        return dString_data(dV_string(value));
+    case DYSL_TYPE_SYMBOL:
+        *length = dV_symbol(value)->length;
+        return dV_symbol(value)->name;
+    case DYSL_TYPE_ARRAY:
+        text = "<array>";
+        break;
+    case DYSL_TYPE_TABLE:
+        text = "<table>";
+        break;
+    case DYSL_TYPE_BUILDER:
+        *length = dV_builder(value)->length;
+        return dV_builder(value)->data != NULL ? dV_builder(value)->data : "";
+    case DYSL_TYPE_PROCEDURE:
+        text = dV_proc(value)->native != NULL ? "<native proc>" : "<proc>";
+        break;
+    default:
+        text = "<unknown>";
+        break;
+    }
+    *length = dU_strlen(text);
+    return text;
+}
+#pragma endregion /* Value API implementation */
+
+#pragma region Utility functions implementation
+size_t dU_format_integer(char* buf, int64_t value) {
+    char digits[20];
+    size_t n = 0, count = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+        buf[n++] = '-';
+    while (count > 0)
+        buf[n++] = digits[--count];
+    return n;
+}
+
+size_t dU_format_real(char* buf, dy_real value) {
+    size_t n = 0;
+#if DYSL_STDIO
+    int written = snprintf(buf, DYSL_FORMAT_BUFFER_SIZE, "%.14g", value);
+    n = written < 0 ? 0 : dU_min((size_t)written, DYSL_FORMAT_BUFFER_SIZE - 1);
+#else /* DYSL_STDIO */
+    // six fractional digits, switching to exponent notation outside of
+    // [1e-5, 1e12)
+    if (value != value) {
+        dMem_copy(buf, "nan", 3);
+        return 3;
+    }
+    if (value < 0) {
+        buf[n++] = '-';
+        value = -value;
+    }
+    if (value > 1.7976931348623157e308) {
+        dMem_copy(buf + n, "inf", 3);
+        return n + 3;
+    }
+    int exponent = 0;
+    if (value >= 1e12) {
+        while (value >= 10) {
+            value /= 10;
+            exponent++;
+        }
+    } else if (value != 0 && value < 1e-5) {
+        while (value < 1) {
+            value *= 10;
+            exponent--;
+        }
+    }
+    uint64_t scaled = (uint64_t)(value * 1e6 + 0.5);
+    n += dU_format_integer(buf + n, (int64_t)(scaled / 1000000));
+    uint64_t fraction = scaled % 1000000;
+    if (fraction != 0) {
+        buf[n++] = '.';
+        for (uint64_t d = 100000; d > 0 && fraction != 0; d /= 10) {
+            buf[n++] = (char)('0' + fraction / d);
+            fraction %= d;
+        }
+    }
+    if (exponent != 0) {
+        buf[n++] = 'e';
+        n += dU_format_integer(buf + n, exponent);
+    }
+#endif /* DYSL_STDIO */
+    // make sure it reads back as a real
+    for (size_t i = 0; i < n; i++) {
+        char c = buf[i];
+        if (c == '.' || c == 'e' || c == 'n' || c == 'i')
+            return n;
+    }
+    buf[n++] = '.';
+    buf[n++] = '0';
+    return n;
+}
+#pragma endregion /* Utility functions implementation */
+
+#pragma region Procedure type API implementation
+struct dy_proc* dProc_create_native(
+    struct dy_gc* gc,
+    struct dy_symbol* name,
+    dysl_native_proc native
+) {
+    struct dy_proc* proc = dProc_create(gc, name, NULL, NULL, 0, NULL, 0, 0);
+    if (proc == NULL)
+        return NULL;
+    proc->native = native;
+    return proc;
+}
+
+/** The `native` of fast natives, see `dVM_call_fast`. */
+static void dProc_fast_native(struct dysl* D) {
+    (void)D;
+}
+
+struct dy_proc* dProc_create_fast(
+    struct dy_gc* gc,
+    struct dy_symbol* name,
+    dysl_fast_proc fast,
+    uint32_t arity
+) {
+    struct dy_proc* proc = dProc_create_native(gc, name, dProc_fast_native);
+    if (proc == NULL)
+        return NULL;
+    proc->fast = fast;
+    proc->arity = arity;
+    return proc;
+}
+
+struct dy_proc* dProc_create(
+    struct dy_gc* gc,
+    struct dy_symbol* name,
+    dy_instr* code,
+    int32_t* lines,
+    uint32_t code_size,
+    struct dy_value* constants,
+    uint32_t constant_count,
+    uint32_t slot_count
+) {
+    // the caches live right after the procedure, padded so the buffers
+    // moved in after them stay aligned
+    size_t align = sizeof(struct dy_value);
+    size_t caches_size = sizeof(struct dy_env_cache) * constant_count;
+    caches_size = (caches_size + align - 1) / align * align;
+    size_t size = sizeof(struct dy_proc) + caches_size;
+    size_t constants_size = sizeof(struct dy_value) * constant_count;
+    size_t code_size_bytes = sizeof(dy_instr) * code_size;
+    size_t lines_size = lines != NULL ? sizeof(int32_t) * code_size : 0;
+    // in arena mode the buffers move in right after the procedure
+    if (dGC_is_arena(gc))
+        size += constants_size + code_size_bytes + lines_size;
+    struct dy_proc* proc = (struct dy_proc*)dGC_create(
+        gc,
+        size,
+        DYSL_TYPE_PROCEDURE
+    );
+    if (proc == NULL)
+        return NULL;
+    struct dy_env_cache* caches = (struct dy_env_cache*)(proc + 1);
+    for (uint32_t c = 0; c < constant_count; c++)
+        caches[c].version = 0;
+    if (dGC_is_arena(gc)) {
+        struct dysl_allocator* allocator = dGC_allocator(gc);
+        char* buffer = (char*)caches + caches_size;
+        if (constants != NULL) {
+            dMem_copy(buffer, constants, constants_size);
+            dAlloc_free(allocator, constants, constants_size);
+            constants = (struct dy_value*)buffer;
+            buffer += constants_size;
+        }
+        if (code != NULL) {
+            dMem_copy(buffer, code, code_size_bytes);
+            dAlloc_free(allocator, code, code_size_bytes);
+            code = (dy_instr*)buffer;
+            buffer += code_size_bytes;
+        }
+        if (lines != NULL) {
+            dMem_copy(buffer, lines, lines_size);
+            dAlloc_free(allocator, lines, lines_size);
+            lines = (int32_t*)buffer;
+        }
+    }
+    proc->native = NULL;
+    proc->fast = NULL;
+    proc->arity = 0;
+    proc->name = name;
+    proc->code = code;
+    proc->lines = lines;
+    proc->code_size = code_size;
+    proc->constants = constants;
+    proc->caches = caches;
+    proc->constant_count = constant_count;
+    proc->slot_count = slot_count;
+    return proc;
+}
+#pragma endregion /* Procedure type API implementation */
+
+#pragma region Array type API implementation
+struct dy_array* dArray_create(struct dy_gc* gc, uint32_t capacity) {
+    struct dy_array* array = (struct dy_array*)dGC_create(
+        gc,
+        sizeof(struct dy_array),
+        DYSL_TYPE_ARRAY
+    );
+    if (array == NULL)
+        return NULL;
+    array->values = NULL;
+    array->count = array->capacity = 0;
+    if (capacity > 0 && !dArray_reserve(gc, array, capacity))
+        return NULL;
+    return array;
+}
+
+int dArray_reserve(struct dy_gc* gc, struct dy_array* array, uint32_t capacity) {
+    if (capacity <= array->capacity)
+        return 1;
+    uint32_t new_capacity = array->capacity == 0
+        ? DYSL_ARRAY_INITIAL_CAPACITY
+        : array->capacity;
+    while (new_capacity < capacity && new_capacity <= UINT32_MAX / 2)
+        new_capacity *= 2;
+    new_capacity = dU_max(new_capacity, capacity);
+    if (new_capacity > DYSL_BUFFER_MAX(struct dy_value))
+        return 0;
+    struct dy_value* values = (struct dy_value*)dGC_realloc_buffer(
+        gc,
+        array->values,
+        sizeof(struct dy_value) * array->capacity,
+        sizeof(struct dy_value) * new_capacity
+    );
+    if (values == NULL)
+        return 0;
+    array->values = values;
+    array->capacity = new_capacity;
+    return 1;
+}
+
+int dArray_push(struct dy_gc* gc, struct dy_array* array, struct dy_value value) {
+    if (array->count == UINT32_MAX ||
+        !dArray_reserve(gc, array, array->count + 1))
+        return 0;
+    array->values[array->count++] = value;
+    dGC_barrier_value(gc, &array->header, value);
+    return 1;
+}
+#pragma endregion /* Array type API implementation */
+
+#pragma region Builder type API implementation
+struct dy_builder* dBuilder_create(struct dy_gc* gc, size_t capacity) {
+    struct dy_builder* builder = (struct dy_builder*)dGC_create(
+        gc,
+        sizeof(struct dy_builder),
+        DYSL_TYPE_BUILDER
+    );
+    if (builder == NULL)
+        return NULL;
+    builder->data = NULL;
+    builder->length = builder->capacity = 0;
+    if (capacity > 0 && !dBuilder_reserve(gc, builder, capacity))
+        return NULL;
+    return builder;
+}
+
+int dBuilder_reserve(struct dy_gc* gc, struct dy_builder* builder, size_t capacity) {
+    if (capacity <= builder->capacity)
+        return 1;
+    size_t new_capacity = builder->capacity == 0
+        ? DYSL_BUILDER_INITIAL_CAPACITY
+        : builder->capacity;
+    while (new_capacity < capacity && new_capacity <= SIZE_MAX / 2)
+        new_capacity *= 2;
+    new_capacity = dU_max(new_capacity, capacity);
+    char* data = (char*)dGC_realloc_buffer(
+        gc,
+        builder->data,
+        builder->capacity,
+        new_capacity
+    );
+    if (data == NULL)
+        return 0;
+    builder->data = data;
+    builder->capacity = new_capacity;
+    return 1;
+}
+
+int dBuilder_append(
+    struct dy_gc* gc,
+    struct dy_builder* builder,
+    const char* data,
+    size_t length
+) {
+    if (length == 0)
+        return 1;
+    // appending the builder to itself reads from the buffer being grown
+    int self = data == builder->data;
+    if (length > SIZE_MAX - builder->length ||
+        !dBuilder_reserve(gc, builder, builder->length + length))
+        return 0;
+    if (self)
+        data = builder->data;
+    dMem_copy(builder->data + builder->length, data, length);
+    builder->length += length;
+    return 1;
+}
+#pragma endregion /* Builder type API implementation */
+
+#pragma region Table type API implementation
+/** Normalizes a key in place, returns 0 if it cannot be one (nil, NaN). */
+static inline int dTable_key(struct dy_value* key) {
+    if (dV_is(*key, DYSL_TYPE_REAL)) {
+        dy_real real = dV_real(*key);
+        if (real != real)
+            return 0;
+        if (real >= (dy_real)INT32_MIN && real <= (dy_real)INT32_MAX &&
+            (dy_real)(dy_int)real == real)
+            *key = dV_make_integer((dy_int)real);
+        return 1;
+    }
+    return !dV_is(*key, DYSL_TYPE_NIL);
+}
+
+#if DYSL_TABLES
+static dy_hash_t dTable_hash(struct dy_global* global, struct dy_value key) {
+    uint64_t bits;
+    switch (dV_type(key)) {
+    case DYSL_TYPE_SYMBOL:
+        return dV_symbol(key)->hash;
+    case DYSL_TYPE_STRING:
+        if (dString_is_short(dV_string(key)->length))
+            return dV_string(key)->hash;
+        return dHash_slice(global->hash_seed, dString_data(dV_string(key)),
+                           dV_string(key)->length);
+    case DYSL_TYPE_INTEGER:
+        bits = (uint32_t)dV_integer(key);
+        break;
+    case DYSL_TYPE_REAL: {
+        union { dy_real real; uint64_t bits; } pun;
+        pun.real = dV_real(key);
+        bits = pun.bits;
+        break;
+    }
+    case DYSL_TYPE_BOOLEAN:
+        bits = (uint64_t)dV_boolean(key);
+        break;
+    case DYSL_TYPE_CHARACTER:
+        bits = (uint32_t)dV_character(key);
+        break;
+    default:
+        bits = (uint64_t)(uintptr_t)dV_object(key);
+        break;
+    }
+    uint64_t hash = dHash_mix(bits ^ global->hash_seed,
+                              DYSL_WYHASH_P1 ^ (uint64_t)dV_type(key));
+    return (dy_hash_t)(hash ^ (hash >> 32));
+}
+
+static inline int dTable_key_equals(struct dy_value a, struct dy_value b) {
+    if (dV_is(a, DYSL_TYPE_SYMBOL))
+        return dV_is(b, DYSL_TYPE_SYMBOL) && dV_object(a) == dV_object(b);
+    if (dV_is(a, DYSL_TYPE_STRING))
+        return dV_is(b, DYSL_TYPE_STRING) &&
+               dString_equals(dV_string(a), dV_string(b));
+    return dV_equals(a, b);
+}
+
+/** Returns the node holding `key`, or the empty node where it would be
+ * inserted. The hash part must have been allocated. */
+static struct dy_table_node* dTable_probe(
+    struct dy_table* table,
+    struct dy_value key,
+    dy_hash_t hash,
+    int* found
+) {
+    uint32_t mask = table->node_capacity - 1;
+    uint32_t index = hash & mask;
+    for (;;) {
+        struct dy_table_node* node = &table->nodes[index];
+        if (dV_is(node->key, DYSL_TYPE_NIL)) {
+            *found = 0;
+            return node;
+        }
+        if (node->hash == hash && dTable_key_equals(node->key, key)) {
+            *found = 1;
+            return node;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+/** Reallocates the hash part with `capacity` nodes, a power of two. */
+static int dTable_resize(
+    struct dy_gc* gc,
+    struct dy_table* table,
+    uint32_t capacity
+) {
+    if (capacity > DYSL_BUFFER_MAX(struct dy_table_node))
+        return 0;
+    struct dy_table_node* nodes = (struct dy_table_node*)dGC_realloc_buffer(
+        gc,
+        NULL,
+        0,
+        sizeof(struct dy_table_node) * capacity
+    );
+    if (nodes == NULL)
+        return 0;
+    for (uint32_t n = 0; n < capacity; n++)
+        nodes[n].key = dV_nil();
+    // reinsert the keys, their hashes are cached
+    uint32_t mask = capacity - 1;
+    for (uint32_t n = 0; n < table->node_capacity; n++) {
+        struct dy_table_node* node = &table->nodes[n];
+        if (dV_is(node->key, DYSL_TYPE_NIL))
+            continue;
+        uint32_t index = node->hash & mask;
+        while (!dV_is(nodes[index].key, DYSL_TYPE_NIL))
+            index = (index + 1) & mask;
+        nodes[index] = *node;
+    }
+    if (table->nodes != NULL && !dGC_is_arena(gc))
+        dAlloc_free(dGC_allocator(gc), table->nodes,
+                    sizeof(struct dy_table_node) * table->node_capacity);
+    table->nodes = nodes;
+    table->node_capacity = capacity;
+    return 1;
+}
+
+/** Empties a node, shifting back the nodes that probed past it. */
+static void dTable_remove_node(
+    struct dy_table* table,
+    struct dy_table_node* node
+) {
+    uint32_t mask = table->node_capacity - 1;
+    uint32_t hole = (uint32_t)(node - table->nodes);
+    uint32_t index = hole;
+    for (;;) {
+        index = (index + 1) & mask;
+        struct dy_table_node* next = &table->nodes[index];
+        if (dV_is(next->key, DYSL_TYPE_NIL))
+            break;
+        uint32_t home = next->hash & mask;
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            table->nodes[hole] = *next;
+            hole = index;
+        }
+    }
+    table->nodes[hole].key = dV_nil();
+    table->node_count--;
+}
+
+/** Appends a value to the array part, then moves in the keys that follow
+ * it from the hash part. */
+static int dTable_append(
+    struct dy_global* global,
+    struct dy_table* table,
+    struct dy_value value
+) {
+    struct dy_gc* gc = &global->gc;
+    for (;;) {
+        if (table->array_count == table->array_capacity) {
+            uint32_t capacity = table->array_capacity == 0
+                ? DYSL_ARRAY_INITIAL_CAPACITY
+                : table->array_capacity * 2;
+            if (table->array_capacity > UINT32_MAX / 2 ||
+                capacity > DYSL_BUFFER_MAX(struct dy_value))
+                return DYSL_ERROR_MEMORY;
+            struct dy_value* array = (struct dy_value*)dGC_realloc_buffer(
+                gc,
+                table->array,
+                sizeof(struct dy_value) * table->array_capacity,
+                sizeof(struct dy_value) * capacity
+            );
+            if (array == NULL)
+                return DYSL_ERROR_MEMORY;
+            table->array = array;
+            table->array_capacity = capacity;
+        }
+        table->array[table->array_count++] = value;
+        dGC_barrier_value(gc, &table->header, value);
+        if (table->node_count == 0 || table->array_count >= INT32_MAX)
+            return DYSL_OK;
+        struct dy_value key = dV_make_integer((dy_int)table->array_count + 1);
+        int found;
+        struct dy_table_node* node = dTable_probe(
+            table, key, dTable_hash(global, key), &found
+        );
+        if (!found)
+            return DYSL_OK;
+        value = node->value;
+        dTable_remove_node(table, node);
+    }
+}
+
+struct dy_table* dTable_create(struct dy_gc* gc, uint32_t node_count) {
+    struct dy_table* table = (struct dy_table*)dGC_create(
+        gc,
+        sizeof(struct dy_table),
+        DYSL_TYPE_TABLE
+    );
+    if (table == NULL)
+        return NULL;
+    table->array = NULL;
+    table->nodes = NULL;
+    table->array_count = table->array_capacity = 0;
+    table->node_count = table->node_capacity = 0;
+    if (node_count > 0) {
+        uint32_t capacity = DYSL_TABLE_MIN_NODES;
+        while (capacity / 4 * 3 < node_count && capacity <= UINT32_MAX / 2)
+            capacity *= 2;
+        if (!dTable_resize(gc, table, capacity))
+            return NULL;
+    }
+    return table;
+}
+
+struct dy_value dTable_get(
+    struct dy_global* global,
+    struct dy_table* table,
+    struct dy_value key
+) {
+    if (!dTable_key(&key))
+        return dV_nil();
+    if (dV_is(key, DYSL_TYPE_INTEGER)) {
+        uint32_t index = (uint32_t)dV_integer(key) - 1;
+        if (index < table->array_count)
+            return table->array[index];
+    }
+    if (table->node_count == 0)
+        return dV_nil();
+    int found;
+    struct dy_table_node* node = dTable_probe(
+        table, key, dTable_hash(global, key), &found
+    );
+    return found ? node->value : dV_nil();
+}
+
+int dTable_set(
+    struct dy_global* global,
+    struct dy_table* table,
+    struct dy_value key,
+    struct dy_value value
+) {
+    struct dy_gc* gc = &global->gc;
+    int removing = dV_is(value, DYSL_TYPE_NIL);
+    if (!dTable_key(&key))
+        return DYSL_ERROR_RUNTIME;
+    if (dV_is(key, DYSL_TYPE_INTEGER)) {
+        uint32_t index = (uint32_t)dV_integer(key) - 1;
+        if (index < table->array_count) {
+            table->array[index] = value;
+            dGC_barrier_value(gc, &table->header, value);
+            // the array part ends at its last non-nil value
+            while (table->array_count > 0 &&
+                   dV_is(table->array[table->array_count - 1],
+                         DYSL_TYPE_NIL))
+                table->array_count--;
+            return DYSL_OK;
+        }
+        if (index == table->array_count && !removing)
+            return dTable_append(global, table, value);
+    }
+    if (table->node_capacity == 0 && removing)
+        return DYSL_OK;
+    dy_hash_t hash = dTable_hash(global, key);
+    int found = 0;
+    struct dy_table_node* node = NULL;
+    if (table->node_capacity > 0)
+        node = dTable_probe(table, key, hash, &found);
+    if (removing) {
+        if (found)
+            dTable_remove_node(table, node);
+        return DYSL_OK;
+    }
+    if (!found) {
+        if ((table->node_count + 1) > table->node_capacity / 4 * 3) {
+            uint32_t capacity = table->node_capacity == 0
+                ? DYSL_TABLE_MIN_NODES
+                : table->node_capacity * 2;
+            if (table->node_capacity > UINT32_MAX / 2 ||
+                !dTable_resize(gc, table, capacity))
+                return DYSL_ERROR_MEMORY;
+            node = dTable_probe(table, key, hash, &found);
+        }
+        node->key = key;
+        node->hash = hash;
+        table->node_count++;
+        dGC_barrier_value(gc, &table->header, key);
+    }
+    node->value = value;
+    dGC_barrier_value(gc, &table->header, value);
+    return DYSL_OK;
+}
+#endif /* DYSL_TABLES */
+#pragma endregion /* Table type API implementation */
+
+#pragma region Value Stack API implementation
+int dStack_init(
+    struct dy_stack* stack,
+    size_t size,
+    struct dysl_allocator* allocator
+) {
+    stack->base = (struct dy_value*)dAlloc_alloc(
+        allocator,
+        sizeof(struct dy_value) * size
+    );
+    stack->top = stack->base;
+    stack->size = stack->base != NULL ? size : 0;
+    return stack->base != NULL;
+}
+
+void dStack_destroy(struct dy_stack* stack, struct dysl_allocator* allocator) {
+    if (stack->base != NULL)
+        dAlloc_free(allocator, stack->base,
+                    sizeof(struct dy_value) * stack->size);
+    stack->base = stack->top = NULL;
+    stack->size = 0;
+}
+
+int dStack_grow(
+    struct dy_stack* stack,
+    size_t n,
+    struct dysl_allocator* allocator
+) {
+#if DYSL_STACK_FIXED
+    (void)n;
+    (void)allocator;
+    (void)stack;
+    return DYSL_ERROR_RUNTIME;
+#else /* DYSL_STACK_FIXED */
+    size_t count = dStack_count(stack);
+    if (n > DYSL_STACK_MAX_SIZE - count)
+        return DYSL_ERROR_RUNTIME;
+    size_t size = dU_max(stack->size, (size_t)DYSL_STACK_SIZE);
+    while (size - count < n)
+        size *= 2;
+    size = dU_min(size, (size_t)DYSL_STACK_MAX_SIZE);
+    struct dy_value* base = (struct dy_value*)dAlloc_realloc(
+        allocator,
+        stack->base,
+        sizeof(struct dy_value) * stack->size,
+        sizeof(struct dy_value) * size
+    );
+    if (base == NULL)
+        return DYSL_ERROR_MEMORY;
+    stack->base = base;
+    stack->top = base + count;
+    stack->size = size;
+    return DYSL_OK;
+#endif /* DYSL_STACK_FIXED */
+}
+#pragma endregion /* Value Stack API implementation */
+
+#pragma region Environment API implementation
+void dEnv_init(struct dy_env* env) {
+    env->bindings = NULL;
+    env->count = 0;
+    env->capacity = 0;
+    env->id = 0;
+}
+
+void dEnv_destroy(struct dy_env* env, struct dysl_allocator* allocator) {
+    if (env->bindings != NULL)
+        dAlloc_free(allocator, env->bindings,
+                    sizeof(struct dy_binding) * env->capacity);
+    dEnv_init(env);
+}
+
+int dEnv_push(
+    struct dy_env* env,
+    struct dy_symbol* name,
+    struct dy_value value,
+    int is_word,
+    struct dysl_allocator* allocator
+) {
+    if (env->count == env->capacity) {
+        size_t new_capacity = env->capacity == 0
+            ? DYSL_ENV_INITIAL_CAPACITY
+            : env->capacity * 2;
+        struct dy_binding* bindings = (struct dy_binding*)dAlloc_realloc(
+            allocator,
+            env->bindings,
+            sizeof(struct dy_binding) * env->capacity,
+            sizeof(struct dy_binding) * new_capacity
+        );
+        if (bindings == NULL)
+            return 0;
+        env->bindings = bindings;
+        env->capacity = new_capacity;
+    }
+    struct dy_binding* binding = &env->bindings[env->count++];
+#if !DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    // shadows any cached binding of the name
+    dSymbol_bump(name);
+#endif /* !DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    binding->name = name;
+    binding->value = value;
+    binding->is_word = is_word;
+    return 1;
+}
+
+static inline struct dy_binding* dEnv_find(
+    struct dy_env* env,
+    struct dy_symbol* name
+) {
+    struct dy_binding* binding = env->bindings + env->count;
+    while (binding != env->bindings) {
+        binding--;
+        if (binding->name == name)
+            return binding;
+    }
+    return NULL;
+}
+
+static inline struct dy_binding* dEnv_cached(
+    struct dy_env* env,
+    struct dy_symbol* name,
+    struct dy_env_cache* cache
+) {
+    // the name check catches the binding popped and its index reused
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    // names are never shadowed, so any binding found stays the one
+    if (cache->version != 0 && cache->env == env->id &&
+#else /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    if (cache->version == dSymbol_version(name) && cache->env == env->id &&
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+        cache->index < env->count) {
+        struct dy_binding* binding = &env->bindings[cache->index];
+        if (binding->name == name)
+            return binding;
+        if (cache->entry != NULL &&
+            binding->name == cache->entry->marker)
+            return &cache->entry->binding;
+    }
+    return NULL;
+}
+
+static inline void dEnv_remember(
+    struct dy_env* env,
+    struct dy_symbol* name,
+    struct dy_binding* binding,
+    struct dy_module_entry* entry,
+    struct dy_env_cache* cache
+) {
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    (void)name; // unused
+    cache->version = 1;
+#else /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    cache->version = dSymbol_version(name);
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    cache->index = (uint32_t)(binding - env->bindings);
+    cache->env = env->id;
+    cache->entry = entry;
+}
+#pragma endregion /* Environment API implementation */
+
+#pragma region Interpreter state API implementation
+int dS_init(struct dysl* D, struct dy_global* global, size_t stack_size) {
+    struct dysl_allocator* allocator = dGC_allocator(&global->gc);
+    D->global = global;
+    dEnv_init(&D->env);
+    D->env.id = global->env_ids++;
+    D->frames = NULL;
+    D->frame_count = D->frame_capacity = 0;
+    D->slots = NULL;
+    D->slot_count = D->slot_capacity = 0;
+    D->prev_thread = D->next_thread = NULL;
+    D->vm_depth = 0;
+    D->suspended = 0;
+    D->resume_base = 0;
+#if DYSL_PROFILE
+    D->profile_frames = NULL;
+    D->profile_depth = D->profile_capacity = 0;
+#endif /* DYSL_PROFILE */
+    D->status = DYSL_OK;
+    D->error[0] = '\0';
+    D->incomplete = 0;
+#if DYSL_STACK_FIXED
+    // a fixed stack never grows, threads need the whole of it
+    stack_size = DYSL_STACK_SIZE;
+#endif /* DYSL_STACK_FIXED */
+    return dStack_init(&D->stack, stack_size, allocator);
+}
+
+void dS_destroy(struct dysl* D) {
+    struct dysl_allocator* allocator = dS_allocator(D);
+    dStack_destroy(&D->stack, allocator);
+    if (D->frames != NULL)
+        dAlloc_free(allocator, D->frames,
+                    sizeof(struct dy_frame) * D->frame_capacity);
+    if (D->slots != NULL)
+        dAlloc_free(allocator, D->slots,
+                    sizeof(struct dy_value) * D->slot_capacity);
+    dEnv_destroy(&D->env, allocator);
+#if DYSL_PROFILE
+    if (D->profile_frames != NULL)
+        dAlloc_free(allocator, D->profile_frames,
+                    sizeof(struct dy_profile_frame) * D->profile_capacity);
+    D->profile_frames = NULL;
+    D->profile_depth = D->profile_capacity = 0;
+#endif /* DYSL_PROFILE */
+    D->frames = NULL;
+    D->slots = NULL;
+}
+
+static inline size_t dS_error_append(
+    struct dysl* D,
+    size_t n,
+    const char* text,
+    size_t length
+) {
+    size_t room = DYSL_ERROR_MESSAGE_SIZE - 1 - n;
+    length = dU_min(length, room);
+    dMem_copy(D->error + n, text, length);
+    return n + length;
+}
+
+int dS_error(
+    struct dysl* D,
+    int status,
+    int32_t line,
+    const char* message,
+    const char* detail,
+    size_t detail_length
+) {
+    size_t n = 0;
+    if (line > 0) {
+        char buf[24];
+        n = dS_error_append(D, n, "line ", 5);
+        n = dS_error_append(D, n, buf, dU_format_integer(buf, line));
+        n = dS_error_append(D, n, ": ", 2);
+    }
+    n = dS_error_append(D, n, message, dU_strlen(message));
+    if (detail != NULL) {
+        n = dS_error_append(D, n, " '", 2);
+        n = dS_error_append(D, n, detail, detail_length);
+        n = dS_error_append(D, n, "'", 1);
+    }
+    D->error[n] = '\0';
+    D->status = status;
+    return status;
+}
+
+int32_t dS_line(struct dysl* D) {
+    if (D->frame_count == 0)
+        return 0;
+    struct dy_frame* frame = &D->frames[D->frame_count - 1];
+    size_t pc = (size_t)(frame->ip - frame->proc->code);
+    if (pc == 0 || pc > frame->proc->code_size || frame->proc->lines == NULL)
+        return 0;
+    return frame->proc->lines[pc - 1];
+}
+
+static inline struct dy_value* dS_index(struct dysl* D, int index) {
+    size_t count = dStack_count(&D->stack);
+    if (index < 0) {
+        if ((size_t)(-(int64_t)index) > count)
+            return NULL;
+        return D->stack.top + index;
+    }
+    if ((size_t)index >= count)
+        return NULL;
+    return D->stack.base + index;
+}
+
+int dS_ensure_stack(struct dysl* D, size_t n) {
+    if (dStack_room(&D->stack) >= n)
+        return 1;
+    int status = dStack_grow(&D->stack, n, dS_allocator(D));
+    if (status == DYSL_OK)
+        return 1;
+    dS_error(D, status, dS_line(D),
+             status == DYSL_ERROR_MEMORY ? "out of memory" : "stack overflow",
+             NULL, 0);
+    return 0;
+}
+
+static inline void dS_push(struct dysl* D, struct dy_value value) {
+    if (dStack_room(&D->stack) == 0 && !dS_ensure_stack(D, 1))
+        return;
+    *D->stack.top++ = value;
+}
+#pragma endregion /* Interpreter state API implementation */
+
+#pragma region Lexer API implementation
+void dLex_init(struct dy_lexer* lexer, const char* source, size_t length) {
+    lexer->cursor = source;
+    lexer->end = source + length;
+    lexer->line = 1;
+    lexer->reader = NULL;
+    lexer->reader_data = NULL;
+    lexer->allocator = NULL;
+    lexer->buffer = NULL;
+    lexer->buffer_capacity = 0;
+}
+
+void dLex_init_reader(
+    struct dy_lexer* lexer,
+    dysl_reader reader,
+    void* user_data,
+    struct dysl_allocator* allocator
+) {
+    dLex_init(lexer, "", 0);
+    lexer->reader = reader;
+    lexer->reader_data = user_data;
+    lexer->allocator = allocator;
+}
+
+void dLex_destroy(struct dy_lexer* lexer) {
+    if (lexer->buffer != NULL)
+        dAlloc_free(lexer->allocator, lexer->buffer, lexer->buffer_capacity);
+    lexer->buffer = NULL;
+    lexer->buffer_capacity = 0;
+}
+
+/** Moves the pending input to the start of a buffer of at least `size`
+ * bytes, returns 0 on failure. */
+static int dLex_reserve(struct dy_lexer* lexer, size_t size) {
+    if (lexer->cursor == lexer->buffer && size <= lexer->buffer_capacity)
+        return 1;
+    size_t capacity = lexer->buffer_capacity == 0
+        ? 256
+        : lexer->buffer_capacity;
+    while (capacity < size)
+        capacity *= 2;
+    char* buffer = (char*)dAlloc_alloc(lexer->allocator, capacity);
+    if (buffer == NULL)
+        return 0;
+    // the pending input may be in the old buffer
+    dMem_copy(buffer, lexer->cursor, (size_t)(lexer->end - lexer->cursor));
+    if (lexer->buffer != NULL)
+        dAlloc_free(lexer->allocator, lexer->buffer, lexer->buffer_capacity);
+    lexer->end = buffer + (lexer->end - lexer->cursor);
+    lexer->cursor = buffer;
+    lexer->buffer = buffer;
+    lexer->buffer_capacity = capacity;
+    return 1;
+}
+
+/** Reads more input after the cursor, returns 0 if out of memory.
+ *
+ * With nothing pending, the next chunk is scanned in place. Otherwise the
+ * pending bytes start an unfinished token, and chunks are appended to them
+ * until they at least double, so scanning a token that spans many small
+ * chunks again stays linear in its length. The reader is dropped once it
+ * runs out. */
+static int dLex_refill(struct dy_lexer* lexer) {
+    size_t pending = (size_t)(lexer->end - lexer->cursor);
+    size_t length = 0;
+    const char* chunk;
+    if (pending == 0) {
+        chunk = lexer->reader(lexer->reader_data, &length);
+        if (chunk == NULL || length == 0) {
+            lexer->reader = NULL;
+        } else {
+            lexer->cursor = chunk;
+            lexer->end = chunk + length;
+        }
+        return 1;
+    }
+    if (!dLex_reserve(lexer, pending))
+        return 0;
+    size_t target = pending * 2;
+    while ((size_t)(lexer->end - lexer->cursor) < target) {
+        chunk = lexer->reader(lexer->reader_data, &length);
+        if (chunk == NULL || length == 0) {
+            lexer->reader = NULL;
+            break;
+        }
+        size_t size = (size_t)(lexer->end - lexer->cursor);
+        if (!dLex_reserve(lexer, size + length))
+            return 0;
+        dMem_copy(lexer->buffer + size, chunk, length);
+        lexer->end += length;
+    }
+    return 1;
+}
+
+static inline int dLex_is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' ||
+           c == '\r' || c == '\f' || c == '\v';
+}
+
+static inline int dLex_is_delimiter(char c) {
+    return dLex_is_blank(c) || c == '{' || c == '}' || c == '"';
+}
+
+static inline int dLex_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline unsigned dLex_digit_value(char c) {
+    if (c >= '0' && c <= '9')
+        return (unsigned)(c - '0');
+    if (c >= 'a' && c <= 'f')
+        return (unsigned)(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F')
+        return (unsigned)(c - 'A' + 10);
+    return 99;
+}
+
+static dy_real dLex_pow10(int exponent) {
+    dy_real result = 1, base = 10;
+    unsigned n = (unsigned)(exponent < 0 ? -exponent : exponent);
+    while (n != 0) {
+        if (n & 1)
+            result *= base;
+        base *= base;
+        n >>= 1;
+    }
+    return exponent < 0 ? 1 / result : result;
+}
+
+/** Parses a word token that looks like a number. */
+static void dLex_number(struct dy_token* token) {
+    const char* p = token->start;
+    const char* end = p + token->length;
+    int negative = 0;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        p++;
+    }
+    unsigned base = 10;
+    if (end - p > 2 && p[0] == '0') {
+        if (p[1] == 'x' || p[1] == 'X')
+            base = 16;
+        else if (p[1] == 'b' || p[1] == 'B')
+            base = 2;
+        else if (p[1] == 'o' || p[1] == 'O')
+            base = 8;
+        if (base != 10)
+            p += 2;
+    }
+    const char* digits = p;
+    uint64_t integer = 0;
+    int overflow = 0;
+    // declared ahead of the gotos, which C++ forbids jumping past them
+    dy_real mantissa = 0;
+    int exponent = 0;
+    while (p < end) {
+        unsigned digit = dLex_digit_value(*p);
+        if (digit >= base)
+            break;
+        if (integer > (UINT64_MAX - digit) / base)
+            overflow = 1;
+        else
+            integer = integer * base + digit;
+        p++;
+    }
+    if (p == digits)
+        goto malformed;
+    if (base != 10 || p == end) {
+        if (p != end)
+            goto malformed;
+        uint64_t limit = negative ? (uint64_t)INT32_MAX + 1 : INT32_MAX;
+        if (!overflow && integer <= limit) {
+            token->type = DYSL_TOKEN_INTEGER;
+            token->as.integer = (dy_int)(negative
+                ? -(int64_t)integer
+                : (int64_t)integer);
+            return;
+        }
+        if (base != 10) {
+            token->type = DYSL_TOKEN_ERROR;
+            token->as.error = "integer literal is too large";
+            return;
+        }
+        // decimal integers that do not fit are read as reals
+    }
+    // digits [. digits] [(e|E) [+|-] digits]
+    p = digits;
+    while (p < end && dLex_is_digit(*p))
+        mantissa = mantissa * 10 + (*p++ - '0');
+    if (p < end && *p == '.') {
+        const char* fraction = ++p;
+        while (p < end && dLex_is_digit(*p)) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            exponent--;
+        }
+        if (p == fraction)
+            goto malformed;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        int sign = 1, value = 0;
+        p++;
+        if (p < end && (*p == '-' || *p == '+'))
+            sign = *p++ == '-' ? -1 : 1;
+        if (p == end || !dLex_is_digit(*p))
+            goto malformed;
+        while (p < end && dLex_is_digit(*p)) {
+            if (value < 100000)
+                value = value * 10 + (*p - '0');
+            p++;
+        }
+        exponent += sign * value;
+    }
+    if (p != end)
+        goto malformed;
+    token->type = DYSL_TOKEN_REAL;
+    // not strtod, which reads past the token and follows the locale. Both
+    // operands are exact, so the result correctly rounded, while the
+    // mantissa has at most 15 digits and the exponent is within 22.
+    if (mantissa == 0) {
+        token->as.real = 0;
+    } else if (exponent < 0) {
+        if (exponent < -300) {
+            mantissa /= dLex_pow10(300);
+            exponent += 300;
+        }
+        token->as.real = mantissa / dLex_pow10(-exponent);
+    } else {
+        token->as.real = mantissa * dLex_pow10(exponent);
+    }
+    if (negative)
+        token->as.real = -token->as.real;
+    return;
+malformed:
+    token->type = DYSL_TOKEN_ERROR;
+    token->as.error = "malformed number";
+}
+
+/** Scans a token, or returns 0 if it may go on past the end of the input
+ * read so far. The cursor is then left at its start. */
+static int dLex_scan(struct dy_lexer* lexer, struct dy_token* token) {
+    const char* p = lexer->cursor;
+    const char* end = lexer->end;
+    int more = lexer->reader != NULL;
+    // skip blanks and comments
+    for (;;) {
+        while (p < end && dLex_is_blank(*p)) {
+            if (*p == '\n')
+                lexer->line++;
+            p++;
+        }
+        if (p < end && *p == '#') {
+            const char* comment = p;
+            while (p < end && *p != '\n')
+                p++;
+            if (p >= end && more) {
+                lexer->cursor = comment;
+                return 0;
+            }
+            continue;
+        }
+        break;
+    }
+    // blanks are never carried over
+    lexer->cursor = p;
+    if (p >= end && more)
+        return 0;
+    token->line = lexer->line;
+    token->start = p;
+    token->length = 0;
+    if (p >= end) {
+        token->type = DYSL_TOKEN_EOF;
+    } else if (*p == '{') {
+        token->type = DYSL_TOKEN_OPEN;
+        token->length = 1;
+        p++;
+    } else if (*p == '}') {
+        token->type = DYSL_TOKEN_CLOSE;
+        token->length = 1;
+        p++;
+    } else if (*p == '"') {
+        token->start = ++p;
+        while (p < end && *p != '"') {
+            if (*p == '\\' && p + 1 < end)
+                p++;
+            if (*p == '\n')
+                lexer->line++;
+            p++;
+        }
+        token->length = (size_t)(p - token->start);
+        if (p >= end && more) {
+            lexer->line = token->line;
+            return 0;
+        }
+        if (p >= end) {
+            token->type = DYSL_TOKEN_ERROR;
+            token->as.error = dLex_unterminated;
+        } else {
+            token->type = DYSL_TOKEN_STRING;
+            p++; // closing quote
+        }
+    } else {
+        while (p < end && !dLex_is_delimiter(*p))
+            p++;
+        if (p >= end && more)
+            return 0;
+        token->type = DYSL_TOKEN_WORD;
+        token->length = (size_t)(p - token->start);
+        char c = token->start[0];
+        if (c == '&' && token->length == 1 && p < end && *p == '{') {
+            token->type = DYSL_TOKEN_PROC_OPEN;
+            token->length = 2;
+            p++;
+        } else if ((c == '&' || c == ':') && token->length > 1) {
+            token->type = c == '&' ? DYSL_TOKEN_REF : DYSL_TOKEN_SYMBOL;
+            token->start++;
+            token->length--;
+        } else if (dLex_is_digit(c) ||
+                   ((c == '-' || c == '+') && token->length > 1 &&
+                    dLex_is_digit(token->start[1]))) {
+            dLex_number(token);
+        }
+    }
+    lexer->cursor = p;
+    return 1;
+}
+
+void dLex_next(struct dy_lexer* lexer, struct dy_token* token) {
+    while (!dLex_scan(lexer, token)) {
+        if (!dLex_refill(lexer)) {
+            token->type = DYSL_TOKEN_ERROR;
+            token->start = lexer->cursor;
+            token->length = 0;
+            token->line = lexer->line;
+            token->as.error = dLex_out_of_memory;
+            return;
+        }
+    }
+}
+#pragma endregion /* Lexer API implementation */
+
+#pragma region Compiler API implementation
+static const char* const dC_keywords[DYSL_KW_COUNT] = {
+    NULL,
+#define DYSL_KEYWORD_TEXT(name, text) text,
+    DYSL_KEYWORDS(DYSL_KEYWORD_TEXT)
+#undef DYSL_KEYWORD_TEXT
+};
+
+/** Words compiled straight to an instruction. They cannot be rebound. */
+static const struct {
+    const char* name;
+    enum dy_opcode op;
+} dC_primitives[] = {
+    { "dup", DYSL_OP_DUP }, { "drop", DYSL_OP_DROP },
+    { "swap", DYSL_OP_SWAP }, { "over", DYSL_OP_OVER },
+    { "rot", DYSL_OP_ROT }, { "nip", DYSL_OP_NIP },
+    { "+", DYSL_OP_ADD }, { "-", DYSL_OP_SUB }, { "*", DYSL_OP_MUL },
+    { "/", DYSL_OP_DIV }, { "%", DYSL_OP_MOD },
+    { "=", DYSL_OP_EQ }, { "!=", DYSL_OP_NE },
+    { "<", DYSL_OP_LT }, { ">", DYSL_OP_GT },
+    { "<=", DYSL_OP_LE }, { ">=", DYSL_OP_GE },
+    { "not", DYSL_OP_NOT }, { "and", DYSL_OP_AND }, { "or", DYSL_OP_OR },
+#if DYSL_PROCS
+    { ".call", DYSL_OP_CALL },
+#endif /* DYSL_PROCS */
+    { "yield", DYSL_OP_YIELD },
+    { "block-given?", DYSL_OP_BLOCK_GIVEN },
+    { ".get", DYSL_OP_GET_INDEX }, { ".set", DYSL_OP_SET_INDEX },
+    { ".push", DYSL_OP_APPEND }, { ".len", DYSL_OP_LENGTH },
+};
+#define DYSL_PRIMITIVE_COUNT (sizeof(dC_primitives) / sizeof(dC_primitives[0]))
+
+/** Block terminators. */
+enum dy_closer {
+    DYSL_CLOSE_EOF,
+    DYSL_CLOSE_BRACE,
+    DYSL_CLOSE_END,
+};
+
+static enum dy_keyword dC_keyword(const struct dy_token* token) {
+    if (token->type != DYSL_TOKEN_WORD)
+        return DYSL_KW_NONE;
+    for (int k = DYSL_KW_NONE + 1; k < DYSL_KW_COUNT; k++) {
+        if (dSlice_equals_cstr(token->start, token->length, dC_keywords[k]))
+            return (enum dy_keyword)k;
+    }
+    return DYSL_KW_NONE;
+}
+
+/** Returns the opcode for a primitive word, or -1. */
+static int dC_primitive(const struct dy_token* token) {
+    if (token->type != DYSL_TOKEN_WORD)
+        return -1;
+    for (size_t p = 0; p < DYSL_PRIMITIVE_COUNT; p++) {
+        if (dSlice_equals_cstr(token->start, token->length,
+                               dC_primitives[p].name))
+            return (int)dC_primitives[p].op;
+    }
+    return -1;
+}
+
+/** Returns the name of a primitive's opcode, for error messages. */
+static const char* dC_primitive_name(enum dy_opcode op) {
+    for (size_t p = 0; p < DYSL_PRIMITIVE_COUNT; p++) {
+        if (dC_primitives[p].op == op)
+            return dC_primitives[p].name;
+    }
+    return "?";
+}
+
+static void dC_error(
+    struct dy_compiler* c,
+    const char* message,
+    const struct dy_token* token
+) {
+    if (c->failed)
+        return;
+    c->failed = 1;
+    dS_error(c->D, DYSL_ERROR_SYNTAX, c->token.line, message,
+             token != NULL ? token->start : NULL,
+             token != NULL ? token->length : 0);
+}
+
+static void dC_memory_error(struct dy_compiler* c) {
+    if (c->failed)
+        return;
+    c->failed = 1;
+    dS_error(c->D, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
+}
+
+/** Reports that the source ended before the construct being compiled. */
+static void dC_incomplete(struct dy_compiler* c, const char* message) {
+    if (!c->failed)
+        c->D->incomplete = 1;
+    dC_error(c, message, NULL);
+}
+
+static void dC_advance(struct dy_compiler* c) {
+    dLex_next(&c->lexer, &c->token);
+    if (c->token.type != DYSL_TOKEN_ERROR)
+        return;
+    if (c->token.as.error == dLex_out_of_memory)
+        dC_memory_error(c);
+    else if (c->token.as.error == dLex_unterminated)
+        dC_incomplete(c, dLex_unterminated);
+    else
+        dC_error(c, c->token.as.error, NULL);
+}
+
+#define dC_allocator(c) dS_allocator((c)->D)
+#define dC_here(c) ((c)->fs->code_count)
+
+#if DYSL_SUPERINSTRUCTIONS
+/** Fuses `instr` into the instruction before it when the pair makes a
+ * superinstruction. Returns 1 if `instr` was absorbed, 0 if it must still
+ * be emitted, which `CALL_VAR` needs. */
+static int dC_fuse(struct dy_compiler* c, dy_instr instr) {
+    struct dy_funcstate* fs = c->fs;
+    if (fs->code_count <= fs->fuse_barrier)
+        return 0;
+    dy_instr* previous = &fs->code[fs->code_count - 1];
+    enum dy_opcode first = dI_op(*previous), second = dI_op(instr);
+    // the fused instruction reports errors at the first one's line
+#if DYSL_LINE_INFO
+    int same_line = fs->lines[fs->code_count - 1] == c->token.line;
+#else /* DYSL_LINE_INFO */
+    int same_line = 1;
+#endif /* DYSL_LINE_INFO */
+    if (second == DYSL_OP_JUMP_IF_FALSE &&
+        first >= DYSL_OP_EQ && first <= DYSL_OP_GE) {
+        *previous = dI_make(DYSL_OP_JUMP_IF_NOT_EQ + (first - DYSL_OP_EQ),
+                            dI_arg(instr));
+        return 1;
+    }
+    if (first == DYSL_OP_PUSH_INT && same_line &&
+        (second == DYSL_OP_ADD || second == DYSL_OP_SUB)) {
+        *previous = dI_make(second == DYSL_OP_ADD
+                                ? DYSL_OP_ADD_INT
+                                : DYSL_OP_SUB_INT,
+                            dI_arg(*previous));
+        return 1;
+    }
+#if DYSL_PROCS
+    if (first == DYSL_OP_CALL_WORD && second == DYSL_OP_CALL)
+        *previous = dI_make(DYSL_OP_CALL_VAR, dI_arg(*previous));
+#endif /* DYSL_PROCS */
+    return 0;
+}
+#endif /* DYSL_SUPERINSTRUCTIONS */
+
+/** Keeps the instruction at `target` from being fused with the one before. */
+static inline void dC_mark_target(struct dy_compiler* c, size_t target) {
+    if (target > c->fs->fuse_barrier)
+        c->fs->fuse_barrier = target;
+}
+
+/** Returns the current position as a jump target. */
+static size_t dC_label(struct dy_compiler* c) {
+    dC_mark_target(c, dC_here(c));
+    return dC_here(c);
+}
+
+static size_t dC_emit(struct dy_compiler* c, dy_instr instr) {
+    struct dy_funcstate* fs = c->fs;
+    if (c->failed)
+        return 0;
+#if DYSL_SUPERINSTRUCTIONS
+    if (dC_fuse(c, instr))
+        return fs->code_count - 1;
+#endif /* DYSL_SUPERINSTRUCTIONS */
+    if (fs->code_count == fs->code_capacity) {
+        size_t capacity = fs->code_capacity;
+        size_t new_capacity = capacity == 0 ? 64 : capacity * 2;
+        dy_instr* code = (dy_instr*)dAlloc_realloc(
+            dC_allocator(c),
+            fs->code,
+            sizeof(dy_instr) * capacity,
+            sizeof(dy_instr) * new_capacity
+        );
+        if (code == NULL) {
+            dC_memory_error(c);
+            return 0;
+        }
+        fs->code = code;
+#if DYSL_LINE_INFO
+        int32_t* lines = (int32_t*)dAlloc_realloc(
+            dC_allocator(c),
+            fs->lines,
+            sizeof(int32_t) * capacity,
+            sizeof(int32_t) * new_capacity
+        );
+        if (lines == NULL) {
+            dC_memory_error(c);
+            return 0;
+        }
+        fs->lines = lines;
+#endif /* DYSL_LINE_INFO */
+        fs->code_capacity = new_capacity;
+    }
+    fs->code[fs->code_count] = instr;
+#if DYSL_LINE_INFO
+    fs->lines[fs->code_count] = c->token.line;
+#endif /* DYSL_LINE_INFO */
+    return fs->code_count++;
+}
+
+static size_t dC_emit_arg(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    int64_t arg
+) {
+    if (arg < DYSL_INSTR_ARG_MIN || arg > DYSL_INSTR_ARG_MAX) {
+        dC_error(c, "procedure is too large", NULL);
+        return 0;
+    }
+    return dC_emit(c, dI_make(op, arg));
+}
+
+static uint32_t dC_constant(struct dy_compiler* c, struct dy_value value) {
+    struct dy_funcstate* fs = c->fs;
+    if (c->failed)
+        return 0;
+    if (fs->constant_count == fs->constant_capacity) {
+        size_t capacity = fs->constant_capacity;
+        size_t new_capacity = capacity == 0 ? 16 : capacity * 2;
+        struct dy_value* constants = (struct dy_value*)dAlloc_realloc(
+            dC_allocator(c),
+            fs->constants,
+            sizeof(struct dy_value) * capacity,
+            sizeof(struct dy_value) * new_capacity
+        );
+        if (constants == NULL) {
+            dC_memory_error(c);
+            return 0;
+        }
+        fs->constants = constants;
+        fs->constant_capacity = new_capacity;
+    }
+    fs->constants[fs->constant_count] = value;
+    return (uint32_t)fs->constant_count++;
+}
+
+static void dC_emit_constant(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    struct dy_value value
+) {
+    dC_emit_arg(c, op, dC_constant(c, value));
+}
+
+/** Interns the symbol named by `token`, returns NULL on failure. */
+static struct dy_symbol* dC_symbol(
+    struct dy_compiler* c,
+    const struct dy_token* token
+) {
+    struct dy_symbol* sym = dGlobal_intern(
+        c->D->global,
+        token->start,
+        token->length
+    );
+    if (sym == NULL)
+        dC_memory_error(c);
+    return sym;
+}
+
+static void dC_emit_symbol(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    const struct dy_token* token
+) {
+    struct dy_symbol* sym = dC_symbol(c, token);
+    if (sym != NULL)
+        dC_emit_constant(c, op, dV_make_object(&sym->header));
+}
+
+static void dC_patch_jump(struct dy_compiler* c, size_t pc, size_t target) {
+    if (c->failed)
+        return;
+    dC_mark_target(c, target);
+    int64_t offset = (int64_t)target - (int64_t)(pc + 1);
+    if (offset < DYSL_INSTR_ARG_MIN || offset > DYSL_INSTR_ARG_MAX) {
+        dC_error(c, "procedure is too large", NULL);
+        return;
+    }
+    dy_instr* code = c->fs->code;
+    code[pc] = dI_make(dI_op(code[pc]), offset);
+}
+
+static void dC_emit_jump_to(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    size_t target
+) {
+    size_t pc = dC_emit(c, dI_make(op, 0));
+    dC_patch_jump(c, pc, target);
+}
+
+/** Emits the extra word of the instruction just emitted. */
+static void dC_emit_word(struct dy_compiler* c, uint32_t word) {
+    // mark the extra word first, so it is never fused
+    dC_mark_target(c, dC_here(c));
+    dC_emit(c, (dy_instr)word);
+    dC_mark_target(c, dC_here(c));
+}
+
+/** Emits an instruction followed by a jump offset extra word. */
+static size_t dC_emit_extended(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    int64_t arg
+) {
+    size_t pc = dC_emit_arg(c, op, arg);
+    dC_emit_word(c, 0);
+    return pc;
+}
+
+static void dC_patch_extended(
+    struct dy_compiler* c,
+    size_t pc,
+    size_t target
+) {
+    if (c->failed)
+        return;
+    dC_mark_target(c, target);
+    int64_t offset = (int64_t)target - (int64_t)(pc + 2);
+    c->fs->code[pc + 1] = (dy_instr)(int32_t)offset;
+}
+
+/** Emits a jump linked into a pending jump chain. */
+static void dC_chain_jump(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    size_t* list
+) {
+    size_t pc = dC_emit_arg(c, op, (int64_t)*list);
+    if (!c->failed)
+        *list = pc + 1;
+}
+
+static void dC_patch_chain(struct dy_compiler* c, size_t list, size_t target) {
+    while (list != 0 && !c->failed) {
+        size_t pc = list - 1;
+        list = (size_t)dI_arg(c->fs->code[pc]);
+        dC_patch_jump(c, pc, target);
+    }
+}
+
+static uint32_t dC_alloc_slots(struct dy_compiler* c, uint32_t count) {
+    struct dy_funcstate* fs = c->fs;
+    uint32_t slot = fs->slot_count;
+    fs->slot_count += count;
+    fs->max_slots = dU_max(fs->max_slots, fs->slot_count);
+    return slot;
+}
+
+static void dC_free_slots(struct dy_compiler* c, uint32_t count) {
+    c->fs->slot_count -= count;
+}
+
+static void dC_open_region(struct dy_compiler* c) {
+    c->fs->region++;
+}
+
+/** Forgets the bindings resolved in the region, and frees their slots. */
+static void dC_close_region(struct dy_compiler* c) {
+    struct dy_funcstate* fs = c->fs;
+    uint32_t count = fs->local_count;
+    while (count > 0 && fs->locals[count - 1].region == fs->region)
+        count--;
+    dC_free_slots(c, fs->local_count - count);
+    fs->local_count = count;
+    fs->region--;
+}
+
+/** Returns the resolved binding of `name`, or NULL if it must be looked
+ * up as the code runs. */
+static struct dy_local* dC_local(
+    struct dy_compiler* c,
+    struct dy_symbol* name
+) {
+    struct dy_funcstate* fs = c->fs;
+    for (uint32_t l = fs->local_count; l > 0; l--) {
+        struct dy_local* local = &fs->locals[l - 1];
+        if (local->name == name)
+            return local->shadowed ? NULL : local;
+    }
+    return NULL;
+}
+
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+/** Rejects binding `name`, the current token, where it is bound already:
+ * lookups in this build may not see the new binding. A procedure binding a
+ * name its callers, or itself when recursing, bound is not caught. */
+static int dC_check_unbound(struct dy_compiler* c, struct dy_symbol* name) {
+    int bound = dEnv_find(&c->D->env, name) != NULL ||
+                dGlobal_find_entry(c->D->global, name) != NULL;
+    for (uint32_t n = 0; n < c->live_count && !bound; n++)
+        bound = c->live[n] == name;
+    if (bound) {
+        dC_error(c, "cannot shadow in this build, already bound:", &c->token);
+        return 0;
+    }
+    if (c->live_count == c->live_capacity) {
+        uint32_t capacity = c->live_capacity == 0 ? 16 : c->live_capacity * 2;
+        struct dy_symbol** live = (struct dy_symbol**)dAlloc_realloc(
+            dC_allocator(c),
+            c->live,
+            sizeof(struct dy_symbol*) * c->live_capacity,
+            sizeof(struct dy_symbol*) * capacity
+        );
+        if (live == NULL) {
+            dC_memory_error(c);
+            return 0;
+        }
+        c->live = live;
+        c->live_capacity = capacity;
+    }
+    c->live[c->live_count++] = name;
+    return 1;
+}
+#else /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+#define dC_check_unbound(c, name) 1
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+
+/** Emits a `LET` or `DEF` of `name`, resolving the binding if it can. */
+static void dC_bind(
+    struct dy_compiler* c,
+    enum dy_opcode op,
+    struct dy_symbol* name
+) {
+    struct dy_funcstate* fs = c->fs;
+    // bindings of the name made before stop being the innermost one
+    for (uint32_t l = 0; l < fs->local_count; l++) {
+        if (fs->locals[l].name == name)
+            fs->locals[l].shadowed = 1;
+    }
+    fs->bindings++;
+    uint32_t k = dC_constant(c, dV_make_object(&name->header));
+#if DYSL_LOCALS_MAX > 0
+    // `import` binds `module:word` names, which are left to lookups
+    if (fs->local_count < DYSL_LOCALS_MAX && !dSymbol_is_qualified(name)) {
+        struct dy_local* local = &fs->locals[fs->local_count++];
+        local->name = name;
+        local->slot = dC_alloc_slots(c, 1);
+        local->region = fs->region;
+        local->is_word = op == DYSL_OP_DEF;
+        local->shadowed = 0;
+        dC_emit_arg(c, op == DYSL_OP_DEF ? DYSL_OP_DEF_LOCAL
+                                         : DYSL_OP_LET_LOCAL, k);
+        dC_emit_word(c, local->slot);
+        return;
+    }
+#endif /* DYSL_LOCALS_MAX > 0 */
+    dC_emit_arg(c, op, k);
+}
+
+#if DYSL_PROCS
+/** Emits a `GET` of the binding named by `token`. */
+static void dC_get(struct dy_compiler* c, const struct dy_token* token) {
+    struct dy_symbol* sym = dC_symbol(c, token);
+    if (sym == NULL)
+        return;
+    struct dy_local* local = dC_local(c, sym);
+    if (local != NULL)
+        dC_emit_arg(c, DYSL_OP_GET_LOCAL, local->slot);
+    else
+        dC_emit_constant(c, DYSL_OP_GET, dV_make_object(&sym->header));
+}
+#endif /* DYSL_PROCS */
+
+static void dC_open_func(
+    struct dy_compiler* c,
+    struct dy_funcstate* fs,
+    struct dy_symbol* name
+) {
+    fs->enclosing = c->fs;
+    fs->name = name;
+    fs->code = NULL;
+    fs->lines = NULL;
+    fs->code_count = fs->code_capacity = 0;
+    fs->constants = NULL;
+    fs->constant_count = fs->constant_capacity = 0;
+    fs->loop = NULL;
+    fs->slot_count = fs->max_slots = 0;
+    fs->bindings = 0;
+    fs->fuse_barrier = 0;
+    fs->local_count = 0;
+    fs->region = 0;
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    fs->live = c->live_count;
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    c->fs = fs;
+}
+
+/** Shrinks a compiler buffer to its final size, updating `capacity`. */
+static void* dC_shrink(
+    struct dy_compiler* c,
+    void* buffer,
+    size_t element_size,
+    size_t* capacity,
+    size_t count
+) {
+    if (c->failed || buffer == NULL || count == *capacity)
+        return buffer;
+    if (count == 0) {
+        dAlloc_free(dC_allocator(c), buffer, element_size * *capacity);
+        *capacity = 0;
+        return NULL;
+    }
+    void* shrunk = dAlloc_realloc(dC_allocator(c), buffer,
+                                  element_size * *capacity,
+                                  element_size * count);
+    if (shrunk == NULL) {
+        dC_memory_error(c);
+        return buffer;
+    }
+    *capacity = count;
+    return shrunk;
+}
+
+static struct dy_proc* dC_close_func(struct dy_compiler* c) {
+    struct dy_funcstate* fs = c->fs;
+    struct dysl_allocator* allocator = dC_allocator(c);
+    struct dy_proc* proc = NULL;
+    dC_emit(c, dI_make(DYSL_OP_RETURN, 0));
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    c->live_count = fs->live;
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    // code and lines grow together, but may not shrink together
+    size_t lines_capacity = fs->code_capacity;
+    fs->code = (dy_instr*)dC_shrink(c, fs->code, sizeof(dy_instr),
+                                    &fs->code_capacity, fs->code_count);
+    fs->lines = (int32_t*)dC_shrink(c, fs->lines, sizeof(int32_t),
+                                    &lines_capacity, fs->code_count);
+    fs->constants = (struct dy_value*)dC_shrink(
+        c, fs->constants, sizeof(struct dy_value),
+        &fs->constant_capacity, fs->constant_count
+    );
+    if (!c->failed) {
+        proc = dProc_create(
+            dS_gc(c->D),
+            fs->name,
+            fs->code,
+            fs->lines,
+            (uint32_t)fs->code_count,
+            fs->constants,
+            (uint32_t)fs->constant_count,
+            fs->max_slots
+        );
+        if (proc == NULL)
+            dC_memory_error(c);
+    }
+    if (proc == NULL) {
+        if (fs->code != NULL)
+            dAlloc_free(allocator, fs->code,
+                        sizeof(dy_instr) * fs->code_capacity);
+        if (fs->lines != NULL)
+            dAlloc_free(allocator, fs->lines, sizeof(int32_t) * lines_capacity);
+        if (fs->constants != NULL)
+            dAlloc_free(allocator, fs->constants,
+                        sizeof(struct dy_value) * fs->constant_capacity);
+    }
+    c->fs = fs->enclosing;
+    return proc;
+}
+
+static int dC_is_block_open(struct dy_compiler* c) {
+    return c->token.type == DYSL_TOKEN_OPEN ||
+           dC_keyword(&c->token) == DYSL_KW_DO;
+}
+
+static int dC_at_closer(struct dy_compiler* c) {
+    return c->token.type == DYSL_TOKEN_EOF ||
+           c->token.type == DYSL_TOKEN_CLOSE ||
+           dC_keyword(&c->token) == DYSL_KW_END;
+}
+
+static int dC_statement(struct dy_compiler* c);
+
+/** Compiles statements until the closer, which is left as current token. */
+static void dC_body(struct dy_compiler* c, enum dy_closer closer) {
+    while (!c->failed) {
+        if (c->token.type == DYSL_TOKEN_EOF) {
+            if (closer != DYSL_CLOSE_EOF)
+                dC_incomplete(c, closer == DYSL_CLOSE_END
+                    ? "unexpected end of input, expected 'end'"
+                    : "unexpected end of input, expected '}'");
+            return;
+        }
+        if (c->token.type == DYSL_TOKEN_CLOSE) {
+            if (closer != DYSL_CLOSE_BRACE)
+                dC_error(c, "unexpected", &c->token);
+            return;
+        }
+        if (dC_keyword(&c->token) == DYSL_KW_END) {
+            if (closer != DYSL_CLOSE_END)
+                dC_error(c, "unexpected", &c->token);
+            return;
+        }
+        dC_statement(c);
+    }
+}
+
+/** Consumes a block opener, returning its closer. */
+static enum dy_closer dC_open_block(struct dy_compiler* c) {
+    enum dy_closer closer = DYSL_CLOSE_EOF;
+    if (c->token.type == DYSL_TOKEN_OPEN ||
+        c->token.type == DYSL_TOKEN_PROC_OPEN)
+        closer = DYSL_CLOSE_BRACE;
+    else if (dC_keyword(&c->token) == DYSL_KW_DO)
+        closer = DYSL_CLOSE_END;
+    else if (c->token.type == DYSL_TOKEN_EOF)
+        dC_incomplete(c, "unexpected end of input, expected a block");
+    else
+        dC_error(c, "expected a block ('do' or '{'), got", &c->token);
+    if (!c->failed)
+        dC_advance(c);
+    return closer;
+}
+
+/** Compiles a block inline, in the current procedure. */
+static void dC_block(struct dy_compiler* c) {
+    enum dy_closer closer = dC_open_block(c);
+    dC_open_region(c);
+    dC_body(c, closer);
+    dC_close_region(c);
+    if (!c->failed)
+        dC_advance(c);
+}
+
+/** Compiles a block as a new procedure, returns NULL on failure. */
+static struct dy_proc* dC_proc(struct dy_compiler* c, struct dy_symbol* name) {
+    struct dy_funcstate fs;
+    dC_open_func(c, &fs, name);
+    dC_block(c);
+    return dC_close_func(c);
+}
+
+static void dC_emit_proc(struct dy_compiler* c, struct dy_proc* proc) {
+    if (proc != NULL)
+        dC_emit_constant(c, DYSL_OP_PUSH_CONST, dV_make_object(&proc->header));
+}
+
+/** Checks that the current token can be used as a binding's name. */
+static int dC_check_name(struct dy_compiler* c, const char* message) {
+    if (c->token.type != DYSL_TOKEN_WORD ||
+        dC_keyword(&c->token) != DYSL_KW_NONE ||
+        dC_primitive(&c->token) >= 0) {
+        if (c->token.type == DYSL_TOKEN_EOF)
+            dC_incomplete(c, message);
+        else
+            dC_error(c, message, &c->token);
+        return 0;
+    }
+    return 1;
+}
+
+static void dC_string(struct dy_compiler* c) {
+    const char* raw = c->token.start;
+    size_t raw_length = c->token.length;
+    size_t length = 0;
+    for (size_t i = 0; i < raw_length; i++, length++) {
+        if (raw[i] == '\\')
+            i++;
+    }
+    // short strings are unescaped here first, then interned
+    char buffer[DYSL_STRING_INTERN_MAX + 1];
+    struct dy_string* str = NULL;
+    char* out = buffer;
+    if (!dString_is_short(length)) {
+        str = dString_alloc(dS_gc(c->D), length);
+        if (str == NULL) {
+            dC_memory_error(c);
+            return;
+        }
+        out = str->data;
+    }
+    for (size_t i = 0; i < raw_length; i++) {
+        char ch = raw[i];
+        if (ch == '\\') {
+            switch (raw[++i]) {
+            case 'n': ch = '\n'; break;
+            case 't': ch = '\t'; break;
+            case 'r': ch = '\r'; break;
+            case 'e': ch = '\x1B'; break;
+            case '0': ch = '\0'; break;
+            default: ch = raw[i]; break;
+            }
+        }
+        *out++ = ch;
+    }
+    if (str == NULL) {
+        str = dGlobal_string(c->D->global, buffer, length);
+        if (str == NULL) {
+            dC_memory_error(c);
+            return;
+        }
+    }
+    dC_emit_constant(c, DYSL_OP_PUSH_CONST, dV_make_object(&str->header));
+}
+
+static void dC_def(struct dy_compiler* c) {
+    dC_advance(c);
+    if (!dC_check_name(c, "expected a word name after 'def', got"))
+        return;
+    struct dy_symbol* sym = dC_symbol(c, &c->token);
+    // bound before its body runs, which may not bind it again
+    if (sym == NULL || !dC_check_unbound(c, sym))
+        return;
+    // the name token does not outlive the body's, which may be streamed
+    dC_advance(c);
+    dC_emit_proc(c, dC_proc(c, sym));
+    dC_bind(c, DYSL_OP_DEF, sym);
+}
+
+static void dC_arrow(struct dy_compiler* c) {
+    int let = 0;
+    dC_advance(c);
+    if (dC_keyword(&c->token) == DYSL_KW_LET) {
+        let = 1;
+        dC_advance(c);
+    }
+    if (!dC_check_name(c, "expected a variable name after '->', got"))
+        return;
+    struct dy_symbol* sym = dC_symbol(c, &c->token);
+    if (sym == NULL)
+        return;
+    struct dy_local* local = let ? NULL : dC_local(c, sym);
+    if (let && !dC_check_unbound(c, sym))
+        return;
+    if (let)
+        dC_bind(c, DYSL_OP_LET, sym);
+    else if (local != NULL && !local->is_word)
+        dC_emit_arg(c, DYSL_OP_SET_LOCAL, local->slot);
+    else
+        dC_emit_constant(c, DYSL_OP_SET, dV_make_object(&sym->header));
+    dC_advance(c);
+}
+
+static void dC_if(struct dy_compiler* c) {
+    dC_advance(c);
+    size_t skip = dC_emit(c, dI_make(DYSL_OP_JUMP_IF_FALSE, 0));
+    dC_block(c);
+    if (dC_keyword(&c->token) != DYSL_KW_ELSE) {
+        dC_patch_jump(c, skip, dC_here(c));
+        return;
+    }
+    size_t done = dC_emit(c, dI_make(DYSL_OP_JUMP, 0));
+    dC_patch_jump(c, skip, dC_here(c));
+    dC_advance(c);
+    if (dC_is_block_open(c)) {
+        dC_block(c);
+    } else {
+        // `else cond? if { ... }` chains into the next if
+        int chained = 0;
+        dC_open_region(c);
+        while (!c->failed && !chained) {
+            if (dC_at_closer(c)) {
+                dC_error(c, "expected a block or 'if' after 'else'", NULL);
+                return;
+            }
+            chained = dC_statement(c);
+        }
+        dC_close_region(c);
+    }
+    dC_patch_jump(c, done, dC_here(c));
+}
+
+static void dC_enter_loop(struct dy_compiler* c, struct dy_loop* loop) {
+    struct dy_funcstate* fs = c->fs;
+    loop->enclosing = fs->loop;
+    loop->break_list = loop->continue_list = 0;
+    loop->bindings = fs->bindings;
+    loop->env_slot = dC_alloc_slots(c, 1);
+    loop->env_pc = dC_emit_arg(c, DYSL_OP_ENV_SAVE, loop->env_slot);
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    loop->live = c->live_count;
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    fs->loop = loop;
+    dC_open_region(c);
+}
+
+/** Closes the loop with a jump back to `head`, returns the exit target.
+ *
+ * Iterations only drop the bindings they made when the body has any. */
+static size_t dC_leave_loop(
+    struct dy_compiler* c,
+    struct dy_loop* loop,
+    size_t head
+) {
+    struct dy_funcstate* fs = c->fs;
+    int scoped = fs->bindings != loop->bindings;
+    dC_close_region(c);
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    c->live_count = loop->live;
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    dC_patch_chain(c, loop->continue_list, dC_here(c));
+    if (scoped)
+        dC_emit_arg(c, DYSL_OP_ENV_RESTORE, loop->env_slot);
+    dC_emit_jump_to(c, DYSL_OP_JUMP, head);
+    size_t exit = dC_here(c);
+    dC_patch_chain(c, loop->break_list, exit);
+    if (scoped)
+        dC_emit_arg(c, DYSL_OP_ENV_RESTORE, loop->env_slot);
+    else if (!c->failed)
+        fs->code[loop->env_pc] = dI_make(DYSL_OP_NOP, 0);
+    fs->loop = loop->enclosing;
+    dC_free_slots(c, 1);
+    return exit;
+}
+
+static void dC_loop(struct dy_compiler* c) {
+    struct dy_loop loop;
+    dC_advance(c);
+    dC_enter_loop(c, &loop);
+    size_t head = dC_label(c);
+    if (!dC_is_block_open(c)) {
+        // loop cond? while { ... }
+        while (!c->failed && dC_keyword(&c->token) != DYSL_KW_WHILE) {
+            if (dC_at_closer(c)) {
+                dC_error(c, "expected a block or 'while' after 'loop'", NULL);
+                return;
+            }
+            dC_statement(c);
+        }
+        dC_advance(c);
+        dC_chain_jump(c, DYSL_OP_JUMP_IF_FALSE, &loop.break_list);
+    }
+    dC_block(c);
+    dC_leave_loop(c, &loop, head);
+}
+
+static void dC_times(struct dy_compiler* c) {
+    struct dy_loop loop;
+    dC_advance(c);
+    uint32_t slot = dC_alloc_slots(c, 1);
+    dC_emit_arg(c, DYSL_OP_TIMES_INIT, slot);
+    dC_enter_loop(c, &loop);
+    size_t head = dC_label(c);
+    size_t step = dC_emit_extended(c, DYSL_OP_TIMES_STEP, slot);
+    dC_block(c);
+    dC_patch_extended(c, step, dC_leave_loop(c, &loop, head));
+    dC_free_slots(c, 1);
+}
+
+static void dC_for(struct dy_compiler* c, int stepped) {
+    struct dy_loop loop;
+    dC_advance(c);
+    uint32_t slot = dC_alloc_slots(c, 3);
+    dC_emit_arg(c, stepped ? DYSL_OP_FOR_INIT_STEP : DYSL_OP_FOR_INIT, slot);
+    dC_enter_loop(c, &loop);
+    size_t head = dC_label(c);
+    size_t step = dC_emit_extended(c, DYSL_OP_FOR_STEP, slot);
+    dC_block(c);
+    dC_patch_extended(c, step, dC_leave_loop(c, &loop, head));
+    dC_free_slots(c, 3);
+}
+
+/** Compiles `array { ... }` and `table { ... }`: the block runs inline and
+ * the values it leaves are collected. */
+static void dC_collection(struct dy_compiler* c, enum dy_opcode op) {
+    int32_t line = c->token.line;
+    dC_advance(c);
+    uint32_t slot = dC_alloc_slots(c, 1);
+    dC_emit_arg(c, DYSL_OP_STACK_MARK, slot);
+    dC_block(c);
+    size_t pc = dC_emit_arg(c, op, slot);
+    // errors are reported at the keyword, not after the block
+    if (!c->failed && DYSL_LINE_INFO)
+        c->fs->lines[pc] = line;
+    dC_free_slots(c, 1);
+}
+
+static void dC_break(struct dy_compiler* c, int is_break) {
+    struct dy_loop* loop = c->fs->loop;
+    if (loop == NULL) {
+        dC_error(c, "used outside of a loop:", &c->token);
+        return;
+    }
+    dC_chain_jump(c, DYSL_OP_JUMP,
+                  is_break ? &loop->break_list : &loop->continue_list);
+    dC_advance(c);
+}
+
+/** Compiles a word call, passing it a trailing block if there is one. */
+static void dC_call(struct dy_compiler* c) {
+    struct dy_token word = c->token;
+    struct dy_symbol* sym = dC_symbol(c, &word);
+    if (sym == NULL)
+        return;
+    dC_advance(c);
+    size_t first = dC_here(c);
+    if (dC_is_block_open(c)) {
+        uint32_t k = dC_constant(c, dV_make_object(&sym->header));
+        struct dy_proc* block = dC_proc(c, NULL);
+        if (block == NULL)
+            return;
+        dC_emit_arg(c, DYSL_OP_CALL_BLOCK, k);
+        dC_emit_word(c, dC_constant(c, dV_make_object(&block->header)));
+#if DYSL_PROCS
+    } else if (c->token.type == DYSL_TOKEN_REF) {
+        dC_get(c, &c->token);
+        dC_advance(c);
+        dC_emit_constant(c, DYSL_OP_CALL_VBLOCK, dV_make_object(&sym->header));
+#endif /* DYSL_PROCS */
+    } else {
+        struct dy_local* local = dC_local(c, sym);
+        if (local == NULL)
+            dC_emit_constant(c, DYSL_OP_CALL_WORD,
+                             dV_make_object(&sym->header));
+        else
+            dC_emit_arg(c, local->is_word ? DYSL_OP_CALL_LOCAL
+                                          : DYSL_OP_GET_LOCAL,
+                        local->slot);
+    }
+#if DYSL_LINE_INFO
+    // lines were taken from the tokens following the word
+    for (size_t pc = first; !c->failed && pc < dC_here(c); pc++)
+        c->fs->lines[pc] = word.line;
+#else /* DYSL_LINE_INFO */
+    (void)first;
+#endif /* DYSL_LINE_INFO */
+}
+
+/** Compiles one statement, returns whether it was an `if`. */
+static int dC_statement(struct dy_compiler* c) {
+    struct dy_token* token = &c->token;
+    switch (token->type) {
+    case DYSL_TOKEN_INTEGER:
+        if (token->as.integer >= DYSL_INSTR_ARG_MIN &&
+            token->as.integer <= DYSL_INSTR_ARG_MAX)
+            dC_emit(c, dI_make(DYSL_OP_PUSH_INT, token->as.integer));
+        else
+            dC_emit_constant(c, DYSL_OP_PUSH_CONST,
+                             dV_make_integer(token->as.integer));
+        dC_advance(c);
+        return 0;
+    case DYSL_TOKEN_REAL:
+#if DYSL_REALS
+        dC_emit_constant(c, DYSL_OP_PUSH_CONST, dV_make_real(token->as.real));
+        dC_advance(c);
+#else /* DYSL_REALS */
+        dC_error(c, "unsupported in this build:", token);
+#endif /* DYSL_REALS */
+        return 0;
+    case DYSL_TOKEN_STRING:
+        dC_string(c);
+        dC_advance(c);
+        return 0;
+    case DYSL_TOKEN_SYMBOL:
+        dC_emit_symbol(c, DYSL_OP_PUSH_CONST, token);
+        dC_advance(c);
+        return 0;
+#if DYSL_PROCS
+    case DYSL_TOKEN_REF:
+        dC_get(c, token);
+        dC_advance(c);
+        return 0;
+    case DYSL_TOKEN_PROC_OPEN:
+        dC_emit_proc(c, dC_proc(c, NULL));
+        return 0;
+#else /* DYSL_PROCS */
+    case DYSL_TOKEN_REF:
+    case DYSL_TOKEN_PROC_OPEN:
+        dC_error(c, "unsupported in this build:", token);
+        return 0;
+#endif /* DYSL_PROCS */
+    case DYSL_TOKEN_WORD:
+        break;
+    default:
+        dC_error(c, "unexpected", token);
+        return 0;
+    }
+    switch (dC_keyword(token)) {
+    case DYSL_KW_NONE: {
+        int op = dC_primitive(token);
+        if (op < 0) {
+            dC_call(c);
+        } else {
+            dC_emit(c, dI_make(op, 0));
+            dC_advance(c);
+        }
+        return 0;
+    }
+    case DYSL_KW_DEF:
+        dC_def(c);
+        return 0;
+    case DYSL_KW_ARROW:
+        dC_arrow(c);
+        return 0;
+    case DYSL_KW_IF:
+        dC_if(c);
+        return 1;
+    case DYSL_KW_LOOP:
+        dC_loop(c);
+        return 0;
+    case DYSL_KW_TIMES:
+        dC_times(c);
+        return 0;
+    case DYSL_KW_FOR:
+    case DYSL_KW_FOR_STEP:
+        dC_for(c, dC_keyword(token) == DYSL_KW_FOR_STEP);
+        return 0;
+    case DYSL_KW_BREAK:
+    case DYSL_KW_CONTINUE:
+        dC_break(c, dC_keyword(token) == DYSL_KW_BREAK);
+        return 0;
+    case DYSL_KW_IMPORT:
+        dC_advance(c);
+        if (!dC_check_name(c, "expected a module name after 'import', got"))
+            return 0;
+        dC_emit_symbol(c, DYSL_OP_IMPORT, token);
+        dC_advance(c);
+        return 0;
+#if DYSL_PROCS
+    case DYSL_KW_PROC:
+        dC_advance(c);
+        dC_emit_proc(c, dC_proc(c, NULL));
+        return 0;
+#endif /* DYSL_PROCS */
+    case DYSL_KW_ARRAY:
+        dC_collection(c, DYSL_OP_ARRAY_NEW);
+        return 0;
+#if DYSL_TABLES
+    case DYSL_KW_TABLE:
+        dC_collection(c, DYSL_OP_TABLE_NEW);
+        return 0;
+#endif /* DYSL_TABLES */
+#if !DYSL_PROCS
+    case DYSL_KW_PROC:
+#endif /* !DYSL_PROCS */
+#if !DYSL_TABLES
+    case DYSL_KW_TABLE:
+#endif /* !DYSL_TABLES */
+#if !DYSL_PROCS || !DYSL_TABLES
+        dC_error(c, "unsupported in this build:", token);
+        return 0;
+#endif /* !DYSL_PROCS || !DYSL_TABLES */
+    case DYSL_KW_TRUE:
+    case DYSL_KW_FALSE:
+    case DYSL_KW_NIL:
+        dC_emit(c, dI_make(dC_keyword(token) == DYSL_KW_NIL
+            ? DYSL_OP_PUSH_NIL
+            : dC_keyword(token) == DYSL_KW_TRUE
+                ? DYSL_OP_PUSH_TRUE
+                : DYSL_OP_PUSH_FALSE, 0));
+        dC_advance(c);
+        return 0;
+    default:
+        dC_error(c, "unexpected", token);
+        return 0;
+    }
+}
+
+/** Compiles the script the lexer was set up for, then destroys it. */
+static struct dy_proc* dC_script(struct dy_compiler* c, int keep_bindings) {
+    struct dy_funcstate fs;
+    c->fs = NULL;
+    c->failed = 0;
+    c->D->incomplete = 0;
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    c->live = NULL;
+    c->live_count = c->live_capacity = 0;
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    dC_open_func(c, &fs, NULL);
+    dC_advance(c);
+    dC_body(c, DYSL_CLOSE_EOF);
+    if (keep_bindings)
+        dC_emit(c, dI_make(DYSL_OP_ENV_KEEP, 0));
+    struct dy_proc* proc = dC_close_func(c);
+#if DYSL_NO_DYNAMIC_SCOPE_SHADOWING
+    if (c->live != NULL)
+        dAlloc_free(dC_allocator(c), c->live,
+                    sizeof(struct dy_symbol*) * c->live_capacity);
+#endif /* DYSL_NO_DYNAMIC_SCOPE_SHADOWING */
+    dLex_destroy(&c->lexer);
+    return proc;
+}
+
+struct dy_proc* dC_compile(struct dysl* D, const char* source, size_t length) {
+    struct dy_compiler c;
+    c.D = D;
+    dLex_init(&c.lexer, source, length);
+    return dC_script(&c, 0);
+}
+
+struct dy_proc* dC_compile_reader(
+    struct dysl* D,
+    dysl_reader reader,
+    void* user_data,
+    int keep_bindings
+) {
+    struct dy_compiler c;
+    c.D = D;
+    dLex_init_reader(&c.lexer, reader, user_data, dS_allocator(D));
+    return dC_script(&c, keep_bindings);
+}
+#pragma endregion /* Compiler API implementation */
+
+#pragma region Bytecode image API implementation
+/** The seed an image's symbol hashes depend on, none for FNV-1a. */
+#define dImage_seed(global) (DYSL_HASH_FNV1A ? 0 : (global)->hash_seed)
+
+struct dy_dumper {
+    struct dysl* D;
+    dysl_writer writer;
+    void* user_data;
+    int failed;
+    struct dy_symbol** symbols;
+    size_t symbol_count, symbol_capacity;
+    struct dy_proc** procs;
+    size_t proc_count, proc_capacity;
+};
+
+/** Appends a pointer to one of the dumper's lists, returns 0 on failure. */
+static int dImage_list_push(
+    struct dy_dumper* d,
+    void*** list,
+    size_t* count,
+    size_t* capacity,
+    void* item
+) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity == 0 ? 16 : *capacity * 2;
+        void** grown = (void**)dAlloc_realloc(
+            dS_allocator(d->D),
+            *list,
+            sizeof(void*) * *capacity,
+            sizeof(void*) * new_capacity
+        );
+        if (grown == NULL) {
+            d->failed = DYSL_ERROR_MEMORY;
+            return 0;
+        }
+        *list = grown;
+        *capacity = new_capacity;
+    }
+    (*list)[(*count)++] = item;
+    return 1;
+}
+
+/** Returns the index of a symbol in the image, adding it if needed. */
+static uint32_t dImage_symbol(struct dy_dumper* d, struct dy_symbol* sym) {
+    for (size_t s = 0; s < d->symbol_count; s++) {
+        if (d->symbols[s] == sym)
+            return (uint32_t)s;
+    }
+    dImage_list_push(d, (void***)&d->symbols, &d->symbol_count,
+                     &d->symbol_capacity, sym);
+    return (uint32_t)(d->symbol_count - 1);
+}
+
+/** Returns the index of a procedure in the image. Procedures are added
+ * after those among their constants, so the loader meets them in order. */
+static uint32_t dImage_proc(struct dy_dumper* d, struct dy_proc* proc) {
+    for (size_t p = 0; p < d->proc_count; p++) {
+        if (d->procs[p] == proc)
+            return (uint32_t)p;
+    }
+    if (proc->native != NULL) {
+        d->failed = DYSL_ERROR_IMAGE;
+        return 0;
+    }
+    if (proc->name != NULL)
+        dImage_symbol(d, proc->name);
+    for (uint32_t k = 0; k < proc->constant_count && !d->failed; k++) {
+        struct dy_value constant = proc->constants[k];
+        if (dV_is(constant, DYSL_TYPE_SYMBOL))
+            dImage_symbol(d, dV_symbol(constant));
+        else if (dV_is(constant, DYSL_TYPE_PROCEDURE))
+            dImage_proc(d, dV_proc(constant));
+    }
+    dImage_list_push(d, (void***)&d->procs, &d->proc_count,
+                     &d->proc_capacity, proc);
+    return (uint32_t)(d->proc_count - 1);
+}
+
+static void dImage_write(struct dy_dumper* d, const void* data, size_t size) {
+    if (!d->failed && size > 0 && d->writer(d->user_data, data, size) != 0)
+        d->failed = DYSL_ERROR_IMAGE;
+}
+
+static void dImage_write_word(struct dy_dumper* d, uint32_t word) {
+    dImage_write(d, &word, sizeof(word));
+}
+
+/** Writes a length and that many bytes, padded to a whole word. */
+static void dImage_write_bytes(
+    struct dy_dumper* d,
+    const char* data,
+    size_t length
+) {
+    static const char padding[4] = { 0 };
+    dImage_write_word(d, (uint32_t)length);
+    dImage_write(d, data, length);
+    dImage_write(d, padding, (4 - length % 4) % 4);
+}
+
+static void dImage_write_proc(struct dy_dumper* d, struct dy_proc* proc) {
+    dImage_write_word(d, proc->name != NULL
+                             ? dImage_symbol(d, proc->name) + 1
+                             : 0);
+    dImage_write_word(d, proc->code_size);
+    dImage_write_word(d, proc->constant_count);
+    dImage_write_word(d, proc->slot_count);
+    dImage_write(d, proc->code, sizeof(dy_instr) * proc->code_size);
+    for (uint32_t pc = 0; pc < proc->code_size; pc++)
+        dImage_write_word(d, (uint32_t)(proc->lines != NULL ? proc->lines[pc]
+                                                            : 0));
+    for (uint32_t k = 0; k < proc->constant_count; k++) {
+        struct dy_value constant = proc->constants[k];
+        dImage_write_word(d, (uint32_t)dV_type(constant));
+        switch (dV_type(constant)) {
+        case DYSL_TYPE_INTEGER:
+            dImage_write_word(d, (uint32_t)dV_integer(constant));
+            break;
+        case DYSL_TYPE_REAL: {
+            dy_real real = dV_real(constant);
+            dImage_write(d, &real, sizeof(real));
+            break;
+        }
+        case DYSL_TYPE_SYMBOL:
+            dImage_write_word(d, dImage_symbol(d, dV_symbol(constant)));
+            break;
+        case DYSL_TYPE_STRING:
+            dImage_write_bytes(d, dString_data(dV_string(constant)),
+                               dV_string(constant)->length);
+            break;
+        case DYSL_TYPE_PROCEDURE:
+            dImage_write_word(d, dImage_proc(d, dV_proc(constant)));
+            break;
+        default:
+            // the compiler only makes the constants above
+            d->failed = DYSL_ERROR_IMAGE;
+            break;
+        }
+    }
+}
+
+int dImage_dump(
+    struct dysl* D,
+    const char* source,
+    size_t length,
+    dysl_writer writer,
+    void* user_data
+) {
+    struct dy_proc* main_proc = dC_compile(D, source, length);
+    if (main_proc == NULL)
+        return D->status;
+    struct dy_dumper d;
+    d.D = D;
+    d.writer = writer;
+    d.user_data = user_data;
+    d.failed = 0;
+    d.symbols = NULL;
+    d.symbol_count = d.symbol_capacity = 0;
+    d.procs = NULL;
+    d.proc_count = d.proc_capacity = 0;
+    // gather everything first, the header needs the counts
+    dImage_proc(&d, main_proc);
+    uint64_t seed = dImage_seed(D->global);
+    dImage_write_word(&d, DYSL_IMAGE_MAGIC);
+    dImage_write_word(&d, DYSL_IMAGE_VERSION);
+    dImage_write_word(&d, DYSL_OP_COUNT);
+    dImage_write_word(&d, DYSL_IMAGE_FEATURES);
+    dImage_write_word(&d, (uint32_t)d.symbol_count);
+    dImage_write_word(&d, (uint32_t)d.proc_count);
+    dImage_write_word(&d, (uint32_t)seed);
+    dImage_write_word(&d, (uint32_t)(seed >> 32));
+    for (size_t s = 0; s < d.symbol_count; s++) {
+        dImage_write_word(&d, d.symbols[s]->hash);
+        dImage_write_bytes(&d, d.symbols[s]->name, d.symbols[s]->length);
+    }
+    for (size_t p = 0; p < d.proc_count; p++)
+        dImage_write_proc(&d, d.procs[p]);
+    struct dysl_allocator* allocator = dS_allocator(D);
+    if (d.symbols != NULL)
+        dAlloc_free(allocator, d.symbols, sizeof(void*) * d.symbol_capacity);
+    if (d.procs != NULL)
+        dAlloc_free(allocator, d.procs, sizeof(void*) * d.proc_capacity);
+    if (d.failed == DYSL_ERROR_MEMORY)
+        return dS_error(D, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
+    if (d.failed)
+        return dS_error(D, DYSL_ERROR_IMAGE, 0, "failed to write the image",
+                        NULL, 0);
+    return DYSL_OK;
+}
+
+struct dy_loader {
+    struct dysl* D;
+    const char* cursor;
+    const char* end;
+    int failed;
+    struct dy_symbol** symbols;
+    uint32_t symbol_count;
+    struct dy_proc** procs;
+    uint32_t proc_count;   /*< Procedures loaded so far. */
+};
+
+/** Reads a word, images need not be aligned. Returns 0 past the end. */
+static uint32_t dImage_read_word(struct dy_loader* l) {
+    uint32_t word = 0;
+    if ((size_t)(l->end - l->cursor) < sizeof(word)) {
+        l->failed = 1;
+        return 0;
+    }
+    dMem_copy(&word, l->cursor, sizeof(word));
+    l->cursor += sizeof(word);
+    return word;
+}
+
+/** Reads `count` words into `out`, or skips them if it is NULL. Returns 0
+ * if the image is too short. */
+static int dImage_read_words(struct dy_loader* l, void* out, uint32_t count) {
+    if ((size_t)(l->end - l->cursor) / sizeof(uint32_t) < count) {
+        l->failed = 1;
+        return 0;
+    }
+    if (out != NULL)
+        dMem_copy(out, l->cursor, sizeof(uint32_t) * count);
+    l->cursor += sizeof(uint32_t) * count;
+    return 1;
+}
+
+/** Reads a length and the padded bytes that follow it, returns them or
+ * NULL if the image is too short. */
+static const char* dImage_read_bytes(struct dy_loader* l, size_t* length) {
+    *length = dImage_read_word(l);
+    size_t padded = *length + (4 - *length % 4) % 4;
+    if (l->failed || (size_t)(l->end - l->cursor) < padded) {
+        l->failed = 1;
+        return NULL;
+    }
+    const char* bytes = l->cursor;
+    l->cursor += padded;
+    return bytes;
+}
+
+/** Interns the image's symbols, in one batch. */
+static int dImage_load_symbols(struct dy_loader* l, int same_seed) {
+    struct dy_global* global = l->D->global;
+    struct dysl_allocator* allocator = dS_allocator(l->D);
+    // grow the table once for all of them
+    size_t desired = global->symbols.count + l->symbol_count;
+    if (dSymbols_should_grow(&global->symbols, desired))
+        dSymbols_ensure_capacity(&global->symbols, desired, allocator);
+    for (uint32_t s = 0; s < l->symbol_count; s++) {
+        dy_hash_t hash = dImage_read_word(l);
+        size_t length;
+        const char* name = dImage_read_bytes(l, &length);
+        if (name == NULL)
+            return 0;
+        if (!same_seed)
+            hash = dHash_slice(global->hash_seed, name, length);
+        l->symbols[s] = dGlobal_intern_hashed(global, name, length, hash);
+        if (l->symbols[s] == NULL) {
+            l->failed = DYSL_ERROR_MEMORY;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/** Reads a constant, returns 0 if it is invalid. */
+static int dImage_load_constant(struct dy_loader* l, struct dy_value* value) {
+    uint32_t kind = dImage_read_word(l);
+    switch (kind) {
+    case DYSL_TYPE_INTEGER:
+        *value = dV_make_integer((dy_int)dImage_read_word(l));
+        return !l->failed;
+#if DYSL_REALS
+    case DYSL_TYPE_REAL: {
+        dy_real real;
+        if (!dImage_read_words(l, &real, sizeof(real) / sizeof(uint32_t)))
+            return 0;
+        *value = dV_make_real(real);
+        return 1;
+    }
+#endif /* DYSL_REALS */
+    case DYSL_TYPE_SYMBOL: {
+        uint32_t index = dImage_read_word(l);
+        if (l->failed || index >= l->symbol_count)
+            return 0;
+        *value = dV_make_object(&l->symbols[index]->header);
+        return 1;
+    }
+    case DYSL_TYPE_STRING: {
+        size_t length;
+        const char* data = dImage_read_bytes(l, &length);
+        if (data == NULL)
+            return 0;
+        struct dy_string* str = dGlobal_string(l->D->global, data, length);
+        if (str == NULL) {
+            l->failed = DYSL_ERROR_MEMORY;
+            return 0;
+        }
+        *value = dV_make_object(&str->header);
+        return 1;
+    }
+    case DYSL_TYPE_PROCEDURE: {
+        // only procedures loaded earlier are valid
+        uint32_t index = dImage_read_word(l);
+        if (l->failed || index >= l->proc_count)
+            return 0;
+        *value = dV_make_object(&l->procs[index]->header);
+        return 1;
+    }
+    default:
+        return 0;
+    }
+}
+
+/** Returns whether `op` is followed by an extra word. */
+static inline int dImage_has_extra(enum dy_opcode op) {
+    return op == DYSL_OP_CALL_BLOCK || op == DYSL_OP_TIMES_STEP ||
+           op == DYSL_OP_FOR_STEP || op == DYSL_OP_LET_LOCAL ||
+           op == DYSL_OP_DEF_LOCAL;
+}
+
+/** Checks a procedure's code against the rest of it, as the VM reads its
+ * operands unchecked: opcodes are known, constants exist and are of the
+ * type their instruction reads, slots are below `slot_count`, jumps land
+ * on an instruction, and the code cannot run past its end. Returns 0 if
+ * it is invalid. */
+static int dImage_check_code(
+    struct dy_loader* l,
+    const dy_instr* code,
+    uint32_t code_size,
+    const struct dy_value* K,
+    uint32_t constant_count,
+    uint32_t slot_count
+) {
+    // which words start an instruction, rather than hold an extra word
+    uint8_t* starts = (uint8_t*)dAlloc_alloc(dS_allocator(l->D), code_size);
+    if (starts == NULL) {
+        l->failed = DYSL_ERROR_MEMORY;
+        return 0;
+    }
+    uint32_t last = 0;
+    int valid = 1;
+    for (uint32_t pc = 0; pc < code_size; pc++) {
+        starts[pc] = 1;
+        last = pc;
+        if (dI_op(code[pc]) >= DYSL_OP_COUNT)
+            valid = 0;
+        else if (dImage_has_extra(dI_op(code[pc])) && pc + 1 < code_size)
+            starts[++pc] = 0;
+        else if (dImage_has_extra(dI_op(code[pc])))
+            valid = 0;
+    }
+    // only returns and jumps do not run into the next instruction
+    if (dI_op(code[last]) != DYSL_OP_RETURN &&
+        dI_op(code[last]) != DYSL_OP_JUMP)
+        valid = 0;
+#define dImage_constant(index, type) \
+    ((uint32_t)(index) < constant_count && \
+     ((type) == DYSL_TYPE_COUNT || dV_is(K[(uint32_t)(index)], (type))))
+#define dImage_slots(index, count) \
+    ((uint32_t)(index) < slot_count && \
+     slot_count - (uint32_t)(index) >= (count))
+#define dImage_target(offset) \
+    ((int64_t)next + (offset) >= 0 && \
+     (int64_t)next + (offset) < (int64_t)code_size && \
+     starts[next + (offset)])
+    for (uint32_t pc = 0; pc < code_size && valid; pc++) {
+        if (!starts[pc])
+            continue;
+        enum dy_opcode op = dI_op(code[pc]);
+        int32_t arg = dI_arg(code[pc]);
+        uint32_t extra = dImage_has_extra(op) ? code[pc + 1] : 0;
+        // where jumps are relative to
+        uint32_t next = pc + 1 + (uint32_t)dImage_has_extra(op);
+        switch (op) {
+        case DYSL_OP_PUSH_CONST:
+            valid = dImage_constant(arg, DYSL_TYPE_COUNT);
+            break;
+#if DYSL_SUPERINSTRUCTIONS && DYSL_PROCS
+        case DYSL_OP_CALL_VAR:
+            // runs the CALL that follows it
+            valid = dImage_constant(arg, DYSL_TYPE_SYMBOL) &&
+                    next < code_size && dI_op(code[next]) == DYSL_OP_CALL;
+            break;
+#endif /* DYSL_SUPERINSTRUCTIONS && DYSL_PROCS */
+#if DYSL_PROCS
+        case DYSL_OP_CALL_VBLOCK:
+#endif /* DYSL_PROCS */
+        case DYSL_OP_CALL_WORD:
+        case DYSL_OP_GET:
+        case DYSL_OP_LET:
+        case DYSL_OP_SET:
+        case DYSL_OP_DEF:
+        case DYSL_OP_IMPORT:
+            valid = dImage_constant(arg, DYSL_TYPE_SYMBOL);
+            break;
+        case DYSL_OP_CALL_BLOCK:
+            valid = dImage_constant(arg, DYSL_TYPE_SYMBOL) &&
+                    dImage_constant(extra, DYSL_TYPE_PROCEDURE);
+            break;
+        case DYSL_OP_LET_LOCAL:
+        case DYSL_OP_DEF_LOCAL:
+            valid = dImage_constant(arg, DYSL_TYPE_SYMBOL) &&
+                    dImage_slots(extra, 1);
+            break;
+        case DYSL_OP_GET_LOCAL:
+        case DYSL_OP_SET_LOCAL:
+        case DYSL_OP_CALL_LOCAL:
+        case DYSL_OP_ENV_SAVE:
+        case DYSL_OP_ENV_RESTORE:
+        case DYSL_OP_TIMES_INIT:
+        case DYSL_OP_STACK_MARK:
+        case DYSL_OP_ARRAY_NEW:
+#if DYSL_TABLES
+        case DYSL_OP_TABLE_NEW:
+#endif /* DYSL_TABLES */
+            valid = dImage_slots(arg, 1);
+            break;
+        case DYSL_OP_TIMES_STEP:
+            valid = dImage_slots(arg, 1) && dImage_target((int32_t)extra);
+            break;
+        case DYSL_OP_FOR_INIT:
+        case DYSL_OP_FOR_INIT_STEP:
+            valid = dImage_slots(arg, 3);
+            break;
+        case DYSL_OP_FOR_STEP:
+            valid = dImage_slots(arg, 3) && dImage_target((int32_t)extra);
+            break;
+        case DYSL_OP_JUMP:
+        case DYSL_OP_JUMP_IF_FALSE:
+#if DYSL_SUPERINSTRUCTIONS
+        case DYSL_OP_JUMP_IF_NOT_EQ:
+        case DYSL_OP_JUMP_IF_NOT_NE:
+        case DYSL_OP_JUMP_IF_NOT_LT:
+        case DYSL_OP_JUMP_IF_NOT_GT:
+        case DYSL_OP_JUMP_IF_NOT_LE:
+        case DYSL_OP_JUMP_IF_NOT_GE:
+#endif /* DYSL_SUPERINSTRUCTIONS */
+            valid = dImage_target(arg);
+            break;
+        default:
+            // the rest have no operand, or an integer one
+            break;
+        }
+    }
+#undef dImage_constant
+#undef dImage_slots
+#undef dImage_target
+    dAlloc_free(dS_allocator(l->D), starts, code_size);
+    return valid;
+}
+
+static struct dy_proc* dImage_load_proc(struct dy_loader* l) {
+    struct dysl_allocator* allocator = dS_allocator(l->D);
+    uint32_t name = dImage_read_word(l);
+    uint32_t code_size = dImage_read_word(l);
+    uint32_t constant_count = dImage_read_word(l);
+    uint32_t slot_count = dImage_read_word(l);
+    // code and lines take two words per instruction, constants at least one
+    size_t left = (size_t)(l->end - l->cursor) / sizeof(uint32_t);
+    if (l->failed || name > l->symbol_count || code_size == 0 ||
+        code_size > left / 2 || constant_count > left - code_size * 2) {
+        l->failed = 1;
+        return NULL;
+    }
+    dy_instr* code = (dy_instr*)dAlloc_alloc(allocator,
+                                             sizeof(dy_instr) * code_size);
+#if DYSL_LINE_INFO
+    int32_t* lines = (int32_t*)dAlloc_alloc(allocator,
+                                            sizeof(int32_t) * code_size);
+#else /* DYSL_LINE_INFO */
+    int32_t* lines = NULL;
+#endif /* DYSL_LINE_INFO */
+    struct dy_value* constants = constant_count > 0
+        ? (struct dy_value*)dAlloc_alloc(
+              allocator, sizeof(struct dy_value) * constant_count)
+        : NULL;
+    if (code == NULL || (DYSL_LINE_INFO && lines == NULL) ||
+        (constant_count > 0 && constants == NULL)) {
+        l->failed = DYSL_ERROR_MEMORY;
+    } else {
+        dImage_read_words(l, code, code_size);
+        // skipped when NULL, without line info
+        dImage_read_words(l, lines, code_size);
+        for (uint32_t k = 0; k < constant_count && !l->failed; k++) {
+            if (!dImage_load_constant(l, &constants[k]) && !l->failed)
+                l->failed = 1;
+        }
+        if (!l->failed && !dImage_check_code(l, code, code_size, constants,
+                                             constant_count, slot_count) &&
+            !l->failed)
+            l->failed = 1;
+    }
+    struct dy_proc* proc = NULL;
+    if (!l->failed) {
+        proc = dProc_create(
+            dS_gc(l->D),
+            name > 0 ? l->symbols[name - 1] : NULL,
+            code,
+            lines,
+            code_size,
+            constants,
+            constant_count,
+            slot_count
+        );
+        if (proc == NULL)
+            l->failed = DYSL_ERROR_MEMORY;
+    }
+    if (proc == NULL) {
+        if (code != NULL)
+            dAlloc_free(allocator, code, sizeof(dy_instr) * code_size);
+        if (lines != NULL)
+            dAlloc_free(allocator, lines, sizeof(int32_t) * code_size);
+        if (constants != NULL)
+            dAlloc_free(allocator, constants,
+                        sizeof(struct dy_value) * constant_count);
+    }
+    return proc;
+}
+
+struct dy_proc* dImage_load(struct dysl* D, const void* image, size_t size) {
+    struct dysl_allocator* allocator = dS_allocator(D);
+    struct dy_loader l;
+    uint32_t header[DYSL_IMAGE_HEADER_WORDS];
+    l.D = D;
+    l.cursor = (const char*)image;
+    l.end = l.cursor + size;
+    l.failed = 0;
+    l.symbols = NULL;
+    l.procs = NULL;
+    l.proc_count = 0;
+    if (!dImage_read_words(&l, header, DYSL_IMAGE_HEADER_WORDS) ||
+        header[0] != DYSL_IMAGE_MAGIC || header[1] != DYSL_IMAGE_VERSION ||
+        header[2] != DYSL_OP_COUNT || header[3] != DYSL_IMAGE_FEATURES ||
+        header[5] == 0) {
+        dS_error(D, DYSL_ERROR_IMAGE, 0, "not a compatible image", NULL, 0);
+        return NULL;
+    }
+    // every symbol and procedure takes a few words, which bounds the counts
+    size_t words = size / sizeof(uint32_t);
+    l.symbol_count = header[4];
+    uint32_t proc_count = header[5];
+    if (l.symbol_count > words / 2 || proc_count > words / 6) {
+        dS_error(D, DYSL_ERROR_IMAGE, 0, "malformed image", NULL, 0);
+        return NULL;
+    }
+    uint64_t seed = header[6] | (uint64_t)header[7] << 32;
+    if (l.symbol_count > 0)
+        l.symbols = (struct dy_symbol**)dAlloc_alloc(
+            allocator, sizeof(struct dy_symbol*) * l.symbol_count);
+    l.procs = (struct dy_proc**)dAlloc_alloc(
+        allocator, sizeof(struct dy_proc*) * proc_count);
+    if ((l.symbol_count > 0 && l.symbols == NULL) || l.procs == NULL)
+        l.failed = DYSL_ERROR_MEMORY;
+    // the hashes only hold under the seed they were made with
+    if (!l.failed)
+        dImage_load_symbols(&l, seed == dImage_seed(D->global));
+    while (!l.failed && l.proc_count < proc_count) {
+        struct dy_proc* proc = dImage_load_proc(&l);
+        if (proc != NULL)
+            l.procs[l.proc_count++] = proc;
+    }
+    struct dy_proc* main_proc = l.failed ? NULL : l.procs[proc_count - 1];
+    if (l.symbols != NULL)
+        dAlloc_free(allocator, l.symbols,
+                    sizeof(struct dy_symbol*) * l.symbol_count);
+    if (l.procs != NULL)
+        dAlloc_free(allocator, l.procs, sizeof(struct dy_proc*) * proc_count);
+    if (l.failed == DYSL_ERROR_MEMORY)
+        dS_error(D, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
+    else if (l.failed)
+        dS_error(D, DYSL_ERROR_IMAGE, 0, "malformed image", NULL, 0);
+    return main_proc;
+}
+#pragma endregion /* Bytecode image API implementation */
+
+#if DYSL_PROFILE
+#pragma region Profiler API implementation
+static inline uint64_t dProfile_now(struct dy_profiler* p) {
+    return p->clock != NULL ? p->clock(p->clock_data) : ++p->ticks;
+}
+
+/** Returns how many objects were created so far, of any type. */
+static size_t dProfile_allocations(struct dy_global* global) {
+    size_t total = 0;
+    for (size_t t = 0; t < DYSL_TYPE_COUNT; t++)
+        total += global->gc.created[t];
+    return total;
+}
+
+/** Grows one of the profiler's arrays, returns NULL on failure. */
+static void* dProfile_grow(
+    struct dysl_allocator* allocator,
+    void* array,
+    size_t* capacity,
+    size_t element_size
+) {
+    size_t new_capacity = *capacity == 0 ? 64 : *capacity * 2;
+    if (new_capacity > UINT32_MAX)
+        return NULL;
+    void* grown = dAlloc_realloc(allocator, array, element_size * *capacity,
+                                 element_size * new_capacity);
+    if (grown != NULL)
+        *capacity = new_capacity;
+    return grown;
+}
+
+/** Charges the periods elapsed since the last sample to the calls `D` is
+ * running. */
+static void dProfile_sample(
+    struct dysl* D,
+    struct dy_profiler* p,
+    uint64_t now
+) {
+    uint64_t periods = (now - p->last_sample) / p->period;
+    if (periods == 0)
+        return;
+    uint32_t node = D->profile_depth > 0
+        ? D->profile_frames[D->profile_depth - 1].node
+        : 0;
+    p->nodes[node].samples += periods;
+    p->last_sample += periods * p->period;
+}
+
+/** Returns the node for `parent` calling `name`, adding it (and an entry
+ * for `name`) if needed. Returns 0 if allocation fails. */
+static uint32_t dProfile_child(
+    struct dysl* D,
+    struct dy_profiler* p,
+    uint32_t parent,
+    struct dy_symbol* name
+) {
+    for (uint32_t n = p->nodes[parent].child; n != 0; n = p->nodes[n].sibling) {
+        if (p->entries[p->nodes[n].entry].name == name)
+            return n;
+    }
+    // new calling contexts are rare, a scan finds the entry
+    size_t e = 0;
+    while (e < p->entry_count && p->entries[e].name != name)
+        e++;
+    if (e == p->entry_capacity) {
+        struct dy_profile_entry* entries = (struct dy_profile_entry*)
+            dProfile_grow(dS_allocator(D), p->entries, &p->entry_capacity,
+                          sizeof(struct dy_profile_entry));
+        if (entries == NULL)
+            return 0;
+        p->entries = entries;
+    }
+    if (p->node_count == p->node_capacity) {
+        struct dy_profile_node* nodes = (struct dy_profile_node*)
+            dProfile_grow(dS_allocator(D), p->nodes, &p->node_capacity,
+                          sizeof(struct dy_profile_node));
+        if (nodes == NULL)
+            return 0;
+        p->nodes = nodes;
+    }
+    if (e == p->entry_count) {
+        p->entries[e].name = name;
+        p->entries[e].calls = 0;
+        p->entries[e].self_time = 0;
+        p->entries[e].allocations = 0;
+        p->entry_count++;
+    }
+    uint32_t n = (uint32_t)p->node_count++;
+    p->nodes[n].entry = (uint32_t)e;
+    p->nodes[n].parent = parent;
+    p->nodes[n].child = 0;
+    p->nodes[n].sibling = p->nodes[parent].child;
+    p->nodes[n].samples = 0;
+    p->nodes[parent].child = n;
+    return n;
+}
+
+static int dProfile_enter(struct dysl* D, struct dy_symbol* name) {
+    struct dy_profiler* p = &D->global->profiler;
+    if (D->profile_depth == D->profile_capacity) {
+        struct dy_profile_frame* frames = (struct dy_profile_frame*)
+            dProfile_grow(dS_allocator(D), D->profile_frames,
+                          &D->profile_capacity,
+                          sizeof(struct dy_profile_frame));
+        if (frames == NULL)
+            return 0;
+        D->profile_frames = frames;
+    }
+    uint64_t now = dProfile_now(p);
+    dProfile_sample(D, p, now);
+    uint32_t parent = D->profile_depth > 0
+        ? D->profile_frames[D->profile_depth - 1].node
+        : 0;
+    uint32_t node = dProfile_child(D, p, parent, name);
+    if (node == 0)
+        return 0;
+    p->entries[p->nodes[node].entry].calls++;
+    struct dy_profile_frame* frame = &D->profile_frames[D->profile_depth++];
+    frame->node = node;
+    frame->start = now;
+    frame->child_time = 0;
+    frame->start_allocations = dProfile_allocations(D->global);
+    frame->child_allocations = 0;
+    return 1;
+}
+
+static void dProfile_leave(struct dysl* D) {
+    struct dy_profiler* p = &D->global->profiler;
+    struct dy_profile_frame* frame = &D->profile_frames[--D->profile_depth];
+    if (!p->active)
+        return;
+    uint64_t now = dProfile_now(p);
+    // the call is still running until now
+    D->profile_depth++;
+    dProfile_sample(D, p, now);
+    D->profile_depth--;
+    struct dy_profile_entry* entry = &p->entries[p->nodes[frame->node].entry];
+    uint64_t elapsed = now - frame->start;
+    size_t allocations = dProfile_allocations(D->global) -
+                         frame->start_allocations;
+    entry->self_time += elapsed - frame->child_time;
+    entry->allocations += allocations - frame->child_allocations;
+    if (D->profile_depth > 0) {
+        struct dy_profile_frame* caller =
+            &D->profile_frames[D->profile_depth - 1];
+        caller->child_time += elapsed;
+        caller->child_allocations += allocations;
+    }
+}
+#pragma endregion /* Profiler API implementation */
+#endif /* DYSL_PROFILE */
+
+#pragma region Virtual machine API implementation
+/** Raises a runtime error at the current instruction. */
+static int dVM_error(
+    struct dysl* D,
+    const char* message,
+    const char* detail,
+    size_t detail_length
+) {
+    return dS_error(D, DYSL_ERROR_RUNTIME, dS_line(D), message,
+                    detail, detail_length);
+}
+
+static int dVM_memory_error(struct dysl* D) {
+    return dS_error(D, DYSL_ERROR_MEMORY, dS_line(D), "out of memory", NULL, 0);
+}
+
+/** `dVM_lookup` for qualified names, which may be module words. A module
+ * word resolves to its entry's binding when the innermost of `name` and its
+ * module's marker is the marker, the entry's procedure being created then
+ * if it is the first time. */
+static int dVM_lookup_word(
+    struct dysl* D,
+    struct dy_symbol* name,
+    struct dy_env_cache* cache,
+    struct dy_binding** found
+) {
+    struct dy_module_entry* entry = dGlobal_find_entry(D->global, name);
+    struct dy_binding* binding;
+    if (entry == NULL) {
+        binding = dEnv_find(&D->env, name);
+    } else {
+        // the import bumps looked up words, so caches see it shadow them
+        entry->binding.name = name;
+        struct dy_symbol* marker = entry->marker;
+        size_t b = D->env.count;
+        while (b > 0 && D->env.bindings[b - 1].name != name &&
+               D->env.bindings[b - 1].name != marker)
+            b--;
+        binding = b > 0 ? &D->env.bindings[b - 1] : NULL;
+        if (binding == NULL || binding->name == name) {
+            entry = NULL;
+        } else if (dV_is(entry->binding.value, DYSL_TYPE_NIL)) {
+            struct dy_proc* proc = dProc_create_native(&D->global->gc, name,
+                                                       entry->fn);
+            if (proc == NULL) {
+                dVM_memory_error(D);
+                return 0;
+            }
+            entry->binding.value = dV_make_object(&proc->header);
+        }
+    }
+    *found = NULL;
+    if (binding != NULL) {
+        dEnv_remember(&D->env, name, binding, entry, cache);
+        *found = entry != NULL ? &entry->binding : binding;
+    }
+    return 1;
+}
+
+/** Looks `name` up past a stale `cache`, and remembers what it found. Sets
+ * `*found` to NULL if unbound, returns 0 if out of memory. */
+static inline int dVM_lookup(
+    struct dysl* D,
+    struct dy_symbol* name,
+    struct dy_env_cache* cache,
+    struct dy_binding** found
+) {
+    if (dSymbol_is_qualified(name))
+        return dVM_lookup_word(D, name, cache, found);
+    *found = dEnv_find(&D->env, name);
+    if (*found != NULL)
+        dEnv_remember(&D->env, name, *found, NULL, cache);
+    return 1;
+}
+
+/** Grows the stack ahead of a native call, so its pushes rarely have to.
+ * Failing is fine, pushes still check for room. */
+static inline void dVM_reserve_native(struct dysl* D) {
+    if (dStack_room(&D->stack) < DYSL_STACK_NATIVE_MIN)
+        dStack_grow(&D->stack, DYSL_STACK_NATIVE_MIN, dS_allocator(D));
+}
+
+/** Runs a fast native on the values on top of the stack, which its result
+ * replaces. */
+static inline void dVM_call_fast(struct dysl* D, struct dy_proc* proc) {
+    size_t count = dStack_count(&D->stack);
+    if (count < proc->arity) {
+        dVM_error(D, "stack underflow", NULL, 0);
+        return;
+    }
+    // the result slot is right above the arguments
+    if (dStack_room(&D->stack) == 0 && !dS_ensure_stack(D, 1))
+        return;
+    struct dy_value* args = D->stack.top - proc->arity;
+    *D->stack.top = dV_nil();
+    proc->fast(D, args, D->stack.top);
+    args[0] = args[proc->arity];
+    D->stack.top = args + 1;
+}
+
+/** Runs a native procedure. */
+static inline void dVM_call_native(struct dysl* D, struct dy_proc* proc) {
+    if (proc->fast != NULL) {
+#if DYSL_PROFILE
+        if (D->global->profiler.active && proc->name != NULL &&
+            dProfile_enter(D, proc->name)) {
+            dVM_call_fast(D, proc);
+            dProfile_leave(D);
+            return;
+        }
+#endif /* DYSL_PROFILE */
+        dVM_call_fast(D, proc);
+        return;
+    }
+    dVM_reserve_native(D);
+#if DYSL_PROFILE
+    if (D->global->profiler.active && proc->name != NULL &&
+        dProfile_enter(D, proc->name)) {
+        proc->native(D);
+        dProfile_leave(D);
+        return;
+    }
+#endif /* DYSL_PROFILE */
+    proc->native(D);
+}
+
+/** Pushes a frame for a bytecode procedure. Returns a status code. */
+static int dVM_push_frame(
+    struct dysl* D,
+    struct dy_proc* proc,
+    struct dy_proc* block
+) {
+    struct dysl_allocator* allocator = dS_allocator(D);
+    if (D->frame_count == D->frame_capacity) {
+        if (D->frame_capacity >= DYSL_MAX_CALL_DEPTH)
+            return dVM_error(D, "call stack overflow", NULL, 0);
+        size_t new_capacity = D->frame_capacity == 0
+            ? 16
+            : dU_min(D->frame_capacity * 2, DYSL_MAX_CALL_DEPTH);
+        struct dy_frame* frames = (struct dy_frame*)dAlloc_realloc(
+            allocator,
+            D->frames,
+            sizeof(struct dy_frame) * D->frame_capacity,
+            sizeof(struct dy_frame) * new_capacity
+        );
+        if (frames == NULL)
+            return dVM_memory_error(D);
+        D->frames = frames;
+        D->frame_capacity = new_capacity;
+    }
+    if (D->slot_count + proc->slot_count > D->slot_capacity) {
+        size_t new_capacity = D->slot_capacity == 0 ? 64 : D->slot_capacity;
+        while (new_capacity < D->slot_count + proc->slot_count)
+            new_capacity *= 2;
+        struct dy_value* slots = (struct dy_value*)dAlloc_realloc(
+            allocator,
+            D->slots,
+            sizeof(struct dy_value) * D->slot_capacity,
+            sizeof(struct dy_value) * new_capacity
+        );
+        if (slots == NULL)
+            return dVM_memory_error(D);
+        D->slots = slots;
+        D->slot_capacity = new_capacity;
+    }
+    struct dy_frame* frame = &D->frames[D->frame_count++];
+    frame->proc = proc;
+    frame->ip = proc->code;
+    frame->block = block;
+    frame->env_base = D->env.count;
+    frame->slot_base = D->slot_count;
+#if DYSL_PROFILE
+    frame->profile_depth = D->profile_depth;
+    if (D->global->profiler.active && proc->name != NULL)
+        dProfile_enter(D, proc->name);
+#endif /* DYSL_PROFILE */
+    // slots are scanned by the collector
+    for (uint32_t s = 0; s < proc->slot_count; s++)
+        D->slots[D->slot_count++] = dV_nil();
+    return DYSL_OK;
+}
+
+/** Generic arithmetic: numbers, and `+` concatenating strings. */
+static int dVM_arith(
+    struct dysl* D,
+    enum dy_opcode op,
+    const struct dy_value* a,
+    const struct dy_value* b,
+    struct dy_value* result
+) {
+    if (dV_is(*a, DYSL_TYPE_INTEGER) && dV_is(*b, DYSL_TYPE_INTEGER)) {
+        dy_int x = dV_integer(*a), y = dV_integer(*b), r;
+#if DYSL_REALS
+        // results that overflow are promoted to reals
+        switch (op) {
+        case DYSL_OP_ADD:
+            *result = dU_add_overflow(x, y, &r)
+                ? dV_make_real((dy_real)x + (dy_real)y)
+                : dV_make_integer(r);
+            return DYSL_OK;
+        case DYSL_OP_SUB:
+            *result = dU_sub_overflow(x, y, &r)
+                ? dV_make_real((dy_real)x - (dy_real)y)
+                : dV_make_integer(r);
+            return DYSL_OK;
+        case DYSL_OP_MUL:
+            *result = dU_mul_overflow(x, y, &r)
+                ? dV_make_real((dy_real)x * (dy_real)y)
+                : dV_make_integer(r);
+            return DYSL_OK;
+        case DYSL_OP_DIV:
+            if (y == 0)
+                return dVM_error(D, "division by zero", NULL, 0);
+            *result = dU_div_overflow(x, y, &r)
+                ? dV_make_real(-(dy_real)x)
+                : dV_make_integer(r);
+            return DYSL_OK;
+#else /* DYSL_REALS */
+        // with nothing to promote them to, results that overflow are errors
+        int overflow;
+        switch (op) {
+        case DYSL_OP_ADD:
+            overflow = dU_add_overflow(x, y, &r);
+            break;
+        case DYSL_OP_SUB:
+            overflow = dU_sub_overflow(x, y, &r);
+            break;
+        case DYSL_OP_MUL:
+            overflow = dU_mul_overflow(x, y, &r);
+            break;
+        case DYSL_OP_DIV:
+            if (y == 0)
+                return dVM_error(D, "division by zero", NULL, 0);
+            overflow = dU_div_overflow(x, y, &r);
+            break;
+#endif /* DYSL_REALS */
+        default: {
+            if (y == 0)
+                return dVM_error(D, "division by zero", NULL, 0);
+            // the result takes the sign of the divisor
+            r = y == -1 ? 0 : x % y;
+            if (r != 0 && (r ^ y) < 0)
+                r += y;
+            *result = dV_make_integer(r);
+            return DYSL_OK;
+        }
+        }
+#if !DYSL_REALS
+        if (overflow) {
+            const char* name = dC_primitive_name(op);
+            return dVM_error(D, "integer overflow in", name, dU_strlen(name));
+        }
+        *result = dV_make_integer(r);
+        return DYSL_OK;
+#endif /* !DYSL_REALS */
+    }
+#if DYSL_REALS
+    if (dV_is_number(*a) && dV_is_number(*b)) {
+        dy_real x = dV_to_real(*a), y = dV_to_real(*b);
+        switch (op) {
+        case DYSL_OP_ADD: *result = dV_make_real(x + y); break;
+        case DYSL_OP_SUB: *result = dV_make_real(x - y); break;
+        case DYSL_OP_MUL: *result = dV_make_real(x * y); break;
+        case DYSL_OP_DIV: *result = dV_make_real(x / y); break;
+        default: *result = dV_make_real(x - dU_floor(x / y) * y); break;
+        }
+        return DYSL_OK;
+    }
+#endif /* DYSL_REALS */
+    if (op == DYSL_OP_ADD &&
+        dV_is(*a, DYSL_TYPE_STRING) && dV_is(*b, DYSL_TYPE_STRING)) {
+        struct dy_string* x = dV_string(*a);
+        struct dy_string* y = dV_string(*b);
+        size_t length = x->length + y->length;
+        struct dy_string* str;
+        if (dString_is_short(length)) {
+            char buffer[DYSL_STRING_INTERN_MAX + 1];
+            dMem_copy(buffer, x->data, x->length);
+            dMem_copy(buffer + x->length, y->data, y->length);
+            str = dGlobal_string(D->global, buffer, length);
+        } else {
+            str = dString_alloc(dS_gc(D), length);
+            if (str != NULL) {
+                dMem_copy(str->data, dString_data(x), x->length);
+                dMem_copy(str->data + x->length, dString_data(y), y->length);
+            }
+        }
+        if (str == NULL)
+            return dVM_memory_error(D);
+        *result = dV_make_object(&str->header);
+        return DYSL_OK;
+    }
+    const char* name = dC_primitive_name(op);
+    return dVM_error(D, "invalid operands for", name, dU_strlen(name));
+}
+
+/** Orders numbers, and strings bytewise. */
+static int dVM_compare(
+    struct dysl* D,
+    enum dy_opcode op,
+    const struct dy_value* a,
+    const struct dy_value* b,
+    struct dy_value* result
+) {
+    int order;
+    if (dV_is(*a, DYSL_TYPE_INTEGER) && dV_is(*b, DYSL_TYPE_INTEGER)) {
+        dy_int x = dV_integer(*a), y = dV_integer(*b);
+        order = (x > y) - (x < y);
+    } else if (dV_is_number(*a) && dV_is_number(*b)) {
+        dy_real x = dV_to_real(*a), y = dV_to_real(*b);
+        if (x != x || y != y) {
+            // NaN is unordered
+            *result = dV_make_boolean(0);
+            return DYSL_OK;
+        }
+        order = (x > y) - (x < y);
+    } else if (dV_is(*a, DYSL_TYPE_STRING) && dV_is(*b, DYSL_TYPE_STRING)) {
+        struct dy_string* x = dV_string(*a);
+        struct dy_string* y = dV_string(*b);
+        const char* xs = dString_data(x);
+        const char* ys = dString_data(y);
+        size_t length = dU_min(x->length, y->length);
+        order = 0;
+        for (size_t i = 0; i < length && order == 0; i++) {
+            uint8_t cx = (uint8_t)xs[i], cy = (uint8_t)ys[i];
+            order = (cx > cy) - (cx < cy);
+        }
+        if (order == 0)
+            order = (x->length > y->length) - (x->length < y->length);
+    } else {
+        const char* name = dC_primitive_name(op);
+        return dVM_error(D, "invalid operands for", name, dU_strlen(name));
+    }
+    switch (op) {
+    case DYSL_OP_LT: *result = dV_make_boolean(order < 0); break;
+    case DYSL_OP_GT: *result = dV_make_boolean(order > 0); break;
+    case DYSL_OP_LE: *result = dV_make_boolean(order <= 0); break;
+    default: *result = dV_make_boolean(order >= 0); break;
+    }
+    return DYSL_OK;
+}
+
+/* Dispatch: with computed gotos every instruction jumps straight to the
+ * next one's handler, otherwise it is a plain switch in a loop. Label
+ * addresses are marked `__extension__`, which keeps `-pedantic` quiet. */
+#if DYSL_COMPUTED_GOTO
+#define vm_dispatch(op) __extension__ ({ goto *dispatch_table[op]; });
+#define vm_case(name)   op_##name:
+#define vm_break        vm_fetch(); vm_dispatch(dI_op(i))
+#else /* DYSL_COMPUTED_GOTO */
+#define vm_dispatch(op) switch (op)
+#define vm_case(name)   case DYSL_OP_##name:
+#define vm_break        break
+#endif /* DYSL_COMPUTED_GOTO */
+#if DYSL_PROFILE_PAIRS
+#define vm_fetch() \
+    (i = *ip++, \
+     pair_counts[previous_op * DYSL_OP_COUNT + dI_op(i)]++, \
+     previous_op = dI_op(i))
+#else /* DYSL_PROFILE_PAIRS */
+#define vm_fetch() (i = *ip++)
+#endif /* DYSL_PROFILE_PAIRS */
+/* the current frame, cached */
+#define vm_load() \
+    (frame = &D->frames[D->frame_count - 1], \
+     ip = frame->ip, \
+     K = frame->proc->constants, \
+     C = frame->proc->caches, \
+     slots = D->slots + frame->slot_base)
+#define vm_save() (D->stack.top = top, frame->ip = ip)
+/* the value stack, cached, reloaded whenever it may have moved */
+#define vm_load_stack() \
+    (stack_base = D->stack.base, \
+     stack_limit = D->stack.base + D->stack.size, \
+     top = D->stack.top)
+#define vm_raise(message, detail, length) \
+    do { \
+        vm_save(); \
+        dVM_error(D, (message), (detail), (length)); \
+        goto vm_fail; \
+    } while (0)
+#define vm_raise_symbol(message, sym) \
+    vm_raise((message), (sym)->name, (sym)->length)
+#define vm_raise_memory() \
+    do { vm_save(); dVM_memory_error(D); goto vm_fail; } while (0)
+/* the binding of `name`, NULL if unbound, through its constant's cache */
+#define vm_find(binding, name, cache) \
+    do { \
+        (binding) = dEnv_cached(&D->env, (name), (cache)); \
+        if ((binding) == NULL) { \
+            vm_save(); \
+            if (!dVM_lookup(D, (name), (cache), &(binding))) \
+                goto vm_fail; \
+        } \
+    } while (0)
+#define vm_check_pop(n) \
+    do { \
+        if (top - stack_base < (n)) \
+            vm_raise("stack underflow", NULL, 0); \
+    } while (0)
+#define vm_check_push(n) \
+    do { \
+        if (stack_limit - top < (n)) { \
+            vm_save(); \
+            if (!dS_ensure_stack(D, (n))) \
+                goto vm_fail; \
+            vm_load_stack(); \
+        } \
+    } while (0)
+/* the collector may only run where every live value is on a root */
+#define vm_check_gc() \
+    do { \
+        if (D->global->gc.debt >= 0) { \
+            vm_save(); \
+            dGC_step(D->global, DYSL_GC_STEP_BUDGET, 0); \
+        } \
+    } while (0)
+
+/* Fast paths of the arithmetic and comparison instructions: int×int and
+ * real×real operands are handled inline, mixed and object operands fall
+ * back to `dVM_arith` and `dVM_compare`, as do integer results that
+ * overflow. */
+#define vm_arith_case(name, overflow, operator) \
+    vm_case(name) { \
+        vm_check_pop(2); \
+        if (dV_is(top[-2], DYSL_TYPE_INTEGER) && \
+            dV_is(top[-1], DYSL_TYPE_INTEGER)) { \
+            dy_int r; \
+            if (!overflow(dV_integer(top[-2]), dV_integer(top[-1]), &r)) { \
+                top[-2] = dV_make_integer(r); \
+                top--; \
+                vm_break; \
+            } \
+        } else if (DYSL_REALS && dV_is(top[-2], DYSL_TYPE_REAL) && \
+                   dV_is(top[-1], DYSL_TYPE_REAL)) { \
+            top[-2] = dV_make_real(dV_real(top[-2]) operator dV_real(top[-1])); \
+            top--; \
+            vm_break; \
+        } \
+        goto vm_arith; \
+    }
+/* sets `holds` to `a operator b`, or goes to `slow` */
+#define vm_order(operator, slow) \
+    if (dV_is(top[-2], DYSL_TYPE_INTEGER) && \
+        dV_is(top[-1], DYSL_TYPE_INTEGER)) \
+        holds = dV_integer(top[-2]) operator dV_integer(top[-1]); \
+    else if (DYSL_REALS && dV_is(top[-2], DYSL_TYPE_REAL) && \
+             dV_is(top[-1], DYSL_TYPE_REAL)) \
+        holds = dV_real(top[-2]) operator dV_real(top[-1]); \
+    else \
+        goto slow;
+#define vm_compare_case(name, operator) \
+    vm_case(name) { \
+        vm_check_pop(2); \
+        vm_order(operator, vm_compare); \
+        top[-2] = dV_make_boolean(holds); \
+        top--; \
+        vm_break; \
+    }
+#define vm_branch_case(name, operator) \
+    vm_case(name) { \
+        vm_check_pop(2); \
+        vm_order(operator, vm_branch); \
+        top -= 2; \
+        if (!holds) \
+            ip += dI_arg(i); \
+        vm_break; \
+    }
+
+/** Converts an array index from 1 to one from 0, returns 0 if `key` is not
+ * an integer. Out of range indices wrap to huge ones. */
+static inline int dVM_array_index(struct dy_value key, uint32_t* index) {
+    if (!dTable_key(&key) || !dV_is(key, DYSL_TYPE_INTEGER))
+        return 0;
+    *index = (uint32_t)dV_integer(key) - 1;
+    return 1;
+}
+
+/** Reads `container[key]`, for arrays and tables. */
+static int dVM_get_index(
+    struct dysl* D,
+    struct dy_value container,
+    struct dy_value key,
+    struct dy_value* result
+) {
+#if DYSL_TABLES
+    if (dV_is(container, DYSL_TYPE_TABLE)) {
+        *result = dTable_get(D->global, dV_table(container), key);
+        return DYSL_OK;
+    }
+#endif /* DYSL_TABLES */
+    if (!dV_is(container, DYSL_TYPE_ARRAY))
+        return dVM_error(D, "expected an array or table for", ".get", 4);
+    struct dy_array* array = dV_array(container);
+    uint32_t index;
+    if (!dVM_array_index(key, &index))
+        return dVM_error(D, "expected an integer index for", ".get", 4);
+    *result = index < array->count ? array->values[index] : dV_nil();
+    return DYSL_OK;
+}
+
+/** Stores `container[key] = value`, for arrays and tables. */
+static int dVM_set_index(
+    struct dysl* D,
+    struct dy_value container,
+    struct dy_value key,
+    struct dy_value value
+) {
+    struct dy_gc* gc = dS_gc(D);
+#if DYSL_TABLES
+    if (dV_is(container, DYSL_TYPE_TABLE)) {
+        int status = dTable_set(D->global, dV_table(container), key, value);
+        if (status == DYSL_ERROR_MEMORY)
+            return dVM_memory_error(D);
+        if (status != DYSL_OK)
+            return dVM_error(D, "invalid table key for", ".set", 4);
+        return DYSL_OK;
+    }
+#endif /* DYSL_TABLES */
+    if (!dV_is(container, DYSL_TYPE_ARRAY))
+        return dVM_error(D, "expected an array or table for", ".set", 4);
+    struct dy_array* array = dV_array(container);
+    uint32_t index;
+    if (!dVM_array_index(key, &index))
+        return dVM_error(D, "expected an integer index for", ".set", 4);
+    if (index < array->count) {
+        array->values[index] = value;
+        dGC_barrier_value(gc, &array->header, value);
+        return DYSL_OK;
+    }
+    if (index != array->count)
+        return dVM_error(D, "array index out of range for", ".set", 4);
+    return dArray_push(gc, array, value) ? DYSL_OK : dVM_memory_error(D);
+}
+
+/** Appends `value` to an array, to a table's array part, or its text to a
+ * builder. */
+static int dVM_append(
+    struct dysl* D,
+    struct dy_value container,
+    struct dy_value value
+) {
+    if (dV_is(container, DYSL_TYPE_BUILDER)) {
+        char buf[DYSL_FORMAT_BUFFER_SIZE];
+        size_t length;
+        const char* text = dV_format(value, buf, &length);
+        if (!dBuilder_append(dS_gc(D), dV_builder(container), text, length))
+            return dVM_memory_error(D);
+        return DYSL_OK;
+    }
+#if DYSL_TABLES
+    if (dV_is(container, DYSL_TYPE_TABLE)) {
+        struct dy_table* table = dV_table(container);
+        if (table->array_count >= INT32_MAX)
+            return dVM_memory_error(D);
+        struct dy_value key = dV_make_integer((dy_int)table->array_count + 1);
+        return dVM_set_index(D, container, key, value);
+    }
+#endif /* DYSL_TABLES */
+    if (!dV_is(container, DYSL_TYPE_ARRAY))
+        return dVM_error(D, "expected an array, table or builder for",
+                         ".push", 5);
+    if (!dArray_push(dS_gc(D), dV_array(container), value))
+        return dVM_memory_error(D);
+    return DYSL_OK;
+}
+
+/** Returns the length of a string, array, table or builder, or -1. */
+static inline int64_t dVM_length(struct dy_value value) {
+    switch (dV_type(value)) {
+    case DYSL_TYPE_STRING:
+        return (int64_t)dV_string(value)->length;
+    case DYSL_TYPE_ARRAY:
+        return dV_array(value)->count;
+#if DYSL_TABLES
+    case DYSL_TYPE_TABLE:
+        return dV_table(value)->array_count;
+#endif /* DYSL_TABLES */
+    case DYSL_TYPE_BUILDER:
+        return (int64_t)dV_builder(value)->length;
+    default:
+        return -1;
+    }
+}
+
+/** Runs frames until the one at `base` returns. */
+static int dVM_execute(struct dysl* D, size_t base) {
+#if DYSL_COMPUTED_GOTO
+    static const void* const dispatch_table[DYSL_OP_COUNT] = {
+#define DYSL_OPCODE_LABEL(name) __extension__ &&op_##name,
+        DYSL_OPCODES(DYSL_OPCODE_LABEL)
+#undef DYSL_OPCODE_LABEL
+    };
+#endif /* DYSL_COMPUTED_GOTO */
+    struct dysl_allocator* allocator = dS_allocator(D);
+    struct dy_value* stack_base;
+    struct dy_value* stack_limit;
     struct dy_value* top;
-    size_t size;
+    struct dy_frame* frame;
+    const dy_instr* ip;
+    const struct dy_value* K;
+    struct dy_env_cache* C;
+    struct dy_value* slots;
+    struct dy_proc* callee;
+    struct dy_proc* block;
+    dy_instr i;
+    int holds;
+#if DYSL_PROFILE_PAIRS
+    uint64_t* pair_counts = D->global->pair_counts;
+    enum dy_opcode previous_op = DYSL_OP_NOP;
+#endif /* DYSL_PROFILE_PAIRS */
+    vm_load_stack();
+    vm_load();
+    for (;;) {
+        vm_fetch();
+        vm_dispatch(dI_op(i)) {
+        vm_case(NOP) {
+            vm_break;
+        }
+        vm_case(RETURN) {
+#if DYSL_PROFILE
+            if (D->profile_depth > frame->profile_depth)
+                dProfile_leave(D);
+#endif /* DYSL_PROFILE */
+            D->env.count = frame->env_base;
+            D->slot_count = frame->slot_base;
+            D->frame_count--;
+            if (D->frame_count == base) {
+                D->stack.top = top;
+                return DYSL_OK;
+            }
+            vm_load();
+            vm_break;
+        }
+        vm_case(PUSH_NIL) {
+            vm_check_push(1);
+            *top++ = dV_nil();
+            vm_break;
+        }
+        vm_case(PUSH_TRUE) {
+            vm_check_push(1);
+            *top++ = dV_make_boolean(1);
+            vm_break;
+        }
+        vm_case(PUSH_FALSE) {
+            vm_check_push(1);
+            *top++ = dV_make_boolean(0);
+            vm_break;
+        }
+        vm_case(PUSH_INT) {
+            vm_check_push(1);
+            *top++ = dV_make_integer(dI_arg(i));
+            vm_break;
+        }
+        vm_case(PUSH_CONST) {
+            vm_check_push(1);
+            *top++ = K[dI_arg(i)];
+            vm_break;
+        }
+        vm_case(CALL_WORD)
+#if DYSL_SUPERINSTRUCTIONS && DYSL_PROCS
+        vm_case(CALL_VAR)
+#endif /* DYSL_SUPERINSTRUCTIONS && DYSL_PROCS */
+        {
+            struct dy_symbol* name = dV_symbol(K[dI_arg(i)]);
+            struct dy_binding* binding;
+            vm_find(binding, name, &C[dI_arg(i)]);
+            if (binding == NULL)
+                vm_raise_symbol("unbound word", name);
+#if DYSL_SUPERINSTRUCTIONS && DYSL_PROCS
+            if (!binding->is_word && dI_op(i) == DYSL_OP_CALL_VAR &&
+                dV_is(binding->value, DYSL_TYPE_PROCEDURE)) {
+                // run the CALL that follows right away
+                ip++;
+                callee = dV_proc(binding->value);
+                block = NULL;
+                goto vm_invoke;
+            }
+#endif /* DYSL_SUPERINSTRUCTIONS && DYSL_PROCS */
+            if (!binding->is_word) {
+                vm_check_push(1);
+                *top++ = binding->value;
+                vm_break;
+            }
+            callee = dV_proc(binding->value);
+            block = NULL;
+            goto vm_invoke;
+        }
+        vm_case(CALL_BLOCK) {
+            struct dy_symbol* name = dV_symbol(K[dI_arg(i)]);
+            struct dy_binding* binding;
+            vm_find(binding, name, &C[dI_arg(i)]);
+            block = dV_proc(K[*ip++]);
+            if (binding == NULL)
+                vm_raise_symbol("unbound word", name);
+            if (!binding->is_word)
+                vm_raise_symbol("cannot pass a block to variable", name);
+            callee = dV_proc(binding->value);
+            goto vm_invoke;
+        }
+#if DYSL_PROCS
+        vm_case(CALL_VBLOCK) {
+            struct dy_symbol* name = dV_symbol(K[dI_arg(i)]);
+            struct dy_binding* binding;
+            vm_find(binding, name, &C[dI_arg(i)]);
+            vm_check_pop(1);
+            if (!dV_is(top[-1], DYSL_TYPE_PROCEDURE))
+                vm_raise_symbol("expected a proc as the block of", name);
+            block = dV_proc(*--top);
+            if (binding == NULL)
+                vm_raise_symbol("unbound word", name);
+            if (!binding->is_word)
+                vm_raise_symbol("cannot pass a block to variable", name);
+            callee = dV_proc(binding->value);
+            goto vm_invoke;
+        }
+        vm_case(CALL) {
+            vm_check_pop(1);
+            if (!dV_is(top[-1], DYSL_TYPE_PROCEDURE))
+                vm_raise("expected a proc for", ".call", 5);
+            callee = dV_proc(*--top);
+            block = NULL;
+            goto vm_invoke;
+        }
+#endif /* DYSL_PROCS */
+        vm_case(GET) {
+            struct dy_symbol* name = dV_symbol(K[dI_arg(i)]);
+            struct dy_binding* binding;
+            vm_find(binding, name, &C[dI_arg(i)]);
+            if (binding == NULL)
+                vm_raise_symbol("unbound word", name);
+            vm_check_push(1);
+            *top++ = binding->value;
+            vm_break;
+        }
+        vm_case(LET) {
+            vm_check_pop(1);
+            top--;
+            if (!dEnv_push(&D->env, dV_symbol(K[dI_arg(i)]), *top, 0,
+                           allocator))
+                vm_raise_memory();
+            vm_break;
+        }
+        vm_case(SET) {
+            struct dy_symbol* name = dV_symbol(K[dI_arg(i)]);
+            struct dy_binding* binding;
+            vm_find(binding, name, &C[dI_arg(i)]);
+            if (binding == NULL)
+                vm_raise_symbol("unbound variable", name);
+            if (binding->is_word)
+                vm_raise_symbol("cannot assign to word", name);
+            vm_check_pop(1);
+            binding->value = *--top;
+            vm_break;
+        }
+        vm_case(DEF) {
+            vm_check_pop(1);
+            top--;
+            if (!dEnv_push(&D->env, dV_symbol(K[dI_arg(i)]), *top, 1,
+                           allocator))
+                vm_raise_memory();
+            vm_break;
+        }
+        vm_case(LET_LOCAL)
+        vm_case(DEF_LOCAL) {
+            vm_check_pop(1);
+            top--;
+            slots[*ip++] = dV_make_integer((dy_int)D->env.count);
+            if (!dEnv_push(&D->env, dV_symbol(K[dI_arg(i)]), *top,
+                           dI_op(i) == DYSL_OP_DEF_LOCAL, allocator))
+                vm_raise_memory();
+            vm_break;
+        }
+        vm_case(GET_LOCAL) {
+            vm_check_push(1);
+            *top++ = D->env.bindings[dV_integer(slots[dI_arg(i)])].value;
+            vm_break;
+        }
+        vm_case(SET_LOCAL) {
+            vm_check_pop(1);
+            D->env.bindings[dV_integer(slots[dI_arg(i)])].value = *--top;
+            vm_break;
+        }
+        vm_case(CALL_LOCAL) {
+            struct dy_binding* binding =
+                &D->env.bindings[dV_integer(slots[dI_arg(i)])];
+            callee = dV_proc(binding->value);
+            block = NULL;
+            goto vm_invoke;
+        }
+        vm_case(IMPORT) {
+            struct dy_symbol* name = dV_symbol(K[dI_arg(i)]);
+            struct dy_module* module = dGlobal_find_module(D->global, name);
+            if (module == NULL)
+                vm_raise_symbol("unknown module", name);
+            // words resolve through the marker when looked up
+            for (size_t e = 0; e < module->count; e++) {
+                if (module->entries[e].binding.name != NULL)
+                    dSymbol_bump(module->entries[e].binding.name);
+            }
+            if (!dEnv_push(&D->env, module->marker, dV_nil(), 0, allocator))
+                vm_raise_memory();
+            vm_break;
+        }
+        vm_case(YIELD) {
+            if (frame->block == NULL)
+                vm_raise("no block given to", "yield", 5);
+            callee = frame->block;
+            block = NULL;
+            goto vm_invoke;
+        }
+        vm_case(BLOCK_GIVEN) {
+            vm_check_push(1);
+            *top++ = dV_make_boolean(frame->block != NULL);
+            vm_break;
+        }
+        vm_case(JUMP) {
+            ip += dI_arg(i);
+            vm_break;
+        }
+        vm_case(JUMP_IF_FALSE) {
+            vm_check_pop(1);
+            top--;
+            if (dV_is_falsy(*top))
+                ip += dI_arg(i);
+            vm_break;
+        }
+        vm_case(ENV_SAVE) {
+            slots[dI_arg(i)] = dV_make_integer((dy_int)D->env.count);
+            vm_break;
+        }
+        vm_case(ENV_RESTORE) {
+            D->env.count = (size_t)dV_integer(slots[dI_arg(i)]);
+            vm_break;
+        }
+        vm_case(ENV_KEEP) {
+            frame->env_base = D->env.count;
+            vm_break;
+        }
+        vm_case(TIMES_INIT) {
+            vm_check_pop(1);
+            if (!dV_is(top[-1], DYSL_TYPE_INTEGER))
+                vm_raise("expected an integer count for", "times", 5);
+            slots[dI_arg(i)] = *--top;
+            vm_break;
+        }
+        vm_case(TIMES_STEP) {
+            struct dy_value* count = &slots[dI_arg(i)];
+            int32_t exit = (int32_t)*ip++;
+            if (dV_integer(*count) <= 0)
+                ip += exit;
+            else
+                *count = dV_make_integer(dV_integer(*count) - 1);
+            vm_break;
+        }
+        vm_case(FOR_INIT)
+        vm_case(FOR_INIT_STEP) {
+            struct dy_value* loop = &slots[dI_arg(i)];
+            int stepped = dI_op(i) == DYSL_OP_FOR_INIT_STEP;
+            vm_check_pop(2 + stepped);
+            loop[2] = stepped ? *--top : dV_make_integer(1);
+            loop[1] = *--top;
+            loop[0] = *--top;
+            if (!dV_is_number(loop[0]) || !dV_is_number(loop[1]) ||
+                !dV_is_number(loop[2]))
+                vm_raise("expected numbers for", stepped ? "for+" : "for",
+                         stepped ? 4 : 3);
+#if DYSL_REALS
+            if (!dV_is(loop[0], DYSL_TYPE_INTEGER) ||
+                !dV_is(loop[1], DYSL_TYPE_INTEGER) ||
+                !dV_is(loop[2], DYSL_TYPE_INTEGER)) {
+                // counting in reals
+                for (int n = 0; n < 3; n++)
+                    loop[n] = dV_make_real(dV_to_real(loop[n]));
+            }
+#endif /* DYSL_REALS */
+            if (dV_to_real(loop[2]) == 0)
+                vm_raise("zero step for", "for+", 4);
+            vm_break;
+        }
+        vm_case(FOR_STEP) {
+            // slots: index, end, step; a nil index marks exhaustion
+            struct dy_value* loop = &slots[dI_arg(i)];
+            int32_t exit = (int32_t)*ip++;
+            if (dV_is(loop[0], DYSL_TYPE_INTEGER)) {
+                dy_int index = dV_integer(loop[0]);
+                dy_int end = dV_integer(loop[1]);
+                dy_int step = dV_integer(loop[2]);
+                if (step > 0 ? index > end : index < end) {
+                    ip += exit;
+                    vm_break;
+                }
+                int64_t next = (int64_t)index + step;
+                if (next > INT32_MAX || next < INT32_MIN)
+                    loop[0] = dV_nil();
+                else
+                    loop[0] = dV_make_integer((dy_int)next);
+                vm_check_push(1);
+                *top++ = dV_make_integer(index);
+#if DYSL_REALS
+            } else if (dV_is(loop[0], DYSL_TYPE_REAL)) {
+                dy_real index = dV_real(loop[0]);
+                dy_real end = dV_real(loop[1]);
+                dy_real step = dV_real(loop[2]);
+                if (step > 0 ? index > end : index < end) {
+                    ip += exit;
+                    vm_break;
+                }
+                loop[0] = dV_make_real(index + step);
+                vm_check_push(1);
+                *top++ = dV_make_real(index);
+#endif /* DYSL_REALS */
+            } else {
+                ip += exit;
+            }
+            vm_break;
+        }
+        vm_case(DUP) {
+            vm_check_pop(1);
+            vm_check_push(1);
+            top[0] = top[-1];
+            top++;
+            vm_break;
+        }
+        vm_case(DROP) {
+            vm_check_pop(1);
+            top--;
+            vm_break;
+        }
+        vm_case(SWAP) {
+            vm_check_pop(2);
+            struct dy_value t = top[-1];
+            top[-1] = top[-2];
+            top[-2] = t;
+            vm_break;
+        }
+        vm_case(OVER) {
+            vm_check_pop(2);
+            vm_check_push(1);
+            top[0] = top[-2];
+            top++;
+            vm_break;
+        }
+        vm_case(ROT) {
+            vm_check_pop(3);
+            struct dy_value t = top[-3];
+            top[-3] = top[-2];
+            top[-2] = top[-1];
+            top[-1] = t;
+            vm_break;
+        }
+        vm_case(NIP) {
+            vm_check_pop(2);
+            top[-2] = top[-1];
+            top--;
+            vm_break;
+        }
+        vm_arith_case(ADD, dU_add_overflow, +)
+        vm_arith_case(SUB, dU_sub_overflow, -)
+        vm_arith_case(MUL, dU_mul_overflow, *)
+        vm_arith_case(DIV, dU_div_overflow, /)
+        vm_case(MOD)
+        vm_arith: {
+            vm_check_pop(2);
+            vm_save();
+            if (dVM_arith(D, dI_op(i), &top[-2], &top[-1], &top[-2]) != DYSL_OK)
+                goto vm_fail;
+            top--;
+            vm_check_gc();
+            vm_break;
+        }
+        vm_case(EQ) {
+            vm_check_pop(2);
+            top[-2] = dV_make_boolean(dV_equals(top[-2], top[-1]));
+            top--;
+            vm_break;
+        }
+        vm_case(NE) {
+            vm_check_pop(2);
+            top[-2] = dV_make_boolean(!dV_equals(top[-2], top[-1]));
+            top--;
+            vm_break;
+        }
+        vm_compare_case(LT, <)
+        vm_compare_case(GT, >)
+        vm_compare_case(LE, <=)
+        vm_compare_case(GE, >=)
+        vm_compare: {
+            vm_save();
+            if (dVM_compare(D, dI_op(i), &top[-2], &top[-1], &top[-2])
+                != DYSL_OK)
+                goto vm_fail;
+            top--;
+            vm_break;
+        }
+        vm_case(NOT) {
+            vm_check_pop(1);
+            top[-1] = dV_make_boolean(dV_is_falsy(top[-1]));
+            vm_break;
+        }
+        vm_case(AND) {
+            vm_check_pop(2);
+            top[-2] = dV_make_boolean(!dV_is_falsy(top[-2]) &&
+                                      !dV_is_falsy(top[-1]));
+            top--;
+            vm_break;
+        }
+        vm_case(OR) {
+            vm_check_pop(2);
+            top[-2] = dV_make_boolean(!dV_is_falsy(top[-2]) ||
+                                      !dV_is_falsy(top[-1]));
+            top--;
+            vm_break;
+        }
+#if DYSL_SUPERINSTRUCTIONS
+        vm_case(JUMP_IF_NOT_EQ)
+        vm_case(JUMP_IF_NOT_NE) {
+            vm_check_pop(2);
+            int equal = dV_equals(top[-2], top[-1]);
+            top -= 2;
+            if (equal != (dI_op(i) == DYSL_OP_JUMP_IF_NOT_EQ))
+                ip += dI_arg(i);
+            vm_break;
+        }
+        vm_branch_case(JUMP_IF_NOT_LT, <)
+        vm_branch_case(JUMP_IF_NOT_GT, >)
+        vm_branch_case(JUMP_IF_NOT_LE, <=)
+        vm_branch_case(JUMP_IF_NOT_GE, >=)
+        vm_branch: {
+            struct dy_value result;
+            vm_save();
+            if (dVM_compare(D, dI_branch_compare(dI_op(i)), &top[-2], &top[-1],
+                            &result) != DYSL_OK)
+                goto vm_fail;
+            top -= 2;
+            if (dV_is_falsy(result))
+                ip += dI_arg(i);
+            vm_break;
+        }
+        vm_case(ADD_INT)
+        vm_case(SUB_INT) {
+            struct dy_value operand = dV_make_integer(dI_arg(i));
+            vm_check_pop(1);
+            if (dV_is(top[-1], DYSL_TYPE_INTEGER)) {
+                dy_int r;
+                int overflow = dI_op(i) == DYSL_OP_ADD_INT
+                    ? dU_add_overflow(dV_integer(top[-1]), dI_arg(i), &r)
+                    : dU_sub_overflow(dV_integer(top[-1]), dI_arg(i), &r);
+                if (!overflow) {
+                    top[-1] = dV_make_integer(r);
+                    vm_break;
+                }
+            }
+            vm_save();
+            if (dVM_arith(D, dI_op(i) == DYSL_OP_ADD_INT ? DYSL_OP_ADD : DYSL_OP_SUB,
+                          &top[-1], &operand, &top[-1]) != DYSL_OK)
+                goto vm_fail;
+            vm_break;
+        }
+#endif /* DYSL_SUPERINSTRUCTIONS */
+        vm_case(STACK_MARK) {
+            slots[dI_arg(i)] = dV_make_integer((dy_int)(top - stack_base));
+            vm_break;
+        }
+        vm_case(ARRAY_NEW) {
+            vm_check_push(1);
+            struct dy_value* mark =
+                stack_base + dV_integer(slots[dI_arg(i)]);
+            if (top < mark)
+                vm_raise("stack underflow", NULL, 0);
+            uint32_t count = (uint32_t)(top - mark);
+            vm_save();
+            struct dy_array* array = dArray_create(dS_gc(D), count);
+            if (array == NULL)
+                vm_raise_memory();
+            if (count > 0)
+                dMem_copy(array->values, mark,
+                          sizeof(struct dy_value) * count);
+            array->count = count;
+            top = mark;
+            *top++ = dV_make_object(&array->header);
+            vm_check_gc();
+            vm_break;
+        }
+#if DYSL_TABLES
+        vm_case(TABLE_NEW) {
+            vm_check_push(1);
+            struct dy_value* mark =
+                stack_base + dV_integer(slots[dI_arg(i)]);
+            if (top < mark)
+                vm_raise("stack underflow", NULL, 0);
+            if ((top - mark) % 2 != 0)
+                vm_raise("expected key value pairs for", "table", 5);
+            vm_save();
+            struct dy_table* table = dTable_create(
+                dS_gc(D),
+                (uint32_t)((top - mark) / 2)
+            );
+            if (table == NULL)
+                vm_raise_memory();
+            for (struct dy_value* pair = mark; pair < top; pair += 2) {
+                int status = dTable_set(D->global, table, pair[0], pair[1]);
+                if (status == DYSL_ERROR_MEMORY)
+                    vm_raise_memory();
+                if (status != DYSL_OK)
+                    vm_raise("invalid key in", "table", 5);
+            }
+            top = mark;
+            *top++ = dV_make_object(&table->header);
+            vm_check_gc();
+            vm_break;
+        }
+#endif /* DYSL_TABLES */
+        vm_case(GET_INDEX) {
+            vm_check_pop(2);
+            vm_save();
+            if (dVM_get_index(D, top[-2], top[-1], &top[-2]) != DYSL_OK)
+                goto vm_fail;
+            top--;
+            vm_break;
+        }
+        vm_case(SET_INDEX) {
+            vm_check_pop(3);
+            vm_save();
+            if (dVM_set_index(D, top[-3], top[-2], top[-1]) != DYSL_OK)
+                goto vm_fail;
+            top -= 3;
+            vm_check_gc();
+            vm_break;
+        }
+        vm_case(APPEND) {
+            vm_check_pop(2);
+            vm_save();
+            if (dVM_append(D, top[-2], top[-1]) != DYSL_OK)
+                goto vm_fail;
+            top -= 2;
+            vm_check_gc();
+            vm_break;
+        }
+        vm_case(LENGTH) {
+            vm_check_pop(1);
+            int64_t length = dVM_length(top[-1]);
+            if (length < 0)
+                vm_raise("expected a string or collection for", ".len", 4);
+            top[-1] = dV_make_integer((dy_int)length);
+            vm_break;
+        }
+#if !DYSL_COMPUTED_GOTO
+        default:
+            vm_raise("invalid instruction", NULL, 0);
+#endif /* !DYSL_COMPUTED_GOTO */
+        vm_invoke:
+            vm_save();
+            if (callee->native != NULL) {
+                dVM_call_native(D, callee);
+                // natives may grow the stack, moving it
+                vm_load_stack();
+                if (D->status != DYSL_OK)
+                    goto vm_fail;
+                vm_check_gc();
+                vm_break;
+            }
+            if (dVM_push_frame(D, callee, block) != DYSL_OK)
+                goto vm_fail;
+            vm_load();
+            vm_break;
+        }
+    }
+vm_fail:
+    return D->status;
+}
+#undef vm_dispatch
+#undef vm_case
+#undef vm_break
+#undef vm_fetch
+#undef vm_load
+#undef vm_save
+#undef vm_load_stack
+#undef vm_raise
+#undef vm_raise_symbol
+#undef vm_raise_memory
+#undef vm_check_pop
+#undef vm_check_push
+#undef vm_check_gc
+
+int dVM_call(struct dysl* D, struct dy_proc* proc, struct dy_proc* block) {
+    if (proc->native != NULL) {
+        dVM_call_native(D, proc);
+        return D->status;
+    }
+    size_t base = D->frame_count;
+    size_t env_base = D->env.count;
+    size_t slot_base = D->slot_count;
+#if DYSL_PROFILE
+    size_t profile_base = D->profile_depth;
+#endif /* DYSL_PROFILE */
+    int status = dVM_push_frame(D, proc, block);
+    if (status == DYSL_OK) {
+        D->vm_depth++;
+        status = dVM_execute(D, base);
+        D->vm_depth--;
+    }
+    if (status == DYSL_YIELD) {
+        // the frames stay, for dysl_resume
+        D->suspended = 1;
+        D->resume_base = base;
+    } else if (status != DYSL_OK) {
+        // unwind whatever the error interrupted
+        D->frame_count = base;
+        D->env.count = env_base;
+        D->slot_count = slot_base;
+#if DYSL_PROFILE
+        D->profile_depth = dU_min(D->profile_depth, profile_base);
+#endif /* DYSL_PROFILE */
+    }
+    return status;
+}
+#pragma endregion /* Virtual machine API implementation */
+
+#pragma region Public dysl API implementation
+/** Creates a context, in arena mode if `arena_chunk_size` is not zero. */
+static struct dysl* dS_new(
+    struct dysl_allocator allocator,
+    size_t arena_chunk_size
+) {
+    struct dysl* D = (struct dysl*)dAlloc_alloc(&allocator, sizeof(*D));
+    if (D == NULL)
+        return NULL;
+    D->global = (struct dy_global*)dAlloc_alloc(&allocator, sizeof(*D->global));
+    if (D->global == NULL) {
+        dAlloc_free(&allocator, D, sizeof(*D));
+        return NULL;
+    }
+    dGlobal_init(D->global, allocator);
+    // the state and context came from the host's allocator too
+    D->global->memory.bytes += sizeof(*D) + sizeof(*D->global);
+    D->global->memory.peak = D->global->memory.bytes;
+    if (arena_chunk_size != 0)
+        dGC_use_arena(&D->global->gc, arena_chunk_size);
+    if (!dS_init(D, D->global, DYSL_STACK_SIZE)) {
+        dS_destroy(D);
+        dGlobal_destroy(D->global);
+        dAlloc_free(&allocator, D->global, sizeof(*D->global));
+        dAlloc_free(&allocator, D, sizeof(*D));
+        return NULL;
+    }
+    D->global->main_state = D;
+    return D;
+}
+
+struct dysl* dysl_new(struct dysl_allocator allocator) {
+    return dS_new(allocator, 0);
+}
+
+struct dysl* dysl_new_arena(struct dysl_allocator allocator, size_t chunk_size) {
+    if (chunk_size == 0)
+        chunk_size = DYSL_ARENA_CHUNK_SIZE;
+    // leave room for the chunk header and a few objects
+    return dS_new(allocator, dU_max(chunk_size, (size_t)1024));
+}
+
+void dysl_destroy(struct dysl* state) {
+    struct dy_global* global = state->global;
+    struct dysl_allocator allocator = global->memory.allocator;
+    if (state != global->main_state) {
+        // a thread, the context lives on
+        if (state->prev_thread != NULL)
+            state->prev_thread->next_thread = state->next_thread;
+        else
+            global->threads = state->next_thread;
+        if (state->next_thread != NULL)
+            state->next_thread->prev_thread = state->prev_thread;
+        dS_destroy(state);
+        dAlloc_free(dGC_allocator(&global->gc), state, sizeof(*state));
+        return;
+    }
+    while (global->threads != NULL) {
+        struct dysl* thread = global->threads;
+        global->threads = thread->next_thread;
+        dS_destroy(thread);
+        dAlloc_free(dGC_allocator(&global->gc), thread, sizeof(*thread));
+    }
+    dS_destroy(state);
+    dGlobal_destroy(global);
+    dAlloc_free(&allocator, global, sizeof(*global));
+    dAlloc_free(&allocator, state, sizeof(*state));
+}
+
+#if DYSL_SHARED_SYMBOLS
+struct dysl_symbol_table* dysl_new_symbol_table(
+    struct dysl_allocator allocator,
+    size_t capacity
+) {
+    struct dysl_symbol_table* table = (struct dysl_symbol_table*)dAlloc_alloc(
+        &allocator, sizeof(*table)
+    );
+    if (table == NULL)
+        return NULL;
+    if (capacity == 0)
+        capacity = DYSL_SHARED_SYMBOLS_CAPACITY;
+    table->allocator = allocator;
+    // the same load factor as the contexts' tables
+    table->capacity = DYSL_SYMBOLS_INITIAL_CAPACITY;
+    while (table->capacity * DYSL_SYMBOLS_LOAD_FACTOR < capacity)
+        table->capacity *= 2;
+    table->limit = capacity;
+    table->count = 0;
+    table->hash_seed = dHash_seed(dHash_mix(
+        dHash_entropy() ^ (uint64_t)(uintptr_t)table,
+        (uint64_t)(uintptr_t)&allocator ^ DYSL_WYHASH_P2
+    ));
+    table->entries = (struct dy_symbol**)dAlloc_alloc(
+        &allocator, sizeof(struct dy_symbol*) * table->capacity
+    );
+    if (table->entries == NULL) {
+        dAlloc_free(&allocator, table, sizeof(*table));
+        return NULL;
+    }
+    dMem_clear(table->entries, sizeof(struct dy_symbol*) * table->capacity);
+    return table;
+}
+
+struct dysl* dysl_new_with_symbols(
+    struct dysl_allocator allocator,
+    struct dysl_symbol_table* symbols
+) {
+    struct dysl* D = dS_new(allocator, 0);
+    if (D == NULL)
+        return NULL;
+    // the shared hashes were made with the table's seed
+    D->global->hash_seed = symbols->hash_seed;
+    D->global->shared_symbols = symbols;
+    return D;
+}
+
+void dysl_symbol_table_destroy(struct dysl_symbol_table* symbols) {
+    struct dysl_allocator allocator = symbols->allocator;
+    for (size_t e = 0; e < symbols->capacity; e++) {
+        if (symbols->entries[e] != NULL)
+            dAlloc_free(&allocator, symbols->entries[e],
+                        sizeof(struct dy_symbol) +
+                        symbols->entries[e]->length);
+    }
+    dAlloc_free(&allocator, symbols->entries,
+                sizeof(struct dy_symbol*) * symbols->capacity);
+    dAlloc_free(&allocator, symbols, sizeof(*symbols));
+}
+#endif /* DYSL_SHARED_SYMBOLS */
+
+struct dysl* dysl_new_thread(struct dysl* dysl) {
+    struct dy_global* global = dysl->global;
+    struct dysl* D = (struct dysl*)dAlloc_alloc(dS_allocator(dysl), sizeof(*D));
+    if (D == NULL)
+        return NULL;
+    if (!dS_init(D, global, DYSL_THREAD_STACK_SIZE)) {
+        dS_destroy(D);
+        dAlloc_free(dS_allocator(dysl), D, sizeof(*D));
+        return NULL;
+    }
+    D->next_thread = global->threads;
+    if (global->threads != NULL)
+        global->threads->prev_thread = D;
+    global->threads = D;
+    return D;
+}
+
+int dysl_yield(struct dysl* dysl) {
+    // only the outermost dVM_execute can leave its frames to be resumed
+    if (dysl->vm_depth != 1)
+        return dS_error(dysl, DYSL_ERROR_RUNTIME, dS_line(dysl),
+                        "cannot yield from here", NULL, 0);
+    dysl->status = DYSL_YIELD;
+    return DYSL_YIELD;
+}
+
+int dysl_resume(struct dysl* dysl) {
+    if (!dysl->suspended)
+        return dS_error(dysl, DYSL_ERROR_RUNTIME, 0,
+                        "cannot resume a state that did not yield", NULL, 0);
+    size_t base = dysl->resume_base;
+    size_t env_base = dysl->frames[base].env_base;
+    size_t slot_base = dysl->frames[base].slot_base;
+    dysl->suspended = 0;
+    dysl->status = DYSL_OK;
+    dysl->error[0] = '\0';
+    dysl->vm_depth++;
+    int status = dVM_execute(dysl, base);
+    dysl->vm_depth--;
+    if (status == DYSL_YIELD) {
+        dysl->suspended = 1;
+    } else if (status != DYSL_OK) {
+#if DYSL_PROFILE
+        dysl->profile_depth = dU_min(dysl->profile_depth,
+                                     dysl->frames[base].profile_depth);
+#endif /* DYSL_PROFILE */
+        dysl->frame_count = base;
+        dysl->env.count = env_base;
+        dysl->slot_count = slot_base;
+    }
+    return status;
+}
+
+int dysl_is_suspended(struct dysl* dysl) {
+    return dysl->suspended;
+}
+
+/** A snapshot is a context nothing runs in, contexts are cloned from it. */
+struct dysl_snapshot {
+    struct dysl* state;
 };
-#pragma endregion /* Value Stack API */
 
-#pragma region Interpreter state API
-struct dysl {
-    struct dy_global* global;
+/** A source object and its copy. */
+struct dy_clone_entry {
+    const struct dy_object* from;
+    struct dy_object* to;
 };
-#define dS_gc(state) dGlobal_gc((state)->global)
-#pragma endregion /* Interpreter state API */
 
-#pragma region Allocator API
-static inline void* dAlloc_alloc(struct dysl_allocator* allocator, size_t size);
-static inline void* dAlloc_free(struct dysl_allocator* allocator, void* ptr);
-static inline void* dAlloc_realloc(
-    struct dysl_allocator* allocator,
-    void* ptr,
-    size_t old_size,
-    size_t new_size
-);
-#pragma endregion /* Allocator API */
+/** Copies objects from one context into another. Objects are copied once,
+ * so sharing and cycles survive the copy. */
+struct dy_cloner {
+    struct dysl* D;                  /*< The context being filled. */
+    struct dy_clone_entry* entries;  /*< Copies by source address. */
+    size_t count, capacity;
+    int failed;
+};
+
+static size_t dClone_slot(const struct dy_cloner* c, const void* from) {
+    uint64_t h = (uint64_t)(uintptr_t)from * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 32) & (c->capacity - 1);
+}
+
+/** Returns the copy of `from`, or NULL if it has not been copied yet. */
+static struct dy_object* dClone_find(
+    const struct dy_cloner* c,
+    const struct dy_object* from
+) {
+    if (c->capacity == 0)
+        return NULL;
+    size_t index = dClone_slot(c, from);
+    while (c->entries[index].from != NULL) {
+        if (c->entries[index].from == from)
+            return c->entries[index].to;
+        index = (index + 1) & (c->capacity - 1);
+    }
+    return NULL;
+}
+
+/** Remembers the copy of `from`, returns 0 if allocation fails. */
+static int dClone_remember(
+    struct dy_cloner* c,
+    const struct dy_object* from,
+    struct dy_object* to
+) {
+    struct dysl_allocator* allocator = dS_allocator(c->D);
+    if ((c->count + 1) * 4 > c->capacity * 3) {
+        size_t new_capacity = c->capacity == 0 ? 64 : c->capacity * 2;
+        struct dy_clone_entry* entries = (struct dy_clone_entry*)dAlloc_alloc(
+            allocator,
+            sizeof(struct dy_clone_entry) * new_capacity
+        );
+        if (entries == NULL)
+            return 0;
+        dMem_clear(entries, sizeof(struct dy_clone_entry) * new_capacity);
+        struct dy_clone_entry* old = c->entries;
+        size_t old_capacity = c->capacity;
+        c->entries = entries;
+        c->capacity = new_capacity;
+        for (size_t e = 0; e < old_capacity; e++) {
+            if (old[e].from == NULL)
+                continue;
+            size_t index = dClone_slot(c, old[e].from);
+            while (entries[index].from != NULL)
+                index = (index + 1) & (new_capacity - 1);
+            entries[index] = old[e];
+        }
+        if (old != NULL)
+            dAlloc_free(allocator, old,
+                        sizeof(struct dy_clone_entry) * old_capacity);
+    }
+    size_t index = dClone_slot(c, from);
+    while (c->entries[index].from != NULL)
+        index = (index + 1) & (c->capacity - 1);
+    c->entries[index].from = from;
+    c->entries[index].to = to;
+    c->count++;
+    return 1;
+}
+
+static struct dy_value dClone_value(struct dy_cloner* c, struct dy_value from);
+
+/** Returns the copy of a symbol. Both contexts share a seed, so its hash is
+ * reused. */
+static struct dy_symbol* dClone_symbol(
+    struct dy_cloner* c,
+    const struct dy_symbol* from
+) {
+    struct dy_symbol* sym = dGlobal_intern_hashed(
+        c->D->global, from->name, from->length, from->hash
+    );
+    if (sym == NULL)
+        c->failed = 1;
+    return sym;
+}
+
+static struct dy_proc* dClone_proc(
+    struct dy_cloner* c,
+    const struct dy_proc* from
+) {
+    struct dy_gc* gc = dS_gc(c->D);
+    struct dysl_allocator* allocator = dS_allocator(c->D);
+    struct dy_symbol* name = from->name != NULL
+        ? dClone_symbol(c, from->name)
+        : NULL;
+    if (c->failed)
+        return NULL;
+    if (from->fast != NULL)
+        return dProc_create_fast(gc, name, from->fast, from->arity);
+    if (from->native != NULL)
+        return dProc_create_native(gc, name, from->native);
+    dy_instr* code = (dy_instr*)dAlloc_alloc(
+        allocator, sizeof(dy_instr) * from->code_size
+    );
+    int32_t* lines = from->lines != NULL
+        ? (int32_t*)dAlloc_alloc(allocator, sizeof(int32_t) * from->code_size)
+        : NULL;
+    struct dy_value* constants = from->constant_count > 0
+        ? (struct dy_value*)dAlloc_alloc(
+              allocator, sizeof(struct dy_value) * from->constant_count)
+        : NULL;
+    struct dy_proc* proc = NULL;
+    if (code != NULL && (lines != NULL || from->lines == NULL) &&
+        (constants != NULL || from->constant_count == 0)) {
+        dMem_copy(code, from->code, sizeof(dy_instr) * from->code_size);
+        if (lines != NULL)
+            dMem_copy(lines, from->lines, sizeof(int32_t) * from->code_size);
+        // constants never refer back to their procedure
+        for (uint32_t k = 0; k < from->constant_count && !c->failed; k++)
+            constants[k] = dClone_value(c, from->constants[k]);
+        if (!c->failed)
+            proc = dProc_create(gc, name, code, lines, from->code_size,
+                                constants, from->constant_count,
+                                from->slot_count);
+    }
+    if (proc == NULL) {
+        if (code != NULL)
+            dAlloc_free(allocator, code, sizeof(dy_instr) * from->code_size);
+        if (lines != NULL)
+            dAlloc_free(allocator, lines, sizeof(int32_t) * from->code_size);
+        if (constants != NULL)
+            dAlloc_free(allocator, constants,
+                        sizeof(struct dy_value) * from->constant_count);
+    }
+    return proc;
+}
+
+#if DYSL_TABLES
+/** Copies the contents of a table, which is already remembered. */
+static int dClone_table_contents(
+    struct dy_cloner* c,
+    struct dy_table* table,
+    const struct dy_table* from
+) {
+    struct dy_global* global = c->D->global;
+    for (uint32_t v = 0; v < from->array_count && !c->failed; v++) {
+        struct dy_value value = dClone_value(c, from->array[v]);
+        if (!c->failed &&
+            dTable_set(global, table, dV_make_integer((dy_int)v + 1),
+                       value) != DYSL_OK)
+            c->failed = 1;
+    }
+    for (uint32_t n = 0; n < from->node_capacity && !c->failed; n++) {
+        const struct dy_table_node* node = &from->nodes[n];
+        if (dV_is(node->key, DYSL_TYPE_NIL))
+            continue;
+        struct dy_value key = dClone_value(c, node->key);
+        struct dy_value value = dClone_value(c, node->value);
+        if (!c->failed && dTable_set(global, table, key, value) != DYSL_OK)
+            c->failed = 1;
+    }
+    return !c->failed;
+}
+#endif /* DYSL_TABLES */
+
+static struct dy_value dClone_value(struct dy_cloner* c, struct dy_value from) {
+    if (!dV_is_object(from) || c->failed)
+        return from;
+    struct dy_gc* gc = dS_gc(c->D);
+    const struct dy_object* obj = dV_object(from);
+    struct dy_object* to = NULL;
+    switch (dV_type(from)) {
+    case DYSL_TYPE_SYMBOL: {
+        struct dy_symbol* sym = dClone_symbol(c, dV_symbol(from));
+        return sym != NULL ? dV_make_object(&sym->header) : from;
+    }
+    case DYSL_TYPE_STRING: {
+        const struct dy_string* str = dV_string(from);
+        // short strings are interned, so only copied once anyway
+        if (!dString_is_short(str->length) &&
+            (to = dClone_find(c, obj)) != NULL)
+            return dV_make_object(to);
+        struct dy_string* copy = dGlobal_string(c->D->global,
+                                                dString_data(str),
+                                                str->length);
+        if (copy != NULL && !dString_is_short(str->length) &&
+            !dClone_remember(c, obj, &copy->header))
+            copy = NULL;
+        if (copy == NULL) {
+            c->failed = 1;
+            return from;
+        }
+        return dV_make_object(&copy->header);
+    }
+    default:
+        break;
+    }
+    if ((to = dClone_find(c, obj)) != NULL)
+        return dV_make_object(to);
+    switch (dV_type(from)) {
+    case DYSL_TYPE_PROCEDURE: {
+        struct dy_proc* proc = dClone_proc(c, dV_proc(from));
+        to = proc != NULL ? &proc->header : NULL;
+        if (to != NULL && !dClone_remember(c, obj, to))
+            to = NULL;
+        break;
+    }
+    case DYSL_TYPE_BUILDER: {
+        const struct dy_builder* builder = (const struct dy_builder*)obj;
+        struct dy_builder* copy = dBuilder_create(gc, builder->length);
+        if (copy != NULL &&
+            (!dBuilder_append(gc, copy, builder->data, builder->length) ||
+             !dClone_remember(c, obj, &copy->header)))
+            copy = NULL;
+        to = copy != NULL ? &copy->header : NULL;
+        break;
+    }
+    case DYSL_TYPE_ARRAY: {
+        // remembered before its values, which may contain it
+        const struct dy_array* array = (const struct dy_array*)obj;
+        struct dy_array* copy = dArray_create(gc, array->count);
+        if (copy != NULL && !dClone_remember(c, obj, &copy->header))
+            copy = NULL;
+        for (uint32_t v = 0; copy != NULL && v < array->count; v++) {
+            struct dy_value value = dClone_value(c, array->values[v]);
+            if (c->failed || !dArray_push(gc, copy, value))
+                copy = NULL;
+        }
+        to = copy != NULL ? &copy->header : NULL;
+        break;
+    }
+#if DYSL_TABLES
+    case DYSL_TYPE_TABLE: {
+        const struct dy_table* table = (const struct dy_table*)obj;
+        struct dy_table* copy = dTable_create(gc, table->node_count);
+        if (copy != NULL && (!dClone_remember(c, obj, &copy->header) ||
+                             !dClone_table_contents(c, copy, table)))
+            copy = NULL;
+        to = copy != NULL ? &copy->header : NULL;
+        break;
+    }
+#endif /* DYSL_TABLES */
+    default:
+        break;
+    }
+    if (to == NULL) {
+        c->failed = 1;
+        return from;
+    }
+    return dV_make_object(to);
+}
+
+/** Copies the modules, keeping their order. */
+static void dClone_modules(struct dy_cloner* c, const struct dy_global* from) {
+    struct dy_global* global = c->D->global;
+    struct dysl_allocator* allocator = dS_allocator(c->D);
+    struct dy_module** tail = &global->modules;
+    for (const struct dy_module* m = from->modules; m != NULL && !c->failed;
+         m = m->next) {
+        struct dy_module* module = (struct dy_module*)dAlloc_alloc(
+            allocator,
+            dModule_size(m->count)
+        );
+        if (module == NULL) {
+            c->failed = 1;
+            return;
+        }
+        module->next = NULL;
+        module->count = m->count;
+        module->entries = (struct dy_module_entry*)(module + 1);
+        module->name = dClone_symbol(c, m->name);
+        module->marker = dClone_symbol(c, m->marker);
+        for (size_t e = 0; e < m->count && !c->failed; e++) {
+            // the hashes stay valid, the seed is the same
+            struct dy_module_entry* entry = &module->entries[e];
+            *entry = m->entries[e];
+            entry->marker = module->marker;
+            if (entry->binding.name != NULL)
+                entry->binding.name = dClone_symbol(c, entry->binding.name);
+            entry->binding.value = dClone_value(c, entry->binding.value);
+        }
+        if (c->failed) {
+            dAlloc_free(allocator, module, dModule_size(module->count));
+            return;
+        }
+        *tail = module;
+        tail = &module->next;
+    }
+}
+
+/** Creates a context holding a copy of `from`'s symbols, modules,
+ * environment and stack. */
+static struct dysl* dS_clone(
+    const struct dysl* from,
+    struct dysl_allocator allocator
+) {
+    struct dysl* D = dS_new(allocator, 0);
+    if (D == NULL)
+        return NULL;
+    struct dy_global* global = D->global;
+    const struct dy_global* source = from->global;
+    // nothing is interned yet, so the seed can still change
+    global->hash_seed = source->hash_seed;
+#if DYSL_SHARED_SYMBOLS
+    global->shared_symbols = source->shared_symbols;
+#endif /* DYSL_SHARED_SYMBOLS */
+    struct dy_cloner c;
+    c.D = D;
+    c.entries = NULL;
+    c.count = c.capacity = 0;
+    c.failed = 0;
+    // every symbol in one batch, with their hashes
+    if (dSymbols_should_grow(&global->symbols, source->symbols.count))
+        dSymbols_ensure_capacity(&global->symbols, source->symbols.count,
+                                 dS_allocator(D));
+    for (size_t s = 0; s < source->symbols.capacity && !c.failed; s++) {
+        const struct dy_object* obj = source->symbols.entries[s].object;
+        if (obj != NULL)
+            dClone_symbol(&c, (const struct dy_symbol*)obj);
+    }
+    dClone_modules(&c, source);
+    for (size_t b = 0; b < from->env.count && !c.failed; b++) {
+        const struct dy_binding* binding = &from->env.bindings[b];
+        struct dy_symbol* name = dClone_symbol(&c, binding->name);
+        struct dy_value value = dClone_value(&c, binding->value);
+        if (!c.failed && !dEnv_push(&D->env, name, value, binding->is_word,
+                                    dS_allocator(D)))
+            c.failed = 1;
+    }
+    for (const struct dy_value* v = from->stack.base;
+         v < from->stack.top && !c.failed; v++) {
+        struct dy_value value = dClone_value(&c, *v);
+        if (!c.failed && dStack_room(&D->stack) == 0 &&
+            dStack_grow(&D->stack, 1, dS_allocator(D)) != DYSL_OK)
+            c.failed = 1;
+        if (!c.failed)
+            *D->stack.top++ = value;
+    }
+    if (c.entries != NULL)
+        dAlloc_free(dS_allocator(D), c.entries,
+                    sizeof(struct dy_clone_entry) * c.capacity);
+    if (c.failed) {
+        dysl_destroy(D);
+        return NULL;
+    }
+    return D;
+}
+
+struct dysl_snapshot* dysl_snapshot(struct dysl* dysl) {
+    struct dysl_allocator allocator = dysl->global->memory.allocator;
+    struct dysl_snapshot* snapshot = (struct dysl_snapshot*)dAlloc_alloc(
+        &allocator, sizeof(*snapshot)
+    );
+    if (snapshot == NULL)
+        return NULL;
+    snapshot->state = dS_clone(dysl, allocator);
+    if (snapshot->state == NULL) {
+        dAlloc_free(&allocator, snapshot, sizeof(*snapshot));
+        return NULL;
+    }
+    return snapshot;
+}
+
+struct dysl* dysl_new_from_snapshot(
+    const struct dysl_snapshot* snapshot,
+    struct dysl_allocator allocator
+) {
+    return dS_clone(snapshot->state, allocator);
+}
+
+void dysl_snapshot_destroy(struct dysl_snapshot* snapshot) {
+    struct dysl_allocator allocator =
+        snapshot->state->global->memory.allocator;
+    dysl_destroy(snapshot->state);
+    dAlloc_free(&allocator, snapshot, sizeof(*snapshot));
+}
+
+/** Fails if the state is suspended, as yielding again would lose it. */
+static int dS_check_runnable(struct dysl* D) {
+    if (D->suspended)
+        return dS_error(D, DYSL_ERROR_RUNTIME, 0,
+                        "cannot run in a suspended state", NULL, 0);
+    D->status = DYSL_OK;
+    D->error[0] = '\0';
+    return DYSL_OK;
+}
+
+int dysl_run(struct dysl* dysl, const char* source, size_t length) {
+    size_t top = dStack_count(&dysl->stack);
+    if (dS_check_runnable(dysl) != DYSL_OK)
+        return dysl->status;
+    struct dy_proc* proc = dC_compile(dysl, source, length);
+    if (proc == NULL)
+        return dysl->status;
+    int status = dVM_call(dysl, proc, NULL);
+    if (status != DYSL_OK && status != DYSL_YIELD)
+        dysl->stack.top = dysl->stack.base + top;
+    return status;
+}
+
+int dysl_run_reader(
+    struct dysl* dysl,
+    dysl_reader reader,
+    void* user_data,
+    int keep_bindings
+) {
+    size_t top = dStack_count(&dysl->stack);
+    if (dS_check_runnable(dysl) != DYSL_OK)
+        return dysl->status;
+    struct dy_proc* proc = dC_compile_reader(dysl, reader, user_data,
+                                             keep_bindings);
+    if (proc == NULL)
+        return dysl->status;
+    int status = dVM_call(dysl, proc, NULL);
+    if (status != DYSL_OK && status != DYSL_YIELD)
+        dysl->stack.top = dysl->stack.base + top;
+    return status;
+}
+
+int dysl_is_incomplete(struct dysl* dysl) {
+    return dysl->status == DYSL_ERROR_SYNTAX && dysl->incomplete;
+}
+
+int dysl_dump(
+    struct dysl* dysl,
+    const char* source,
+    size_t length,
+    dysl_writer writer,
+    void* user_data
+) {
+    dysl->status = DYSL_OK;
+    dysl->error[0] = '\0';
+    return dImage_dump(dysl, source, length, writer, user_data);
+}
+
+int dysl_run_image(struct dysl* dysl, const void* image, size_t size) {
+    size_t top = dStack_count(&dysl->stack);
+    if (dS_check_runnable(dysl) != DYSL_OK)
+        return dysl->status;
+    struct dy_proc* proc = dImage_load(dysl, image, size);
+    if (proc == NULL)
+        return dysl->status;
+    int status = dVM_call(dysl, proc, NULL);
+    if (status != DYSL_OK && status != DYSL_YIELD)
+        dysl->stack.top = dysl->stack.base + top;
+    return status;
+}
+
+int dysl_is_image(const void* data, size_t size) {
+    uint32_t magic;
+    if (size < sizeof(magic))
+        return 0;
+    dMem_copy(&magic, data, sizeof(magic));
+    return magic == DYSL_IMAGE_MAGIC;
+}
+
+const char* dysl_error_message(struct dysl* dysl) {
+    return dysl->error;
+}
 
-#pragma region Utility functions and macros
-#define dU_min(a, b) ((a) < (b) ? (a) : (b))
-#define dU_max(a, b) ((a) > (b) ? (a) : (b))
+void dysl_error(struct dysl* dysl, const char* message) {
+    dS_error(dysl, DYSL_ERROR_RUNTIME, dS_line(dysl), message, NULL, 0);
+}
 
-/** Clears a chunk of memory (sets to zero) */
-static inline void dMem_clear(void* ptr, size_t size) {
-    uint8_t* p = (uint8_t*)ptr;
-    for (size_t i = 0; i < size; i++)
-        p[i] = 0;
+void dysl_register(struct dysl* dysl, const char* name, dysl_native_proc fn) {
+    struct dy_symbol* sym = dGlobal_intern(dysl->global, name, dU_strlen(name));
+    struct dy_proc* proc = sym != NULL
+        ? dProc_create_native(dS_gc(dysl), sym, fn)
+        : NULL;
+    if (proc == NULL ||
+        !dEnv_push(&dysl->env, sym, dV_make_object(&proc->header), 1,
+                   dS_allocator(dysl)))
+        dS_error(dysl, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
 }
 
-/** Copies a chunk of memory (from src to dest) */
-static inline void dMem_copy(void* dest, const void* src, size_t size) {
-    uint8_t* d = (uint8_t*)dest;
-    const uint8_t* s = (const uint8_t*)src;
-    for (size_t i = 0; i < size; i++)
-        d[i] = s[i];
+void dysl_register_fast(
+    struct dysl* dysl,
+    const char* name,
+    int arity,
+    dysl_fast_proc fn
+) {
+    struct dy_symbol* sym = dGlobal_intern(dysl->global, name, dU_strlen(name));
+    struct dy_proc* proc = sym != NULL
+        ? dProc_create_fast(dS_gc(dysl), sym, fn,
+                            arity < 0 ? 0 : (uint32_t)arity)
+        : NULL;
+    if (proc == NULL ||
+        !dEnv_push(&dysl->env, sym, dV_make_object(&proc->header), 1,
+                   dS_allocator(dysl)))
+        dS_error(dysl, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
 }
 
-/** FNV-1a hash function implementation */
-static inline dy_hash_t dHash_fnv1a(const void* key, size_t length) {
-    const uint8_t* data = (const uint8_t*)key;
-    dy_hash_t hash = 2166136261u;
-    for (size_t i = 0; i < length; i++) {
-        hash ^= data[i];
-        hash *= 16777619u;
+int dysl_call_batch(
+    struct dysl* dysl,
+    const char* word,
+    int arity,
+    const struct dy_value* inputs,
+    size_t count,
+    struct dy_value* outputs
+) {
+    if (dS_check_runnable(dysl) != DYSL_OK)
+        return dysl->status;
+    size_t length = dU_strlen(word);
+    struct dy_symbol* sym = dGlobal_intern(dysl->global, word, length);
+    if (sym == NULL)
+        return dS_error(dysl, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
+    struct dy_env_cache cache = {0, 0, 0, NULL};
+    struct dy_binding* binding;
+    if (!dVM_lookup(dysl, sym, &cache, &binding))
+        return dysl->status;
+    if (binding == NULL || !dV_is(binding->value, DYSL_TYPE_PROCEDURE))
+        return dS_error(dysl, DYSL_ERROR_RUNTIME, 0, "unbound word",
+                        word, length);
+    struct dy_proc* proc = dV_proc(binding->value);
+    size_t n = arity < 0 ? 0 : (size_t)arity;
+    int direct = proc->fast != NULL && proc->arity == n;
+#if DYSL_PROFILE
+    direct = direct && !dysl->global->profiler.active;
+#endif /* DYSL_PROFILE */
+    if (direct) {
+        // fast natives read their arguments where they are
+        for (size_t i = 0; i < count; i++) {
+            outputs[i] = dV_nil();
+            proc->fast(dysl, inputs + i * n, &outputs[i]);
+            if (dysl->status != DYSL_OK)
+                return dysl->status;
+        }
+        return DYSL_OK;
     }
-    return hash;
+    size_t top = dStack_count(&dysl->stack);
+    // as if called from a native, so nothing yields
+    dysl->vm_depth++;
+    int status = DYSL_OK;
+    for (size_t i = 0; i < count && status == DYSL_OK; i++) {
+        // the outputs so far stay on the stack, where the collectors the
+        // next calls run see them, until the batch ends
+        if (!dS_ensure_stack(dysl, n > 0 ? n : 1)) {
+            status = dysl->status;
+            break;
+        }
+        struct dy_value* args = dysl->stack.top;
+        if (n > 0)
+            dMem_copy(args, inputs + i * n, sizeof(struct dy_value) * n);
+        dysl->stack.top = args + n;
+        status = dVM_call(dysl, proc, NULL);
+        if (status == DYSL_OK)
+            outputs[i] = dStack_count(&dysl->stack) > top + i
+                ? dysl->stack.top[-1]
+                : dV_nil();
+        dysl->stack.top = dysl->stack.base + top + i;
+        if (status == DYSL_OK)
+            *dysl->stack.top++ = outputs[i];
+    }
+    dysl->stack.top = dysl->stack.base + top;
+    dysl->vm_depth--;
+    return status;
 }
-#define dHash_slice(key, length) dHash_fnv1a((key), (length))
 
-/** Compares two memory slices for equality */
-static inline int dSlice_equals(
-    const void* a,
-    size_t a_length,
-    const void* b,
-    size_t b_length
+void dysl_register_module(
+    struct dysl* dysl,
+    const char* name,
+    const struct dysl_reg* entries
 ) {
-    if (a_length != b_length)
-        return 0;
-    const uint8_t* pa = (const uint8_t*)a;
-    const uint8_t* pb = (const uint8_t*)b;
-    for (size_t i = 0; i < a_length; i++) {
-        if (pa[i] != pb[i])
-            return 0;
+    struct dy_global* global = dysl->global;
+    struct dysl_allocator* allocator = dGC_allocator(&global->gc);
+    size_t count = 0, longest = 0;
+    for (; entries[count].name != NULL; count++)
+        longest = dU_max(longest, dU_strlen(entries[count].name));
+    size_t name_length = dU_strlen(name);
+    // module:word, for hashing each word's qualified name
+    size_t capacity = name_length + 1 + longest;
+    char* qualified = (char*)dAlloc_alloc(allocator, capacity);
+    struct dy_module* module = (struct dy_module*)dAlloc_alloc(
+        allocator,
+        dModule_size(count)
+    );
+    if (qualified == NULL || module == NULL)
+        goto fail;
+    dMem_copy(qualified, name, name_length);
+    qualified[name_length] = ':';
+    module->count = count;
+    module->entries = (struct dy_module_entry*)(module + 1);
+    module->name = dGlobal_intern(global, name, name_length);
+    module->marker = module->name != NULL
+        ? dGlobal_intern(global, qualified, name_length + 1)
+        : NULL;
+    if (module->marker == NULL)
+        goto fail;
+    // words are only interned once looked up, given procedures once found
+    for (size_t e = 0; e < count; e++) {
+        struct dy_module_entry* entry = &module->entries[e];
+        size_t entry_length = dU_strlen(entries[e].name);
+        dMem_copy(qualified + name_length + 1, entries[e].name, entry_length);
+        entry->name = entries[e].name;
+        entry->hash = dHash_slice(global->hash_seed, qualified,
+                                  name_length + 1 + entry_length);
+        entry->fn = entries[e].fn;
+        entry->marker = module->marker;
+        entry->binding.name = NULL;
+        entry->binding.value = dV_nil();
+        entry->binding.is_word = 1;
     }
-    return 1;
+    dAlloc_free(allocator, qualified, capacity);
+    module->next = global->modules;
+    global->modules = module;
+    return;
+fail:
+    if (qualified != NULL)
+        dAlloc_free(allocator, qualified, capacity);
+    if (module != NULL)
+        dAlloc_free(allocator, module, dModule_size(count));
+    dS_error(dysl, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
 }
-#pragma endregion /* Utility functions and macros */
 
-/* == Implementation == */
+#if DYSL_BACKGROUND_SWEEP
+void dysl_set_sweeper(struct dysl* dysl, struct dysl_sweeper sweeper) {
+    dS_gc(dysl)->sweeper = sweeper;
+}
+#endif /* DYSL_BACKGROUND_SWEEP */
 
-#pragma region Allocator API implementation
-static inline void* dAlloc_alloc(struct dysl_allocator* allocator, size_t size) {
-    return allocator->fn(allocator->user_data, NULL, 0, size);
+int dysl_gc_step(struct dysl* dysl, size_t budget) {
+    return dGC_step(dysl->global, budget, 1);
+}
+
+void dysl_gc_collect(struct dysl* dysl) {
+    dGC_collect(dysl->global);
 }
-static inline void* dAlloc_free(struct dysl_allocator* allocator, void* ptr) {
-    return allocator->fn(allocator->user_data, ptr, 0, 0);
+
+void dysl_set_gc_clock(struct dysl* dysl, dysl_clock clock, void* user_data) {
+    dS_gc(dysl)->clock = clock;
+    dS_gc(dysl)->clock_data = user_data;
 }
-static inline void* dAlloc_realloc(
-    struct dysl_allocator* allocator,
-    void* ptr,
-    size_t old_size,
-    size_t new_size
-) {
-    return allocator->fn(allocator->user_data, ptr, old_size, new_size);
+
+void dysl_memstats(struct dysl* dysl, struct dysl_memstats* stats) {
+    struct dy_global* global = dysl->global;
+    stats->bytes = global->memory.bytes;
+    stats->peak_bytes = global->memory.peak;
+    stats->limit = global->memory.limit;
+    stats->allocations = global->memory.allocations;
+    stats->refused = global->memory.refused;
+    stats->gc_time = global->gc.time;
+    for (size_t t = 0; t < DYSL_TYPE_COUNT; t++)
+        stats->objects[t] = global->gc.created[t];
 }
-#pragma endregion /* Allocator API implementation */
 
-#pragma region Object (header) linked list API implementation
-static inline void dObj_close(struct dy_object* obj) {
-    obj->previous = obj->next = obj;
+void dysl_set_memory_limit(struct dysl* dysl, size_t limit) {
+    dysl->global->memory.limit = limit;
+    dGlobal_pace_limit(dysl->global);
 }
 
-static inline void dObj_unlink(struct dy_object* obj) {
-    obj->previous->next = obj->next;
-    obj->next->previous = obj->previous;
-    dObj_close(obj);
+int dysl_get_top(struct dysl* dysl) {
+    return (int)dStack_count(&dysl->stack);
 }
 
-static inline void dObj_link(struct dy_object* obj, struct dy_object* list) {
-    obj->next = list->next;
-    obj->previous = list;
-    list->next->previous = obj;
-    list->next = obj;
+int dysl_ensure_stack(struct dysl* dysl, int count) {
+    if (count <= 0 || dStack_room(&dysl->stack) >= (size_t)count)
+        return 1;
+    return dStack_grow(&dysl->stack, (size_t)count, dS_allocator(dysl)) ==
+        DYSL_OK;
 }
-#pragma endregion /* Object (header) linked list API implementation */
 
-#pragma region Symbol type API implementation
-struct dy_symbol* dSymbol_create(
-    struct dy_gc* gc,
-    const char* name,
+void dysl_pop(struct dysl* dysl, int count) {
+    size_t n = count < 0 ? 0 : (size_t)count;
+    dysl->stack.top -= dU_min(n, dStack_count(&dysl->stack));
+}
+
+int dysl_type(struct dysl* dysl, int index) {
+    struct dy_value* value = dS_index(dysl, index);
+    return value != NULL ? (int)dV_type(*value) : DYSL_TYPE_NIL;
+}
+
+void dysl_push_nil(struct dysl* dysl) {
+    dS_push(dysl, dV_nil());
+}
+
+void dysl_push_integer(struct dysl* dysl, int32_t value) {
+    dS_push(dysl, dV_make_integer(value));
+}
+
+void dysl_push_real(struct dysl* dysl, double value) {
+#if DYSL_REALS
+    dS_push(dysl, dV_make_real(value));
+#else /* DYSL_REALS */
+    // truncated, saturating, and NaN is zero
+    dy_int integer = value >= (double)INT32_MAX ? INT32_MAX
+        : value <= (double)INT32_MIN ? INT32_MIN
+        : value == value ? (dy_int)value
+        : 0;
+    dS_push(dysl, dV_make_integer(integer));
+#endif /* DYSL_REALS */
+}
+
+void dysl_push_boolean(struct dysl* dysl, int value) {
+    dS_push(dysl, dV_make_boolean(value));
+}
+
+void dysl_push_value(struct dysl* dysl, struct dy_value value) {
+    dS_push(dysl, value);
+}
+
+void dysl_push_string(struct dysl* dysl, const char* data, size_t length) {
+    struct dy_string* str = dGlobal_string(dysl->global, data, length);
+    if (str == NULL) {
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dS_push(dysl, dV_make_object(&str->header));
+    dGC_check(dysl);
+}
+
+void dysl_push_external_string(
+    struct dysl* dysl,
+    const char* data,
     size_t length,
-    dy_hash_t hash
+    dysl_release release,
+    void* user_data
 ) {
-    size_t total_size = sizeof(struct dy_symbol) + length;
-    struct dy_symbol* sym = (struct dy_symbol*)dGC_create(
-        gc,
-        total_size,
-        DYSL_TYPE_SYMBOL
+    // interned strings must be unique, and arenas never free objects
+    if (dString_is_short(length) || dGC_is_arena(dS_gc(dysl))) {
+        dysl_push_string(dysl, data, length);
+        if (release != NULL)
+            release(user_data, data, length);
+        return;
+    }
+    struct dy_string* str = dString_create_external(
+        dS_gc(dysl), data, length, release, user_data
     );
-    if (sym == NULL)
-        return NULL;
-    sym->length = length;
-    sym->hash = hash;
-    dMem_copy(sym->name, name, length);
-    sym->name[length] = '\0'; // null-terminate
-    return sym;
+    if (str == NULL) {
+        if (release != NULL)
+            release(user_data, data, length);
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dS_push(dysl, dV_make_object(&str->header));
+    dGC_check(dysl);
 }
-#pragma endregion /* Symbol type API implementation */
 
-#pragma region String type API implementation
-struct dy_string* dString_create(
-    struct dy_gc* gc,
-    const char* data,
-    size_t length
+void dysl_push_symbol(struct dysl* dysl, const char* name, size_t length) {
+    struct dy_symbol* sym = dGlobal_intern(dysl->global, name, length);
+    if (sym == NULL) {
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dS_push(dysl, dV_make_object(&sym->header));
+    dGC_check(dysl);
+}
+
+void dysl_push_array(struct dysl* dysl) {
+    struct dy_array* array = dArray_create(dS_gc(dysl), 0);
+    if (array == NULL) {
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dS_push(dysl, dV_make_object(&array->header));
+    dGC_check(dysl);
+}
+
+#if DYSL_TABLES
+void dysl_push_table(struct dysl* dysl) {
+    struct dy_table* table = dTable_create(dS_gc(dysl), 0);
+    if (table == NULL) {
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dS_push(dysl, dV_make_object(&table->header));
+    dGC_check(dysl);
+}
+#endif /* DYSL_TABLES */
+
+void dysl_push_builder(struct dysl* dysl) {
+    struct dy_builder* builder = dBuilder_create(dS_gc(dysl), 0);
+    if (builder == NULL) {
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dS_push(dysl, dV_make_object(&builder->header));
+    dGC_check(dysl);
+}
+
+size_t dysl_hot_pairs(
+    struct dysl* dysl,
+    struct dysl_pair_count* pairs,
+    size_t max
 ) {
-    struct dy_string* str = (struct dy_string*)dGC_create(
-        gc,
-        sizeof(struct dy_string) + length + 1,
-        DYSL_TYPE_STRING
-    );
-    if (str == NULL)
-        return NULL;
-    str->length = length;
-    dMem_copy(str->data, data, length);
-    str->data[length] = '\0'; // null-terminate
-    return str;
+#if DYSL_PROFILE_PAIRS
+    static const char* const names[DYSL_OP_COUNT] = {
+#define DYSL_OPCODE_NAME(name) #name,
+        DYSL_OPCODES(DYSL_OPCODE_NAME)
+#undef DYSL_OPCODE_NAME
+    };
+    const uint64_t* counts = dysl->global->pair_counts;
+    size_t found = 0;
+    // insertion into the sorted output, the table is small
+    for (size_t p = 0; p < (size_t)DYSL_OP_COUNT * DYSL_OP_COUNT; p++) {
+        if (counts[p] == 0 || (found == max && counts[p] <= pairs[max - 1].count))
+            continue;
+        size_t at = found < max ? found++ : max - 1;
+        while (at > 0 && pairs[at - 1].count < counts[p]) {
+            pairs[at] = pairs[at - 1];
+            at--;
+        }
+        pairs[at].first = names[p / DYSL_OP_COUNT];
+        pairs[at].second = names[p % DYSL_OP_COUNT];
+        pairs[at].count = counts[p];
+    }
+    return found;
+#else /* DYSL_PROFILE_PAIRS */
+    (void)dysl;
+    (void)pairs;
+    (void)max;
+    return 0;
+#endif /* DYSL_PROFILE_PAIRS */
 }
-#pragma endregion /* String type API implementation */
 
-#pragma region Symbol table API implementation
-void dSymbols_init(
-    struct dy_symbols* symbols,
-    size_t initial_capacity,
-    struct dysl_allocator* allocator
+#if DYSL_PROFILE
+void dysl_profile_start(
+    struct dysl* dysl,
+    dysl_clock clock,
+    void* user_data,
+    uint64_t period
 ) {
-    symbols->count = 0;
-    symbols->capacity = initial_capacity;
-    symbols->buckets = (struct dy_symbol**)dAlloc_alloc(
-        allocator,
-        sizeof(struct dy_symbol*) * initial_capacity
+    struct dy_global* global = dysl->global;
+    struct dy_profiler* p = &global->profiler;
+    p->active = 0;
+    if (p->node_capacity == 0) {
+        struct dy_profile_node* nodes = (struct dy_profile_node*)
+            dProfile_grow(dS_allocator(dysl), NULL, &p->node_capacity,
+                          sizeof(struct dy_profile_node));
+        if (nodes == NULL)
+            return;
+        p->nodes = nodes;
+    }
+    p->entry_count = 0;
+    p->node_count = 1;
+    dMem_clear(&p->nodes[0], sizeof(p->nodes[0]));
+    p->clock = clock;
+    p->clock_data = user_data;
+    p->ticks = 0;
+    p->period = period != 0 ? period : 1;
+    p->last_sample = dProfile_now(p);
+    // the calls running now were never entered
+    global->main_state->profile_depth = 0;
+    for (struct dysl* D = global->threads; D != NULL; D = D->next_thread)
+        D->profile_depth = 0;
+    p->active = 1;
+}
+
+void dysl_profile_stop(struct dysl* dysl) {
+    dysl->global->profiler.active = 0;
+}
+
+size_t dysl_profile_entries(
+    struct dysl* dysl,
+    struct dysl_profile_entry* entries,
+    size_t max
+) {
+    const struct dy_profiler* p = &dysl->global->profiler;
+    size_t found = 0;
+    // insertion into the sorted output, as `dysl_hot_pairs`
+    for (size_t e = 0; e < p->entry_count && max > 0; e++) {
+        const struct dy_profile_entry* entry = &p->entries[e];
+        if (found == max && entry->self_time <= entries[max - 1].self_time)
+            continue;
+        size_t at = found < max ? found++ : max - 1;
+        while (at > 0 && entries[at - 1].self_time < entry->self_time) {
+            entries[at] = entries[at - 1];
+            at--;
+        }
+        entries[at].name = entry->name->name;
+        entries[at].calls = entry->calls;
+        entries[at].self_time = entry->self_time;
+        entries[at].allocations = entry->allocations;
+    }
+    return found;
+}
+
+int dysl_profile_dump(struct dysl* dysl, dysl_writer writer, void* user_data) {
+    const struct dy_profiler* p = &dysl->global->profiler;
+    if (p->node_count == 0)
+        return DYSL_OK;
+    uint32_t* path = (uint32_t*)dAlloc_alloc(
+        dS_allocator(dysl), sizeof(uint32_t) * p->node_count
     );
-    for (size_t i = 0; i < initial_capacity; i++)
-        symbols->buckets[i] = NULL;
+    if (path == NULL)
+        return dS_error(dysl, DYSL_ERROR_MEMORY, 0, "out of memory", NULL, 0);
+    int failed = 0;
+    for (size_t n = 0; n < p->node_count && !failed; n++) {
+        if (p->nodes[n].samples == 0)
+            continue;
+        size_t depth = 0;
+        for (uint32_t at = (uint32_t)n; at != 0; at = p->nodes[at].parent)
+            path[depth++] = at;
+        if (depth == 0)
+            failed |= writer(user_data, "(top)", 5);
+        while (depth > 0 && !failed) {
+            const struct dy_symbol* name =
+                p->entries[p->nodes[path[--depth]].entry].name;
+            failed |= writer(user_data, name->name, name->length);
+            if (depth > 0)
+                failed |= writer(user_data, ";", 1);
+        }
+        char buf[24];
+        buf[0] = ' ';
+        size_t length = 1 + dU_format_integer(buf + 1,
+                                              (int64_t)p->nodes[n].samples);
+        buf[length++] = '\n';
+        if (!failed)
+            failed |= writer(user_data, buf, length);
+    }
+    dAlloc_free(dS_allocator(dysl), path, sizeof(uint32_t) * p->node_count);
+    if (failed)
+        return dS_error(dysl, DYSL_ERROR_IMAGE, 0,
+                        "failed to write the profile", NULL, 0);
+    return DYSL_OK;
 }
+#endif /* DYSL_PROFILE */
 
-void dSymbols_destroy(struct dy_symbols* symbols, struct dysl_allocator* allocator) {
-    // destroys only the symbol table structure,
-    // the symbols themselves should be GC'd
-    dAlloc_free(allocator, symbols->buckets);
-    symbols->buckets = NULL;
-    symbols->count = 0;
-    symbols->capacity = 0;
+void dysl_get(struct dysl* dysl, int index) {
+    struct dy_value* container = dS_index(dysl, index);
+    struct dy_value* key = dS_index(dysl, -1);
+    if (container == NULL || key == NULL) {
+        dysl_error(dysl, "expected an array or table and a key");
+        return;
+    }
+    dVM_get_index(dysl, *container, *key, key);
 }
 
-struct dy_symbol** dSymbols_lookup(
-    struct dy_symbols* symbols,
-    const char* name,
-    size_t length,
-    dy_hash_t hash,
-    int* found
+void dysl_set(struct dysl* dysl, int index) {
+    struct dy_value* container = dS_index(dysl, index);
+    if (container == NULL || dysl_get_top(dysl) < 2) {
+        dysl_error(dysl, "expected an array or table, a key and a value");
+        return;
+    }
+    struct dy_value* top = dysl->stack.top;
+    if (dVM_set_index(dysl, *container, top[-2], top[-1]) != DYSL_OK)
+        return;
+    dysl->stack.top -= 2;
+    dGC_check(dysl);
+}
+
+size_t dysl_length(struct dysl* dysl, int index) {
+    struct dy_value* value = dS_index(dysl, index);
+    if (value == NULL)
+        return 0;
+    int64_t length = dVM_length(*value);
+    return length < 0 ? 0 : (size_t)length;
+}
+
+void dysl_append(struct dysl* dysl, int index) {
+    struct dy_value* container = dS_index(dysl, index);
+    if (container == NULL || dysl_get_top(dysl) < 1) {
+        dysl_error(dysl, "expected an array, table or builder and a value");
+        return;
+    }
+    if (dVM_append(dysl, *container, dysl->stack.top[-1]) != DYSL_OK)
+        return;
+    dysl->stack.top--;
+    dGC_check(dysl);
+}
+
+void dysl_append_string(
+    struct dysl* dysl,
+    int index,
+    const char* data,
+    size_t length
 ) {
-    size_t index = hash % symbols->capacity;
-    struct dy_symbol** slot = &(symbols->buckets[index]);
-    *found = 0;
-    while (*slot != NULL) {
-        struct dy_symbol* sym = *slot;
-        if (sym->hash == hash &&
-            sym->length == length &&
-            dSlice_equals(sym->name, sym->length, name, length)) {
-            *found = 1;
-            break;
+    struct dy_value* builder = dS_index(dysl, index);
+    if (builder == NULL || !dV_is(*builder, DYSL_TYPE_BUILDER)) {
+        dysl_error(dysl, "expected a builder");
+        return;
+    }
+    if (!dBuilder_append(dS_gc(dysl), dV_builder(*builder), data, length)) {
+        dS_error(dysl, DYSL_ERROR_MEMORY, dS_line(dysl), "out of memory",
+                 NULL, 0);
+        return;
+    }
+    dGC_check(dysl);
+}
+
+void dysl_build_string(struct dysl* dysl, int index) {
+    struct dy_value* value = dS_index(dysl, index);
+    if (value == NULL || !dV_is(*value, DYSL_TYPE_BUILDER)) {
+        dysl_error(dysl, "expected a builder");
+        return;
+    }
+    struct dy_builder* builder = dV_builder(*value);
+    dysl_push_string(dysl, builder->data != NULL ? builder->data : "",
+                     builder->length);
+}
+
+int32_t dysl_to_integer(struct dysl* dysl, int index) {
+    struct dy_value* value = dS_index(dysl, index);
+    if (value == NULL)
+        return 0;
+    if (dV_is(*value, DYSL_TYPE_INTEGER))
+        return dV_integer(*value);
+    if (dV_is(*value, DYSL_TYPE_REAL)) {
+        dy_real real = dV_real(*value);
+        if (!(real >= (dy_real)INT32_MIN && real <= (dy_real)INT32_MAX))
+            return 0;
+        return (int32_t)real;
+    }
+    return 0;
+}
+
+double dysl_to_real(struct dysl* dysl, int index) {
+    struct dy_value* value = dS_index(dysl, index);
+    if (value == NULL || !dV_is_number(*value))
+        return 0;
+    return dV_to_real(*value);
+}
+
+int dysl_to_boolean(struct dysl* dysl, int index) {
+    struct dy_value* value = dS_index(dysl, index);
+    return value != NULL && !dV_is_falsy(*value);
+}
+
+const char* dysl_to_string(struct dysl* dysl, int index, size_t* length) {
+    struct dy_value* value = dS_index(dysl, index);
+    const char* data = NULL;
+    size_t n = 0;
+    if (value != NULL && dV_is(*value, DYSL_TYPE_STRING)) {
+        data = dString_data(dV_string(*value));
+        n = dV_string(*value)->length;
+    } else if (value != NULL && dV_is(*value, DYSL_TYPE_SYMBOL)) {
+        data = dV_symbol(*value)->name;
+        n = dV_symbol(*value)->length;
+    } else if (value != NULL && dV_is(*value, DYSL_TYPE_BUILDER)) {
+        data = dV_builder(*value)->data != NULL ? dV_builder(*value)->data : "";
+        n = dV_builder(*value)->length;
+    }
+    if (length != NULL)
+        *length = n;
+    return data;
+}
+#pragma endregion /* Public Dysl API implementation */
+
+/* == Standard modules implementation == */
+#if DYSL_STDIO || DYSL_MODULE_SERDE
+/** Raises an error unless there are at least `count` values on the stack. */
+static int dStd_check_args(struct dysl* D, int count, const char* message) {
+    if (dysl_get_top(D) < count) {
+        dysl_error(D, message);
+        return 0;
+    }
+    return 1;
+}
+#endif /* DYSL_STDIO || DYSL_MODULE_SERDE */
+
+#if DYSL_STDIO
+static void dIO_write(struct dysl* D, const char* end) {
+    char buf[DYSL_FORMAT_BUFFER_SIZE];
+    size_t length;
+    if (!dStd_check_args(D, 1, "io: expected a value to print"))
+        return;
+    const char* text = dV_format(*dS_index(D, -1), buf, &length);
+    fwrite(text, 1, length, stdout);
+    fputs(end, stdout);
+    dysl_pop(D, 1);
+}
+
+static void dIO_print(struct dysl* D) {
+    dIO_write(D, "");
+}
+
+static void dIO_println(struct dysl* D) {
+    dIO_write(D, "\n");
+}
+
+static void dIO_readline(struct dysl* D) {
+    struct dysl_allocator* allocator = dS_allocator(D);
+    char stack_buffer[256];
+    char* line = stack_buffer;
+    size_t length = 0, capacity = sizeof(stack_buffer);
+    int c;
+    fflush(stdout);
+    while ((c = getchar()) != EOF && c != '\n') {
+        if (length == capacity) {
+            // move to the heap when the line gets long
+            char* grown = (char*)dAlloc_realloc(
+                allocator,
+                line == stack_buffer ? NULL : line,
+                line == stack_buffer ? 0 : capacity,
+                capacity * 2
+            );
+            if (grown == NULL) {
+                if (line != stack_buffer)
+                    dAlloc_free(allocator, line, capacity);
+                dS_error(D, DYSL_ERROR_MEMORY, dS_line(D), "out of memory",
+                         NULL, 0);
+                return;
+            }
+            if (line == stack_buffer)
+                dMem_copy(grown, stack_buffer, length);
+            line = grown;
+            capacity *= 2;
         }
-        slot = &sym->next_in_table;
+        line[length++] = (char)c;
     }
-    return slot;
+    if (c == EOF && length == 0)
+        dysl_push_nil(D);
+    else
+        dysl_push_string(D, line, length);
+    if (line != stack_buffer)
+        dAlloc_free(allocator, line, capacity);
+}
+
+static const struct dysl_reg dIO_module[] = {
+    { "print", dIO_print },
+    { "println", dIO_println },
+    { "readline", dIO_readline },
+    { NULL, NULL },
+};
+#endif /* DYSL_STDIO */
+
+#if DYSL_MODULE_MATH
+/** Pushes a real as an integer when it is integral and fits. */
+static void dMath_push_integral(struct dysl* D, dy_real value) {
+    if (value >= (dy_real)INT32_MIN && value <= (dy_real)INT32_MAX)
+        dysl_push_integer(D, (int32_t)value);
+    else
+        dysl_push_real(D, value);
+}
+
+/** Pops a number, raising an error if the top value isn't one. */
+static int dMath_pop_number(struct dysl* D, struct dy_value* number) {
+    struct dy_value* value = dS_index(D, -1);
+    if (value == NULL || !dV_is_number(*value)) {
+        dysl_error(D, "math: expected a number");
+        return 0;
+    }
+    *number = *value;
+    dysl_pop(D, 1);
+    return 1;
 }
 
-struct dy_symbol** dSymbols_intern(
-    struct dy_symbols* symbols,
-    const char* name,
-    size_t length,
-    dy_hash_t hash,
-    struct dysl_allocator* allocator
-) {
-    int found = 0;
-    struct dy_symbol** slot;
-    // first lookup
-    slot = dSymbols_lookup(symbols, name, length, hash, &found);
-    if (found) return slot;
-    // not found, create new symbol
-    size_t new_count = symbols->count + 1;
-    if (dSymbols_should_grow(symbols, new_count)) {
-        dSymbols_ensure_capacity(symbols, new_count, allocator);
-        // re-lookup after resize
-        slot = dSymbols_lookup(symbols, name, length, hash, &found);
-    }
-    symbols->count = new_count;
-    // caller allocates the symbol and places it in *slot
-    return slot;
+static void dMath_random(struct dysl* D) {
+    // xorshift64*, 53 random bits
+    uint64_t x = D->global->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    D->global->random_state = x;
+    x *= 0x2545F4914F6CDD1Dull;
+#if DYSL_REALS
+    dysl_push_real(D, (dy_real)(x >> 11) * (1.0 / 9007199254740992.0));
+#else /* DYSL_REALS */
+    // a non-negative integer instead, 31 random bits
+    dysl_push_integer(D, (int32_t)(x >> 33));
+#endif /* DYSL_REALS */
 }
 
-void dSymbols_resize(
-    struct dy_symbols* symbols,
-    size_t new_capacity,
-    struct dysl_allocator* allocator
-) {
-    struct dy_symbol** new_buckets = (struct dy_symbol**)dAlloc_alloc(
-        allocator,
-        sizeof(struct dy_symbol*) * new_capacity
-    );
-    if (new_buckets == NULL)
-        // Allocation failed, overflow the symbol table until next resize.
-        // This keeps things functional at the cost of performance.
+static void dMath_floor(struct dysl* D) {
+    struct dy_value n;
+    if (!dMath_pop_number(D, &n))
         return;
-    for (size_t i = 0; i < new_capacity; i++)
-        new_buckets[i] = NULL;
-    // rehash existing symbols
-    for (size_t i = 0; i < symbols->capacity; i++) {
-        struct dy_symbol* sym = symbols->buckets[i];
-        while (sym != NULL) {
-            struct dy_symbol* next_sym = sym->next_in_table;
-            size_t new_index = sym->hash % new_capacity;
-            sym->next_in_table = new_buckets[new_index];
-            new_buckets[new_index] = sym;
-            sym = next_sym;
-        }
-    }
-    // free old buckets
-    dAlloc_free(allocator, symbols->buckets);
-    symbols->buckets = new_buckets;
-    symbols->capacity = new_capacity;
+    if (dV_is(n, DYSL_TYPE_INTEGER))
+        dS_push(D, n);
+    else
+        dMath_push_integral(D, dU_floor(dV_real(n)));
 }
 
-void dSymbols_ensure_capacity(
-    struct dy_symbols* symbols,
-    size_t desired_count,
-    struct dysl_allocator* allocator
-) {
-    size_t capacity = symbols->capacity;
-    size_t grow_threshold = (size_t)(capacity * DYSL_SYMBOLS_LOAD_FACTOR);
-    size_t shrink_threshold = capacity / 4;
-    size_t new_capacity = symbols->capacity;
-    if (desired_count > grow_threshold) {
-        // need to grow
-        while (new_capacity * DYSL_SYMBOLS_LOAD_FACTOR < desired_count) {
-            new_capacity *= 2;
-        }
-    } else if (desired_count < shrink_threshold &&
-               capacity > DYSL_SYMBOLS_INITIAL_CAPACITY) {
-        // need to shrink
-        new_capacity = capacity / 2;
-        new_capacity = dU_max(new_capacity, DYSL_SYMBOLS_INITIAL_CAPACITY);
-        while (new_capacity > DYSL_SYMBOLS_INITIAL_CAPACITY &&
-               desired_count < (size_t)(new_capacity / 4)) {
-            new_capacity /= 2;
-        }
-    }
-    dSymbols_resize(symbols, new_capacity, allocator);
+static void dMath_ceil(struct dysl* D) {
+    struct dy_value n;
+    if (!dMath_pop_number(D, &n))
+        return;
+    if (dV_is(n, DYSL_TYPE_INTEGER))
+        dS_push(D, n);
+    else
+        dMath_push_integral(D, -dU_floor(-dV_real(n)));
 }
 
-int dSymbols_should_grow(struct dy_symbols* symbols, size_t desired_count) {
-    size_t grow_threshold = (size_t)(symbols->capacity * DYSL_SYMBOLS_LOAD_FACTOR);
-    return desired_count > grow_threshold;
+static void dMath_abs(struct dysl* D) {
+    struct dy_value n;
+    if (!dMath_pop_number(D, &n))
+        return;
+    if (dV_is(n, DYSL_TYPE_INTEGER) && dV_integer(n) != INT32_MIN)
+        dysl_push_integer(D, dV_integer(n) < 0 ? -dV_integer(n) : dV_integer(n));
+    else
+        dysl_push_real(D, dV_to_real(n) < 0 ? -dV_to_real(n) : dV_to_real(n));
 }
-#pragma endregion /* Symbol table API implementation */
 
-#pragma region Garbage Collector API implementation
-void dGC_init(struct dy_gc* gc, struct dysl_allocator allocator) {
-    gc->allocator = allocator;
-    dy_tag tag = DYSL_TAG_OBJECT | DYSL_TAG_SPECIAL | DYSL_TYPE_NIL;
-    dObj_close(&gc->root);
-    gc->root.tag = tag;
-    dObj_close(&gc->gen);
-    gc->gen.tag = tag;
+static void dMath_minmax(struct dysl* D, int max) {
+    struct dy_value a, b;
+    if (!dMath_pop_number(D, &b) || !dMath_pop_number(D, &a))
+        return;
+    int a_wins = max
+        ? dV_to_real(a) >= dV_to_real(b)
+        : dV_to_real(a) <= dV_to_real(b);
+    dS_push(D, a_wins ? a : b);
 }
 
-static inline void dGC_track(struct dy_gc* gc, struct dy_object* obj) {
-    dObj_link(obj, &gc->gen);
+static void dMath_min(struct dysl* D) {
+    dMath_minmax(D, 0);
 }
 
-static inline void dGC_root(struct dy_gc* gc, struct dy_object* obj) {
-    dObj_link(obj, &gc->root);
+static void dMath_max(struct dysl* D) {
+    dMath_minmax(D, 1);
 }
 
-static inline void dGC_unroot(struct dy_gc* gc, struct dy_object* obj) {
-    dObj_unlink(obj);
-    dGC_track(gc, obj);
+static const struct dysl_reg dMath_module[] = {
+    { "random", dMath_random },
+    { "floor", dMath_floor },
+    { "ceil", dMath_ceil },
+    { "abs", dMath_abs },
+    { "min", dMath_min },
+    { "max", dMath_max },
+    { NULL, NULL },
+};
+#endif /* DYSL_MODULE_MATH */
+
+#if DYSL_MODULE_STRING
+static void dStrlib_builder(struct dysl* D) {
+    dysl_push_builder(D);
 }
 
-struct dy_object* dGC_create(struct dy_gc* gc, size_t size, dy_tag tag) {
-    struct dy_object* obj = (struct dy_object*)dAlloc_alloc(dGC_allocator(gc),
-                                                            size);
-    if (obj == NULL)
-        return NULL;
-    obj->tag = tag | DYSL_TAG_OBJECT;
-    // dObj_close(obj); // unnecessary
-    dGC_track(gc, obj);
-    return obj;
+static const struct dysl_reg dStrlib_module[] = {
+    { "builder", dStrlib_builder },
+    { NULL, NULL },
+};
+#endif /* DYSL_MODULE_STRING */
+
+#if DYSL_MODULE_SERDE
+/** Parses the string on top of the stack as a number literal. */
+static void dSerde_parse(struct dysl* D, int want_integer) {
+    size_t length;
+    const char* data;
+    if (!dStd_check_args(D, 1, "serde: expected a string"))
+        return;
+    data = dysl_to_string(D, -1, &length);
+    if (data == NULL) {
+        dysl_error(D, "serde: expected a string");
+        return;
+    }
+    struct dy_lexer lexer;
+    struct dy_token token;
+    dLex_init(&lexer, data, length);
+    dLex_next(&lexer, &token);
+    int whole = lexer.cursor == data + length;
+    dysl_pop(D, 1);
+    if (whole && token.type == DYSL_TOKEN_INTEGER)
+        want_integer
+            ? dysl_push_integer(D, token.as.integer)
+            : dysl_push_real(D, token.as.integer);
+    else if (whole && token.type == DYSL_TOKEN_REAL && !want_integer)
+        dysl_push_real(D, token.as.real);
+    else
+        dysl_push_nil(D);
 }
-#pragma endregion /* Garbage Collector API implementation */
 
-#pragma region Global context API implementation
-void dGlobal_init(struct dy_global* global, struct dysl_allocator allocator) {
-    dGC_init(&global->gc, allocator);
-    dSymbols_init(&global->symbols, DYSL_SYMBOLS_INITIAL_CAPACITY, &allocator);
+static void dSerde_string_to_integer(struct dysl* D) {
+    dSerde_parse(D, 1);
 }
-#pragma endregion /* Global context API implementation */
 
-#pragma region Public dysl API implementation
-struct dysl* dysl_new(struct dysl_allocator allocator) {
-    struct dysl* D = (struct dysl*)dAlloc_alloc(&allocator, sizeof(*D));
-    if (D == NULL)
-        return NULL;
-    D->global = (struct dy_global*)dAlloc_alloc(&allocator, sizeof(*D->global));
-    if (D->global == NULL) {
-        dAlloc_free(&allocator, D);
-        return NULL;
+static void dSerde_string_to_real(struct dysl* D) {
+    dSerde_parse(D, 0);
+}
+
+static void dSerde_to_string(struct dysl* D) {
+    char buf[DYSL_FORMAT_BUFFER_SIZE];
+    size_t length;
+    if (!dStd_check_args(D, 1, "serde: expected a value"))
+        return;
+    struct dy_value value = *dS_index(D, -1);
+    if (dV_is(value, DYSL_TYPE_STRING))
+        return;
+    const char* text = dV_format(value, buf, &length);
+    struct dy_string* str = dGlobal_string(D->global, text, length);
+    if (str == NULL) {
+        dS_error(D, DYSL_ERROR_MEMORY, dS_line(D), "out of memory", NULL, 0);
+        return;
     }
-    dGlobal_init(D->global, allocator);
-    D->global->main_state = D;
-    return D;
+    *dS_index(D, -1) = dV_make_object(&str->header);
 }
 
-void dysl_destroy(struct dysl* state) {
-    struct dysl_allocator* allocator = &state->global->gc.allocator;
-    dAlloc_free(allocator, state->global);
-    dAlloc_free(allocator, state);
+static const struct dysl_reg dSerde_module[] = {
+    { "string->integer", dSerde_string_to_integer },
+    { "string->real", dSerde_string_to_real },
+    { "->string", dSerde_to_string },
+    { NULL, NULL },
+};
+#endif /* DYSL_MODULE_SERDE */
+
+void dysl_open_modules(struct dysl* dysl) {
+    (void)dysl; // unused when every module is left out
+#if DYSL_STDIO
+    dysl_register_module(dysl, "io", dIO_module);
+#endif /* DYSL_STDIO */
+#if DYSL_MODULE_MATH
+    dysl_register_module(dysl, "math", dMath_module);
+#endif /* DYSL_MODULE_MATH */
+#if DYSL_MODULE_SERDE
+    dysl_register_module(dysl, "serde", dSerde_module);
+#endif /* DYSL_MODULE_SERDE */
+#if DYSL_MODULE_STRING
+    dysl_register_module(dysl, "string", dStrlib_module);
+#endif /* DYSL_MODULE_STRING */
 }
-#pragma endregion /* Public Dysl API implementation */
 
 /* == Standard allocator implementation == */
 #if DYSL_STDLIB
@@ -729,13 +10003,53 @@ struct dysl_allocator dysl_standard_allocator(void) {
 /* == Command-line interface implementation == */
 #ifdef DYSL_CLI
 #include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define DYSL_CLI_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#else
+#define DYSL_CLI_MMAP 0
+#include <time.h>
+#endif /* defined(__unix__) || defined(__APPLE__) */
 
 void usage(const char* program_name);
 void version(void);
+char* read_file(const char* file_name, size_t* length);
+void* map_file(const char* file_name, size_t* length);
+void release_file(char* source, size_t length, int mapped);
+int write_file(void* user_data, const void* data, size_t size);
+int run_source(struct dysl* dysl, const char* source, size_t length);
+const char* read_stream(void* user_data, size_t* length);
+int repl(struct dysl* dysl, int prompt);
+uint64_t wall_clock(void* user_data);
+uint64_t cli_random_seed(void);
+int bench(const char* file_name, const char* source, size_t length, int runs);
+void report_runs(const char* mode, uint64_t* wall, uint64_t* gc, int runs);
+void sort_times(uint64_t* times, int count);
+#if DYSL_PROFILE
+#include <time.h>
+uint64_t profile_clock(void* user_data);
+void write_profile(struct dysl* dysl, const char* profile_name);
+#endif /* DYSL_PROFILE */
 
 int main(int argc, const char* argv[]) {
     const char* program_name = argv[0];
     const char* file_name = NULL;
+    const char* output_name = NULL;
+#if DYSL_PROFILE
+    const char* profile_name = NULL;
+#endif /* DYSL_PROFILE */
+    int show_pairs = 0;
+    int bench_runs = 0;
+#if DYSL_CLI_MMAP
+    int terminal = isatty(STDIN_FILENO);
+#else
+    int terminal = 1;
+#endif /* DYSL_CLI_MMAP */
+    int interactive = terminal;
     // parse command-line arguments
     int arg_index = 1;
     for (arg_index = 1; arg_index < argc; arg_index++) {
@@ -746,6 +10060,24 @@ int main(int argc, const char* argv[]) {
         } else if (strcmp(arg, "-v") == 0 || strcmp(arg, "--version") == 0) {
             version();
             return 0;
+        } else if (strcmp(arg, "-i") == 0) {
+            interactive = 1;
+        } else if (strcmp(arg, "--compile") == 0 && arg_index + 1 < argc) {
+            output_name = argv[++arg_index];
+        } else if (strcmp(arg, "--bench") == 0 && arg_index + 1 < argc) {
+            bench_runs = atoi(argv[++arg_index]);
+            if (bench_runs <= 0) {
+                printf("Invalid run count: %s\n", argv[arg_index]);
+                return 1;
+            }
+#if DYSL_PROFILE_PAIRS
+        } else if (strcmp(arg, "--pairs") == 0) {
+            show_pairs = 1;
+#endif /* DYSL_PROFILE_PAIRS */
+#if DYSL_PROFILE
+        } else if (strcmp(arg, "--profile") == 0 && arg_index + 1 < argc) {
+            profile_name = argv[++arg_index];
+#endif /* DYSL_PROFILE */
         } else if (arg[0] == '-') {
             printf("Unknown option: %s\n", arg);
             usage(program_name);
@@ -759,32 +10091,731 @@ int main(int argc, const char* argv[]) {
     if (arg_index < argc) {
         file_name = argv[arg_index];
     }
-    // temporarily: fail if no script file is provided
-    // TODO: REPL
-    if (file_name == NULL) {
+    // without one, scripts are read from the standard input
+    if (file_name == NULL && (output_name != NULL || bench_runs > 0)) {
         printf("No script file provided.\n");
         usage(program_name);
         return 1;
     }
+    size_t length = 0;
+    char* source = NULL;
+    int mapped = 0;
+    if (file_name != NULL) {
+        // map the file when possible, images then load without copying
+        source = (char*)map_file(file_name, &length);
+        mapped = source != NULL;
+        if (!mapped)
+            source = read_file(file_name, &length);
+        if (source == NULL) {
+            printf("Failed to read script file: %s\n", file_name);
+            return 1;
+        }
+    }
+    if (bench_runs > 0) {
+        int status = bench(file_name, source, length, bench_runs);
+        release_file(source, length, mapped);
+        return status == DYSL_OK ? 0 : 1;
+    }
     struct dysl* dysl = dysl_new(dysl_standard_allocator());
     if (dysl == NULL) {
         printf("Failed to create dysl interpreter.\n");
+        release_file(source, length, mapped);
         return 1;
     }
-
+    dysl_open_modules(dysl);
+#if DYSL_PROFILE
+    // ten thousand samples per second of processor time
+    if (profile_name != NULL)
+        dysl_profile_start(dysl, profile_clock, NULL,
+                           (uint64_t)(CLOCKS_PER_SEC / 10000));
+#endif /* DYSL_PROFILE */
+    int status;
+    if (output_name != NULL) {
+        FILE* output = fopen(output_name, "wb");
+        if (output == NULL) {
+            printf("Failed to open output file: %s\n", output_name);
+            status = DYSL_ERROR_IMAGE;
+        } else {
+            status = dysl_dump(dysl, source, length, write_file, output);
+            if (fclose(output) != 0 && status == DYSL_OK)
+                status = DYSL_ERROR_IMAGE;
+        }
+    } else if (file_name == NULL) {
+        // pipes are streamed, terminals get a REPL
+        status = interactive
+            ? repl(dysl, terminal)
+            : dysl_run_reader(dysl, read_stream, stdin, 0);
+        file_name = "stdin";
+    } else {
+        status = run_source(dysl, source, length);
+    }
+    if (status != DYSL_OK && dysl_error_message(dysl)[0] != '\0')
+        fprintf(stderr, "%s: %s\n", file_name, dysl_error_message(dysl));
+    if (show_pairs) {
+        struct dysl_pair_count pairs[20];
+        size_t count = dysl_hot_pairs(dysl, pairs, 20);
+        fprintf(stderr, "hottest instruction pairs:\n");
+        for (size_t p = 0; p < count; p++)
+            fprintf(stderr, "%14llu  %s %s\n",
+                    (unsigned long long)pairs[p].count,
+                    pairs[p].first, pairs[p].second);
+    }
+#if DYSL_PROFILE
+    if (profile_name != NULL)
+        write_profile(dysl, profile_name);
+#endif /* DYSL_PROFILE */
     dysl_destroy(dysl);
-    return 0;
+    release_file(source, length, mapped);
+    return status == DYSL_OK ? 0 : 1;
+}
+
+void* map_file(const char* file_name, size_t* length) {
+#if DYSL_CLI_MMAP
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat info;
+    void* data = NULL;
+    // empty files cannot be mapped, they are read instead
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+            data = NULL;
+        else
+            *length = (size_t)info.st_size;
+    }
+    close(fd);
+    return data;
+#else
+    (void)file_name; // unused
+    (void)length; // unused
+    return NULL;
+#endif /* DYSL_CLI_MMAP */
+}
+
+/** Frees what `map_file()` mapped, or `read_file()` read when `mapped` is
+ * not set. */
+void release_file(char* source, size_t length, int mapped) {
+#if DYSL_CLI_MMAP
+    if (mapped) {
+        munmap(source, length);
+        return;
+    }
+#else
+    (void)length; // unused
+    (void)mapped; // unused
+#endif /* DYSL_CLI_MMAP */
+    free(source);
+}
+
+int write_file(void* user_data, const void* data, size_t size) {
+    return fwrite(data, 1, size, (FILE*)user_data) == size ? 0 : 1;
+}
+
+/** Runs a script, or the image it was compiled to. */
+int run_source(struct dysl* dysl, const char* source, size_t length) {
+    if (dysl_is_image(source, length))
+        return dysl_run_image(dysl, source, length);
+    return dysl_run(dysl, source, length);
+}
+
+/** Reads a script piped into the interpreter, a chunk at a time. */
+const char* read_stream(void* user_data, size_t* length) {
+    static char chunk[4096];
+    *length = fread(chunk, 1, sizeof(chunk), (FILE*)user_data);
+    return chunk;
+}
+
+/** The lines typed for a REPL entry, given to the compiler one by one. */
+struct repl_entry {
+    char* text;
+    size_t length, capacity;
+    size_t read;  /*< Bytes already given to the compiler. */
+};
+
+const char* read_entry(void* user_data, size_t* length);
+int read_line(struct repl_entry* entry, const char* prompt);
+
+const char* read_entry(void* user_data, size_t* length) {
+    struct repl_entry* entry = (struct repl_entry*)user_data;
+    const char* line = entry->text + entry->read;
+    const char* newline = (const char*)memchr(line, '\n',
+                                              entry->length - entry->read);
+    *length = newline != NULL
+        ? (size_t)(newline - line) + 1
+        : entry->length - entry->read;
+    entry->read += *length;
+    return line;
+}
+
+/** Appends a line of the standard input to the entry, prompting for it
+ * unless `prompt` is NULL. Returns 0 once the input ends. */
+int read_line(struct repl_entry* entry, const char* prompt) {
+    if (prompt != NULL) {
+        fputs(prompt, stdout);
+        fflush(stdout);
+    }
+    size_t start = entry->length;
+    int ch;
+    while ((ch = getchar()) != EOF) {
+        if (entry->length == entry->capacity) {
+            size_t capacity = entry->capacity == 0 ? 256 : entry->capacity * 2;
+            char* text = (char*)realloc(entry->text, capacity);
+            if (text == NULL)
+                return 0;
+            entry->text = text;
+            entry->capacity = capacity;
+        }
+        entry->text[entry->length++] = (char)ch;
+        if (ch == '\n')
+            break;
+    }
+    return entry->length > start;
+}
+
+/** Runs each entry typed once it compiles, keeping its bindings for the
+ * next ones. An entry ending inside a block or string goes on with the
+ * next line. Errors are reported as they happen. */
+int repl(struct dysl* dysl, int prompt) {
+    struct repl_entry entry = { NULL, 0, 0, 0 };
+    while (read_line(&entry, !prompt ? NULL
+                                    : entry.length == 0 ? "> " : "... ")) {
+        entry.read = 0;
+        int status = dysl_run_reader(dysl, read_entry, &entry, 1);
+        if (status != DYSL_OK && dysl_is_incomplete(dysl))
+            continue;
+        if (status != DYSL_OK)
+            fprintf(stderr, "%s\n", dysl_error_message(dysl));
+        entry.length = 0;
+    }
+    // an unfinished entry still gets its error
+    if (entry.length != 0)
+        fprintf(stderr, "%s\n", dysl_error_message(dysl));
+    if (prompt)
+        putchar('\n');
+    free(entry.text);
+    return DYSL_OK;
+}
+
+/** Returns the time, in microseconds. */
+uint64_t wall_clock(void* user_data) {
+    (void)user_data; // unused
+#if DYSL_CLI_MMAP
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_usec;
+#else
+    // processor time is the best the standard library offers
+    return (uint64_t)((double)clock() * 1000000.0 / CLOCKS_PER_SEC);
+#endif /* DYSL_CLI_MMAP */
+}
+
+/** Random bits for the contexts' hash seeds. They are read from
+ * `/dev/urandom` once, when there is one, and told apart by a count. */
+uint64_t cli_random_seed(void) {
+    static uint64_t bits = 0, count = 0;
+    if (count++ == 0) {
+        FILE* random = fopen("/dev/urandom", "rb");
+        if (random == NULL || fread(&bits, sizeof(bits), 1, random) != 1)
+            bits = wall_clock(NULL);
+        if (random != NULL)
+            fclose(random);
+    }
+    return bits + count * 0x9E3779B97F4A7C15ull;
+}
+
+/** Runs a script `runs` times in fresh contexts, then `runs` times in one
+ * reused context, and reports the times of both. */
+int bench(const char* file_name, const char* source, size_t length, int runs) {
+    uint64_t* times = (uint64_t*)malloc(sizeof(uint64_t) * 4 * (size_t)runs);
+    if (times == NULL) {
+        printf("Failed to allocate benchmark results.\n");
+        return DYSL_ERROR_MEMORY;
+    }
+    uint64_t* wall = times;
+    uint64_t* gc = times + runs;
+    int status = DYSL_OK;
+    // fresh contexts count creating them and opening the modules
+    for (int run = 0; run < runs && status == DYSL_OK; run++) {
+        uint64_t start = wall_clock(NULL);
+        struct dysl* dysl = dysl_new(dysl_standard_allocator());
+        if (dysl == NULL) {
+            printf("Failed to create dysl interpreter.\n");
+            status = DYSL_ERROR_MEMORY;
+            break;
+        }
+        dysl_set_gc_clock(dysl, wall_clock, NULL);
+        dysl_open_modules(dysl);
+        status = run_source(dysl, source, length);
+        struct dysl_memstats stats;
+        dysl_memstats(dysl, &stats);
+        wall[run] = wall_clock(NULL) - start;
+        gc[run] = stats.gc_time;
+        if (status != DYSL_OK)
+            fprintf(stderr, "%s: %s\n", file_name, dysl_error_message(dysl));
+        dysl_destroy(dysl);
+    }
+    if (status == DYSL_OK) {
+        report_runs("fresh", wall, gc, runs);
+        wall = times + 2 * runs;
+        gc = times + 3 * runs;
+        struct dysl* dysl = dysl_new(dysl_standard_allocator());
+        if (dysl == NULL) {
+            printf("Failed to create dysl interpreter.\n");
+            status = DYSL_ERROR_MEMORY;
+        } else {
+            dysl_set_gc_clock(dysl, wall_clock, NULL);
+            dysl_open_modules(dysl);
+        }
+        for (int run = 0; run < runs && status == DYSL_OK; run++) {
+            struct dysl_memstats before, after;
+            dysl_memstats(dysl, &before);
+            uint64_t start = wall_clock(NULL);
+            status = run_source(dysl, source, length);
+            wall[run] = wall_clock(NULL) - start;
+            dysl_memstats(dysl, &after);
+            gc[run] = after.gc_time - before.gc_time;
+            // leftovers would pile up over the runs
+            dysl_pop(dysl, dysl_get_top(dysl));
+            if (status != DYSL_OK)
+                fprintf(stderr, "%s: %s\n", file_name,
+                        dysl_error_message(dysl));
+        }
+        if (status == DYSL_OK)
+            report_runs("reused", wall, gc, runs);
+        if (dysl != NULL)
+            dysl_destroy(dysl);
+    }
+    free(times);
+    return status;
+}
+
+/** Sorts a few run times, in place. */
+void sort_times(uint64_t* times, int count) {
+    for (int i = 1; i < count; i++) {
+        uint64_t time = times[i];
+        int at = i;
+        for (; at > 0 && times[at - 1] > time; at--)
+            times[at] = times[at - 1];
+        times[at] = time;
+    }
+}
+
+void report_runs(const char* mode, uint64_t* wall, uint64_t* gc, int runs) {
+    sort_times(wall, runs);
+    sort_times(gc, runs);
+    // nearest rank, the slowest run until there are a hundred
+    int p99 = (runs * 99 + 99) / 100 - 1;
+    fprintf(stderr, "%-6s %5d runs  wall ms: min %9.3f  median %9.3f  "
+            "p99 %9.3f  gc ms: min %9.3f  median %9.3f  p99 %9.3f\n",
+            mode, runs, wall[0] / 1000.0, wall[runs / 2] / 1000.0,
+            wall[p99] / 1000.0, gc[0] / 1000.0, gc[runs / 2] / 1000.0,
+            gc[p99] / 1000.0);
+}
+
+#if DYSL_PROFILE
+uint64_t profile_clock(void* user_data) {
+    (void)user_data; // unused
+    return (uint64_t)clock();
+}
+
+void write_profile(struct dysl* dysl, const char* profile_name) {
+    dysl_profile_stop(dysl);
+    FILE* output = fopen(profile_name, "wb");
+    int status = output != NULL
+        ? dysl_profile_dump(dysl, write_file, output)
+        : DYSL_ERROR_IMAGE;
+    if (output == NULL || fclose(output) != 0 || status != DYSL_OK)
+        fprintf(stderr, "Failed to write profile: %s\n", profile_name);
+    struct dysl_profile_entry entries[20];
+    size_t count = dysl_profile_entries(dysl, entries, 20);
+    fprintf(stderr, "%12s %10s %12s  %s\n", "calls", "self ms", "allocations",
+            "word");
+    for (size_t e = 0; e < count; e++)
+        fprintf(stderr, "%12llu %10.1f %12llu  %s\n",
+                (unsigned long long)entries[e].calls,
+                (double)entries[e].self_time * 1000.0 / CLOCKS_PER_SEC,
+                (unsigned long long)entries[e].allocations, entries[e].name);
+}
+#endif /* DYSL_PROFILE */
+
+char* read_file(const char* file_name, size_t* length) {
+    FILE* file = fopen(file_name, "rb");
+    if (file == NULL)
+        return NULL;
+    size_t capacity = 4096, size = 0, n;
+    char* data = (char*)malloc(capacity);
+    while (data != NULL &&
+           (n = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += n;
+        if (size == capacity) {
+            char* grown = (char*)realloc(data, capacity * 2);
+            if (grown == NULL) {
+                free(data);
+                data = NULL;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+    fclose(file);
+    *length = size;
+    return data;
 }
 
 void usage(const char* program_name) {
     printf("Usage: %s [options] [script]\n", program_name);
+    printf("Without a script, runs the standard input or starts a REPL.\n");
     printf("Options:\n");
     printf("  -h, --help      Show this help message and exit\n");
     printf("  -v, --version   Show version information and exit\n");
+    printf("  -i              Start the REPL even if the input is not a "
+           "terminal\n");
+    printf("  --compile FILE  Write the script's bytecode image to FILE\n");
+    printf("  --bench N       Time N runs in fresh and in reused contexts\n");
+#if DYSL_PROFILE_PAIRS
+    printf("  --pairs         Report the hottest instruction pairs on exit\n");
+#endif /* DYSL_PROFILE_PAIRS */
+#if DYSL_PROFILE
+    printf("  --profile FILE  Write folded stacks to FILE, report hot words\n");
+#endif /* DYSL_PROFILE */
 }
 
 void version(void) {
     printf("dysl version %s\n", DYSL_VERSION_STRING);
 }
 #endif /* DYSL_CLI */
+
+#ifdef DYSL_BENCH
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* Micro-benchmarks of the runtime's hot paths, one result per line:
+ *
+ *     benchmark  ops  ns/op  allocs/op  bytes/op
+ *
+ * separated by tabs. Allocations are the calls reaching the standard
+ * allocator that allocate or resize, bytes are what they grew by. */
+
+/** Counts what reaches the standard allocator. */
+struct bench_counter {
+    size_t allocations;
+    size_t bytes;
+};
+/** A benchmark being timed. */
+struct bench {
+    struct bench_counter* counter;
+    size_t allocations, bytes;
+    clock_t start;
+};
+
+void* bench_allocate(void* ud, void* ptr, size_t old_size, size_t new_size);
+void bench_begin(struct bench* bench, struct bench_counter* counter);
+void bench_end(
+    struct bench* bench,
+    const char* name,
+    size_t size,
+    size_t ops
+);
+size_t bench_name(char* buf, size_t index);
+void bench_intern(size_t count);
+void bench_string_create(size_t length);
+void bench_hash(size_t length);
+void bench_mem_copy(size_t length);
+void bench_gc_create(size_t length);
+void bench_native_call(size_t count);
+
+/** Keeps results alive, so the work is not optimized away. */
+volatile uint64_t bench_sink;
+
+int main(int argc, const char* argv[]) {
+    size_t max_symbols = 10000000;
+    if (argc == 2 && strcmp(argv[1], "--quick") == 0) {
+        max_symbols = 100000;
+    } else if (argc > 1) {
+        printf("Usage: %s [--quick]\n", argv[0]);
+        return 1;
+    }
+    printf("benchmark\tops\tns/op\tallocs/op\tbytes/op\n");
+    for (size_t count = 1000; count <= max_symbols; count *= 100)
+        bench_intern(count);
+    static const size_t string_lengths[] = {8, 64, 1024};
+    for (size_t l = 0; l < sizeof(string_lengths) / sizeof(size_t); l++)
+        bench_string_create(string_lengths[l]);
+    static const size_t hash_lengths[] = {4, 16, 64, 256, 4096};
+    for (size_t l = 0; l < sizeof(hash_lengths) / sizeof(size_t); l++)
+        bench_hash(hash_lengths[l]);
+    static const size_t copy_lengths[] = {16, 256, 4096, 65536};
+    for (size_t l = 0; l < sizeof(copy_lengths) / sizeof(size_t); l++)
+        bench_mem_copy(copy_lengths[l]);
+    // the largest is past the slabs, then served as the heap ones
+    static const size_t object_lengths[] = {16, 64, 200, 1024};
+    for (size_t l = 0; l < sizeof(object_lengths) / sizeof(size_t); l++)
+        bench_gc_create(object_lengths[l]);
+    bench_native_call(1000000);
+    return 0;
+}
+
+void* bench_allocate(void* ud, void* ptr, size_t old_size, size_t new_size) {
+    struct bench_counter* counter = (struct bench_counter*)ud;
+    if (new_size > 0)
+        counter->allocations++;
+    if (new_size > old_size)
+        counter->bytes += new_size - old_size;
+    return dysl_stdlib_allocator_fn(NULL, ptr, old_size, new_size);
+}
+
+void bench_begin(struct bench* bench, struct bench_counter* counter) {
+    bench->counter = counter;
+    bench->allocations = counter->allocations;
+    bench->bytes = counter->bytes;
+    bench->start = clock();
+}
+
+void bench_end(
+    struct bench* bench,
+    const char* name,
+    size_t size,
+    size_t ops
+) {
+    double elapsed = (double)(clock() - bench->start) / CLOCKS_PER_SEC;
+    double count = ops > 0 ? (double)ops : 1.0;
+    printf("%s/%zu\t%zu\t%.2f\t%.3f\t%.1f\n", name, size, ops,
+           elapsed * 1e9 / count,
+           (double)(bench->counter->allocations - bench->allocations) / count,
+           (double)(bench->counter->bytes - bench->bytes) / count);
+    fflush(stdout);
+}
+
+/** Writes the `index`th symbol name, returns its length. */
+size_t bench_name(char* buf, size_t index) {
+    buf[0] = 's';
+    return 1 + dU_format_integer(buf + 1, (int64_t)index);
+}
+
+void bench_intern(size_t count) {
+    struct bench_counter counter = {0, 0};
+    struct dysl_allocator allocator = {&counter, bench_allocate};
+    struct dy_gc gc;
+    dGC_init(&gc, allocator);
+    struct dy_symbols symbols;
+    dSymbols_init(&symbols, DYSL_SYMBOLS_INITIAL_CAPACITY, &allocator);
+    uint64_t seed = dHash_seed(DYSL_HASH_SEED);
+    // names are formatted in both passes, so only the lookups differ
+    struct bench bench;
+    bench_begin(&bench, &counter);
+    size_t interned = 0;
+    for (; interned < count; interned++) {
+        char name[24];
+        size_t length = bench_name(name, interned);
+        dy_hash_t hash = dHash_slice(seed, name, length);
+        struct dy_symbol_entry* slot = dSymbols_intern(
+            &symbols, name, length, hash, &allocator
+        );
+        if (slot == NULL)
+            break;
+        struct dy_symbol* sym = dSymbol_create(&gc, name, length, hash);
+        if (sym == NULL) {
+            symbols.count--;
+            break;
+        }
+        slot->hash = hash;
+        slot->object = &sym->header;
+    }
+    bench_end(&bench, "intern_new", count, interned);
+    bench_begin(&bench, &counter);
+    for (size_t i = 0; i < interned; i++) {
+        char name[24];
+        size_t length = bench_name(name, i);
+        dy_hash_t hash = dHash_slice(seed, name, length);
+        struct dy_symbol_entry* slot = dSymbols_intern(
+            &symbols, name, length, hash, &allocator
+        );
+        bench_sink += (uint64_t)(uintptr_t)slot->object;
+    }
+    bench_end(&bench, "intern_hit", count, interned);
+    dSymbols_destroy(&symbols, &allocator);
+    dGC_destroy(&gc);
+}
+
+void bench_string_create(size_t length) {
+    struct bench_counter counter = {0, 0};
+    struct dysl_allocator allocator = {&counter, bench_allocate};
+    struct dy_gc gc;
+    dGC_init(&gc, allocator);
+    char* data = (char*)dAlloc_alloc(&allocator, length);
+    if (data == NULL)
+        return;
+    memset(data, 'x', length);
+    // about 64MB of strings, all alive until the collector is destroyed
+    size_t count = dU_min((size_t)1 << 20, ((size_t)64 << 20) / length);
+    struct bench bench;
+    bench_begin(&bench, &counter);
+    size_t created = 0;
+    for (; created < count; created++) {
+        if (dString_create(&gc, data, length) == NULL)
+            break;
+    }
+    bench_end(&bench, "string_create", length, created);
+    dAlloc_free(&allocator, data, length);
+    dGC_destroy(&gc);
+}
+
+void bench_hash(size_t length) {
+    struct bench_counter counter = {0, 0};
+    struct dysl_allocator allocator = {&counter, bench_allocate};
+    char* data = (char*)dAlloc_alloc(&allocator, length);
+    if (data == NULL)
+        return;
+    for (size_t i = 0; i < length; i++)
+        data[i] = (char)('a' + i % 26);
+    size_t count = dU_max((size_t)1 << 20, ((size_t)256 << 20) / length);
+    // chaining the seeds keeps iterations from overlapping
+    uint64_t hash = dHash_seed(DYSL_HASH_SEED);
+    struct bench bench;
+    bench_begin(&bench, &counter);
+    for (size_t i = 0; i < count; i++)
+        hash = dHash_seed(dHash_slice(hash, data, length));
+    bench_end(&bench, "hash_slice", length, count);
+    bench_sink += hash;
+    dAlloc_free(&allocator, data, length);
+}
+
+/** Copies `length` bytes, which must be a power of two. */
+void bench_mem_copy(size_t length) {
+    struct bench_counter counter = {0, 0};
+    struct dysl_allocator allocator = {&counter, bench_allocate};
+    char* source = (char*)dAlloc_alloc(&allocator, length);
+    char* dest = (char*)dAlloc_alloc(&allocator, length);
+    if (source == NULL || dest == NULL) {
+        if (source != NULL)
+            dAlloc_free(&allocator, source, length);
+        if (dest != NULL)
+            dAlloc_free(&allocator, dest, length);
+        return;
+    }
+    memset(source, 'x', length);
+    size_t count = dU_max((size_t)1 << 10, ((size_t)1 << 30) / length);
+    // `length` is a power of two, masking picks the touched bytes
+    size_t mask = length - 1;
+    struct bench bench;
+    bench_begin(&bench, &counter);
+    for (size_t i = 0; i < count; i++) {
+        source[i & mask] = (char)i;
+        dMem_copy(dest, source, length);
+        bench_sink += (uint64_t)dest[(i * 7) & mask];
+    }
+    bench_end(&bench, "mem_copy", length, count);
+    dAlloc_free(&allocator, source, length);
+    dAlloc_free(&allocator, dest, length);
+}
+
+/** Strings of `length` bytes, allocated and freed in batches, through the
+ * collector and straight from the standard allocator. Build with
+ * `DYSL_SLAB_ALLOCATOR` set to 0 to have the collector skip the slabs. */
+void bench_gc_create(size_t length) {
+    enum { BATCH = 1024, ROUNDS = 4096 };
+    struct bench_counter counter = {0, 0};
+    struct dysl_allocator allocator = {&counter, bench_allocate};
+    size_t block_size = sizeof(struct dy_link) + sizeof(struct dy_string) +
+                        length + 1;
+    void* blocks[BATCH];
+    struct bench bench;
+    bench_begin(&bench, &counter);
+    for (size_t round = 0; round < ROUNDS; round++) {
+        for (size_t b = 0; b < BATCH; b++)
+            blocks[b] = dAlloc_alloc(&allocator, block_size);
+        for (size_t b = 0; b < BATCH; b++) {
+            if (blocks[b] != NULL)
+                dAlloc_free(&allocator, blocks[b], block_size);
+        }
+    }
+    bench_end(&bench, "alloc_free/malloc", length, (size_t)BATCH * ROUNDS);
+    struct dy_gc gc;
+    dGC_init(&gc, allocator);
+    struct dy_string* strings[BATCH];
+    bench_begin(&bench, &counter);
+    for (size_t round = 0; round < ROUNDS; round++) {
+        for (size_t b = 0; b < BATCH; b++)
+            strings[b] = dString_alloc(&gc, length);
+        for (size_t b = 0; b < BATCH; b++) {
+            if (strings[b] == NULL)
+                continue;
+            dObj_unlink(&strings[b]->header);
+            dGC_release(&gc, &strings[b]->header);
+        }
+    }
+    bench_end(&bench, dSlab_serves(block_size)
+                  ? "gc_create/slab"
+                  : "gc_create/malloc",
+              length, (size_t)BATCH * ROUNDS);
+    dGC_destroy(&gc);
+}
+
+/* adds wrapping, as the loops sum past INT32_MAX */
+void bench_add(struct dysl* dysl) {
+    int32_t sum = (int32_t)((uint32_t)dysl_to_integer(dysl, -2) +
+                            (uint32_t)dysl_to_integer(dysl, -1));
+    dysl_pop(dysl, 2);
+    dysl_push_integer(dysl, sum);
+}
+
+void bench_fast_add(
+    struct dysl* dysl,
+    const struct dy_value* args,
+    struct dy_value* result
+) {
+    (void)dysl;
+    *result = dysl_integer_value(
+        (int32_t)((uint32_t)dysl_value_integer(&args[0]) +
+                  (uint32_t)dysl_value_integer(&args[1]))
+    );
+}
+
+/** A loop calling a two argument native `count` times, registered both
+ * ways, then the fast one called from C in a single batch. */
+void bench_native_call(size_t count) {
+    struct bench_counter counter = {0, 0};
+    struct dysl_allocator allocator = {&counter, bench_allocate};
+    struct dysl* dysl = dysl_new(allocator);
+    if (dysl == NULL)
+        return;
+    dysl_register(dysl, "add", bench_add);
+    dysl_register_fast(dysl, "fast-add", 2, bench_fast_add);
+    static const char* const words[] = {"add", "fast-add"};
+    static const char* const names[] = {"native_call", "native_call/fast"};
+    for (size_t w = 0; w < 2; w++) {
+        char source[64];
+        int length = snprintf(source, sizeof(source), "0 1 %zu for { %s }",
+                              count, words[w]);
+        struct bench bench;
+        bench_begin(&bench, &counter);
+        if (dysl_run(dysl, source, (size_t)length) != DYSL_OK)
+            break;
+        bench_end(&bench, names[w], 2, count);
+        bench_sink += (uint64_t)dysl_to_integer(dysl, -1);
+        dysl_pop(dysl, 1);
+    }
+    struct dy_value* inputs = (struct dy_value*)dAlloc_alloc(
+        &allocator, sizeof(struct dy_value) * count * 3
+    );
+    if (inputs != NULL) {
+        struct dy_value* outputs = inputs + count * 2;
+        for (size_t i = 0; i < count; i++) {
+            inputs[i * 2] = dysl_integer_value((int32_t)i);
+            inputs[i * 2 + 1] = dysl_integer_value(1);
+        }
+        struct bench bench;
+        bench_begin(&bench, &counter);
+        if (dysl_call_batch(dysl, "fast-add", 2, inputs, count,
+                            outputs) == DYSL_OK) {
+            bench_end(&bench, "native_call/batch", 2, count);
+            bench_sink += (uint64_t)dysl_value_integer(&outputs[count - 1]);
+        }
+        dAlloc_free(&allocator, inputs, sizeof(struct dy_value) * count * 3);
+    }
+    dysl_destroy(dysl);
+}
+#endif /* DYSL_BENCH */
 #endif /* __DYSL__ */
@@ -0,0 +1,161 @@
+/* Fast natives, called by scripts and by the host, and batches of calls to
+ * every kind of word. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+static void sum_of_squares(
+    struct dysl* dysl,
+    const struct dy_value* args,
+    struct dy_value* result
+) {
+    if (dysl_value_type(&args[0]) != DYSL_TYPE_INTEGER ||
+        dysl_value_type(&args[1]) != DYSL_TYPE_INTEGER) {
+        dysl_error(dysl, "sum-of-squares takes integers");
+        return;
+    }
+    int32_t a = dysl_value_integer(&args[0]);
+    int32_t b = dysl_value_integer(&args[1]);
+    *result = dysl_integer_value(a * a + b * b);
+}
+
+static int nothing_calls = 0;
+
+/* leaves its result nil */
+static void nothing(
+    struct dysl* dysl,
+    const struct dy_value* args,
+    struct dy_value* result
+) {
+    (void)dysl;
+    (void)args;
+    (void)result;
+    nothing_calls++;
+}
+
+static void negate(struct dysl* dysl) {
+    int32_t value = dysl_to_integer(dysl, -1);
+    dysl_pop(dysl, 1);
+    dysl_push_integer(dysl, -value);
+}
+
+struct chunk {
+    const char* source;
+    int done;
+};
+
+static const char* read_once(void* user_data, size_t* length) {
+    struct chunk* chunk = (struct chunk*)user_data;
+    if (chunk->done)
+        return NULL;
+    chunk->done = 1;
+    *length = strlen(chunk->source);
+    return chunk->source;
+}
+
+#define COUNT 100
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+    dysl_register_fast(dysl, "sum-of-squares", 2, sum_of_squares);
+    dysl_register_fast(dysl, "nothing", 0, nothing);
+    dysl_register(dysl, "negate", negate);
+
+    // from scripts, in place on the stack
+    check_run(dysl,
+        "0 1 10 for { -> let i i i 1 + sum-of-squares + } nothing", DYSL_OK);
+    check(dysl_get_top(dysl) == 2);
+    check(dysl_to_integer(dysl, 0) == 2 * 385 + 11 * 11 - 1);
+    check(dysl_type(dysl, 1) == DYSL_TYPE_NIL && nothing_calls == 1);
+    dysl_pop(dysl, 2);
+    check_run(dysl, "1 \"two\" sum-of-squares", DYSL_ERROR_RUNTIME);
+    check(strstr(dysl_error_message(dysl), "takes integers") != NULL);
+    dysl_pop(dysl, dysl_get_top(dysl));
+
+    // words kept from a script, for batches to call
+    struct chunk words = {
+        "import math\n"
+        "import serde\n"
+        "def triple do 3 * end\n"
+        "def label do serde:->string \"item number \" swap + end\n"
+        "&{ negate 1 + } -> let flip\n",
+        0
+    };
+    check(dysl_run_reader(dysl, read_once, &words, 1) == DYSL_OK);
+
+    struct dy_value inputs[2 * COUNT], outputs[COUNT];
+    for (int i = 0; i < 2 * COUNT; i++)
+        inputs[i] = dysl_integer_value(i - COUNT);
+    dysl_push_integer(dysl, 7);
+    size_t env = dysl->env.count;
+    // every kind of word, each batch twice, so the second finds it cached
+    const char* names[] = {
+        "sum-of-squares", "triple", "flip", "negate", "math:abs", "nothing",
+    };
+    const int arities[] = { 2, 1, 1, 1, 1, 0 };
+    for (int round = 0; round < 2; round++) {
+        for (int w = 0; w < 6; w++) {
+            check(dysl_call_batch(dysl, names[w], arities[w], inputs, COUNT,
+                                  outputs) == DYSL_OK);
+            int correct = 1;
+            for (int i = 0; i < COUNT; i++) {
+                int32_t a = i * arities[w] - COUNT;
+                int32_t expected[] = {
+                    a * a + (a + 1) * (a + 1), 3 * a, 1 - a, -a,
+                    a < 0 ? -a : a, 0,
+                };
+                if (w == 5)
+                    correct &= dysl_value_type(&outputs[i]) == DYSL_TYPE_NIL;
+                else
+                    correct &= dysl_value_integer(&outputs[i]) == expected[w];
+            }
+            check(correct);
+            // the stack and the environment are as they were
+            check(dysl_get_top(dysl) == 1 && dysl_to_integer(dysl, 0) == 7);
+            check(dysl->env.count == env);
+        }
+    }
+    check(nothing_calls == 1 + 2 * COUNT);
+
+    // outputs made by earlier calls outlive the later ones, and are read
+    // before the context allocates again
+    check(dysl_call_batch(dysl, "label", 1, inputs, COUNT, outputs)
+          == DYSL_OK);
+    check(dysl_get_top(dysl) == 1);
+    int labelled = 1;
+    for (int i = 0; i < COUNT; i++) {
+        char expected[32];
+        int expected_length = snprintf(expected, sizeof(expected),
+                                       "item number %d", i - COUNT);
+        size_t length = 0;
+        dysl_push_value(dysl, outputs[i]);
+        const char* text = dysl_to_string(dysl, -1, &length);
+        labelled &= text != NULL && length == (size_t)expected_length &&
+                    memcmp(text, expected, length) == 0;
+        dysl_pop(dysl, 1);
+    }
+    check(labelled);
+
+    // a failing call stops the batch, with the outputs before it written
+    struct dy_value mixed[4] = {
+        dysl_integer_value(1), dysl_integer_value(2),
+        dysl_integer_value(3), dysl_nil_value(),
+    };
+    outputs[0] = outputs[1] = dysl_nil_value();
+    check(dysl_call_batch(dysl, "sum-of-squares", 2, mixed, 2, outputs)
+          == DYSL_ERROR_RUNTIME);
+    check(dysl_value_integer(&outputs[0]) == 5);
+    check(dysl_call_batch(dysl, "triple", 1, mixed + 3, 1, outputs)
+          == DYSL_ERROR_RUNTIME);
+    check(dysl_call_batch(dysl, "no-such-word", 1, inputs, 1, outputs)
+          == DYSL_ERROR_RUNTIME);
+    check(dysl_get_top(dysl) == 1 && dysl_to_integer(dysl, 0) == 7);
+    check_run(dysl, "1 triple", DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 3);
+
+    dysl_destroy(dysl);
+    return test_done("batch");
+}
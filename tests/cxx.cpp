@@ -0,0 +1,26 @@
+/* Embeds dysl in a C++ program: the implementation must compile, and run,
+ * as C++ too. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+static void twice(struct dysl* dysl) {
+    int32_t value = dysl_to_integer(dysl, -1);
+    dysl_pop(dysl, 1);
+    dysl_push_integer(dysl, value * 2);
+}
+
+int main() {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+    dysl_register(dysl, "twice", twice);
+    check_run(dysl, "import math 20 twice -1 math:abs + 0.5 1.5e1 +", DYSL_OK);
+    check(dysl_get_top(dysl) == 2);
+    check(dysl_to_integer(dysl, 0) == 41);
+    check(dysl_to_real(dysl, 1) == 15.5);
+    check_run(dysl, "1.e5", DYSL_ERROR_SYNTAX);
+    dysl_destroy(dysl);
+    return test_done("cxx");
+}
@@ -0,0 +1,4 @@
+/* The tests' configuration: the standard library and its modules, without
+ * the CLI's `main`. Other options come from the build's flags. */
+#define DYSL_STDLIB 1
+#define DYSL_STDIO 1
@@ -0,0 +1,95 @@
+/* External strings: read in place while they live, released exactly once,
+ * and equal to the ordinary strings holding the same bytes. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+struct host_bytes {
+    const char* data;
+    int released;
+};
+
+static void release(void* user_data, const char* data, size_t length) {
+    struct host_bytes* bytes = (struct host_bytes*)user_data;
+    if (data == bytes->data && length == strlen(bytes->data))
+        bytes->released++;
+    else
+        bytes->released = -1000;
+}
+
+static void push(struct dysl* dysl, struct host_bytes* bytes) {
+    dysl_push_external_string(dysl, bytes->data, strlen(bytes->data),
+                              release, bytes);
+}
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+
+    // long strings are read in place, until they are collected
+    struct host_bytes key = { "a key held by the host, not by the context", 0 };
+    push(dysl, &key);
+    size_t length = 0;
+    check(dysl_to_string(dysl, -1, &length) == key.data);
+    check(length == strlen(key.data));
+    dysl_gc_collect(dysl);
+    check(key.released == 0);
+    dysl_pop(dysl, 1);
+    dysl_gc_collect(dysl);
+    check(key.released == 1);
+
+    // short ones are interned, so copied and released right away
+    struct host_bytes name = { "short", 0 };
+    push(dysl, &name);
+    check(name.released == 1);
+    check(dysl_to_string(dysl, -1, NULL) != name.data);
+    check_run(dysl, "\"short\" =", DYSL_OK);
+    check(dysl_to_boolean(dysl, -1));
+    dysl_pop(dysl, 1);
+
+    // they equal, hash and concatenate as the same bytes copied would
+    key.released = 0;
+    dysl_push_table(dysl);
+    push(dysl, &key);
+    dysl_push_integer(dysl, 42);
+    dysl_set(dysl, 0);
+    dysl_push_value(dysl, *dS_index(dysl, 0));
+    check_run(dysl,
+        "\"a key held by the host, not by the context\" .get", DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 42);
+    dysl_pop(dysl, 1);
+    push(dysl, &key);
+    check_run(dysl,
+        "dup \"a key held by the host, not by the context\" = swap "
+        "\"!\" + .len", DYSL_OK);
+    check(dysl_to_boolean(dysl, -2));
+    check(dysl_to_integer(dysl, -1) == (int32_t)strlen(key.data) + 1);
+    dysl_pop(dysl, 2);
+    // the table's key is still the host's, the other copy is released
+    dysl_gc_collect(dysl);
+    check(key.released == 1);
+    dysl_pop(dysl, 1);
+    dysl_gc_collect(dysl);
+    check(key.released == 2);
+
+    // a NULL release is never called, destroying releases the rest
+    dysl_push_external_string(dysl, key.data, strlen(key.data), NULL, NULL);
+    check(dysl_to_string(dysl, -1, NULL) == key.data);
+    key.released = 0;
+    push(dysl, &key);
+    dysl_destroy(dysl);
+    check(key.released == 1);
+
+    // arena contexts copy every string
+    struct dysl* arena = dysl_new_arena(dysl_standard_allocator(), 0);
+    check(arena != NULL);
+    key.released = 0;
+    push(arena, &key);
+    check(key.released == 1);
+    check(dysl_to_string(arena, -1, &length) != key.data);
+    check(length == strlen(key.data));
+    dysl_destroy(arena);
+    check(key.released == 1);
+    return test_done("external");
+}
@@ -0,0 +1,192 @@
+/* Runs scripts and C API calls under a collector that never stops: tiny
+ * thresholds make every few allocations a step, and minor and major cycles
+ * overlap the code that mutates what they scan. Slabs are off, so that
+ * `make test`'s AddressSanitizer sees each object freed early on its own. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_GC_MINOR_BYTES 256
+#define DYSL_GC_MAJOR_PERCENT 110
+#define DYSL_GC_MAJOR_MIN_BYTES 1024
+#define DYSL_GC_STEP_BUDGET 4
+#define DYSL_GC_STEP_BYTES 64
+#define DYSL_SLAB_ALLOCATOR 0
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+/* old tables and arrays made to point at young values, strings built and
+ * dropped, words rebound as they run */
+static const char* churn =
+    "import string\n"
+    "import serde\n"
+    "def make do -> let id\n"
+    "  table { :id id :name \"record\" :tags array { id id 1 + } }\n"
+    "end\n"
+    "array { } -> let records\n"
+    "1 300 for { -> let i records i make .push }\n"
+    "1 20 for { -> let round\n"
+    "  1 records .len for { -> let i\n"
+    "    records i .get -> let record\n"
+    "    record :tags .get round .push\n"
+    "    record :name \"record \" i serde:->string + .set\n"
+    "    i 7 % 0 = if { records i i make .set }\n"
+    "  }\n"
+    "}\n"
+    "string:builder -> let b\n"
+    "0 -> let total\n"
+    "1 records .len for { -> let i\n"
+    "  records i .get -> let record\n"
+    "  total record :tags .get .len + -> total\n"
+    "  b record :name .get .push\n"
+    "}\n"
+    "total b .len +\n";
+
+static const char* long_value =
+    "a value far too long for it to be interned as short";
+
+/* a native that allocates while its arguments are only on the stack */
+static void pair(struct dysl* dysl) {
+    dysl_push_table(dysl);
+    for (int k = 0; k < 8; k++) {
+        dysl_push_integer(dysl, k);
+        dysl_push_string(dysl, long_value, strlen(long_value));
+        dysl_set(dysl, -3);
+    }
+    dysl_push_symbol(dysl, "left", 4);
+    dysl_push_value(dysl, *dS_index(dysl, -4));
+    dysl_set(dysl, -3);
+    dysl_push_symbol(dysl, "right", 5);
+    dysl_push_value(dysl, *dS_index(dysl, -3));
+    dysl_set(dysl, -3);
+    // leaves only the pair
+    struct dy_value table = *dS_index(dysl, -1);
+    dysl_pop(dysl, 3);
+    dysl_push_value(dysl, table);
+}
+
+/* a native returning a string made anew, too long to be interned */
+static void fresh(struct dysl* dysl) {
+    int32_t k = dysl_to_integer(dysl, -1);
+    dysl_pop(dysl, 1);
+    char text[64];
+    int length = snprintf(text, sizeof(text),
+                          "fresh string number %d, not interned", (int)k);
+    dysl_push_string(dysl, text, (size_t)length);
+}
+
+static int32_t run_integer(struct dysl* dysl, const char* source) {
+    if (dysl_run(dysl, source, strlen(source)) != DYSL_OK) {
+        printf("%s\n", dysl_error_message(dysl));
+        return -1;
+    }
+    int32_t result = dysl_to_integer(dysl, -1);
+    dysl_pop(dysl, 1);
+    return result;
+}
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+    dysl_register(dysl, "pair", pair);
+    dysl_register(dysl, "fresh", fresh);
+
+    // every 7th record is made anew in each round, the others get a tag
+    // per round and their number in their name
+    int32_t expected = 0;
+    for (int r = 1; r <= 300; r++) {
+        if (r % 7 == 0)
+            expected += 2 + 6;
+        else
+            expected += 22 + (r < 10 ? 8 : r < 100 ? 9 : 10);
+    }
+    uint32_t cycles = dS_gc(dysl)->cycle;
+    for (int run = 0; run < 3; run++)
+        check(run_integer(dysl, churn) == expected);
+    check(dS_gc(dysl)->cycle - cycles >= 30);
+
+    check(run_integer(dysl,
+        "array { } -> let pairs\n"
+        "1 200 for { -> let i pairs i \"x\" pair .push }\n"
+        "0 -> let total\n"
+        "1 pairs .len for { -> let i\n"
+        "  total pairs i .get :left .get + -> total\n"
+        "  pairs i .get 7 .get .len total + -> total\n"
+        "}\n"
+        "total") == 200 * 201 / 2 + 200 * (int32_t)strlen(long_value));
+
+    // the host stores young values into an old table between steps
+    dysl_push_table(dysl);
+    dysl_gc_collect(dysl);
+    for (int k = 1; k <= 500; k++) {
+        char text[64];
+        int length = snprintf(text, sizeof(text),
+                              "value number %d, which is not interned", k);
+        dysl_push_integer(dysl, k);
+        dysl_push_string(dysl, text, (size_t)length);
+        dysl_set(dysl, 0);
+        dysl_gc_step(dysl, 1);
+    }
+    while (!dysl_gc_step(dysl, 16)) {
+    }
+    check(dysl_length(dysl, 0) == 500);
+    int intact = 1;
+    for (int k = 1; k <= 500; k++) {
+        char text[64];
+        int length = snprintf(text, sizeof(text),
+                              "value number %d, which is not interned", k);
+        size_t got_length = 0;
+        dysl_push_integer(dysl, k);
+        dysl_get(dysl, 0);
+        const char* got = dysl_to_string(dysl, -1, &got_length);
+        intact &= got != NULL && got_length == (size_t)length &&
+                  memcmp(got, text, got_length) == 0;
+        dysl_pop(dysl, 1);
+    }
+    check(intact);
+    dysl_pop(dysl, 1);
+
+    // a batch's outputs live through the steps its later calls take
+    struct dy_value inputs[200], outputs[200];
+    for (int k = 0; k < 200; k++)
+        inputs[k] = dysl_integer_value(k);
+    check(dysl_call_batch(dysl, "fresh", 1, inputs, 200, outputs) == DYSL_OK);
+    check(dysl_get_top(dysl) == 0);
+    intact = 1;
+    for (int k = 0; k < 200; k++) {
+        char text[64];
+        int length = snprintf(text, sizeof(text),
+                              "fresh string number %d, not interned", k);
+        size_t got_length = 0;
+        dysl_push_value(dysl, outputs[k]);
+        const char* got = dysl_to_string(dysl, -1, &got_length);
+        intact &= got != NULL && got_length == (size_t)length &&
+                  memcmp(got, text, got_length) == 0;
+        dysl_pop(dysl, 1);
+    }
+    check(intact);
+
+    // everything dropped is freed, down to what the first run left
+    dysl_gc_collect(dysl);
+    struct dysl_memstats before, after;
+    dysl_memstats(dysl, &before);
+    check(run_integer(dysl, churn) == expected);
+    dysl_gc_collect(dysl);
+    dysl_memstats(dysl, &after);
+    check(after.bytes <= before.bytes);
+
+    // out of memory is an error, after which the context still runs
+    dysl_set_memory_limit(dysl, before.bytes + 64 * 1024);
+    check_run(dysl,
+        "import serde\n"
+        "array { } -> let all\n"
+        "loop { all \"ab\" all .len serde:->string + .push }",
+        DYSL_ERROR_MEMORY);
+    dysl_pop(dysl, dysl_get_top(dysl));
+    dysl_gc_collect(dysl);
+    check(run_integer(dysl, "1 100 for { -> let i table { :i i } drop } 7")
+          == 7);
+    dysl_set_memory_limit(dysl, 0);
+
+    dysl_destroy(dysl);
+    return test_done("gc");
+}
@@ -0,0 +1,230 @@
+/* Bytecode images: dumped in one context, run in others with other hash
+ * seeds, and rejected when truncated or damaged rather than read past,
+ * whether in their structure or in the operands of their code. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+struct buffer {
+    char* data;
+    size_t size, capacity;
+    size_t fail_after; /*< Fails writes past this many bytes, if not 0. */
+};
+
+static int write_buffer(void* user_data, const void* data, size_t size) {
+    struct buffer* buffer = (struct buffer*)user_data;
+    if (buffer->fail_after != 0 && buffer->size + size > buffer->fail_after)
+        return 1;
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? 256 : buffer->capacity;
+        while (capacity < buffer->size + size)
+            capacity *= 2;
+        char* grown = (char*)realloc(buffer->data, capacity);
+        if (grown == NULL)
+            return 1;
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return 0;
+}
+
+/* words, blocks, procs, loops, every constant type and module words */
+static const char* script =
+    "import math\n"
+    "import string\n"
+    "def square do dup * end\n"
+    "def twice do yield yield end\n"
+    "&{ 3 + } -> let add3\n"
+    "0 -> let total\n"
+    "1 10 for { -> let i total i square + -> total }\n"
+    "total twice { 2 * } -> total\n"
+    "table { :name \"a string long enough not to be interned as short\" "
+    ":short \"ab\" :real 2.5 :list array { 1 2 3 } } -> let t\n"
+    "string:builder -> let b b t :short .get .push b :sym .push\n"
+    "total add3 .call\n"
+    "t :real .get 2 * math:floor\n"
+    "t :name .get .len\n"
+    "b .len\n"
+    "t :list .get 3 .get\n";
+
+static void check_results(struct dysl* dysl) {
+    check(dysl_get_top(dysl) == 5);
+    check(dysl_to_integer(dysl, 0) == 385 * 4 + 3);
+    check(dysl_to_integer(dysl, 1) == 5);
+    check(dysl_to_integer(dysl, 2) == 48);
+    check(dysl_to_integer(dysl, 3) == 5);
+    check(dysl_to_integer(dysl, 4) == 3);
+}
+
+static uint32_t read_word(const struct buffer* image, size_t at) {
+    uint32_t word;
+    memcpy(&word, image->data + at * sizeof(word), sizeof(word));
+    return word;
+}
+
+/* returns where the main procedure's code starts, in words: it is the last
+ * procedure, after the symbols and every other procedure */
+static size_t main_code(const struct buffer* image) {
+    size_t at = DYSL_IMAGE_HEADER_WORDS;
+    uint32_t symbol_count = read_word(image, 4);
+    uint32_t proc_count = read_word(image, 5);
+    for (uint32_t s = 0; s < symbol_count; s++)
+        at += 2 + (read_word(image, at + 1) + 3) / 4;
+    for (uint32_t p = 0; p + 1 < proc_count; p++) {
+        uint32_t code_size = read_word(image, at + 1);
+        uint32_t constant_count = read_word(image, at + 2);
+        // code and lines
+        at += 4 + 2 * (size_t)code_size;
+        for (uint32_t k = 0; k < constant_count; k++) {
+            uint32_t kind = read_word(image, at++);
+            if (kind == DYSL_TYPE_STRING)
+                at += 1 + (read_word(image, at) + 3) / 4;
+            else if (kind == DYSL_TYPE_REAL)
+                at += 2;
+            else
+                at += 1;
+        }
+    }
+    return at + 4;
+}
+
+/* returns where the main procedure's first `op` instruction is, in words */
+static size_t find_op(const struct buffer* image, enum dy_opcode op) {
+    size_t at = main_code(image);
+    while (dI_op(read_word(image, at)) != op)
+        at += 1 + (size_t)dImage_has_extra(dI_op(read_word(image, at)));
+    return at;
+}
+
+/* runs a copy of just the image's size, with the word `at` replaced */
+static int run_patched(
+    struct dysl* dysl,
+    const struct buffer* image,
+    size_t at,
+    uint32_t word
+) {
+    char* copy = (char*)malloc(image->size);
+    memcpy(copy, image->data, image->size);
+    memcpy(copy + at * sizeof(word), &word, sizeof(word));
+    int status = dysl_run_image(dysl, copy, image->size);
+    free(copy);
+    dysl_pop(dysl, dysl_get_top(dysl));
+    return status;
+}
+
+static struct dysl* new_context(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+    return dysl;
+}
+
+int main(void) {
+    struct dysl* dysl = new_context();
+    check_run(dysl, script, DYSL_OK);
+    check_results(dysl);
+
+    struct buffer image = { NULL, 0, 0, 0 };
+    check(dysl_dump(dysl, script, strlen(script), write_buffer, &image)
+          == DYSL_OK);
+    check(dysl_is_image(image.data, image.size));
+    check(!dysl_is_image(script, strlen(script)));
+    dysl_destroy(dysl);
+
+    // contexts hash with their own seeds, the image's symbols are rehashed
+    for (int run = 0; run < 2; run++) {
+        dysl = new_context();
+        check(dysl_run_image(dysl, image.data, image.size) == DYSL_OK);
+        check_results(dysl);
+        // and a second run, with the symbols interned already
+        dysl_pop(dysl, dysl_get_top(dysl));
+        check(dysl_run_image(dysl, image.data, image.size) == DYSL_OK);
+        check_results(dysl);
+        dysl_destroy(dysl);
+    }
+
+    // damaged images are errors, run from a copy of just their size so
+    // that AddressSanitizer catches any read past them
+    dysl = new_context();
+    int rejected = 1;
+    for (size_t size = 0; size < image.size; size++) {
+        char* copy = (char*)malloc(size > 0 ? size : 1);
+        memcpy(copy, image.data, size);
+        rejected &= dysl_run_image(dysl, copy, size) == DYSL_ERROR_IMAGE;
+        free(copy);
+    }
+    check(rejected);
+    image.data[0] ^= 0xFF;
+    check(!dysl_is_image(image.data, image.size));
+    check(dysl_run_image(dysl, image.data, image.size) == DYSL_ERROR_IMAGE);
+    check(dysl_get_top(dysl) == 0);
+    dysl_destroy(dysl);
+
+    // operands naming what the procedure does not have are errors
+    // the string comes first, so the first constant pushed is the string
+    const char* operands =
+        "\"a string long enough not to be interned as short\" .len\n"
+        "def twice do yield yield end\n"
+        "twice { 1 + }\n"
+        "1 3 for { + }\n"
+        "true if { 1 } else { 2 }\n";
+    dysl = new_context();
+    struct buffer code = { NULL, 0, 0, 0 };
+    check(dysl_dump(dysl, operands, strlen(operands), write_buffer, &code)
+          == DYSL_OK);
+    size_t push = find_op(&code, DYSL_OP_PUSH_CONST);
+    uint32_t string = (uint32_t)dI_arg(read_word(&code, push));
+    size_t call = find_op(&code, DYSL_OP_CALL_BLOCK);
+    size_t init = find_op(&code, DYSL_OP_FOR_INIT);
+    size_t step = find_op(&code, DYSL_OP_FOR_STEP);
+    size_t jump = find_op(&code, DYSL_OP_JUMP);
+    size_t end = find_op(&code, DYSL_OP_RETURN);
+    // unchanged, it runs
+    check(run_patched(dysl, &code, push, read_word(&code, push)) == DYSL_OK);
+    const struct {
+        size_t at;
+        uint32_t word;
+    } damaged[] = {
+        { push, dI_make(DYSL_OP_PUSH_CONST, 50) },
+        { push, dI_make(DYSL_OP_PUSH_CONST, -1) },
+        { push, dI_make(DYSL_OP_COUNT, 0) },
+        // a name that is a string, a block that is a string
+        { call, dI_make(DYSL_OP_CALL_BLOCK, string) },
+        { call + 1, string },
+        { init, dI_make(DYSL_OP_FOR_INIT, 1000) },
+        // past the end, and onto its own extra word
+        { step + 1, 1000 },
+        { step + 1, (uint32_t)-1 },
+        { jump, dI_make(DYSL_OP_JUMP, -1000) },
+        // running past the end
+        { end, dI_make(DYSL_OP_NOP, 0) },
+    };
+    rejected = 1;
+    for (size_t d = 0; d < sizeof(damaged) / sizeof(*damaged); d++) {
+        rejected &= run_patched(dysl, &code, damaged[d].at, damaged[d].word)
+                    == DYSL_ERROR_IMAGE;
+    }
+    check(rejected);
+    check(run_patched(dysl, &code, push, read_word(&code, push)) == DYSL_OK);
+    dysl_destroy(dysl);
+    free(code.data);
+
+    // a failing writer aborts the dump, syntax errors are reported as such
+    dysl = new_context();
+    struct buffer failing = { NULL, 0, 0, image.size / 2 };
+    check(dysl_dump(dysl, script, strlen(script), write_buffer, &failing)
+          == DYSL_ERROR_IMAGE);
+    struct buffer unused = { NULL, 0, 0, 0 };
+    check(dysl_dump(dysl, "def broken do", 13, write_buffer, &unused)
+          == DYSL_ERROR_SYNTAX);
+    check(unused.size == 0);
+    dysl_destroy(dysl);
+
+    free(failing.data);
+    free(unused.data);
+    free(image.data);
+    return test_done("image");
+}
@@ -0,0 +1,61 @@
+/* Sources end at their length, not at a NUL byte: literals at the end are
+ * read from buffers of just their size, where AddressSanitizer catches any
+ * read past them. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+/* runs the first `length` bytes of `source` from a copy of just that size */
+static int run_bounded(struct dysl* dysl, const char* source, size_t length) {
+    char* copy = (char*)malloc(length > 0 ? length : 1);
+    memcpy(copy, source, length);
+    int status = dysl_run(dysl, copy, length);
+    free(copy);
+    return status;
+}
+
+struct real_literal {
+    const char* text;
+    double value;
+};
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+
+    // what follows the length is not part of the literal
+    check(run_bounded(dysl, "2.5e3 99", 3) == DYSL_OK);
+    check(dysl_get_top(dysl) == 1 && dysl_to_real(dysl, -1) == 2.5);
+    dysl_pop(dysl, 1);
+    check(run_bounded(dysl, "12345", 2) == DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 12);
+    dysl_pop(dysl, 1);
+    check(run_bounded(dysl, "1.5e", 3) == DYSL_OK);
+    check(dysl_to_real(dysl, -1) == 1.5);
+    dysl_pop(dysl, 1);
+
+    // reals are read exactly as the compiler would write them
+    const struct real_literal reals[] = {
+        { "0.5", 0.5 }, { "1.5", 1.5 }, { "0.1", 0.1 }, { "12.375", 12.375 },
+        { "-2.25", -2.25 }, { "3.14159", 3.14159 }, { "1e10", 1e10 },
+        { "1.5e2", 1.5e2 }, { "2.5E-3", 2.5e-3 }, { "6.02e+23", 6.02e23 },
+        { "123456789.125", 123456789.125 }, { "0.0", 0.0 }, { "0e400", 0.0 },
+        { "1e-310", 1e-310 }, { "4294967296", 4294967296.0 },
+    };
+    int exact = 1;
+    for (size_t r = 0; r < sizeof(reals) / sizeof(*reals); r++) {
+        const char* text = reals[r].text;
+        exact &= run_bounded(dysl, text, strlen(text)) == DYSL_OK &&
+                 dysl_to_real(dysl, -1) == reals[r].value;
+        dysl_pop(dysl, dysl_get_top(dysl));
+    }
+    check(exact);
+
+    // malformed literals are errors, even cut short
+    check(run_bounded(dysl, "1.e5", 4) == DYSL_ERROR_SYNTAX);
+    check(run_bounded(dysl, "1.5e+", 5) == DYSL_ERROR_SYNTAX);
+
+    dysl_destroy(dysl);
+    return test_done("lexer");
+}
@@ -0,0 +1,133 @@
+/* Scripts read in chunks of every small size must compile as they do
+ * whole, and entries a REPL reads must tell an early end from an error. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+/* hands out copies of `size` bytes, each freed when the next is asked for,
+ * so that AddressSanitizer catches reads past a chunk or kept too long */
+struct chunks {
+    const char* source;
+    size_t length, read, size;
+    char* chunk;
+};
+
+static const char* read_chunk(void* user_data, size_t* length) {
+    struct chunks* chunks = (struct chunks*)user_data;
+    free(chunks->chunk);
+    chunks->chunk = NULL;
+    *length = chunks->length - chunks->read;
+    if (*length > chunks->size)
+        *length = chunks->size;
+    if (*length == 0)
+        return NULL;
+    chunks->chunk = (char*)malloc(*length);
+    memcpy(chunks->chunk, chunks->source + chunks->read, *length);
+    chunks->read += *length;
+    return chunks->chunk;
+}
+
+static int run_chunks(
+    struct dysl* dysl,
+    const char* source,
+    size_t size,
+    int keep_bindings
+) {
+    struct chunks chunks = { source, strlen(source), 0, size, NULL };
+    int status = dysl_run_reader(dysl, read_chunk, &chunks, keep_bindings);
+    free(chunks.chunk);
+    return status;
+}
+
+/* tokens of every kind, long ones spanning many chunks */
+static const char* script =
+    "import math\n"
+    "import serde\n"
+    "# a comment, \"with a string\" in it\n"
+    "def a-rather-long-word-name do 1234567 + end\n"
+    "\"a string literal, long enough to span chunks, \\\"escaped\\\"\" "
+    ".len -> let length\n"
+    "0x1AF 0b101 + 0o17 + 12.375 + 1.5e2 + -> let number\n"
+    "table { :a-symbol-key 3 } :a-symbol-key .get -> let found\n"
+    "&{ 2 * } -> let double\n"
+    "length a-rather-long-word-name number math:floor + found +\n"
+    "double .call serde:->string\n";
+
+static int32_t expected_length(void) {
+    // the script's string, once unescaped
+    return (int32_t)strlen("a string literal, long enough to span chunks, "
+                           "\"escaped\"");
+}
+
+static void check_script(struct dysl* dysl) {
+    size_t length = 0;
+    const char* text = dysl_to_string(dysl, -1, &length);
+    char expected[32];
+    int expected_size = snprintf(expected, sizeof(expected), "%d",
+        (expected_length() + 1234567 + 451 + 12 + 150 + 3) * 2);
+    check(text != NULL && length == (size_t)expected_size &&
+          memcmp(text, expected, length) == 0);
+}
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+
+    check_run(dysl, script, DYSL_OK);
+    check_script(dysl);
+    dysl_pop(dysl, 1);
+    for (size_t size = 1; size <= 9; size++) {
+        check(run_chunks(dysl, script, size, 0) == DYSL_OK);
+        check(dysl_get_top(dysl) == 1);
+        check_script(dysl);
+        dysl_pop(dysl, 1);
+    }
+
+    // errors report the same line, however the script is read
+    const char* broken = "1 2 +\n\"fine\"\ndef do end\n";
+    check_run(dysl, broken, DYSL_ERROR_SYNTAX);
+    char message[DYSL_ERROR_MESSAGE_SIZE];
+    strcpy(message, dysl_error_message(dysl));
+    for (size_t size = 1; size <= 4; size++) {
+        check(run_chunks(dysl, broken, size, 0) == DYSL_ERROR_SYNTAX);
+        check(strcmp(dysl_error_message(dysl), message) == 0);
+        check(!dysl_is_incomplete(dysl));
+    }
+
+    // sources ending inside a construct are incomplete, not wrong
+    const char* incomplete[] = {
+        "def f do 1", "1 2 < if {", "\"an open string", "def",
+        "loop { 1 -> let", "table { :a 1", "-> let",
+    };
+    int all_incomplete = 1;
+    for (size_t i = 0; i < sizeof(incomplete) / sizeof(*incomplete); i++) {
+        all_incomplete &= run_chunks(dysl, incomplete[i], 3, 1)
+                              == DYSL_ERROR_SYNTAX &&
+                          dysl_is_incomplete(dysl);
+    }
+    check(all_incomplete);
+    check_run(dysl, "1 }", DYSL_ERROR_SYNTAX);
+    check(!dysl_is_incomplete(dysl));
+    check_run(dysl, "1 \"a\" +", DYSL_ERROR_RUNTIME);
+    check(!dysl_is_incomplete(dysl));
+    dysl_pop(dysl, dysl_get_top(dysl));
+
+    // as a REPL does, entries keep their bindings for the next ones
+    check(run_chunks(dysl, "def add do + end 10 -> let ten", 4, 1)
+          == DYSL_OK);
+    check(run_chunks(dysl, "ten 5 add -> let fifteen", 4, 1) == DYSL_OK);
+    check(run_chunks(dysl, "fifteen ten add", 4, 1) == DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 25);
+    dysl_pop(dysl, 1);
+    // without keep_bindings, the bindings are dropped
+    check(run_chunks(dysl, "2 -> let two", 4, 0) == DYSL_OK);
+    check(run_chunks(dysl, "two", 4, 1) == DYSL_ERROR_RUNTIME);
+    dysl_pop(dysl, dysl_get_top(dysl));
+    check(run_chunks(dysl, "ten fifteen add", 4, 1) == DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 25);
+
+    dysl_destroy(dysl);
+    return test_done("reader");
+}
@@ -0,0 +1,44 @@
+/* The host's random bits go into the hash seed of every new context and
+ * shared symbol table, see DYSL_HASH_SEED_FN. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_HASH_SEED_FN test_random_bits
+#define DYSL_SHARED_SYMBOLS 1
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+static int calls = 0;
+
+uint64_t test_random_bits(void) {
+    calls++;
+    return 0x0123456789ABCDEFull * (uint64_t)calls;
+}
+
+int main(void) {
+    struct dysl* first = dysl_new(dysl_standard_allocator());
+    check(first != NULL && calls == 1);
+    struct dysl* second = dysl_new(dysl_standard_allocator());
+    check(second != NULL && calls == 2);
+    check(first->global->hash_seed != second->global->hash_seed);
+
+    struct dysl_symbol_table* table = dysl_new_symbol_table(
+        dysl_standard_allocator(), 0
+    );
+    check(table != NULL && calls == 3);
+    // contexts sharing a table hash with its seed
+    struct dysl* shared = dysl_new_with_symbols(dysl_standard_allocator(),
+                                                table);
+    check(shared != NULL);
+    check(shared->global->hash_seed == table->hash_seed);
+
+    check_run(first, "table { :a 1 :b 2 } :b .get", DYSL_OK);
+    check(dysl_to_integer(first, -1) == 2);
+    check_run(shared, "def twice do 2 * end 21 twice", DYSL_OK);
+    check(dysl_to_integer(shared, -1) == 42);
+
+    dysl_destroy(shared);
+    dysl_symbol_table_destroy(table);
+    dysl_destroy(second);
+    dysl_destroy(first);
+    return test_done("seed");
+}
@@ -0,0 +1,47 @@
+/* With DYSL_NO_DYNAMIC_SCOPE_SHADOWING, the compiler rejects the bindings
+ * lookups would not see, instead of running them. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_NO_DYNAMIC_SCOPE_SHADOWING 1
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+static void answer(struct dysl* dysl) {
+    dysl_push_integer(dysl, 42);
+}
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+    dysl_register(dysl, "answer", answer);
+
+    // bound where the second binding is made
+    check_run(dysl, "1 -> let x 2 -> let x", DYSL_ERROR_SYNTAX);
+    check_run(dysl, "1 -> let x def f do 2 -> let x end", DYSL_ERROR_SYNTAX);
+    check_run(dysl, "def f do 1 end def f do 2 end", DYSL_ERROR_SYNTAX);
+    check_run(dysl, "def f do 1 -> let f end", DYSL_ERROR_SYNTAX);
+    check_run(dysl, "true if { 1 -> let x } 2 -> let x", DYSL_ERROR_SYNTAX);
+    check_run(dysl, "1 -> let x 1 3 for { -> let x }", DYSL_ERROR_SYNTAX);
+    // bound by the host, or a module
+    check_run(dysl, "1 -> let answer", DYSL_ERROR_SYNTAX);
+    check_run(dysl, "def io:print do end", DYSL_ERROR_SYNTAX);
+    check(dysl_get_top(dysl) == 0);
+
+    // loops and procedures drop their bindings, so these never shadow
+    check_run(dysl,
+        "0 -> let sum\n"
+        "1 3 for { -> let i sum i + -> sum }\n"
+        "1 3 for { -> let i sum i + -> sum }\n"
+        "def f do -> let n n n * end def g do -> let n n 1 + end\n"
+        "3 f 3 g + sum + answer +", DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 67);
+    dysl_pop(dysl, 1);
+    // and the script's own are gone once it returns
+    check_run(dysl, "1 -> let x 2 -> x x", DYSL_OK);
+    check_run(dysl, "3 -> let x x", DYSL_OK);
+    check(dysl_to_integer(dysl, -1) == 3);
+
+    dysl_destroy(dysl);
+    return test_done("shadowing");
+}
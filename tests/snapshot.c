@@ -0,0 +1,118 @@
+/* Snapshots: contexts made from one start where the snapshotted context
+ * was, and go on independently of it and of each other. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+struct chunk {
+    const char* source;
+    int done;
+};
+
+static const char* read_once(void* user_data, size_t* length) {
+    struct chunk* chunk = (struct chunk*)user_data;
+    if (chunk->done)
+        return NULL;
+    chunk->done = 1;
+    *length = strlen(chunk->source);
+    return chunk->source;
+}
+
+static void answer(struct dysl* dysl) {
+    dysl_push_integer(dysl, 42);
+}
+
+static int released = 0;
+
+static void release(void* user_data, const char* data, size_t length) {
+    (void)user_data;
+    (void)data;
+    (void)length;
+    released++;
+}
+
+static const char external[] =
+    "host bytes, long enough to be left out of the short string table";
+
+int main(void) {
+    struct dysl* prelude = dysl_new(dysl_standard_allocator());
+    check(prelude != NULL);
+    dysl_open_modules(prelude);
+    dysl_register(prelude, "answer", answer);
+    // words kept in the environment, and values left on the stack
+    struct chunk words = {
+        "import math\n"
+        "def square do dup * end\n"
+        "def magnitude do math:abs answer + end\n",
+        0
+    };
+    check(dysl_run_reader(prelude, read_once, &words, 1) == DYSL_OK);
+    check_run(prelude,
+        "table { :count 0 :name \"a name too long to be interned as short\" }"
+        " array { 1 2 3 }", DYSL_OK);
+    dysl_push_external_string(prelude, external, sizeof(external) - 1,
+                              release, NULL);
+    dysl_push_builder(prelude);
+    dysl_append_string(prelude, -1, "built", 5);
+
+    struct dysl_snapshot* snapshot = dysl_snapshot(prelude);
+    check(snapshot != NULL);
+    check(dysl_get_top(prelude) == 4);
+    dysl_destroy(prelude);
+    // snapshots copy external strings, only the prelude's copy is released
+    check(released == 1);
+
+    struct dysl* first = dysl_new_from_snapshot(snapshot,
+                                                dysl_standard_allocator());
+    struct dysl* second = dysl_new_from_snapshot(snapshot,
+                                                 dysl_standard_allocator());
+    check(first != NULL && second != NULL);
+    check(dysl_get_top(first) == 4 && dysl_get_top(second) == 4);
+    size_t length = 0;
+    const char* text = dysl_to_string(first, 2, &length);
+    check(text != NULL && length == sizeof(external) - 1 &&
+          memcmp(text, external, length) == 0);
+    text = dysl_to_string(first, 3, &length);
+    check(text != NULL && length == 5 && memcmp(text, "built", 5) == 0);
+
+    // the words, natives and modules came along
+    check_run(first, "7 square -8 magnitude +", DYSL_OK);
+    check(dysl_to_integer(first, -1) == 49 + 50);
+    dysl_pop(first, 1);
+    check_run(second, "import math 2.5 math:ceil answer +", DYSL_OK);
+    check(dysl_to_integer(second, -1) == 45);
+    dysl_pop(second, 1);
+
+    // changes to one context's values are its own
+    dysl_push_symbol(first, "count", 5);
+    dysl_push_integer(first, 7);
+    dysl_set(first, 0);
+    dysl_push_integer(first, 10);
+    dysl_append(first, 1);
+    dysl_append_string(first, 3, " more", 5);
+    dysl_push_symbol(second, "count", 5);
+    dysl_get(second, 0);
+    check(dysl_to_integer(second, -1) == 0);
+    dysl_pop(second, 1);
+    check(dysl_length(first, 1) == 4 && dysl_length(second, 1) == 3);
+    check(dysl_length(first, 3) == 10 && dysl_length(second, 3) == 5);
+
+    // and contexts made later still start from the snapshot
+    dysl_destroy(first);
+    struct dysl* third = dysl_new_from_snapshot(snapshot,
+                                                dysl_standard_allocator());
+    check(third != NULL);
+    dysl_push_symbol(third, "count", 5);
+    dysl_get(third, 0);
+    check(dysl_to_integer(third, -1) == 0);
+    dysl_gc_collect(third);
+    check_run(third, "9 square", DYSL_OK);
+    check(dysl_to_integer(third, -1) == 81);
+
+    dysl_destroy(third);
+    dysl_destroy(second);
+    dysl_snapshot_destroy(snapshot);
+    check(released == 1);
+    return test_done("snapshot");
+}
@@ -0,0 +1,42 @@
+/* Checks shared by the tests. Each test is its own program, which includes
+ * dysl with the tests' configuration, runs its checks and exits nonzero if
+ * any failed. */
+#ifndef DYSL_TEST_H
+#define DYSL_TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+/** Reports a failed check, with where it failed, and carries on. */
+#define check(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", \
+                    __FILE__, __LINE__, #condition); \
+            test_failures++; \
+        } \
+    } while (0)
+
+/** Checks that running `source` returns `expected`, printing the error
+ * message if it does not. */
+#define check_run(dysl, source, expected) \
+    do { \
+        int check_status = dysl_run((dysl), (source), strlen(source)); \
+        if (check_status != (expected)) { \
+            fprintf(stderr, "%s:%d: running `%s` returned %d, not %d: %s\n", \
+                    __FILE__, __LINE__, (source), check_status, \
+                    (expected), dysl_error_message(dysl)); \
+            test_failures++; \
+        } \
+    } while (0)
+
+/** The exit status of a test: 0 if every check passed. */
+static int test_done(const char* name) {
+    if (test_failures > 0)
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+    return test_failures > 0;
+}
+
+#endif /* DYSL_TEST_H */
@@ -0,0 +1,175 @@
+/* Runs contexts on many threads at once, one per worker as a server would.
+ * Contexts made with `dysl_new()` must share no mutable state, and those
+ * made with `dysl_new_with_symbols()` intern into one table concurrently.
+ * `make test` builds this with DYSL_SHARED_SYMBOLS under ThreadSanitizer,
+ * which reports any race between them. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+#include <pthread.h>
+
+#define THREADS 64
+/* more names than the shared table holds, so some fall back to the
+ * contexts' own tables */
+#define NAMES 384
+#define SHARED_CAPACITY 256
+
+/* tables, arrays, strings, words and enough garbage to collect */
+static const char* workload =
+    "def make do -> let id table { :id id :score id 7 % } end\n"
+    "array { } -> let records\n"
+    "1 2000 for { -> let i records i make .push }\n"
+    "0 -> let total\n"
+    "1 records .len for { -> let i\n"
+    "  total records i .get :score .get + -> total\n"
+    "}\n"
+    "\"\" -> let s 1 300 for { -> let i s \"ab\" + -> s }\n"
+    "total s .len +\n";
+
+struct worker {
+    pthread_t thread;
+    int id;
+    int32_t result;
+    int failed;
+    struct dy_symbol* symbols[NAMES];
+    int shared[NAMES];
+};
+
+static struct dysl_symbol_table* table;
+
+static int run_workload(struct dysl* dysl, int32_t* result) {
+    if (dysl_run(dysl, workload, strlen(workload)) != DYSL_OK)
+        return 0;
+    *result = dysl_to_integer(dysl, -1);
+    dysl_pop(dysl, 1);
+    return 1;
+}
+
+static void* run_private(void* argument) {
+    struct worker* worker = (struct worker*)argument;
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    if (dysl == NULL || !run_workload(dysl, &worker->result))
+        worker->failed = 1;
+    if (dysl != NULL)
+        dysl_destroy(dysl);
+    return NULL;
+}
+
+static struct dy_symbol* intern(struct dysl* dysl, int n) {
+    char name[32];
+    int length = snprintf(name, sizeof(name), "name-%d", n);
+    dysl_push_symbol(dysl, name, (size_t)length);
+    struct dy_value* top = dS_index(dysl, -1);
+    struct dy_symbol* sym = dV_is(*top, DYSL_TYPE_SYMBOL)
+        ? dV_symbol(*top)
+        : NULL;
+    dysl_pop(dysl, 1);
+    return sym;
+}
+
+static void* run_shared(void* argument) {
+    struct worker* worker = (struct worker*)argument;
+    struct dysl* dysl = dysl_new_with_symbols(dysl_standard_allocator(),
+                                              table);
+    if (dysl == NULL) {
+        worker->failed = 1;
+        return NULL;
+    }
+    // each worker starts at a different name, so they race on all of them
+    for (int k = 0; k < NAMES; k++) {
+        int n = (k + worker->id * 7) % NAMES;
+        struct dy_symbol* sym = intern(dysl, n);
+        worker->symbols[n] = sym;
+        worker->shared[n] = sym != NULL &&
+                            (sym->header.tag & DYSL_TAG_SHARED) != 0;
+        if (sym == NULL || intern(dysl, n) != sym)
+            worker->failed = 1;
+    }
+    // binding shared names bumps their versions from every thread
+    const char* shadowing =
+        "def name-1 do 1 end 2 -> let name-2\n"
+        "1 50 for { -> let name-3 name-1 name-2 + -> name-2 }\n"
+        "name-2";
+    if (dysl_run(dysl, shadowing, strlen(shadowing)) != DYSL_OK ||
+        dysl_to_integer(dysl, -1) != 52)
+        worker->failed = 1;
+    dysl_pop(dysl, 1);
+    if (!run_workload(dysl, &worker->result))
+        worker->failed = 1;
+    dysl_destroy(dysl);
+    return NULL;
+}
+
+static void run_workers(struct worker* workers, void* (*body)(void*)) {
+    for (int t = 0; t < THREADS; t++) {
+        workers[t].id = t;
+        workers[t].failed = 0;
+        check(pthread_create(&workers[t].thread, NULL, body,
+                             &workers[t]) == 0);
+    }
+    for (int t = 0; t < THREADS; t++)
+        pthread_join(workers[t].thread, NULL);
+}
+
+static struct worker workers[THREADS];
+
+int main(void) {
+    int32_t expected = 0;
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL && run_workload(dysl, &expected));
+    dysl_destroy(dysl);
+
+    run_workers(workers, run_private);
+    for (int t = 0; t < THREADS; t++) {
+        check(!workers[t].failed);
+        check(workers[t].result == expected);
+    }
+
+    table = dysl_new_symbol_table(dysl_standard_allocator(),
+                                  SHARED_CAPACITY);
+    check(table != NULL);
+    run_workers(workers, run_shared);
+    int shared = 0;
+    for (int n = 0; n < NAMES; n++) {
+        // a name in the shared table is the same symbol everywhere
+        struct dy_symbol* first = NULL;
+        for (int t = 0; t < THREADS; t++) {
+            if (!workers[t].shared[n])
+                continue;
+            if (first == NULL)
+                first = workers[t].symbols[n];
+            check(workers[t].symbols[n] == first);
+        }
+        shared += first != NULL;
+    }
+    check(shared > 0 && shared <= SHARED_CAPACITY);
+    for (int t = 0; t < THREADS; t++) {
+        check(!workers[t].failed);
+        check(workers[t].result == expected);
+    }
+    dysl_symbol_table_destroy(table);
+
+    // a name refused while another thread's claim fills the table stays
+    // the context's own symbol once the claim is given back and another
+    // context shares the name
+    table = dysl_new_symbol_table(dysl_standard_allocator(), 16);
+    check(table != NULL);
+    struct dysl* refused = dysl_new_with_symbols(dysl_standard_allocator(),
+                                                 table);
+    struct dysl* other = dysl_new_with_symbols(dysl_standard_allocator(),
+                                               table);
+    check(refused != NULL && other != NULL);
+    size_t count = table->count;
+    table->count = table->limit;
+    struct dy_symbol* own = intern(refused, NAMES);
+    check(own != NULL && (own->header.tag & DYSL_TAG_SHARED) == 0);
+    table->count = count;
+    struct dy_symbol* sym = intern(other, NAMES);
+    check(sym != NULL && (sym->header.tag & DYSL_TAG_SHARED) != 0);
+    check(intern(refused, NAMES) == own);
+    dysl_destroy(refused);
+    dysl_destroy(other);
+    dysl_symbol_table_destroy(table);
+    return test_done("threads");
+}
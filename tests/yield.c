@@ -0,0 +1,105 @@
+/* Threads of one context, suspended by a native and resumed by the host,
+ * interleaved with each other and with collections. */
+#define DYSL_CONFIG_FILE "tests/dysl-config.h"
+#define DYSL_IMPLEMENTATION 1
+#include "../dysl.h"
+#include "test.h"
+
+/* leaves its argument to the host, and returns what the host pushes */
+static void wait_for_host(struct dysl* dysl) {
+    dysl_yield(dysl);
+}
+
+static int nested_status = DYSL_OK;
+
+/* natives called from a native's script cannot yield, which is an error */
+static void nested(struct dysl* dysl) {
+    nested_status = dysl_run(dysl, "1 wait", 6);
+}
+
+/* the thread's generator: hands out i, gets back a multiplier */
+static const char* generator =
+    "import serde\n"
+    "0 -> let total\n"
+    "\"a prefix long enough not to be an interned string\" -> let text\n"
+    "1 5 for { -> let i\n"
+    "  i wait -> let factor\n"
+    "  total i factor * + -> total\n"
+    "  text i serde:->string + -> text\n"
+    "}\n"
+    "total text .len\n";
+
+static struct dysl* new_thread(struct dysl* dysl) {
+    struct dysl* thread = dysl_new_thread(dysl);
+    check(thread != NULL);
+    dysl_register(thread, "wait", wait_for_host);
+    dysl_register(thread, "nested", nested);
+    return thread;
+}
+
+/* answers the thread's yield with `factor` */
+static int answer(struct dysl* thread, int32_t expected, int32_t factor) {
+    int ok = dysl_is_suspended(thread) &&
+             dysl_get_top(thread) >= 1 &&
+             dysl_to_integer(thread, -1) == expected;
+    dysl_pop(thread, 1);
+    dysl_push_integer(thread, factor);
+    return ok;
+}
+
+int main(void) {
+    struct dysl* dysl = dysl_new(dysl_standard_allocator());
+    check(dysl != NULL);
+    dysl_open_modules(dysl);
+    struct dysl* first = new_thread(dysl);
+    struct dysl* second = new_thread(dysl);
+
+    check_run(first, generator, DYSL_YIELD);
+    check_run(second, generator, DYSL_YIELD);
+    int answered = 1;
+    for (int32_t i = 1; i <= 5; i++) {
+        answered &= answer(first, i, 10);
+        answered &= answer(second, i, 100);
+        // collect while both are suspended, with garbage from a third
+        check_run(dysl, "1 100 for { -> let i table { :i i } drop }",
+                  DYSL_OK);
+        dysl_gc_collect(dysl);
+        int expected = i < 5 ? DYSL_YIELD : DYSL_OK;
+        check(dysl_resume(first) == expected);
+        check(dysl_resume(second) == expected);
+    }
+    check(answered);
+    check(!dysl_is_suspended(first) && !dysl_is_suspended(second));
+    check(dysl_get_top(first) == 2 && dysl_get_top(second) == 2);
+    check(dysl_to_integer(first, 0) == 150);
+    check(dysl_to_integer(second, 0) == 1500);
+    check(dysl_to_integer(first, 1) == 49 + 5);
+    check(dysl_to_integer(second, 1) == 49 + 5);
+    dysl_pop(first, 2);
+    dysl_pop(second, 2);
+
+    // only suspended states resume, and only outermost natives yield
+    check(dysl_resume(first) == DYSL_ERROR_RUNTIME);
+    check_run(first, "nested 5", DYSL_ERROR_RUNTIME);
+    check(nested_status == DYSL_ERROR_RUNTIME);
+    check(!dysl_is_suspended(first));
+    dysl_pop(first, dysl_get_top(first));
+
+    // errors after a resume end the run, and the thread runs again
+    check_run(first, "wait 1 +", DYSL_YIELD);
+    dysl_pop(first, dysl_get_top(first));
+    dysl_push_string(first, "not a number", 12);
+    check(dysl_resume(first) == DYSL_ERROR_RUNTIME);
+    check(!dysl_is_suspended(first));
+    dysl_pop(first, dysl_get_top(first));
+    check_run(first, "2 3 *", DYSL_OK);
+    check(dysl_to_integer(first, -1) == 6);
+
+    // suspended threads are destroyed, alone or with their context
+    check_run(first, "1 wait", DYSL_YIELD);
+    check_run(second, "2 wait", DYSL_YIELD);
+    dysl_destroy(first);
+    dysl_gc_collect(dysl);
+    dysl_destroy(dysl);
+    return test_done("yield");
+}